@@ -5,6 +5,8 @@
  **  1) reads parameters from an xml file (specified as the first argument)\n
  **  2) creates the network\n
  **  3) launches the simulation\n
+ **  With a sweep specification, it runs the simulation of each set of parameters of the
+ **  sweep in a child process of its own instead (see Sweep).
  **
  **  @authors Allan Ortiz and Cory Mayberry.
  **/
@@ -15,6 +17,7 @@
 #include <assert.h>
 #include <time.h>
 #include <deque>
+#include <map>
 #include <ctime>
 
 #include "global.h"
@@ -24,6 +27,9 @@
 #include "DynamicSpikingSynapse.h"
 #include "LifNeuron.h"
 #include "Network.h"
+#include "LaneSim.h"
+#include "Sweep.h"
+#include "Thread.h"
 
 using namespace std;
 
@@ -39,6 +45,46 @@ string memInputFileName;
 bool fReadMemImage = false; // True if dumped memory image is read before starting simulation
 bool fWriteMemImage = false; // True if dumped memory image is written after simulation
 
+// spike output file name
+string spikeOutputFileName;
+bool fWriteSpikes = false; // True if spikes are streamed to a file during simulation
+
+// growth output file name
+string growthOutputFileName;
+bool fWriteGrowth = false; // True if radii and rates are streamed to a file during simulation
+
+// history file name; if given, radii and rates history are kept on disk instead of in memory
+string historyFileName;
+
+// checkpoint file name; if given, checkpoints of the running simulation are written to it
+string checkpointFileName;
+int checkpointInterval = 0; // Number of growth steps between checkpoints
+int checkpointBaseInterval = 1; // Number of checkpoints between full checkpoints
+
+// checkpoint file name to resume a simulation from
+string resumeFileName;
+
+// number of activity-only replicas of the network of the memory image to run; 0 if not an ensemble
+int cReplicas = 0;
+
+// number of replicas of an ensemble each process runs in lockstep, in the lanes of a LaneSim
+int cLanes = 1;
+
+// sweep specification file name; if given, the runs of the sweep are simulated instead
+string sweepFileName;
+int cJobs = 0; // Number of runs of a sweep simulated at a time; 0 runs one per core
+
+// state output format
+bool fBinaryState = false; // True if the state is written as a binary state file instead of XML
+bool fPackOutput = false; // True if binary output files are packed (compressed)
+
+// simulation engine options
+bool fInputRingBuffers = false; // True if delayed input is delivered through per-target ring buffers
+neuronOrder order = ROW_MAJOR; // Order in which neurons are stored internally
+#if defined(USE_GPU)
+int deviceId = 0; // CUDA device ID
+#endif // USE_GPU
+
 // Parameters for LSM
 int poolsize[3]; // size of pool of neurons [x y z]
 FLOAT frac_EXC; // Fraction of excitatory neurons
@@ -64,6 +110,9 @@ FLOAT minRadius; // To ensure that even rapidly-firing neurons will connect to
 // other neurons, when within their RFS.
 FLOAT startRadius; // No need to wait a long time before RFs start to overlap
 
+// Parameters for synapses
+FLOAT conductionVelocity = 0; // Axonal conduction velocity (grid units/s); 0 = fixed per-type delays
+
 // Simulation Parameters
 FLOAT Tsim; // Simulation time (s) (between growth updates)
 int numSims; // Number of Tsim simulation to run
@@ -76,6 +125,8 @@ void SaveSimState(ostream &);
 void printParams();
 bool parseCommandLine(int argc, char* argv[]);
 void getValueList(const string& valString, vector<int>* pList);
+void loadRunParms(TiXmlElement* pBase, const Sweep& sweep, int run);
+int runSweep(TiXmlElement* pBase, const NeuronDistances** ppDistances, int* pThreads);
 
 int main(int argc, char* argv[]) {
 
@@ -97,15 +148,31 @@ int main(int argc, char* argv[]) {
 		return -1;
 	}
 
-	// aquire the in/out file
-	ofstream state_out( stateOutputFileName.c_str( ) );
+	// each run of a sweep continues from here in a child process of its own, with its
+	// parameters and output files; the parent only waits for the runs
+	const NeuronDistances* pDistances = NULL;
+	int cThreads = 0;
+	if (!sweepFileName.empty()) {
+		runSweep( simDoc.FirstChildElement( "SimParams" ), &pDistances, &cThreads );
+	}
+
+	// aquire the in/out file; the replicas of an ensemble open files of their own
+	bool fEnsemble = cReplicas > 0;
+	ofstream state_out;
+	if (!fEnsemble) {
+		state_out.open( stateOutputFileName.c_str( ), fBinaryState ? ofstream::out | ofstream::binary : ofstream::out );
+	}
 	ofstream memory_out;
-	if (fWriteMemImage) {
+	if (fWriteMemImage && !fEnsemble) {
 		memory_out.open( memOutputFileName.c_str( ), ofstream::binary | ofstream::trunc );
 	}
-	ifstream memory_in;
-	if (fReadMemImage) {
-		memory_in.open( memInputFileName.c_str( ), ofstream::binary | ofstream::in );
+	ofstream spike_out;
+	if (fWriteSpikes && !fEnsemble) {
+		spike_out.open( spikeOutputFileName.c_str( ), ofstream::binary | ofstream::trunc );
+	}
+	ofstream growth_out;
+	if (fWriteGrowth && !fEnsemble) {
+		growth_out.open( growthOutputFileName.c_str( ), ofstream::binary | ofstream::trunc );
 	}
 
 	// calculate the number of inhibitory, excitory, and endogenously active neurons
@@ -125,17 +192,36 @@ int main(int argc, char* argv[]) {
 	// create the network
 	Network network( poolsize[0], poolsize[1], inhFrac, excFrac, startFrac, Iinject, Inoise, Vthresh, Vresting, Vreset,
 			Vinit, starter_vthresh, starter_vreset, epsilon, beta, rho, targetRate, maxRate, minRadius, startRadius,
-			DEFAULT_dt, state_out, memory_out, fWriteMemImage, memory_in, fReadMemImage, fFixedLayout, &endogenouslyActiveNeuronLayout, &inhibitoryNeuronLayout);
+			DEFAULT_dt, conductionVelocity, state_out, memory_out, fWriteMemImage, memInputFileName, fReadMemImage, fFixedLayout, &endogenouslyActiveNeuronLayout, &inhibitoryNeuronLayout,
+			fInputRingBuffers, order, spike_out, fWriteSpikes, growth_out, fWriteGrowth, historyFileName, fBinaryState,
+			fPackOutput, checkpointFileName, checkpointInterval, checkpointBaseInterval, resumeFileName,
+			cReplicas, cLanes, stateOutputFileName, memOutputFileName, spikeOutputFileName, growthOutputFileName);
+#if defined(USE_GPU)
+	network.m_context.deviceId = deviceId;
+#endif // USE_GPU
+	network.m_cThreads = cThreads;
+	network.m_pDistances = pDistances;
 
 	time_t start_time, end_time;
 	time(&start_time);
 
-	network.simulate( Tsim, numSims, maxFiringRate, maxSynapsesPerNeuron );
+	try {
+		network.simulate( Tsim, numSims, maxFiringRate, maxSynapsesPerNeuron );
+	} catch (KII_exception& e) {
+		cerr << "Simulation failed:\n\t" << e.what( ) << endl;
+		return -1;
+	}
+
+	// the parent of an ensemble reports the time of all of its replicas
+	if (network.m_replica >= 0) {
+		exit( EXIT_SUCCESS );
+	}
 
 	time(&end_time);
 	double time_elapsed = difftime(end_time, start_time);
-	double ssps = Tsim * numSims / time_elapsed;
-	cout << "time simulated: " << Tsim * numSims << endl;
+	int cRuns = fEnsemble ? cReplicas : 1;
+	double ssps = Tsim * numSims * cRuns / time_elapsed;
+	cout << "time simulated: " << Tsim * numSims * cRuns << endl;
 	cout << "time elapsed: " << time_elapsed << endl;
 	cout << "ssps (simulation seconds / real time seconds): " << ssps << endl;
 
@@ -143,8 +229,11 @@ int main(int argc, char* argv[]) {
 	if (fWriteMemImage) {
 		memory_out.close();		
 	}
-	if (fReadMemImage) {
-		memory_in.close();
+	if (fWriteSpikes) {
+		spike_out.close();
+	}
+	if (fWriteGrowth) {
+		growth_out.close();
 	}
 
 	exit( EXIT_SUCCESS );
@@ -166,6 +255,7 @@ void printParams() {
 	cout << "Growth parameters: " << endl << "\tepsilon: " << epsilon << ", beta: " << beta << ", rho: " << rho
 			<< ", targetRate: " << targetRate << ",\n\tminRadius: " << minRadius << ", startRadius: " << startRadius
 			<< endl;
+	cout << "Synapse parameters: " << endl << "\tconductionVelocity: " << conductionVelocity << endl;
 	cout << "Simulation Parameters:\n";
 	cout << "\tTime between growth updates (in seconds): " << Tsim << endl;
 	cout << "\tNumber of simulations to run: " << numSims << endl;
@@ -380,6 +470,24 @@ void LoadSimParms(TiXmlElement* parms)
 		cerr << "missing GrowthParams" << endl;
 	}
 
+	// Synapse parameters are optional; without them the fixed per-type delays are used
+	if (( temp = parms->FirstChildElement( "SynapseParams" ) ) != NULL) {
+		if (temp->QueryFLOATAttribute("conductionVelocity", &conductionVelocity ) != TIXML_SUCCESS
+				|| conductionVelocity < 0) {
+			fSet = false;
+			cerr << "error conductionVelocity" << endl;
+		} else if (conductionVelocity > 0) {
+			// the delay of the longest connection, corner to corner, must fit in the delay queue
+			FLOAT maxDist = sqrt( static_cast<FLOAT>( ( poolsize[0] - 1 ) * ( poolsize[0] - 1 ) + ( poolsize[1] - 1 ) * ( poolsize[1] - 1 ) ) );
+			FLOAT maxDelay = DynamicSpikingSynapse::maxAxonalDelay( DEFAULT_dt );
+			if (maxDist / conductionVelocity >= maxDelay) {
+				fSet = false;
+				cerr << "error conductionVelocity: the delay of the longest connection does not fit in the delay queue of "
+					<< MAX_LENGTH_OF_DELAYQUEUE << " steps; it needs a velocity above " << maxDist / maxDelay << endl;
+			}
+		}
+	}
+
 	if (( temp = parms->FirstChildElement( "SimParams" ) ) != NULL) {
 		if (temp->QueryFLOATAttribute("Tsim", &Tsim ) != TIXML_SUCCESS) {
 			fSet = false;
@@ -437,6 +545,135 @@ void LoadSimParms(TiXmlElement* parms)
 	if (!fSet) throw KII_exception( "Failed to initialize one or more simulation parameters; check XML" );
 }
 
+/**
+ * Load the parameters of a run of a sweep: the base parameters with those of the run set.
+ * @param[in] pBase	The SimParams of the base configuration.
+ * @param[in] sweep	The sweep.
+ * @param[in] run	The run.
+ * @throws KII_exception if a parameter of the run is missing or invalid.
+ */
+void loadRunParms(TiXmlElement* pBase, const Sweep& sweep, int run)
+{
+	TiXmlElement parms( *pBase );
+	sweep.apply( run, &parms );
+
+	// parameters that LoadSimParms() adds to, or that are optional, start as they do in a new process
+	endogenouslyActiveNeuronLayout.clear();
+	inhibitoryNeuronLayout.clear();
+	conductionVelocity = 0;
+	LoadSimParms( &parms );
+}
+
+/**
+ * Run the simulations of a sweep.  The parameters of every run are checked first, and the
+ * distances between the neurons are computed once for each size of network of the sweep;
+ * then each run is simulated in a child process (see Sweep::forkRuns()), which returns from
+ * this function with the parameters of its run loaded and its output files named for it.
+ * The parent writes the index of the sweep once all runs are done, and exits.
+ * @param[in] pBase	The SimParams of the base configuration.
+ * @param[out] ppDistances	Receives the distances between the neurons of the network of the run.
+ * @param[out] pThreads	Receives the number of threads that simulate the run.
+ * @return the run to simulate (in a child).
+ */
+int runSweep(TiXmlElement* pBase, const NeuronDistances** ppDistances, int* pThreads)
+{
+	Sweep sweep;
+	string baseStateOutputFileName = stateOutputFileName;
+	vector<double> rgCost;
+	map<pair<int, int>, NeuronDistances*> distances;
+
+	try {
+		sweep.load( sweepFileName );
+		for (int run = 0; run < sweep.getRuns( ); run++) {
+			loadRunParms( pBase, sweep, run );
+			rgCost.push_back( static_cast<double>( poolsize[0] ) * poolsize[1] * Tsim * numSims );
+			distances[make_pair( poolsize[0], poolsize[1] )] = NULL;
+		}
+	} catch (KII_exception& e) {
+		cerr << "Failure loading sweep " << sweepFileName << ":\n\t" << e.what( ) << endl;
+		exit( -1 );
+	}
+
+	// the immutable data of the runs is computed once, and shared with the runs by fork()
+	for (map<pair<int, int>, NeuronDistances*>::iterator it = distances.begin( ); it != distances.end( ); ++it) {
+		cout << "Computing the distances between the neurons of a " << it->first.first << "x" << it->first.second
+				<< " network" << endl;
+		it->second = Network::computeDistances( it->first.first, it->first.second );
+	}
+
+	int cCores = Thread::hardwareConcurrency( );
+	int jobs = cJobs > 0 ? cJobs : cCores;
+	jobs = min( jobs, sweep.getRuns( ) );
+	cout << "Sweep of " << sweep.getRuns( ) << " runs, " << jobs << " at a time" << endl;
+
+	time_t start_time, end_time;
+	time(&start_time);
+
+	int run;
+	try {
+		run = sweep.forkRuns( rgCost, jobs );
+	} catch (KII_exception& e) {
+		cerr << "Sweep failed:\n\t" << e.what( ) << endl;
+		exit( -1 );
+	}
+
+	if (run >= 0) {
+		loadRunParms( pBase, sweep, run );
+		*ppDistances = distances[make_pair( poolsize[0], poolsize[1] )];
+		*pThreads = max( 1, cCores / jobs );
+
+		stateOutputFileName = Sweep::runFileName( stateOutputFileName, run );
+		if (fWriteMemImage) {
+			memOutputFileName = Sweep::runFileName( memOutputFileName, run );
+		}
+		if (fWriteSpikes) {
+			spikeOutputFileName = Sweep::runFileName( spikeOutputFileName, run );
+		}
+		if (fWriteGrowth) {
+			growthOutputFileName = Sweep::runFileName( growthOutputFileName, run );
+		}
+		if (!historyFileName.empty()) {
+			historyFileName = Sweep::runFileName( historyFileName, run );
+		}
+		cout << "Run " << run << " writes " << stateOutputFileName << endl;
+		return run;
+	}
+
+	time(&end_time);
+	cout << "time elapsed: " << difftime(end_time, start_time) << endl;
+
+	// the index of the sweep lists the parameters, the output files and the outcome of each run
+	vector<pair<string, string> > rgOutput;
+	rgOutput.push_back( make_pair( string( "stateOutputFileName" ), baseStateOutputFileName ) );
+	if (fWriteMemImage) {
+		rgOutput.push_back( make_pair( string( "memOutputFileName" ), memOutputFileName ) );
+	}
+	if (fWriteSpikes) {
+		rgOutput.push_back( make_pair( string( "spikeOutputFileName" ), spikeOutputFileName ) );
+	}
+	if (fWriteGrowth) {
+		rgOutput.push_back( make_pair( string( "growthOutputFileName" ), growthOutputFileName ) );
+	}
+	if (!historyFileName.empty()) {
+		rgOutput.push_back( make_pair( string( "historyFileName" ), historyFileName ) );
+	}
+	string indexFileName = Sweep::indexFileName( baseStateOutputFileName );
+	ofstream index_out( indexFileName.c_str( ) );
+	sweep.writeIndex( index_out, stateInputFileName, rgOutput );
+	index_out.close( );
+	cout << "Sweep index written to " << indexFileName << endl;
+
+	for (map<pair<int, int>, NeuronDistances*>::iterator it = distances.begin( ); it != distances.end( ); ++it) {
+		delete it->second;
+	}
+
+	if (sweep.getFailed( ) > 0) {
+		cerr << sweep.getFailed( ) << " of " << sweep.getRuns( ) << " runs failed" << endl;
+		exit( -1 );
+	}
+	exit( EXIT_SUCCESS );
+}
+
 void getValueList(const string& valString, vector<int>* pList)
 {
     std::istringstream valStream(valString);
@@ -461,7 +698,16 @@ bool parseCommandLine(int argc, char* argv[])
 			|| ( cl.addParam( "stateinfile", 't', ParamContainer::filename | ParamContainer::required, "simulation state input filename" ) != ParamContainer::errOk )
 			|| ( cl.addParam( "deviceid", 'd', ParamContainer::regular, "CUDA device id" ) != ParamContainer::errOk )
 			|| ( cl.addParam( "meminfile", 'r', ParamContainer::filename, "simulation memory image input filename" ) != ParamContainer::errOk )
-			|| ( cl.addParam( "memoutfile", 'w', ParamContainer::filename, "simulation memory image output filename" ) != ParamContainer::errOk )) {
+			|| ( cl.addParam( "memoutfile", 'w', ParamContainer::filename, "simulation memory image output filename" ) != ParamContainer::errOk )
+			|| ( cl.addParam( "spikeoutfile", 's', ParamContainer::filename, "binary spike output filename" ) != ParamContainer::errOk )
+			|| ( cl.addParam( "growthoutfile", 'g', ParamContainer::filename, "binary radii and rates output filename" ) != ParamContainer::errOk )
+			|| ( cl.addParam( "historyfile", 'y', ParamContainer::filename, "keep radii and rates history in files with this name (.radii/.rates) instead of memory" ) != ParamContainer::errOk )
+			|| ( cl.addParam( "stateformat", 'f', ParamContainer::regular, "simulation state output format: xml (default) or binary" ) != ParamContainer::errOk )
+			|| ( cl.addParam( "pack", 'z', ParamContainer::novalue, "compress checkpoints, memory images, binary state files and the spike file" ) != ParamContainer::errOk )
+			|| ( cl.addParam( "checkpointfile", 'c', ParamContainer::filename, "write checkpoints of the running simulation to this file" ) != ParamContainer::errOk )
+			|| ( cl.addParam( "checkpointinterval", 'k', ParamContainer::regular, "number of growth steps between checkpoints (default 1)" ) != ParamContainer::errOk )
+			|| ( cl.addParam( "checkpointbase", 'b', ParamContainer::regular, "write every n-th checkpoint in full and the others as deltas (default 1)" ) != ParamContainer::errOk )
+			|| ( cl.addParam( "resumefile", 'u', ParamContainer::filename, "resume the simulation from this checkpoint" ) != ParamContainer::errOk )) {
 		cerr << "Internal error creating command line parser" << endl;
 		return false;
 	}
@@ -469,7 +715,22 @@ bool parseCommandLine(int argc, char* argv[])
 	if (( cl.addParam( "stateoutfile", 'o', ParamContainer::filename, "simulation state output filename" ) != ParamContainer::errOk ) 
 			|| ( cl.addParam( "stateinfile", 't', ParamContainer::filename | ParamContainer::required, "simulation state input filename" ) != ParamContainer::errOk ) 
 			|| ( cl.addParam( "meminfile", 'r', ParamContainer::filename, "simulation memory image filename" ) != ParamContainer::errOk )
-			|| ( cl.addParam( "memoutfile", 'w', ParamContainer::filename, "simulation memory image output filename" ) != ParamContainer::errOk )) {
+			|| ( cl.addParam( "memoutfile", 'w', ParamContainer::filename, "simulation memory image output filename" ) != ParamContainer::errOk )
+			|| ( cl.addParam( "spikeoutfile", 's', ParamContainer::filename, "binary spike output filename" ) != ParamContainer::errOk )
+			|| ( cl.addParam( "growthoutfile", 'g', ParamContainer::filename, "binary radii and rates output filename" ) != ParamContainer::errOk )
+			|| ( cl.addParam( "historyfile", 'y', ParamContainer::filename, "keep radii and rates history in files with this name (.radii/.rates) instead of memory" ) != ParamContainer::errOk )
+			|| ( cl.addParam( "stateformat", 'f', ParamContainer::regular, "simulation state output format: xml (default) or binary" ) != ParamContainer::errOk )
+			|| ( cl.addParam( "inputring", 'i', ParamContainer::novalue, "deliver delayed input through per-target ring buffers" ) != ParamContainer::errOk )
+			|| ( cl.addParam( "order", 'n', ParamContainer::regular, "neuron storage order: rowmajor (default), morton or hilbert" ) != ParamContainer::errOk )
+			|| ( cl.addParam( "ensemble", 'e', ParamContainer::regular, "run n activity-only replicas of the network of the memory image, each with its own noise and output files" ) != ParamContainer::errOk )
+			|| ( cl.addParam( "lanes", 'l', ParamContainer::regular, "run the replicas of an ensemble (-e) n at a time in lockstep in one process (SIMD lanes; default 1); the runs of a sweep (-p) are not run in lanes" ) != ParamContainer::errOk )
+			|| ( cl.addParam( "sweepfile", 'p', ParamContainer::filename, "run each set of parameters of this sweep specification, each with its own output files and an index of the runs" ) != ParamContainer::errOk )
+			|| ( cl.addParam( "jobs", 'j', ParamContainer::regular, "number of runs of a sweep simulated at a time (default one per core)" ) != ParamContainer::errOk )
+			|| ( cl.addParam( "pack", 'z', ParamContainer::novalue, "compress checkpoints, memory images, binary state files and the spike file" ) != ParamContainer::errOk )
+			|| ( cl.addParam( "checkpointfile", 'c', ParamContainer::filename, "write checkpoints of the running simulation to this file" ) != ParamContainer::errOk )
+			|| ( cl.addParam( "checkpointinterval", 'k', ParamContainer::regular, "number of growth steps between checkpoints (default 1)" ) != ParamContainer::errOk )
+			|| ( cl.addParam( "checkpointbase", 'b', ParamContainer::regular, "write every n-th checkpoint in full and the others as deltas (default 1)" ) != ParamContainer::errOk )
+			|| ( cl.addParam( "resumefile", 'u', ParamContainer::filename, "resume the simulation from this checkpoint" ) != ParamContainer::errOk )) {
 		cerr << "Internal error creating command line parser" << endl;
 		return false;
 	}
@@ -492,9 +753,107 @@ bool parseCommandLine(int argc, char* argv[])
 	if (!memOutputFileName.empty()) {
 		fWriteMemImage = true;
 	}
+	spikeOutputFileName = cl["spikeoutfile"];
+	if (!spikeOutputFileName.empty()) {
+		fWriteSpikes = true;
+	}
+	growthOutputFileName = cl["growthoutfile"];
+	historyFileName = cl["historyfile"];
+	if (!growthOutputFileName.empty()) {
+		fWriteGrowth = true;
+	}
+	checkpointFileName = cl["checkpointfile"];
+	if (!checkpointFileName.empty()) {
+		checkpointInterval = 1;
+		if (!cl["checkpointinterval"].empty()
+				&& ( sscanf( cl["checkpointinterval"].c_str( ), "%d", &checkpointInterval ) != 1 || checkpointInterval < 1 )) {
+			cerr << "Invalid checkpoint interval " << cl["checkpointinterval"] << endl;
+			return false;
+		}
+		if (!cl["checkpointbase"].empty()
+				&& ( sscanf( cl["checkpointbase"].c_str( ), "%d", &checkpointBaseInterval ) != 1 || checkpointBaseInterval < 1 )) {
+			cerr << "Invalid number of checkpoints between full checkpoints " << cl["checkpointbase"] << endl;
+			return false;
+		}
+	} else if (!cl["checkpointinterval"].empty() || !cl["checkpointbase"].empty()) {
+		cerr << "A checkpoint interval needs a checkpoint file" << endl;
+		return false;
+	}
+	fPackOutput = !cl["pack"].empty();
+	resumeFileName = cl["resumefile"];
+	if (!resumeFileName.empty() && fReadMemImage) {
+		cerr << "A simulation cannot both read a memory image and resume from a checkpoint" << endl;
+		return false;
+	}
+	if (cl["stateformat"].empty() || cl["stateformat"] == "xml") {
+		fBinaryState = false;
+	} else if (cl["stateformat"] == "binary") {
+		fBinaryState = true;
+	} else {
+		cerr << "Unknown simulation state format " << cl["stateformat"] << endl;
+		return false;
+	}
+#if !defined(USE_GPU)
+	fInputRingBuffers = !cl["inputring"].empty();
+	if (cl["order"].empty() || cl["order"] == "rowmajor") {
+		order = ROW_MAJOR;
+	} else if (cl["order"] == "morton") {
+		order = MORTON;
+	} else if (cl["order"] == "hilbert") {
+		order = HILBERT;
+	} else {
+		cerr << "Unknown neuron storage order " << cl["order"] << endl;
+		return false;
+	}
+	if (!cl["ensemble"].empty()) {
+		if (sscanf( cl["ensemble"].c_str( ), "%d", &cReplicas ) != 1 || cReplicas < 1) {
+			cerr << "Invalid number of replicas " << cl["ensemble"] << endl;
+			return false;
+		}
+		if (!fReadMemImage) {
+			cerr << "An ensemble needs the memory image of the network it runs" << endl;
+			return false;
+		}
+		if (!checkpointFileName.empty()) {
+			cerr << "An ensemble cannot write checkpoints" << endl;
+			return false;
+		}
+	}
+	if (!cl["lanes"].empty()) {
+		if (sscanf( cl["lanes"].c_str( ), "%d", &cLanes ) != 1 || cLanes < 1 || cLanes > MAX_LANES) {
+			cerr << "Invalid number of lanes " << cl["lanes"] << "; it is 1 to " << MAX_LANES << endl;
+			return false;
+		}
+		if (cReplicas == 0) {
+			cerr << "Only the replicas of an ensemble run in lanes; the runs of a sweep do not" << endl;
+			return false;
+		}
+	}
+	sweepFileName = cl["sweepfile"];
+	if (!sweepFileName.empty()) {
+		if (cReplicas > 0) {
+			cerr << "A sweep cannot run ensembles" << endl;
+			return false;
+		}
+		if (!checkpointFileName.empty() || !resumeFileName.empty()) {
+			cerr << "A sweep cannot write or resume from checkpoints" << endl;
+			return false;
+		}
+	}
+	if (!cl["jobs"].empty()) {
+		if (sscanf( cl["jobs"].c_str( ), "%d", &cJobs ) != 1 || cJobs < 1) {
+			cerr << "Invalid number of jobs " << cl["jobs"] << endl;
+			return false;
+		}
+		if (sweepFileName.empty()) {
+			cerr << "Only the runs of a sweep are run as jobs" << endl;
+			return false;
+		}
+	}
+#endif // !USE_GPU
 #if defined(USE_GPU)
-	if ( EOF == sscanf(cl["deviceid"].c_str( ), "%d", &g_deviceId ) ) {
-		g_deviceId = 0;
+	if ( EOF == sscanf(cl["deviceid"].c_str( ), "%d", &deviceId ) ) {
+		deviceId = 0;
 	}
 #endif // USE_GPU
 
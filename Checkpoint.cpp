@@ -0,0 +1,737 @@
+/**
+ *	\file Checkpoint.cpp
+ *
+ *	\brief The state of a Network that a simulation can be resumed from.
+ */
+#include "Checkpoint.h"
+#include <climits>
+#include <cstring>
+
+/**
+ * @param[in] section	A section.
+ * @return its values, as values of type T.
+ */
+template <class T>
+static inline T* sectionValues(CheckpointSection& section)
+{
+    return section.data.empty() ? NULL : reinterpret_cast<T*>(&section.data[0]);
+}
+
+/**
+ * Create an empty checkpoint.
+ */
+Checkpoint::Checkpoint() :
+    m_cSections(0)
+{
+}
+
+/**
+ * Copy the state of a network; any previously captured state is discarded.  The
+ * buffers of a previous capture are reused.
+ * @param[in] network	The network.
+ * @param[in] radii	The current radii.
+ * @param[in] rates	The current rates.
+ * @throws KII_exception if the network has too many synapses for a checkpoint.
+ */
+void Checkpoint::capture(const Network& network, const VectorMatrix& radii, const VectorMatrix& rates)
+{
+    int cNeurons = network.m_cNeurons;
+
+    m_cSections = 0;
+
+    addScalar<uint32_t>("checkpointVersion", SIMSTATE_UINT32, CHECKPOINT_VERSION);
+    addScalar<uint32_t>("byteOrder", SIMSTATE_UINT32, CHECKPOINT_BYTE_ORDER);
+    addScalar<int32_t>("width", SIMSTATE_INT32, network.m_width);
+    addScalar<int32_t>("height", SIMSTATE_INT32, network.m_height);
+
+    // the neurons
+    addNeuronField<float>("neuron.deltaT", SIMSTATE_FLOAT32, network, &LifNeuron::deltaT);
+    addNeuronField<float>("neuron.Cm", SIMSTATE_FLOAT32, network, &LifNeuron::Cm);
+    addNeuronField<float>("neuron.Rm", SIMSTATE_FLOAT32, network, &LifNeuron::Rm);
+    addNeuronField<float>("neuron.Vthresh", SIMSTATE_FLOAT32, network, &LifNeuron::Vthresh);
+    addNeuronField<float>("neuron.Vrest", SIMSTATE_FLOAT32, network, &LifNeuron::Vrest);
+    addNeuronField<float>("neuron.Vreset", SIMSTATE_FLOAT32, network, &LifNeuron::Vreset);
+    addNeuronField<float>("neuron.Vinit", SIMSTATE_FLOAT32, network, &LifNeuron::Vinit);
+    addNeuronField<float>("neuron.Trefract", SIMSTATE_FLOAT32, network, &LifNeuron::Trefract);
+    addNeuronField<float>("neuron.Inoise", SIMSTATE_FLOAT32, network, &LifNeuron::Inoise);
+    addNeuronField<float>("neuron.Iinject", SIMSTATE_FLOAT32, network, &LifNeuron::Iinject);
+    addNeuronField<float>("neuron.Isyn", SIMSTATE_FLOAT32, network, &LifNeuron::Isyn);
+    addNeuronField<int32_t>("neuron.nStepsInRefr", SIMSTATE_INT32, network, &LifNeuron::nStepsInRefr);
+    addNeuronField<float>("neuron.C1", SIMSTATE_FLOAT32, network, &LifNeuron::C1);
+    addNeuronField<float>("neuron.C2", SIMSTATE_FLOAT32, network, &LifNeuron::C2);
+    addNeuronField<float>("neuron.I0", SIMSTATE_FLOAT32, network, &LifNeuron::I0);
+    addNeuronField<float>("neuron.Vm", SIMSTATE_FLOAT32, network, &LifNeuron::Vm);
+    addNeuronField<int32_t>("neuron.hasFired", SIMSTATE_INT32, network, &LifNeuron::hasFired);
+    addNeuronField<float>("neuron.Tau", SIMSTATE_FLOAT32, network, &LifNeuron::Tau);
+    addNeuronField<int32_t>("neuron.spikeCount", SIMSTATE_INT32, network, &LifNeuron::spikeCount);
+
+    float* pRadii = sectionValues<float>(addSection("radii", SIMSTATE_FLOAT32, SIMSTATE_VECTOR, 1, cNeurons));
+    for (int i = 0; i < cNeurons; i++)
+    {
+        pRadii[i] = radii[i];
+    }
+    float* pRates = sectionValues<float>(addSection("rates", SIMSTATE_FLOAT32, SIMSTATE_VECTOR, 1, cNeurons));
+    for (int i = 0; i < cNeurons; i++)
+    {
+        pRates[i] = rates[i];
+    }
+
+    // the synapses, neuron by neuron
+    int32_t* pCount = sectionValues<int32_t>(addSection("synapseCount", SIMSTATE_INT32, SIMSTATE_VECTOR, 1, cNeurons));
+    int64_t cSynapses = 0;
+    for (int i = 0; i < cNeurons; i++)
+    {
+        pCount[i] = network.m_rgSynapseMap[network.m_rgStorageIndex[i]].size();
+        cSynapses += pCount[i];
+    }
+    if (cSynapses > INT_MAX / WORDS_OF_DELAYQUEUE)
+    {
+        throw KII_exception("Too many synapses for a checkpoint");
+    }
+
+    int32_t* pTarget = sectionValues<int32_t>(addSection("synapse.target", SIMSTATE_INT32, SIMSTATE_VECTOR, 1, cSynapses));
+    for (int i = 0, j = 0; i < cNeurons; i++)
+    {
+        const vector<DynamicSpikingSynapse>& synapses = network.m_rgSynapseMap[network.m_rgStorageIndex[i]];
+        for (size_t k = 0; k < synapses.size(); k++, j++)
+        {
+            pTarget[j] = synapses[k].summationCoord.x + synapses[k].summationCoord.y * network.m_width;
+        }
+    }
+    addSynapseField<int32_t>("synapse.type", SIMSTATE_INT32, network, cSynapses, &DynamicSpikingSynapse::type);
+    addSynapseField<float>("synapse.deltaT", SIMSTATE_FLOAT32, network, cSynapses, &DynamicSpikingSynapse::deltaT);
+    addSynapseField<float>("synapse.W", SIMSTATE_FLOAT32, network, cSynapses, &DynamicSpikingSynapse::W);
+    addSynapseField<float>("synapse.psr", SIMSTATE_FLOAT32, network, cSynapses, &DynamicSpikingSynapse::psr);
+    addSynapseField<float>("synapse.decay", SIMSTATE_FLOAT32, network, cSynapses, &DynamicSpikingSynapse::decay);
+    addSynapseField<int32_t>("synapse.total_delay", SIMSTATE_INT32, network, cSynapses, &DynamicSpikingSynapse::total_delay);
+    addSynapseField<int32_t>("synapse.delayIdx", SIMSTATE_INT32, network, cSynapses, &DynamicSpikingSynapse::delayIdx);
+    addSynapseField<int32_t>("synapse.ldelayQueue", SIMSTATE_INT32, network, cSynapses, &DynamicSpikingSynapse::ldelayQueue);
+    addSynapseField<float>("synapse.tau", SIMSTATE_FLOAT32, network, cSynapses, &DynamicSpikingSynapse::tau);
+    addSynapseField<float>("synapse.r", SIMSTATE_FLOAT32, network, cSynapses, &DynamicSpikingSynapse::r);
+    addSynapseField<float>("synapse.u", SIMSTATE_FLOAT32, network, cSynapses, &DynamicSpikingSynapse::u);
+    addSynapseField<float>("synapse.D", SIMSTATE_FLOAT32, network, cSynapses, &DynamicSpikingSynapse::D);
+    addSynapseField<float>("synapse.U", SIMSTATE_FLOAT32, network, cSynapses, &DynamicSpikingSynapse::U);
+    addSynapseField<float>("synapse.F", SIMSTATE_FLOAT32, network, cSynapses, &DynamicSpikingSynapse::F);
+    addSynapseField<uint64_t>("synapse.lastSpike", SIMSTATE_UINT64, network, cSynapses, &DynamicSpikingSynapse::lastSpike);
+
+    uint32_t* pDelayQueue = sectionValues<uint32_t>(addSection("synapse.delayQueue", SIMSTATE_UINT32, SIMSTATE_ROWS,
+            cSynapses, WORDS_OF_DELAYQUEUE));
+    for (int i = 0; i < cNeurons; i++)
+    {
+        const vector<DynamicSpikingSynapse>& synapses = network.m_rgSynapseMap[network.m_rgStorageIndex[i]];
+        for (size_t k = 0; k < synapses.size(); k++, pDelayQueue += WORDS_OF_DELAYQUEUE)
+        {
+            memcpy(pDelayQueue, synapses[k].delayQueue, WORDS_OF_DELAYQUEUE * sizeof(uint32_t));
+        }
+    }
+}
+
+/**
+ * Copy what the next time step of a simulation depends on besides the state of the
+ * network: the time step, the state of the random number generators and the input
+ * the neurons have not taken yet.  The state of the network must have been captured
+ * first.
+ * @param[in] network	The network.
+ * @param[in] pInputRing	The input ring buffers, or NULL if they are not used.
+ */
+void Checkpoint::captureContinuation(const Network& network, const InputRingBuffer* pInputRing)
+{
+    int cNeurons = network.m_cNeurons;
+    const SimulationContext& context = network.m_context;
+    int cNorm = context.rgNormrnd.size();
+    MTRand::uint32 state[MTRand::SAVE];
+
+    assert(m_cSections > 0 && cNorm > 0);
+
+    addScalar<uint64_t>("simulationStep", SIMSTATE_UINT64, context.simulationStep);
+
+    // the random number generators
+    context.rng.save(state);
+    uint32_t* pRng = sectionValues<uint32_t>(addSection("rng", SIMSTATE_UINT32, SIMSTATE_VECTOR, 1, MTRand::SAVE));
+    for (int i = 0; i < MTRand::SAVE; i++)
+    {
+        pRng[i] = state[i];
+    }
+
+    uint32_t* pNormState = sectionValues<uint32_t>(addSection("normrnd.state", SIMSTATE_UINT32, SIMSTATE_ROWS,
+            cNorm, MTRand::SAVE));
+    int32_t* pOdd = sectionValues<int32_t>(addSection("normrnd.odd", SIMSTATE_INT32, SIMSTATE_VECTOR, 1, cNorm));
+    float* pX2 = sectionValues<float>(addSection("normrnd.X2", SIMSTATE_FLOAT32, SIMSTATE_VECTOR, 1, cNorm));
+    for (int n = 0; n < cNorm; n++)
+    {
+        bool fOdd;
+        FLOAT x2;
+
+        context.rgNormrnd[n]->saveState(state, fOdd, x2);
+        for (int i = 0; i < MTRand::SAVE; i++)
+        {
+            pNormState[n * MTRand::SAVE + i] = state[i];
+        }
+        pOdd[n] = fOdd;
+        pX2[n] = x2;
+    }
+
+    // the input the neurons have not taken yet
+    float* pSummation = sectionValues<float>(addSection("summationMap", SIMSTATE_FLOAT32, SIMSTATE_VECTOR, 1, cNeurons));
+    for (int i = 0; i < cNeurons; i++)
+    {
+        pSummation[i] = network.m_summationMap[network.m_rgStorageIndex[i]];
+    }
+
+    if (pInputRing != NULL)
+    {
+        int cInputs = cNeurons * INPUT_CLASSES;
+
+        pInputRing->save(
+                sectionValues<float>(addSection("inputRing.slots", SIMSTATE_FLOAT32, SIMSTATE_ROWS,
+                        pInputRing->getSlots(), cInputs)),
+                sectionValues<float>(addSection("inputRing.psr", SIMSTATE_FLOAT32, SIMSTATE_VECTOR, 1, cInputs)),
+                sectionValues<float>(addSection("inputRing.decay", SIMSTATE_FLOAT32, SIMSTATE_VECTOR, 1, cInputs)),
+                network.m_rgStorageIndex);
+    }
+}
+
+/**
+ * Copy the progress of a simulation at the end of a growth step, so that the
+ * simulation can be resumed from the checkpoint.  The state of the network must
+ * have been captured first.
+ * @param[in] network	The network.
+ * @param[in] growthStep	The growth step that has just been completed.
+ * @param[in] radiiHistory	The radii history; rows up to growthStep are copied.
+ * @param[in] ratesHistory	The rates history; rows up to growthStep are copied.
+ * @param[in] burstinessHist	The spike histogram with 1 s bins, with the spikes up to now.
+ * @param[in] spikesHistory	The spike histogram with 10 ms bins, with the spikes up to now.
+ * @param[in] pInputRing	The input ring buffers, or NULL if they are not used.
+ */
+void Checkpoint::captureProgress(const Network& network, int growthStep, HistoryStore& radiiHistory,
+        HistoryStore& ratesHistory, const VectorMatrix& burstinessHist, const VectorMatrix& spikesHistory,
+        const InputRingBuffer* pInputRing)
+{
+    int cNeurons = network.m_cNeurons;
+
+    addScalar<int32_t>("growthStep", SIMSTATE_INT32, growthStep);
+    int32_t* pType = sectionValues<int32_t>(addSection("neuronType", SIMSTATE_INT32, SIMSTATE_VECTOR, 1, cNeurons));
+    for (int i = 0; i < cNeurons; i++)
+    {
+        pType[i] = network.m_rgNeuronTypeMap[i];
+    }
+
+    captureContinuation(network, pInputRing);
+
+    // the output accumulated so far
+    radiiHistory.getRows(growthStep + 1, sectionValues<float>(addSection("radiiHistory", SIMSTATE_FLOAT32,
+            SIMSTATE_ROWS, growthStep + 1, cNeurons)));
+    ratesHistory.getRows(growthStep + 1, sectionValues<float>(addSection("ratesHistory", SIMSTATE_FLOAT32,
+            SIMSTATE_ROWS, growthStep + 1, cNeurons)));
+
+    float* pBurstiness = sectionValues<float>(addSection("burstinessHist", SIMSTATE_FLOAT32, SIMSTATE_VECTOR,
+            1, burstinessHist.Size()));
+    for (int i = 0; i < burstinessHist.Size(); i++)
+    {
+        pBurstiness[i] = burstinessHist[i];
+    }
+    float* pSpikes = sectionValues<float>(addSection("spikesHistory", SIMSTATE_FLOAT32, SIMSTATE_VECTOR,
+            1, spikesHistory.Size()));
+    for (int i = 0; i < spikesHistory.Size(); i++)
+    {
+        pSpikes[i] = spikesHistory[i];
+    }
+}
+
+/**
+ * Add the identifier of a captured checkpoint, which delta checkpoints encoded
+ * against it refer to.
+ * @param[in] id	The identifier.
+ */
+void Checkpoint::identify(uint64_t id)
+{
+    addScalar<uint64_t>("checkpointId", SIMSTATE_UINT64, id);
+}
+
+/**
+ * Copy all arrays of a checkpoint file as sections, in the order they were written;
+ * any previously captured state is discarded.
+ * @param[in] file	The checkpoint file, checked by verify().
+ */
+void Checkpoint::load(const MappedSimState& file)
+{
+    m_cSections = 0;
+    for (size_t i = 0; i < file.arrays().size(); i++)
+    {
+        const SimStateArray& array = file.arrays()[i];
+        CheckpointSection& section = addSection(array.name, array.type, array.layout, array.cRows, array.cColumns);
+
+        if (!section.data.empty())
+        {
+            memcpy(&section.data[0], file.values(array.name, array.type,
+                    static_cast<uint64_t>(array.cRows) * array.cColumns), section.data.size());
+        }
+    }
+}
+
+/**
+ * Write the captured state; each section is written as one array of a binary state file.
+ * @param[in] os	The binary output stream.
+ * @param[in] fPack	True to pack the arrays.
+ */
+void Checkpoint::write(ostream& os, bool fPack) const
+{
+    SimStateWriter writer(os, fPack);
+
+    for (size_t i = 0; i < m_cSections; i++)
+    {
+        const CheckpointSection& section = m_sections[i];
+
+        writer.beginArray(section.name, section.type, section.layout, section.cRows, section.cColumns);
+        if (!section.data.empty())
+        {
+            writer.writeRaw(&section.data[0], static_cast<size_t>(section.cRows) * section.cColumns);
+        }
+        writer.endArray();
+    }
+    writer.close();
+}
+
+/**
+ * Check every chunk of a checkpoint file, and that this version can read it.
+ * @param[in] file	The checkpoint file.
+ * @throws KII_exception if the file is not an intact checkpoint of a supported version.
+ */
+void Checkpoint::verify(const MappedSimState& file)
+{
+    const string& fileName = file.fileName();
+
+    for (size_t i = 0; i < file.arrays().size(); i++)
+    {
+        if (!file.verify(file.arrays()[i].name))
+        {
+            throw KII_exception("Corrupt array " + file.arrays()[i].name + " in checkpoint " + fileName);
+        }
+    }
+
+    if (file.find("checkpointVersion") == NULL)
+    {
+        throw KII_exception(fileName + " is not a checkpoint");
+    }
+    if (*static_cast<const uint32_t*>(file.values("byteOrder", SIMSTATE_UINT32, 1)) != CHECKPOINT_BYTE_ORDER)
+    {
+        throw KII_exception("Checkpoint " + fileName + " was written on a host of a different byte order");
+    }
+    if (*static_cast<const uint32_t*>(file.values("checkpointVersion", SIMSTATE_UINT32, 1)) != CHECKPOINT_VERSION)
+    {
+        throw KII_exception("Unsupported version of checkpoint " + fileName);
+    }
+}
+
+/**
+ * Restore the neurons, the synapses and the current radii and rates of a network from a
+ * checkpoint file.  The synapses of the network are replaced; the lists of the neurons are
+ * built in parallel when the simulator is built with OpenMP.
+ * @param[in] file	The checkpoint file, checked by verify().
+ * @param[in] network	The network; it must have the size of the checkpointed network.
+ * @param[out] radii	Receives the radii.
+ * @param[out] rates	Receives the rates.
+ * @throws KII_exception if the file is not a valid checkpoint of a network of this size.
+ */
+void Checkpoint::restore(const MappedSimState& file, Network& network, VectorMatrix& radii, VectorMatrix& rates)
+{
+    const string& fileName = file.fileName();
+    int cNeurons = network.m_cNeurons;
+    int width = network.m_width;
+
+    if (*static_cast<const int32_t*>(file.values("width", SIMSTATE_INT32, 1)) != network.m_width
+            || *static_cast<const int32_t*>(file.values("height", SIMSTATE_INT32, 1)) != network.m_height)
+    {
+        throw KII_exception("Checkpoint " + fileName + " is of a network of a different size");
+    }
+
+    // the neurons
+    restoreNeuronField<float>(file, "neuron.deltaT", SIMSTATE_FLOAT32, network, &LifNeuron::deltaT);
+    restoreNeuronField<float>(file, "neuron.Cm", SIMSTATE_FLOAT32, network, &LifNeuron::Cm);
+    restoreNeuronField<float>(file, "neuron.Rm", SIMSTATE_FLOAT32, network, &LifNeuron::Rm);
+    restoreNeuronField<float>(file, "neuron.Vthresh", SIMSTATE_FLOAT32, network, &LifNeuron::Vthresh);
+    restoreNeuronField<float>(file, "neuron.Vrest", SIMSTATE_FLOAT32, network, &LifNeuron::Vrest);
+    restoreNeuronField<float>(file, "neuron.Vreset", SIMSTATE_FLOAT32, network, &LifNeuron::Vreset);
+    restoreNeuronField<float>(file, "neuron.Vinit", SIMSTATE_FLOAT32, network, &LifNeuron::Vinit);
+    restoreNeuronField<float>(file, "neuron.Trefract", SIMSTATE_FLOAT32, network, &LifNeuron::Trefract);
+    restoreNeuronField<float>(file, "neuron.Inoise", SIMSTATE_FLOAT32, network, &LifNeuron::Inoise);
+    restoreNeuronField<float>(file, "neuron.Iinject", SIMSTATE_FLOAT32, network, &LifNeuron::Iinject);
+    restoreNeuronField<float>(file, "neuron.Isyn", SIMSTATE_FLOAT32, network, &LifNeuron::Isyn);
+    restoreNeuronField<int32_t>(file, "neuron.nStepsInRefr", SIMSTATE_INT32, network, &LifNeuron::nStepsInRefr);
+    restoreNeuronField<float>(file, "neuron.C1", SIMSTATE_FLOAT32, network, &LifNeuron::C1);
+    restoreNeuronField<float>(file, "neuron.C2", SIMSTATE_FLOAT32, network, &LifNeuron::C2);
+    restoreNeuronField<float>(file, "neuron.I0", SIMSTATE_FLOAT32, network, &LifNeuron::I0);
+    restoreNeuronField<float>(file, "neuron.Vm", SIMSTATE_FLOAT32, network, &LifNeuron::Vm);
+    restoreNeuronField<int32_t>(file, "neuron.hasFired", SIMSTATE_INT32, network, &LifNeuron::hasFired);
+    restoreNeuronField<float>(file, "neuron.Tau", SIMSTATE_FLOAT32, network, &LifNeuron::Tau);
+    restoreNeuronField<int32_t>(file, "neuron.spikeCount", SIMSTATE_INT32, network, &LifNeuron::spikeCount);
+
+    const float* pRadii = static_cast<const float*>(file.values("radii", SIMSTATE_FLOAT32, cNeurons));
+    const float* pRates = static_cast<const float*>(file.values("rates", SIMSTATE_FLOAT32, cNeurons));
+    for (int i = 0; i < cNeurons; i++)
+    {
+        radii[i] = pRadii[i];
+        rates[i] = pRates[i];
+    }
+
+    // the synapses
+    // the synapses of each neuron are a range of the synapse arrays; rgFirst[i] is the first
+    const int32_t* pCount = static_cast<const int32_t*>(file.values("synapseCount", SIMSTATE_INT32, cNeurons));
+    vector<int64_t> rgFirst(cNeurons + 1);
+    rgFirst[0] = 0;
+    for (int i = 0; i < cNeurons; i++)
+    {
+        if (pCount[i] < 0)
+        {
+            throw KII_exception("Corrupt synapse count in checkpoint " + fileName);
+        }
+        rgFirst[i + 1] = rgFirst[i] + pCount[i];
+    }
+    int64_t cSynapses = rgFirst[cNeurons];
+
+    const int32_t* pTarget = static_cast<const int32_t*>(file.values("synapse.target", SIMSTATE_INT32, cSynapses));
+    const int32_t* pType = static_cast<const int32_t*>(file.values("synapse.type", SIMSTATE_INT32, cSynapses));
+    const float* pDeltaT = static_cast<const float*>(file.values("synapse.deltaT", SIMSTATE_FLOAT32, cSynapses));
+    const float* pW = static_cast<const float*>(file.values("synapse.W", SIMSTATE_FLOAT32, cSynapses));
+    const float* pPsr = static_cast<const float*>(file.values("synapse.psr", SIMSTATE_FLOAT32, cSynapses));
+    const float* pDecay = static_cast<const float*>(file.values("synapse.decay", SIMSTATE_FLOAT32, cSynapses));
+    const int32_t* pTotalDelay = static_cast<const int32_t*>(file.values("synapse.total_delay", SIMSTATE_INT32, cSynapses));
+    const int32_t* pDelayIdx = static_cast<const int32_t*>(file.values("synapse.delayIdx", SIMSTATE_INT32, cSynapses));
+    const int32_t* pLDelayQueue = static_cast<const int32_t*>(file.values("synapse.ldelayQueue", SIMSTATE_INT32, cSynapses));
+    const float* pTau = static_cast<const float*>(file.values("synapse.tau", SIMSTATE_FLOAT32, cSynapses));
+    const float* pR = static_cast<const float*>(file.values("synapse.r", SIMSTATE_FLOAT32, cSynapses));
+    const float* pU = static_cast<const float*>(file.values("synapse.u", SIMSTATE_FLOAT32, cSynapses));
+    const float* pD = static_cast<const float*>(file.values("synapse.D", SIMSTATE_FLOAT32, cSynapses));
+    const float* pUse = static_cast<const float*>(file.values("synapse.U", SIMSTATE_FLOAT32, cSynapses));
+    const float* pF = static_cast<const float*>(file.values("synapse.F", SIMSTATE_FLOAT32, cSynapses));
+    const uint64_t* pLastSpike = static_cast<const uint64_t*>(file.values("synapse.lastSpike", SIMSTATE_UINT64, cSynapses));
+
+    // a checkpoint may hold more words per delay queue than a synapse has (e.g. one written
+    // with a longer queue); the words beyond ldelayQueue, which is checked below, are empty
+    const SimStateArray* pDelayQueueArray = file.find("synapse.delayQueue");
+    int cWords = pDelayQueueArray != NULL ? pDelayQueueArray->cColumns : WORDS_OF_DELAYQUEUE;
+    if (cWords < 1)
+    {
+        throw KII_exception("Corrupt synapse.delayQueue in checkpoint " + fileName);
+    }
+    const uint32_t* pDelayQueue = static_cast<const uint32_t*>(file.values("synapse.delayQueue", SIMSTATE_UINT32,
+            cSynapses * cWords));
+
+    // the synapses of different neurons are independent, so each neuron's list is built by
+    // whichever thread gets to it; a corrupt synapse is reported once all threads are done
+    int fCorrupt = 0;
+#ifdef USE_OMP
+#pragma omp parallel for schedule(dynamic, 64) reduction(|:fCorrupt)
+#endif
+    for (int i = 0; i < cNeurons; i++)
+    {
+        vector<DynamicSpikingSynapse>& synapses = network.m_rgSynapseMap[network.m_rgStorageIndex[i]];
+        synapses.clear();
+        synapses.reserve(pCount[i]);
+
+        for (int64_t j = rgFirst[i]; j < rgFirst[i + 1]; j++)
+        {
+            int target = pTarget[j];
+            if (target < 0 || target >= cNeurons || pType[j] < II || pType[j] > EE
+                    || pLDelayQueue[j] <= 0 || pLDelayQueue[j] > static_cast<int>(MAX_LENGTH_OF_DELAYQUEUE)
+                    || pLDelayQueue[j] % LENGTH_OF_DELAYQUEUE != 0
+                    || pDelayIdx[j] < 0 || pDelayIdx[j] >= pLDelayQueue[j]
+                    || pTotalDelay[j] < 0 || pTotalDelay[j] >= pLDelayQueue[j])
+            {
+                fCorrupt = 1;
+                break;
+            }
+
+            synapses.push_back(DynamicSpikingSynapse(i % width, i / width, target % width, target / width,
+                    network.m_summationMap[network.m_rgStorageIndex[target]], static_cast<synapseType>(pType[j])));
+            DynamicSpikingSynapse& syn = synapses.back();
+            syn.deltaT = pDeltaT[j];
+            syn.W = pW[j];
+            syn.psr = pPsr[j];
+            syn.decay = pDecay[j];
+            syn.total_delay = pTotalDelay[j];
+            memcpy(syn.delayQueue, pDelayQueue + j * cWords,
+                    min(cWords, static_cast<int>(WORDS_OF_DELAYQUEUE)) * sizeof(uint32_t));
+            syn.delayIdx = pDelayIdx[j];
+            syn.ldelayQueue = pLDelayQueue[j];
+            syn.tau = pTau[j];
+            syn.r = pR[j];
+            syn.u = pU[j];
+            syn.D = pD[j];
+            syn.U = pUse[j];
+            syn.F = pF[j];
+            syn.lastSpike = pLastSpike[j];
+        }
+    }
+
+    if (fCorrupt)
+    {
+        throw KII_exception("Corrupt synapse in checkpoint " + fileName);
+    }
+}
+
+/**
+ * Restore what the next time step of a simulation depends on besides the state of
+ * the network, after the state of the network has been restored and the simulation
+ * has been initialized.
+ * @param[in] file	The checkpoint file, checked by verify().
+ * @param[in] network	The network.
+ * @param[out] pInputRing	Receives the pending input, if input ring buffers are used (may be NULL).
+ * @return false if the file does not hold it; nothing is restored then.
+ * @throws KII_exception if the file is corrupt.
+ */
+bool Checkpoint::restoreContinuation(const MappedSimState& file, Network& network, InputRingBuffer* pInputRing)
+{
+    const string& fileName = file.fileName();
+    int cNeurons = network.m_cNeurons;
+    SimulationContext& context = network.m_context;
+    MTRand::uint32 state[MTRand::SAVE];
+
+    if (file.find("simulationStep") == NULL)
+    {
+        return false;
+    }
+    context.simulationStep = *static_cast<const uint64_t*>(file.values("simulationStep", SIMSTATE_UINT64, 1));
+
+    // the random number generators
+    const uint32_t* pRng = static_cast<const uint32_t*>(file.values("rng", SIMSTATE_UINT32, MTRand::SAVE));
+    if (pRng[MTRand::N] > static_cast<uint32_t>(MTRand::N))
+    {
+        throw KII_exception("Corrupt random number generator in checkpoint " + fileName);
+    }
+    for (int i = 0; i < MTRand::SAVE; i++)
+    {
+        state[i] = pRng[i];
+    }
+    context.rng.load(state);
+
+    const SimStateArray* pNormOdd = file.find("normrnd.odd");
+    int cNorm = pNormOdd != NULL ? pNormOdd->cColumns : 0;
+    const uint32_t* pNormState = static_cast<const uint32_t*>(file.values("normrnd.state", SIMSTATE_UINT32,
+            static_cast<uint64_t>(cNorm) * MTRand::SAVE));
+    const int32_t* pOdd = static_cast<const int32_t*>(file.values("normrnd.odd", SIMSTATE_INT32, cNorm));
+    const float* pX2 = static_cast<const float*>(file.values("normrnd.X2", SIMSTATE_FLOAT32, cNorm));
+    if (cNorm != static_cast<int>(context.rgNormrnd.size()))
+    {
+        cerr << "Warning: checkpoint " << fileName << " has the noise generators of " << cNorm
+             << " threads, the simulation uses " << context.rgNormrnd.size() << "; the run is not reproduced exactly" << endl;
+    }
+    for (int n = 0; n < cNorm && n < static_cast<int>(context.rgNormrnd.size()); n++)
+    {
+        if (pNormState[n * MTRand::SAVE + MTRand::N] > static_cast<uint32_t>(MTRand::N))
+        {
+            throw KII_exception("Corrupt random number generator in checkpoint " + fileName);
+        }
+        for (int i = 0; i < MTRand::SAVE; i++)
+        {
+            state[i] = pNormState[n * MTRand::SAVE + i];
+        }
+        context.rgNormrnd[n]->loadState(state, pOdd[n] != 0, pX2[n]);
+    }
+
+    // the input the neurons have not taken yet
+    const float* pSummation = static_cast<const float*>(file.values("summationMap", SIMSTATE_FLOAT32, cNeurons));
+    for (int i = 0; i < cNeurons; i++)
+    {
+        network.m_summationMap[network.m_rgStorageIndex[i]] = pSummation[i];
+    }
+
+    // without input ring buffers, the pending input is in the delay queues of the synapses
+    if (file.find("inputRing.slots") != NULL)
+    {
+        if (pInputRing == NULL)
+        {
+            cerr << "Warning: checkpoint " << fileName << " holds input of input ring buffers, which are not used;"
+                 << " the run is not reproduced exactly" << endl;
+        }
+        else
+        {
+            int cInputs = cNeurons * INPUT_CLASSES;
+            pInputRing->restore(
+                    static_cast<const float*>(file.values("inputRing.slots", SIMSTATE_FLOAT32,
+                            static_cast<uint64_t>(pInputRing->getSlots()) * cInputs)),
+                    static_cast<const float*>(file.values("inputRing.psr", SIMSTATE_FLOAT32, cInputs)),
+                    static_cast<const float*>(file.values("inputRing.decay", SIMSTATE_FLOAT32, cInputs)),
+                    network.m_rgStorageIndex);
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Restore the progress of a simulation from a checkpoint file, after the state of
+ * its network has been restored and the simulation has been initialized.  The
+ * histories must not have any rows yet.
+ * @param[in] file	The checkpoint file, checked by verify().
+ * @param[in] network	The network; its neuron types must be those of the checkpointed network.
+ * @param[in] maxGrowthSteps	Number of growth steps of the simulation.
+ * @param[out] radiiHistory	Receives the radii history up to the growth step of the checkpoint.
+ * @param[out] ratesHistory	Receives the rates history up to the growth step of the checkpoint.
+ * @param[out] burstinessHist	Receives the spike histogram with 1 s bins.
+ * @param[out] spikesHistory	Receives the spike histogram with 10 ms bins.
+ * @param[out] pInputRing	Receives the pending input, if input ring buffers are used (may be NULL).
+ * @return the growth step the checkpoint was taken after.
+ * @throws KII_exception if the file is not a checkpoint of this simulation in progress.
+ */
+int Checkpoint::restoreProgress(const MappedSimState& file, Network& network, int maxGrowthSteps,
+        HistoryStore& radiiHistory, HistoryStore& ratesHistory, VectorMatrix& burstinessHist,
+        VectorMatrix& spikesHistory, InputRingBuffer* pInputRing)
+{
+    const string& fileName = file.fileName();
+    int cNeurons = network.m_cNeurons;
+
+    if (file.find("growthStep") == NULL)
+    {
+        throw KII_exception(fileName + " is not a checkpoint of a simulation in progress");
+    }
+    int growthStep = *static_cast<const int32_t*>(file.values("growthStep", SIMSTATE_INT32, 1));
+    if (growthStep < 0 || growthStep > maxGrowthSteps)
+    {
+        throw KII_exception("Checkpoint " + fileName + " is past the end of the simulation");
+    }
+
+    const int32_t* pType = static_cast<const int32_t*>(file.values("neuronType", SIMSTATE_INT32, cNeurons));
+    for (int i = 0; i < cNeurons; i++)
+    {
+        if (pType[i] != network.m_rgNeuronTypeMap[i])
+        {
+            throw KII_exception("Checkpoint " + fileName + " is of a network with other neuron types");
+        }
+    }
+
+    if (!restoreContinuation(file, network, pInputRing))
+    {
+        throw KII_exception(fileName + " is not a checkpoint of a simulation in progress");
+    }
+
+    // the output accumulated so far
+    uint64_t cHistory = static_cast<uint64_t>(growthStep + 1) * cNeurons;
+    radiiHistory.setRows(growthStep + 1, static_cast<const float*>(file.values("radiiHistory", SIMSTATE_FLOAT32, cHistory)));
+    ratesHistory.setRows(growthStep + 1, static_cast<const float*>(file.values("ratesHistory", SIMSTATE_FLOAT32, cHistory)));
+    restoreVector(file, "burstinessHist", burstinessHist);
+    restoreVector(file, "spikesHistory", spikesHistory);
+
+    return growthStep;
+}
+
+/**
+ * @param[in] name	Name of the section.
+ * @param[in] type	Type of the values.
+ * @param[in] layout	How the section is written in the XML state format.
+ * @param[in] cRows	Number of rows.
+ * @param[in] cColumns	Number of columns.
+ * @return the section, with room for its values; valid until the next section is added.
+ */
+CheckpointSection& Checkpoint::addSection(const string& name, simStateType type, simStateLayout layout, int cRows, int cColumns)
+{
+    if (m_cSections == m_sections.size())
+    {
+        m_sections.push_back(CheckpointSection());
+    }
+
+    CheckpointSection& section = m_sections[m_cSections++];
+    section.name = name;
+    section.type = type;
+    section.layout = layout;
+    section.cRows = cRows;
+    section.cColumns = cColumns;
+    section.data.resize(static_cast<size_t>(cRows) * cColumns * SimStateFormat::valueBytes(type));
+    return section;
+}
+
+/**
+ * The vectors of a run that is resumed with more growth steps are longer than
+ * those of the checkpoint; the values after those of the checkpoint are kept.
+ * @param[in] file	The checkpoint file.
+ * @param[in] name	Name of the vector.
+ * @param[in,out] values	Receives the values.
+ * @throws KII_exception if the file has no such float vector.
+ */
+void Checkpoint::restoreVector(const MappedSimState& file, const string& name, VectorMatrix& values)
+{
+    const SimStateArray* pArray = file.find(name);
+    uint64_t cValues = pArray != NULL ? static_cast<uint64_t>(pArray->cRows) * pArray->cColumns : 0;
+    const float* pValues = static_cast<const float*>(file.values(name, SIMSTATE_FLOAT32, cValues));
+
+    for (int i = 0; i < values.Size() && static_cast<uint64_t>(i) < cValues; i++)
+    {
+        values[i] = pValues[i];
+    }
+}
+
+/**
+ * @param[in] name	Name of the section.
+ * @param[in] type	Type of the values; values of type T.
+ * @param[in] network	The network.
+ * @param[in] field	The field.
+ */
+template <class T, class V>
+void Checkpoint::addNeuronField(const string& name, simStateType type, const Network& network, V LifNeuron::*field)
+{
+    assert(sizeof(T) == SimStateFormat::valueBytes(type));
+
+    T* pValues = sectionValues<T>(addSection(name, type, SIMSTATE_VECTOR, 1, network.m_cNeurons));
+    for (int i = 0; i < network.m_cNeurons; i++)
+    {
+        pValues[i] = static_cast<T>(network.m_neuronList[network.m_rgStorageIndex[i]].*field);
+    }
+}
+
+/**
+ * @param[in] name	Name of the section.
+ * @param[in] type	Type of the values; values of type T.
+ * @param[in] network	The network.
+ * @param[in] cSynapses	Number of synapses of the network.
+ * @param[in] field	The field.
+ */
+template <class T, class V>
+void Checkpoint::addSynapseField(const string& name, simStateType type, const Network& network, int cSynapses,
+        V DynamicSpikingSynapse::*field)
+{
+    assert(sizeof(T) == SimStateFormat::valueBytes(type));
+
+    T* pValues = sectionValues<T>(addSection(name, type, SIMSTATE_VECTOR, 1, cSynapses));
+    for (int i = 0; i < network.m_cNeurons; i++)
+    {
+        const vector<DynamicSpikingSynapse>& synapses = network.m_rgSynapseMap[network.m_rgStorageIndex[i]];
+        for (size_t k = 0; k < synapses.size(); k++)
+        {
+            *pValues++ = static_cast<T>(synapses[k].*field);
+        }
+    }
+}
+
+/**
+ * @param[in] name	Name of the section.
+ * @param[in] type	Type of the value; a value of type T.
+ * @param[in] value	The value.
+ */
+template <class T>
+void Checkpoint::addScalar(const string& name, simStateType type, T value)
+{
+    assert(sizeof(T) == SimStateFormat::valueBytes(type));
+
+    *sectionValues<T>(addSection(name, type, SIMSTATE_SCALAR, 1, 1)) = value;
+}
+
+/**
+ * @param[in] file	The checkpoint file.
+ * @param[in] name	Name of the section.
+ * @param[in] type	Type of the values; values of type T.
+ * @param[in] network	The network.
+ * @param[in] field	The field.
+ * @throws KII_exception if the file has no such section.
+ */
+template <class T, class V>
+void Checkpoint::restoreNeuronField(const MappedSimState& file, const string& name, simStateType type,
+        Network& network, V LifNeuron::*field)
+{
+    assert(sizeof(T) == SimStateFormat::valueBytes(type));
+
+    const T* pValues = static_cast<const T*>(file.values(name, type, network.m_cNeurons));
+    for (int i = 0; i < network.m_cNeurons; i++)
+    {
+        network.m_neuronList[network.m_rgStorageIndex[i]].*field = static_cast<V>(pValues[i]);
+    }
+}
@@ -0,0 +1,164 @@
+/**
+ *	@file Checkpoint.h
+ *
+ *	@brief Header file for Checkpoint.
+ */
+//! The state of a Network that a simulation can be resumed from (the simulation memory image).
+
+/**
+ ** \class Checkpoint Checkpoint.h "Checkpoint.h"
+ **
+ ** \latexonly	\subsubsection*{Implementation} \endlatexonly
+ ** \htmlonly	<h3>Implementation</h3> \endhtmlonly
+ **
+ ** A Checkpoint holds the neurons, the synapses and the current radii and rates of a Network
+ ** as sections: named arrays with one value per neuron or per synapse for each field, in
+ ** row-major order of the neurons (structure of arrays).  capture() copies the state out of a
+ ** Network and write() writes the sections to a binary state file (see SimStateFormat.h),
+ ** each as one array, so the file has a header with the format version, 64 byte aligned
+ ** arrays and CRC-32 checksums of its chunks.  The arrays can be packed, which makes the file
+ ** smaller; restore() then reads them unpacked into memory rather than in place.
+ **
+ ** restore() maps a checkpoint file, checks all of its chunks, and builds the neurons and
+ ** synapses from the mapped arrays in place: the synapse list of each neuron is reserved at
+ ** its final size from synapseCount, and each synapse is created without recomputing its
+ ** parameters.  The prefix sums of synapseCount partition the synapse arrays by source
+ ** neuron, so the lists of different neurons are built in parallel with OpenMP.
+ **
+ ** Besides the sections of the state, a checkpoint has the scalars checkpointVersion
+ ** (CHECKPOINT_VERSION), byteOrder (CHECKPOINT_BYTE_ORDER as written on the host that wrote
+ ** the file), width and height.  The synapses of a neuron are stored after those of the
+ ** neurons before it, synapseCount of them; synapse.target is the row-major index of the
+ ** neuron a synapse delivers its input to.
+ **
+ ** What the next time step depends on besides the network can be added with
+ ** captureContinuation(): the time step (simulationStep), the state of the random number
+ ** generators (rng and normrnd.*, one row per thread), the summation map, and the input pending
+ ** in the input ring buffers if they are used (inputRing.*).  The simulation memory image has
+ ** them, so a run started from it with restoreContinuation() goes on exactly as the run that
+ ** wrote it would have.  A checkpoint of a simulation in progress (captureProgress()) also holds
+ ** the growth step it was taken after (growthStep), the radii and rates history up to the
+ ** growth step and the spike histograms; a run resumed from it with restoreProgress() continues
+ ** exactly as the run it was taken from.
+ **
+ ** A checkpoint that others are encoded against (see CheckpointDelta) is marked with a
+ ** checkpointId.
+ **
+ ** The buffers of the sections are kept from one capture to the next, so a Checkpoint that is
+ ** captured repeatedly allocates memory only when the network grows.
+ **
+ ** \latexonly	\subsubsection*{Credits} \endlatexonly
+ ** \htmlonly	<h3>Credits</h3> \endhtmlonly
+ **
+ ** This simulator is a rewrite of CSIM (2006) and other work (Stiber and Kawasaki (2007?))
+ **/
+
+#pragma once
+
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+
+#include "global.h"
+#include "Network.h"
+#include "HistoryStore.h"
+#include "InputRingBuffer.h"
+#include "SimStateFile.h"
+#include "Matrix/MappedSimState.h"
+#include "Matrix/VectorMatrix.h"
+#include <deque>
+
+//! Version of the checkpoint sections.
+#define CHECKPOINT_VERSION 1
+
+//! Written as a uint32_t; reads differently on a host of the other byte order.
+#define CHECKPOINT_BYTE_ORDER 0x01020304
+
+//! A named array of a Checkpoint.
+struct CheckpointSection
+{
+    string name;
+    simStateType type;
+    simStateLayout layout;
+    int cRows;
+    int cColumns;
+
+    //! The values, as they are written.
+    vector<char> data;
+};
+
+class Checkpoint
+{
+public:
+    //! The constructor for Checkpoint.
+    Checkpoint();
+
+    //! Copy the state of a network.
+    void capture(const Network& network, const VectorMatrix& radii, const VectorMatrix& rates);
+
+    //! Copy the time step, random number generators and pending input of a simulation, after capture().
+    void captureContinuation(const Network& network, const InputRingBuffer* pInputRing);
+
+    //! Copy the progress of a simulation, after capture().
+    void captureProgress(const Network& network, int growthStep, HistoryStore& radiiHistory,
+            HistoryStore& ratesHistory, const VectorMatrix& burstinessHist, const VectorMatrix& spikesHistory,
+            const InputRingBuffer* pInputRing);
+
+    //! Mark a captured checkpoint with an identifier, for the delta checkpoints against it.
+    void identify(uint64_t id);
+
+    //! Copy all arrays of a checkpoint file.
+    void load(const MappedSimState& file);
+
+    //! Write the captured state as a checkpoint file.
+    void write(ostream& os, bool fPack = false) const;
+
+    //! Check that a mapped file is an intact checkpoint that this version can read.
+    static void verify(const MappedSimState& file);
+
+    //! Restore the state of a network from a checkpoint file.
+    static void restore(const MappedSimState& file, Network& network, VectorMatrix& radii, VectorMatrix& rates);
+
+    //! Restore the time step, random number generators and pending input of a simulation, if the file has them.
+    static bool restoreContinuation(const MappedSimState& file, Network& network, InputRingBuffer* pInputRing);
+
+    //! Restore the progress of a simulation from a checkpoint file.
+    static int restoreProgress(const MappedSimState& file, Network& network, int maxGrowthSteps,
+            HistoryStore& radiiHistory, HistoryStore& ratesHistory, VectorMatrix& burstinessHist,
+            VectorMatrix& spikesHistory, InputRingBuffer* pInputRing);
+
+private:
+    //! Add a section; its values are left to the caller.
+    CheckpointSection& addSection(const string& name, simStateType type, simStateLayout layout, int cRows, int cColumns);
+
+    //! Add a section with a field of each neuron.
+    template <class T, class V>
+    void addNeuronField(const string& name, simStateType type, const Network& network, V LifNeuron::*field);
+
+    //! Add a section with a field of each synapse.
+    template <class T, class V>
+    void addSynapseField(const string& name, simStateType type, const Network& network, int cSynapses,
+            V DynamicSpikingSynapse::*field);
+
+    //! Add a scalar section.
+    template <class T>
+    void addScalar(const string& name, simStateType type, T value);
+
+    //! Set a field of each neuron from a mapped section.
+    template <class T, class V>
+    static void restoreNeuronField(const MappedSimState& file, const string& name, simStateType type,
+            Network& network, V LifNeuron::*field);
+
+    //! Copy a vector of a checkpoint file into a VectorMatrix, as far as both reach.
+    static void restoreVector(const MappedSimState& file, const string& name, VectorMatrix& values);
+
+    //! The sections; the first m_cSections of them are captured, in the order they are written.
+    deque<CheckpointSection> m_sections;
+    size_t m_cSections;
+
+    Checkpoint(const Checkpoint&);
+    Checkpoint& operator=(const Checkpoint&);
+
+    friend class CheckpointDelta;
+};
+
+#endif // _CHECKPOINT_H_
@@ -0,0 +1,579 @@
+/**
+ *	\file CheckpointDelta.cpp
+ *
+ *	\brief Encodes a checkpoint as the difference to an earlier one (a delta checkpoint).
+ */
+#include "CheckpointDelta.h"
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+//! The number of 32-bit words of a bitmap with a bit for each of cWords words.
+#define BITMAP_WORDS(cWords) (((cWords) + 31) / 32)
+
+//! The words of the .changed section before the bitmap: type, layout, rows, columns.
+#define CHANGED_HEADER_WORDS 4
+
+/**
+ * @param[in] section	A section.
+ * @return its values, as 32-bit words.
+ */
+static inline uint32_t* sectionWords(CheckpointSection& section)
+{
+    return section.data.empty() ? NULL : reinterpret_cast<uint32_t*>(&section.data[0]);
+}
+
+static inline const uint32_t* sectionWords(const CheckpointSection& section)
+{
+    return section.data.empty() ? NULL : reinterpret_cast<const uint32_t*>(&section.data[0]);
+}
+
+/**
+ * @param[in] name	Name of a section.
+ * @return true if the section has a value for each synapse.
+ */
+static inline bool isSynapseSection(const string& name)
+{
+    return name.compare(0, 8, "synapse.") == 0;
+}
+
+/**
+ * Encode a checkpoint as the difference to a base checkpoint.  Both must have been
+ * captured from the same simulation.
+ * @param[in] base	The base checkpoint.
+ * @param[in] baseId	The checkpointId of the base.
+ * @param[in] checkpoint	The checkpoint to encode.
+ * @param[out] delta	Receives the delta checkpoint; its buffers are reused.
+ * @return false if the checkpoint lacks a section of the base, which a delta cannot express.
+ */
+bool CheckpointDelta::encode(const Checkpoint& base, uint64_t baseId, const Checkpoint& checkpoint, Checkpoint& delta)
+{
+    vector<int> rgBaseIndex;
+    vector<uint32_t> aligned;
+
+    for (size_t i = 0; i < base.m_cSections; i++)
+    {
+        if (base.m_sections[i].name != "checkpointId" && find(checkpoint, base.m_sections[i].name) == NULL)
+        {
+            return false;
+        }
+    }
+
+    delta.m_cSections = 0;
+    *reinterpret_cast<uint32_t*>(sectionWords(delta.addSection("checkpointVersion", SIMSTATE_UINT32,
+            SIMSTATE_SCALAR, 1, 1))) = CHECKPOINT_VERSION;
+    *reinterpret_cast<uint32_t*>(sectionWords(delta.addSection("byteOrder", SIMSTATE_UINT32,
+            SIMSTATE_SCALAR, 1, 1))) = CHECKPOINT_BYTE_ORDER;
+    uint64_t* pBaseId = reinterpret_cast<uint64_t*>(sectionWords(delta.addSection("baseCheckpointId", SIMSTATE_UINT64,
+            SIMSTATE_SCALAR, 1, 1)));
+    *pBaseId = baseId;
+
+    // the synapses that were removed and added since the base
+    bool fAligned = matchSynapses(base, checkpoint, rgBaseIndex);
+    int cBaseSynapses = 0;
+    if (fAligned)
+    {
+        cBaseSynapses = find(base, "synapse.target")->cColumns;
+
+        int cAdded = 0;
+        for (size_t i = 0; i < rgBaseIndex.size(); i++)
+        {
+            if (rgBaseIndex[i] < 0)
+                cAdded++;
+        }
+        int32_t* pAdded = reinterpret_cast<int32_t*>(sectionWords(
+                delta.addSection("delta.added", SIMSTATE_INT32, SIMSTATE_VECTOR, 1, cAdded)));
+        int32_t* pRemoved = reinterpret_cast<int32_t*>(sectionWords(
+                delta.addSection("delta.removed", SIMSTATE_INT32, SIMSTATE_VECTOR, 1,
+                        cBaseSynapses - (static_cast<int>(rgBaseIndex.size()) - cAdded))));
+
+        // the kept synapses are in the order of the base
+        int iBase = 0;
+        for (size_t i = 0; i < rgBaseIndex.size(); i++)
+        {
+            if (rgBaseIndex[i] < 0)
+            {
+                *pAdded++ = static_cast<int32_t>(i);
+                continue;
+            }
+            while (iBase < rgBaseIndex[i])
+            {
+                *pRemoved++ = iBase++;
+            }
+            iBase++;
+        }
+        while (iBase < cBaseSynapses)
+        {
+            *pRemoved++ = iBase++;
+        }
+    }
+
+    for (size_t i = 0; i < checkpoint.m_cSections; i++)
+    {
+        const CheckpointSection& section = checkpoint.m_sections[i];
+        const CheckpointSection* pBase = find(base, section.name);
+
+        if (section.name == "checkpointVersion" || section.name == "byteOrder" || section.name == "checkpointId")
+        {
+            continue;
+        }
+
+        size_t cWords = section.data.size() / sizeof(uint32_t);
+        const uint32_t* pBaseWords = NULL;
+        if (pBase != NULL && pBase->type == section.type)
+        {
+            if (fAligned && isSynapseSection(section.name))
+            {
+                pBaseWords = alignSynapses(*pBase, cBaseSynapses, rgBaseIndex, cWords, aligned);
+            }
+            else if (pBase->cRows == section.cRows && pBase->cColumns == section.cColumns)
+            {
+                // sections that have not changed are taken from the base
+                if (memcmp(sectionWords(*pBase), sectionWords(section), section.data.size()) == 0)
+                {
+                    continue;
+                }
+                pBaseWords = sectionWords(*pBase);
+            }
+        }
+
+        if (pBaseWords != NULL)
+        {
+            addChanged(delta, section, pBaseWords);
+        }
+        else
+        {
+            CheckpointSection& full = delta.addSection(section.name, section.type, section.layout,
+                    section.cRows, section.cColumns);
+            if (!full.data.empty())
+            {
+                memcpy(&full.data[0], &section.data[0], full.data.size());
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Rebuild the checkpoint a delta was encoded from.
+ * @param[in] base	The base of the delta.
+ * @param[in] delta	The delta checkpoint file, checked by Checkpoint::verify().
+ * @param[out] checkpoint	Receives the checkpoint.
+ * @throws KII_exception if the delta is corrupt or does not fit the base.
+ */
+void CheckpointDelta::apply(const Checkpoint& base, const MappedSimState& delta, Checkpoint& checkpoint)
+{
+    const string& fileName = delta.fileName();
+    vector<int> rgBaseIndex;
+    vector<uint32_t> aligned;
+    int cBaseSynapses = 0;
+
+    checkpoint.m_cSections = 0;
+
+    // line up the synapses of the base with those of the checkpoint
+    const SimStateArray* pAddedArray = delta.find("delta.added");
+    if (pAddedArray != NULL)
+    {
+        const SimStateArray* pRemovedArray = delta.find("delta.removed");
+        const CheckpointSection* pBaseTarget = find(base, "synapse.target");
+        if (pRemovedArray == NULL || pBaseTarget == NULL)
+        {
+            throw KII_exception("Corrupt delta checkpoint " + fileName);
+        }
+
+        int cAdded = pAddedArray->cColumns;
+        int cRemoved = pRemovedArray->cColumns;
+        const int32_t* pAdded = static_cast<const int32_t*>(delta.values("delta.added", SIMSTATE_INT32, cAdded));
+        const int32_t* pRemoved = static_cast<const int32_t*>(delta.values("delta.removed", SIMSTATE_INT32, cRemoved));
+        cBaseSynapses = pBaseTarget->cColumns;
+        if (pAddedArray->cRows != 1 || pRemovedArray->cRows != 1 || cRemoved > cBaseSynapses)
+        {
+            throw KII_exception("Corrupt delta checkpoint " + fileName);
+        }
+
+        int iAdded = 0;
+        int iRemoved = 0;
+        int iBase = 0;
+        rgBaseIndex.resize(cBaseSynapses - cRemoved + cAdded);
+        for (size_t i = 0; i < rgBaseIndex.size(); i++)
+        {
+            if (iAdded < cAdded && pAdded[iAdded] == static_cast<int32_t>(i))
+            {
+                rgBaseIndex[i] = -1;
+                iAdded++;
+                continue;
+            }
+            while (iRemoved < cRemoved && pRemoved[iRemoved] == iBase)
+            {
+                iRemoved++;
+                iBase++;
+            }
+            if (iBase >= cBaseSynapses)
+            {
+                throw KII_exception("Corrupt delta checkpoint " + fileName);
+            }
+            rgBaseIndex[i] = iBase++;
+        }
+        while (iRemoved < cRemoved && pRemoved[iRemoved] == iBase)
+        {
+            iRemoved++;
+            iBase++;
+        }
+        if (iAdded != cAdded || iRemoved != cRemoved || iBase != cBaseSynapses)
+        {
+            throw KII_exception("Corrupt delta checkpoint " + fileName);
+        }
+    }
+
+    // the sections, in the order of the base
+    for (size_t i = 0; i < base.m_cSections; i++)
+    {
+        const CheckpointSection& baseSection = base.m_sections[i];
+        const string& name = baseSection.name;
+
+        if (name == "checkpointId")
+        {
+            continue;
+        }
+
+        const SimStateArray* pArray = delta.find(name);
+        const SimStateArray* pChangedArray = delta.find(name + ".changed");
+        if (pArray != NULL)
+        {
+            uint64_t cValues = static_cast<uint64_t>(pArray->cRows) * pArray->cColumns;
+            CheckpointSection& section = checkpoint.addSection(name, pArray->type, pArray->layout,
+                    pArray->cRows, pArray->cColumns);
+            if (!section.data.empty())
+            {
+                memcpy(&section.data[0], delta.values(name, pArray->type, cValues), section.data.size());
+            }
+        }
+        else if (pChangedArray != NULL)
+        {
+            uint64_t cChanged = static_cast<uint64_t>(pChangedArray->cRows) * pChangedArray->cColumns;
+            const uint32_t* pChanged = static_cast<const uint32_t*>(delta.values(name + ".changed",
+                    SIMSTATE_UINT32, cChanged));
+            if (cChanged < CHANGED_HEADER_WORDS)
+            {
+                throw KII_exception("Corrupt delta checkpoint " + fileName);
+            }
+
+            simStateType type = static_cast<simStateType>(pChanged[0]);
+            simStateLayout layout = static_cast<simStateLayout>(pChanged[1]);
+            int cRows = static_cast<int32_t>(pChanged[2]);
+            int cColumns = static_cast<int32_t>(pChanged[3]);
+            if (SimStateFormat::valueBytes(type) == 0 || layout > SIMSTATE_SCALAR || cRows < 0 || cColumns < 0)
+            {
+                throw KII_exception("Corrupt delta checkpoint " + fileName);
+            }
+            size_t cWords = static_cast<size_t>(cRows) * cColumns * SimStateFormat::valueBytes(type) / sizeof(uint32_t);
+            if (cChanged != CHANGED_HEADER_WORDS + BITMAP_WORDS(cWords))
+            {
+                throw KII_exception("Corrupt delta checkpoint " + fileName);
+            }
+            const uint32_t* pBitmap = pChanged + CHANGED_HEADER_WORDS;
+
+            const uint32_t* pBaseWords = NULL;
+            if (pAddedArray != NULL && isSynapseSection(name))
+            {
+                pBaseWords = alignSynapses(baseSection, cBaseSynapses, rgBaseIndex, cWords, aligned);
+            }
+            else if (baseSection.data.size() == cWords * sizeof(uint32_t))
+            {
+                pBaseWords = sectionWords(baseSection);
+            }
+            if (pBaseWords == NULL && cWords > 0)
+            {
+                throw KII_exception("Corrupt delta checkpoint " + fileName);
+            }
+
+            const SimStateArray* pXorArray = delta.find(name + ".xor");
+            uint64_t cXor = pXorArray != NULL ? static_cast<uint64_t>(pXorArray->cRows) * pXorArray->cColumns : 0;
+            const uint32_t* pXor = static_cast<const uint32_t*>(delta.values(name + ".xor", SIMSTATE_UINT32, cXor));
+
+            CheckpointSection& section = checkpoint.addSection(name, type, layout, cRows, cColumns);
+            uint32_t* pWords = sectionWords(section);
+            uint64_t iXor = 0;
+            for (size_t w = 0; w < cWords; w++)
+            {
+                pWords[w] = pBaseWords[w];
+                if (pBitmap[w / 32] & (1u << (w % 32)))
+                {
+                    if (iXor == cXor)
+                    {
+                        throw KII_exception("Corrupt delta checkpoint " + fileName);
+                    }
+                    pWords[w] ^= pXor[iXor++];
+                }
+            }
+            if (iXor != cXor)
+            {
+                throw KII_exception("Corrupt delta checkpoint " + fileName);
+            }
+        }
+        else
+        {
+            CheckpointSection& section = checkpoint.addSection(name, baseSection.type, baseSection.layout,
+                    baseSection.cRows, baseSection.cColumns);
+            section.data = baseSection.data;
+        }
+    }
+
+    // sections the base does not have
+    for (size_t i = 0; i < delta.arrays().size(); i++)
+    {
+        const SimStateArray& array = delta.arrays()[i];
+        const string& name = array.name;
+
+        if (name == "baseCheckpointId" || name.compare(0, 6, "delta.") == 0 || find(base, name) != NULL
+                || (name.size() > 8 && name.compare(name.size() - 8, 8, ".changed") == 0)
+                || (name.size() > 4 && name.compare(name.size() - 4, 4, ".xor") == 0))
+        {
+            continue;
+        }
+
+        CheckpointSection& section = checkpoint.addSection(name, array.type, array.layout, array.cRows, array.cColumns);
+        if (!section.data.empty())
+        {
+            memcpy(&section.data[0], delta.values(name, array.type,
+                    static_cast<uint64_t>(array.cRows) * array.cColumns), section.data.size());
+        }
+    }
+}
+
+/**
+ * Map a checkpoint file.  If there is a delta file next to it that was encoded
+ * against it, the checkpoint is rebuilt from both, in memory.  A delta file of an
+ * earlier checkpoint is ignored, and a corrupt one is ignored with a warning.
+ * @param[in] fileName	The checkpoint file.
+ * @return the checkpoint; to be deleted by the caller.
+ * @throws KII_exception if the checkpoint file cannot be mapped.
+ */
+MappedSimState* CheckpointDelta::open(const string& fileName)
+{
+    string deltaFileName = fileName + CHECKPOINT_DELTA_SUFFIX;
+    MappedSimState* pFile = new MappedSimState(fileName);
+
+    if (!ifstream(deltaFileName.c_str()).is_open() || pFile->find("checkpointId") == NULL)
+    {
+        return pFile;
+    }
+
+    try
+    {
+        Checkpoint::verify(*pFile);
+        MappedSimState deltaFile(deltaFileName);
+        Checkpoint::verify(deltaFile);
+
+        uint64_t id = *static_cast<const uint64_t*>(pFile->values("checkpointId", SIMSTATE_UINT64, 1));
+        if (deltaFile.find("baseCheckpointId") == NULL
+                || *static_cast<const uint64_t*>(deltaFile.values("baseCheckpointId", SIMSTATE_UINT64, 1)) != id)
+        {
+            return pFile;
+        }
+
+        Checkpoint base;
+        Checkpoint checkpoint;
+        ostringstream os(ios_base::out | ios_base::binary);
+
+        base.load(*pFile);
+        apply(base, deltaFile, checkpoint);
+        checkpoint.write(os);
+
+        string contents = os.str();
+        MappedSimState* pCheckpoint = new MappedSimState(deltaFileName, contents);
+        delete pFile;
+        return pCheckpoint;
+    }
+    catch (KII_exception& e)
+    {
+        cerr << "Warning: " << e.what() << "; the delta checkpoint is ignored" << endl;
+        return pFile;
+    }
+}
+
+/**
+ * Match the synapses of a checkpoint with those of its base by source neuron and
+ * target.
+ * @param[in] base	The base checkpoint.
+ * @param[in] checkpoint	The checkpoint.
+ * @param[out] rgBaseIndex	Receives, for each synapse of the checkpoint, the index of
+ *				the same synapse in the base, or -1 if it is new.
+ * @return false if the synapses cannot be matched, or the synapses that are kept are
+ *	not in the order of the base.
+ */
+bool CheckpointDelta::matchSynapses(const Checkpoint& base, const Checkpoint& checkpoint, vector<int>& rgBaseIndex)
+{
+    const CheckpointSection* pBaseCountSection = find(base, "synapseCount");
+    const CheckpointSection* pCountSection = find(checkpoint, "synapseCount");
+    const CheckpointSection* pBaseTargetSection = find(base, "synapse.target");
+    const CheckpointSection* pTargetSection = find(checkpoint, "synapse.target");
+
+    if (pBaseCountSection == NULL || pCountSection == NULL || pBaseTargetSection == NULL || pTargetSection == NULL
+            || pBaseCountSection->cColumns != pCountSection->cColumns)
+    {
+        return false;
+    }
+
+    int cNeurons = pCountSection->cColumns;
+    int cBaseSynapses = pBaseTargetSection->cColumns;
+    const int32_t* pBaseCount = reinterpret_cast<const int32_t*>(sectionWords(*pBaseCountSection));
+    const int32_t* pCount = reinterpret_cast<const int32_t*>(sectionWords(*pCountSection));
+    const int32_t* pBaseTarget = reinterpret_cast<const int32_t*>(sectionWords(*pBaseTargetSection));
+    const int32_t* pTarget = reinterpret_cast<const int32_t*>(sectionWords(*pTargetSection));
+
+    // the synapse of the base to each target of the current neuron
+    vector<int> rgTargetSynapse(cNeurons, -1);
+
+    rgBaseIndex.resize(pTargetSection->cColumns);
+    int iBase = 0;
+    int i = 0;
+    int lastBase = -1;
+    for (int n = 0; n < cNeurons; n++)
+    {
+        if (iBase + pBaseCount[n] > cBaseSynapses || i + pCount[n] > pTargetSection->cColumns)
+        {
+            return false;
+        }
+
+        for (int k = iBase; k < iBase + pBaseCount[n]; k++)
+        {
+            if (pBaseTarget[k] < 0 || pBaseTarget[k] >= cNeurons)
+            {
+                return false;
+            }
+            rgTargetSynapse[pBaseTarget[k]] = k;
+        }
+        for (int k = i; k < i + pCount[n]; k++)
+        {
+            if (pTarget[k] < 0 || pTarget[k] >= cNeurons)
+            {
+                return false;
+            }
+            rgBaseIndex[k] = rgTargetSynapse[pTarget[k]];
+            if (rgBaseIndex[k] >= 0)
+            {
+                if (rgBaseIndex[k] <= lastBase)
+                {
+                    return false;
+                }
+                lastBase = rgBaseIndex[k];
+            }
+        }
+        for (int k = iBase; k < iBase + pBaseCount[n]; k++)
+        {
+            rgTargetSynapse[pBaseTarget[k]] = -1;
+        }
+
+        iBase += pBaseCount[n];
+        i += pCount[n];
+    }
+
+    return iBase == cBaseSynapses && i == pTargetSection->cColumns;
+}
+
+/**
+ * Add a section to a delta as the words that differ from the base, or in full if
+ * that takes less room.
+ * @param[in,out] delta	The delta checkpoint.
+ * @param[in] section	The section.
+ * @param[in] pBase	The words of the base, lined up with those of the section.
+ */
+void CheckpointDelta::addChanged(Checkpoint& delta, const CheckpointSection& section, const uint32_t* pBase)
+{
+    size_t cWords = section.data.size() / sizeof(uint32_t);
+    const uint32_t* pWords = sectionWords(section);
+
+    size_t cChanged = 0;
+    for (size_t w = 0; w < cWords; w++)
+    {
+        if (pWords[w] != pBase[w])
+            cChanged++;
+    }
+
+    if (CHANGED_HEADER_WORDS + BITMAP_WORDS(cWords) + cChanged >= cWords)
+    {
+        CheckpointSection& full = delta.addSection(section.name, section.type, section.layout,
+                section.cRows, section.cColumns);
+        if (!full.data.empty())
+        {
+            memcpy(&full.data[0], &section.data[0], full.data.size());
+        }
+        return;
+    }
+
+    uint32_t* pChanged = sectionWords(delta.addSection(section.name + ".changed", SIMSTATE_UINT32, SIMSTATE_VECTOR,
+            1, CHANGED_HEADER_WORDS + BITMAP_WORDS(cWords)));
+    uint32_t* pXor = sectionWords(delta.addSection(section.name + ".xor", SIMSTATE_UINT32, SIMSTATE_VECTOR,
+            1, cChanged));
+
+    pChanged[0] = section.type;
+    pChanged[1] = section.layout;
+    pChanged[2] = section.cRows;
+    pChanged[3] = section.cColumns;
+
+    uint32_t* pBitmap = pChanged + CHANGED_HEADER_WORDS;
+    memset(pBitmap, 0, BITMAP_WORDS(cWords) * sizeof(uint32_t));
+    for (size_t w = 0; w < cWords; w++)
+    {
+        if (pWords[w] != pBase[w])
+        {
+            pBitmap[w / 32] |= 1u << (w % 32);
+            *pXor++ = pWords[w] ^ pBase[w];
+        }
+    }
+}
+
+/**
+ * @param[in] baseSection	A synapse section of the base.
+ * @param[in] cBaseSynapses	Number of synapses of the base.
+ * @param[in] rgBaseIndex	For each synapse, the index of the same synapse in the base, or -1.
+ * @param[in] cWords	Number of words of the section of the checkpoint.
+ * @param[out] aligned	Receives the words; the words of new synapses are 0.
+ * @return the words, or NULL if the sections do not have the same number of words per synapse.
+ */
+const uint32_t* CheckpointDelta::alignSynapses(const CheckpointSection& baseSection, int cBaseSynapses,
+        const vector<int>& rgBaseIndex, size_t cWords, vector<uint32_t>& aligned)
+{
+    if (rgBaseIndex.empty() || cWords % rgBaseIndex.size() != 0)
+    {
+        return NULL;
+    }
+
+    size_t cSynapseWords = cWords / rgBaseIndex.size();
+    if (baseSection.data.size() != cSynapseWords * cBaseSynapses * sizeof(uint32_t))
+    {
+        return NULL;
+    }
+
+    const uint32_t* pBase = sectionWords(baseSection);
+    aligned.resize(cWords);
+    for (size_t i = 0; i < rgBaseIndex.size(); i++)
+    {
+        if (rgBaseIndex[i] >= 0)
+        {
+            memcpy(&aligned[i * cSynapseWords], pBase + rgBaseIndex[i] * cSynapseWords,
+                    cSynapseWords * sizeof(uint32_t));
+        }
+        else
+        {
+            memset(&aligned[i * cSynapseWords], 0, cSynapseWords * sizeof(uint32_t));
+        }
+    }
+    return aligned.empty() ? NULL : &aligned[0];
+}
+
+/**
+ * @param[in] checkpoint	A checkpoint.
+ * @param[in] name	Name of a section.
+ * @return the section, or NULL if the checkpoint has none of that name.
+ */
+const CheckpointSection* CheckpointDelta::find(const Checkpoint& checkpoint, const string& name)
+{
+    for (size_t i = 0; i < checkpoint.m_cSections; i++)
+    {
+        if (checkpoint.m_sections[i].name == name)
+            return &checkpoint.m_sections[i];
+    }
+    return NULL;
+}
@@ -0,0 +1,81 @@
+/**
+ *	@file CheckpointDelta.h
+ *
+ *	@brief Header file for CheckpointDelta.
+ */
+//! Encodes a checkpoint as the difference to an earlier one (a delta checkpoint).
+
+/**
+ ** \class CheckpointDelta CheckpointDelta.h "CheckpointDelta.h"
+ **
+ ** \latexonly	\subsubsection*{Implementation} \endlatexonly
+ ** \htmlonly	<h3>Implementation</h3> \endhtmlonly
+ **
+ ** Between growth steps most of a checkpoint does not change: the parameters of the neurons
+ ** and synapses stay the same, and most synapses survive a growth update.  A delta checkpoint
+ ** holds only what differs from a full checkpoint, its base, that is kept in a file of its own.
+ **
+ ** The synapses of the two checkpoints are matched by their source neuron and target.  Growth
+ ** removes synapses and adds new ones, but keeps the order of the others, so delta.removed (the
+ ** indices of the synapses of the base that are gone) and delta.added (the indices of the new
+ ** synapses) are enough to line up the synapse sections of the base with those of the delta.
+ **
+ ** Each section is then stored in one of three ways:
+ **  - not at all, if it is not a synapse section and is identical in the base;
+ **  - as <name>.changed and <name>.xor: the first holds the type, layout, rows and columns of
+ **    the section followed by a bitmap of the 32-bit words that differ from the (lined up)
+ **    base, the second the XOR of those words with the base.  The values of new synapses are
+ **    XORed with 0;
+ **  - in full, under its own name, if it has no counterpart in the base or if most of its
+ **    words differ.
+ **
+ ** The delta also holds checkpointVersion and byteOrder, so it is checked as a checkpoint, and
+ ** baseCheckpointId, the checkpointId of its base.  open() maps a checkpoint file and applies
+ ** the delta file of the same name with .delta appended, if it belongs to that checkpoint.
+ **
+ ** \latexonly	\subsubsection*{Credits} \endlatexonly
+ ** \htmlonly	<h3>Credits</h3> \endhtmlonly
+ **
+ ** This simulator is a rewrite of CSIM (2006) and other work (Stiber and Kawasaki (2007?))
+ **/
+
+#pragma once
+
+#ifndef _CHECKPOINTDELTA_H_
+#define _CHECKPOINTDELTA_H_
+
+#include "global.h"
+#include "Checkpoint.h"
+#include "Matrix/MappedSimState.h"
+
+//! Appended to the name of a checkpoint file for the name of its delta file.
+#define CHECKPOINT_DELTA_SUFFIX ".delta"
+
+class CheckpointDelta
+{
+public:
+    //! Encode a checkpoint as a delta against a base.
+    static bool encode(const Checkpoint& base, uint64_t baseId, const Checkpoint& checkpoint, Checkpoint& delta);
+
+    //! Rebuild the checkpoint a delta was encoded from.
+    static void apply(const Checkpoint& base, const MappedSimState& delta, Checkpoint& checkpoint);
+
+    //! Map a checkpoint file, with its delta file applied if it has a current one.
+    static MappedSimState* open(const string& fileName);
+
+private:
+    //! Line up the synapses of a checkpoint with those of its base.
+    static bool matchSynapses(const Checkpoint& base, const Checkpoint& checkpoint, vector<int>& rgBaseIndex);
+
+    //! Add a section as its changed words, or in full if that is smaller.
+    static void addChanged(Checkpoint& delta, const CheckpointSection& section, const uint32_t* pBase);
+
+    //! The words of a base section, lined up with the synapses of the checkpoint.
+    static const uint32_t* alignSynapses(const CheckpointSection& baseSection, int cBaseSynapses,
+            const vector<int>& rgBaseIndex, size_t cWords, vector<uint32_t>& aligned);
+
+    //! Find a section of a checkpoint by name.
+    static const CheckpointSection* find(const Checkpoint& checkpoint, const string& name);
+};
+
+#endif // _CHECKPOINTDELTA_H_
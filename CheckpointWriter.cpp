@@ -0,0 +1,300 @@
+/**
+ *	\file CheckpointWriter.cpp
+ *
+ *	\brief Writes the checkpoints of a running simulation from a background thread.
+ */
+#include "CheckpointWriter.h"
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+
+/**
+ * Start the writer thread.  If the thread cannot be started, checkpoints are
+ * written by commit() instead.
+ * @param[in] fileName	The checkpoint file; it is replaced by each checkpoint.
+ * @param[in] baseInterval	Number of checkpoints from one full checkpoint to the next;
+ *				the others are written as deltas.  1 if all are written in full.
+ * @param[in] fPack	True to pack the arrays of the checkpoint files.
+ */
+CheckpointWriter::CheckpointWriter(const string& fileName, int baseInterval, bool fPack) :
+    m_fileName(fileName),
+    m_baseInterval(baseInterval),
+    m_fPack(fPack),
+    m_iNext(0),
+    m_iBase(-1),
+    m_baseId(0),
+    m_cDeltas(0),
+    m_iPending(-1),
+    m_fClosing(false),
+    m_cWritten(0),
+    m_cDeltasWritten(0),
+    m_lastGrowthStep(-1),
+    m_cBaseBytes(0),
+    m_cDeltaBytes(0),
+    m_writeTime(0),
+    m_stallTime(0),
+    m_cStalls(0)
+{
+    m_rgGrowthStep[0] = m_rgGrowthStep[1] = m_rgGrowthStep[2] = -1;
+
+    if (!m_thread.start(writerThread, this))
+    {
+        cerr << "Warning: cannot start the checkpoint writer thread; checkpoints are written synchronously" << endl;
+    }
+}
+
+/**
+ * Destructor
+ */
+CheckpointWriter::~CheckpointWriter()
+{
+    close();
+}
+
+/**
+ * The checkpoint to capture the next state into.  It is neither being written nor
+ * the base of the deltas, so it can be captured while the previous checkpoint is
+ * written.
+ * @return the checkpoint.
+ */
+Checkpoint& CheckpointWriter::next()
+{
+    return m_rgCheckpoints[m_iNext];
+}
+
+/**
+ * Hand the checkpoint returned by next() to the writer thread.  Waits while the
+ * previous checkpoint is still being written.
+ * @param[in] growthStep	The growth step the checkpoint was captured after.
+ */
+void CheckpointWriter::commit(int growthStep)
+{
+    int iCheckpoint = m_iNext;
+
+    m_rgGrowthStep[iCheckpoint] = growthStep;
+
+    if (!m_thread.running())
+    {
+        writeCheckpoint(iCheckpoint);
+        m_iNext = nextCheckpoint(iCheckpoint);
+        return;
+    }
+
+    Mutex::Lock lock(m_mutex);
+    assert(!m_fClosing);
+    if (m_iPending >= 0)
+    {
+        m_cStalls++;
+        m_stallTimer.start();
+        while (m_iPending >= 0)
+        {
+            m_written.wait(m_mutex);
+        }
+        m_stallTime += m_stallTimer.lap() / 1000000.0;
+    }
+
+    m_iPending = iCheckpoint;
+    m_committed.broadcast();
+
+    m_iNext = nextCheckpoint(iCheckpoint);
+}
+
+/**
+ * The committed checkpoint may become the base once it is written, but the current
+ * base is used until then, so the next checkpoint is neither of them.  Without
+ * deltas, the first two checkpoints take turns.
+ * @param[in] iCommitted	The checkpoint just committed.
+ * @return the checkpoint to capture into next.
+ */
+int CheckpointWriter::nextCheckpoint(int iCommitted) const
+{
+    int iNext = (iCommitted + 1) % 3;
+
+    if (iNext == m_iBase || (m_baseInterval <= 1 && iNext == 2))
+    {
+        iNext = (iNext + 1) % 3;
+    }
+    return iNext;
+}
+
+/**
+ * Write the committed checkpoint, if any, then stop the writer thread.
+ */
+void CheckpointWriter::close()
+{
+    {
+        Mutex::Lock lock(m_mutex);
+        m_fClosing = true;
+        m_committed.broadcast();
+    }
+    m_thread.join();
+}
+
+/**
+ * Print the number of checkpoints written and the time spent.
+ * @param[in] os	The output stream.
+ */
+void CheckpointWriter::printStats(ostream& os)
+{
+    Mutex::Lock lock(m_mutex);
+
+    os << "checkpoints written: " << m_cWritten;
+    if (m_cWritten > 0)
+    {
+        os << " (last after growth step " << m_lastGrowthStep << ")";
+    }
+    os << endl;
+    if (m_baseInterval > 1)
+    {
+        os << "delta checkpoints written: " << m_cDeltasWritten << endl;
+        os << "checkpoint bytes written: " << m_cBaseBytes << " in full, " << m_cDeltaBytes << " in deltas" << endl;
+    }
+    os << "checkpoint write time: " << m_writeTime << " s" << endl;
+    os << "checkpoint stalls: " << m_cStalls << " (" << m_stallTime << " s)" << endl;
+}
+
+/**
+ * Entry point of the writer thread.
+ * @param[in] pWriter	The CheckpointWriter.
+ */
+void CheckpointWriter::writerThread(void* pWriter)
+{
+    static_cast<CheckpointWriter*>(pWriter)->writeCheckpoints();
+}
+
+/**
+ * Write committed checkpoints until the writer is closed and the last committed
+ * checkpoint has been written.
+ */
+void CheckpointWriter::writeCheckpoints()
+{
+    for (;;)
+    {
+        int iCheckpoint;
+        {
+            Mutex::Lock lock(m_mutex);
+            while (m_iPending < 0 && !m_fClosing)
+            {
+                m_committed.wait(m_mutex);
+            }
+            if (m_iPending < 0)
+                return;
+
+            iCheckpoint = m_iPending;
+        }
+
+        writeCheckpoint(iCheckpoint);
+
+        {
+            Mutex::Lock lock(m_mutex);
+            m_iPending = -1;
+            m_written.broadcast();
+        }
+    }
+}
+
+/**
+ * Write a checkpoint in full, as a new base, or as a delta against the last base.
+ * A checkpoint that cannot be written is reported and skipped; the previous
+ * checkpoint is kept.
+ * @param[in] iCheckpoint	Which of the checkpoints.
+ */
+void CheckpointWriter::writeCheckpoint(int iCheckpoint)
+{
+    Checkpoint& checkpoint = m_rgCheckpoints[iCheckpoint];
+    bool fDelta = false;
+    bool fWritten;
+    uint64_t cBytes = 0;
+
+    m_writeTimer.start();
+    if (m_iBase >= 0 && m_cDeltas < m_baseInterval - 1
+            && CheckpointDelta::encode(m_rgCheckpoints[m_iBase], m_baseId, checkpoint, m_delta))
+    {
+        fDelta = true;
+        fWritten = writeFile(m_delta, m_fileName + CHECKPOINT_DELTA_SUFFIX, cBytes);
+        if (fWritten)
+        {
+            m_cDeltas++;
+        }
+    }
+    else
+    {
+        // unique among the checkpoints that may be left next to a stale delta
+        uint64_t id = (static_cast<uint64_t>(time(NULL)) << 32) | static_cast<uint32_t>(m_rgGrowthStep[iCheckpoint]);
+        if (m_baseInterval > 1)
+        {
+            checkpoint.identify(id);
+        }
+        fWritten = writeFile(checkpoint, m_fileName, cBytes);
+        if (fWritten && m_baseInterval > 1)
+        {
+            remove((m_fileName + CHECKPOINT_DELTA_SUFFIX).c_str());
+            m_baseId = id;
+            m_cDeltas = 0;
+
+            Mutex::Lock lock(m_mutex);
+            m_iBase = iCheckpoint;
+        }
+    }
+
+    if (!fWritten)
+    {
+        cerr << "Warning: cannot write the checkpoint of growth step " << m_rgGrowthStep[iCheckpoint]
+             << " to " << (fDelta ? m_fileName + CHECKPOINT_DELTA_SUFFIX : m_fileName) << endl;
+    }
+
+    Mutex::Lock lock(m_mutex);
+    m_writeTime += m_writeTimer.lap() / 1000000.0;
+    if (fWritten)
+    {
+        m_cWritten++;
+        m_lastGrowthStep = m_rgGrowthStep[iCheckpoint];
+        if (fDelta)
+        {
+            m_cDeltasWritten++;
+            m_cDeltaBytes += cBytes;
+        }
+        else
+        {
+            m_cBaseBytes += cBytes;
+        }
+    }
+}
+
+/**
+ * Write a checkpoint to the temporary file, then replace the file with it.
+ * @param[in] checkpoint	The checkpoint.
+ * @param[in] fileName	The file.
+ * @param[out] cBytes	Receives the size of the file.
+ * @return true if the file has been replaced.
+ */
+bool CheckpointWriter::writeFile(const Checkpoint& checkpoint, const string& fileName, uint64_t& cBytes)
+{
+    string tempFileName = fileName + ".tmp";
+    bool fWritten = false;
+
+    {
+        ofstream os(tempFileName.c_str(), ofstream::binary | ofstream::trunc);
+        if (os.is_open())
+        {
+            checkpoint.write(os, m_fPack);
+            cBytes = os.tellp();
+            os.close();
+            fWritten = !os.fail();
+        }
+    }
+
+    if (fWritten)
+    {
+#ifdef _WIN32
+        fWritten = MoveFileExA(tempFileName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+        fWritten = rename(tempFileName.c_str(), fileName.c_str()) == 0;
+#endif
+    }
+    if (!fWritten)
+    {
+        remove(tempFileName.c_str());
+    }
+    return fWritten;
+}
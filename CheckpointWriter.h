@@ -0,0 +1,155 @@
+/**
+ *	@file CheckpointWriter.h
+ *
+ *	@brief Header file for CheckpointWriter.
+ */
+//! Writes the checkpoints of a running simulation from a background thread.
+
+/**
+ ** \class CheckpointWriter CheckpointWriter.h "CheckpointWriter.h"
+ **
+ ** \latexonly	\subsubsection*{Implementation} \endlatexonly
+ ** \htmlonly	<h3>Implementation</h3> \endhtmlonly
+ **
+ ** The CheckpointWriter has two Checkpoints (double buffering).  The simulation captures its
+ ** state into the one returned by next() and hands it over with commit(); a writer thread then
+ ** writes it while the simulation continues and captures the following checkpoint into the
+ ** other one.  Only capturing, a copy of the state in memory, holds up the simulation, unless
+ ** a checkpoint is committed while the previous one is still being written; commit() then
+ ** waits for it (a stall), so at most one checkpoint is written at a time.
+ **
+ ** Each checkpoint replaces the previous one in the same file.  It is written to a temporary
+ ** file (the name with .tmp appended) that is renamed once it is complete, so an interrupted
+ ** run always leaves a whole checkpoint behind.
+ **
+ ** With a base interval of M > 1, only every M-th checkpoint is written in full (a base); the
+ ** ones in between are written as the difference to the last base (see CheckpointDelta) to
+ ** the delta file, whose name has .delta appended, in the same way.  The base is kept in a
+ ** third Checkpoint, so each delta is encoded by the writer thread against the base in
+ ** memory, and only needs the base file and the latest delta file to be read back.  Once a
+ ** new base is written, the delta file of the previous one is removed.
+ **
+ ** The arrays of bases and deltas can be packed (see SimStateWriter), by the writer thread,
+ ** so packing does not hold up the simulation either.
+ **
+ ** If the writer thread cannot be started, checkpoints are written by commit().
+ **
+ ** \latexonly	\subsubsection*{Credits} \endlatexonly
+ ** \htmlonly	<h3>Credits</h3> \endhtmlonly
+ **
+ ** This simulator is a rewrite of CSIM (2006) and other work (Stiber and Kawasaki (2007?))
+ **/
+
+#pragma once
+
+#ifndef _CHECKPOINTWRITER_H_
+#define _CHECKPOINTWRITER_H_
+
+#include "global.h"
+#include "Checkpoint.h"
+#include "CheckpointDelta.h"
+#include "Thread.h"
+#include "Timer.h"
+
+class CheckpointWriter
+{
+public:
+    //! The constructor for CheckpointWriter.
+    CheckpointWriter(const string& fileName, int baseInterval, bool fPack);
+    ~CheckpointWriter();
+
+    //! The checkpoint to capture the next state into.
+    Checkpoint& next();
+
+    //! Write the checkpoint returned by next() in the background.
+    void commit(int growthStep);
+
+    //! Write the committed checkpoint and stop the writer thread.
+    void close();
+
+    //! Print the number of checkpoints written and the time spent.
+    void printStats(ostream& os);
+
+private:
+    //! The checkpoint to capture into after one is committed.
+    int nextCheckpoint(int iCommitted) const;
+
+    //! Entry point of the writer thread.
+    static void writerThread(void* pWriter);
+
+    //! Write committed checkpoints until the writer is closed.
+    void writeCheckpoints();
+
+    //! Write a checkpoint as a base or as a delta.
+    void writeCheckpoint(int iCheckpoint);
+
+    //! Write a checkpoint to the temporary file and rename it.
+    bool writeFile(const Checkpoint& checkpoint, const string& fileName, uint64_t& cBytes);
+
+    //! Name of the checkpoint file.
+    string m_fileName;
+
+    //! Number of checkpoints from one base to the next; 1 if every checkpoint is a base.
+    int m_baseInterval;
+
+    //! True if the arrays of the checkpoint files are packed.
+    bool m_fPack;
+
+    //! The checkpoints and the growth step of each; the third one is only used for a base.
+    Checkpoint m_rgCheckpoints[3];
+    int m_rgGrowthStep[3];
+
+    //! The checkpoint next() returns.
+    int m_iNext;
+
+    //! The last base written, or -1; only changed by the writer.
+    int m_iBase;
+
+    //! The checkpointId of the last base, and the number of deltas written since.
+    uint64_t m_baseId;
+    int m_cDeltas;
+
+    //! The delta being written.
+    Checkpoint m_delta;
+
+    //! The committed checkpoint that is not written yet, or -1.
+    int m_iPending;
+
+    //! Protects m_iPending, m_iBase, m_fClosing and the statistics.
+    Mutex m_mutex;
+
+    //! Signaled when a checkpoint is committed or the writer is closed.
+    Condition m_committed;
+
+    //! Signaled when a checkpoint has been written.
+    Condition m_written;
+
+    //! True once close() has been called.
+    bool m_fClosing;
+
+    //! Number of checkpoints written, how many of them as deltas, and the last growth step written.
+    int m_cWritten;
+    int m_cDeltasWritten;
+    int m_lastGrowthStep;
+
+    //! Bytes written in full checkpoints and in deltas.
+    uint64_t m_cBaseBytes;
+    uint64_t m_cDeltaBytes;
+
+    //! Time spent writing and waiting for a write to finish (s), and the number of waits.
+    double m_writeTime;
+    double m_stallTime;
+    int m_cStalls;
+
+    //! Measures the time spent writing and waiting.
+    Timer m_writeTimer;
+    Timer m_stallTimer;
+
+    //! The writer thread.
+    Thread m_thread;
+
+    CheckpointWriter(const CheckpointWriter&);
+    CheckpointWriter& operator=(const CheckpointWriter&);
+};
+
+#endif // _CHECKPOINTWRITER_H_
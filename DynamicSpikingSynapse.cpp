@@ -15,15 +15,16 @@
  * @param[in] source_y	The location(y) of the synapse.
  * @param[in] sumX	The coordinates(x) of the summation point. 
  * @param[in] sumY	The coordinates(y) of the summation point.
- * @param[in] delay	The synaptic transmission delay (sec).
+ * @param[in] delay	The axonal conduction delay (sec), added to the synaptic delay of the type.
  * @param[in] new_deltaT The time step size (sec).
  * @param[in] s_type	Synapse type.
+ * @param[out] pfDelayClipped	If not NULL, set to whether the delay was clipped to fit the delay queue.
  */
 DynamicSpikingSynapse::DynamicSpikingSynapse(int source_x, int source_y, 
                                              int sumX, int sumY, 
                                              FLOAT& sum_point,
                                              FLOAT delay, FLOAT new_deltaT, 
-                                             synapseType s_type) :
+                                             synapseType s_type, bool* pfDelayClipped) :
     summationPoint( sum_point ),
     deltaT( new_deltaT ),
     W( 10.0e-9 ),
@@ -36,6 +37,7 @@ DynamicSpikingSynapse::DynamicSpikingSynapse(int source_x, int source_y,
     D( 1.0 ),
     U( DEFAULT_U ),
     F( 0.01 ),
+    fRemoved( false ),
     lastSpike( ULONG_MAX )
 {
 	synapseCoord.x = source_x;
@@ -50,28 +52,28 @@ DynamicSpikingSynapse::DynamicSpikingSynapse(int source_x, int source_y,
 		D = 0.144;
 		F = 0.06;
 		tau = 6e-3;
-		delay = 0.8e-3;
+		delay += 0.8e-3;
 		break;
 	case IE:
 		U = 0.25;
 		D = 0.7;
 		F = 0.02;
 		tau = 6e-3;
-		delay = 0.8e-3;
+		delay += 0.8e-3;
 		break;
 	case EI:
 		U = 0.05;
 		D = 0.125;
 		F = 1.2;
 		tau = 3e-3;
-		delay = 0.8e-3;
+		delay += 0.8e-3;
 		break;
 	case EE:
 		U = 0.5;
 		D = 1.1;
 		F = 0.05;
 		tau = 3e-3;
-		delay = 1.5e-3;
+		delay += 1.5e-3;
 		break;
 	default:
 		assert( false );
@@ -80,6 +82,13 @@ DynamicSpikingSynapse::DynamicSpikingSynapse(int source_x, int source_y,
 	// calculate the discrete delay (time steps)
 	FLOAT tmpFLOAT = ( delay / new_deltaT);	//needed to be done in 2 lines or may cause incorrect results in linux
 	total_delay = static_cast<int> (tmpFLOAT) + 1;
+	bool fClipped = total_delay >= static_cast<int>(MAX_LENGTH_OF_DELAYQUEUE);
+	if (fClipped) {
+		total_delay = MAX_LENGTH_OF_DELAYQUEUE - 1;
+	}
+	if (pfDelayClipped != NULL) {
+		*pfDelayClipped = fClipped;
+	}
 
 	// initialize spike queue
 	initSpikeQueue();
@@ -87,6 +96,45 @@ DynamicSpikingSynapse::DynamicSpikingSynapse(int source_x, int source_y,
 	reset( );
 }
 
+/**
+ * Create a synapse with no state; the state is restored by the caller (see Checkpoint).
+ * @param[in] source_x	The location(x) of the synapse.
+ * @param[in] source_y	The location(y) of the synapse.
+ * @param[in] sumX	The coordinates(x) of the summation point. 
+ * @param[in] sumY	The coordinates(y) of the summation point.
+ * @param[in] sum_point	The summation point.
+ * @param[in] s_type	Synapse type.
+ */
+DynamicSpikingSynapse::DynamicSpikingSynapse(int source_x, int source_y, 
+                                             int sumX, int sumY, 
+                                             FLOAT& sum_point,
+                                             synapseType s_type) :
+    summationPoint( sum_point ),
+    deltaT( 0 ),
+    W( 0 ),
+    psr( 0 ),
+    decay( 0 ),
+    total_delay( 0 ),
+    delayIdx( 0 ),
+    ldelayQueue( LENGTH_OF_DELAYQUEUE ),
+    type( s_type ),
+    tau( 0 ),
+    r( 0 ),
+    u( 0 ),
+    D( 0 ),
+    U( 0 ),
+    F( 0 ),
+    fRemoved( false ),
+    lastSpike( ULONG_MAX )
+{
+	synapseCoord.x = source_x;
+	synapseCoord.y = source_y;
+	summationCoord.x = sumX;
+	summationCoord.y = sumY;
+	for (int i = 0; i < WORDS_OF_DELAYQUEUE; i++)
+		delayQueue[i] = 0;
+}
+
 DynamicSpikingSynapse::~DynamicSpikingSynapse() {
 }
 
@@ -99,9 +147,10 @@ DynamicSpikingSynapse::DynamicSpikingSynapse(const DynamicSpikingSynapse &other)
 	summationPoint( other.summationPoint ), summationCoord( other.summationCoord ), synapseCoord( other.synapseCoord ),
 			deltaT( other.deltaT ), W( other.W ), psr( other.psr ), decay( other.decay ), total_delay( other.total_delay ), 
 					delayIdx( other.delayIdx ), ldelayQueue( other.ldelayQueue ), type( other.type ),
-					tau( other.tau ), r( other.r ), u( other.u ), D( other.D ), U( other.U ), F( other.F ), lastSpike(
-					other.lastSpike ) {
-	delayQueue[0] = other.delayQueue[0];
+					tau( other.tau ), r( other.r ), u( other.u ), D( other.D ), U( other.U ), F( other.F ), fRemoved(
+					other.fRemoved ), lastSpike( other.lastSpike ) {
+	for (int i = 0; i < WORDS_OF_DELAYQUEUE; i++)
+		delayQueue[i] = other.delayQueue[i];
 }
 
 /**
@@ -118,6 +167,17 @@ DynamicSpikingSynapse& DynamicSpikingSynapse::operator=(const DynamicSpikingSyna
 	return *this;
 }
 
+/**
+ * The longest axonal delay that the delay queue holds: the synaptic delay of the type
+ * (1.5 ms for EE, the longest) is added to it, and the sum discretized must fit in
+ * MAX_LENGTH_OF_DELAYQUEUE - 1 time steps.
+ * @param[in] deltaT	The time step size.
+ * @return the longest axonal delay (sec).
+ */
+FLOAT DynamicSpikingSynapse::maxAxonalDelay(FLOAT deltaT) {
+	return ( MAX_LENGTH_OF_DELAYQUEUE - 1 ) * deltaT - 1.5e-3;
+}
+
 /**
  * Reset time varying state vars and recompute decay.
  */
@@ -140,18 +200,12 @@ void DynamicSpikingSynapse::preSpikeHit() {
 /**
  * If an input spike is in the queue, adjust synapse parameters, calculate psr.
  * Decay the post spike response(psr), and apply it to the summation point.
+ * @param[in] step	The current time step.
  */
-void DynamicSpikingSynapse::advance() {
+void DynamicSpikingSynapse::advance( uint64_t step ) {
 	// is an input in the queue?
 	if (isSpikeQueue()) {
-		// adjust synapse paramaters
-		if (lastSpike != ULONG_MAX) {
-			FLOAT isi = (g_simulationStep - lastSpike) * deltaT ;
-			r = 1 + ( r * ( 1 - u ) - 1 ) * exp( -isi / D );
-			u = U + u * ( 1 - U ) * exp( -isi / F );
-		}
-		psr += ( ( W / decay ) * u * r );// calculate psr
-		lastSpike = g_simulationStep; // record the time of the spike
+		psr += spikeResponse( step ); // calculate psr
 	}
 
 	// decay the post spike response
@@ -167,6 +221,23 @@ void DynamicSpikingSynapse::advance() {
 #endif
 }
 
+/**
+ * Adjust the facilitation and depression of the synapse for a spike that arrives at
+ * the given time step, and record the time of the spike.
+ * @param[in] step	The time step at which the spike arrives.
+ * @return the increment of the psr caused by the spike.
+ */
+FLOAT DynamicSpikingSynapse::spikeResponse( uint64_t step ) {
+	// adjust synapse paramaters
+	if (lastSpike != ULONG_MAX) {
+		FLOAT isi = (step - lastSpike) * deltaT ;
+		r = 1 + ( r * ( 1 - u ) - 1 ) * exp( -isi / D );
+		u = U + u * ( 1 - U ) * exp( -isi / F );
+	}
+	lastSpike = step; // record the time of the spike
+	return ( ( W / decay ) * u * r );
+}
+
 /**
  * Recompute decay.
  * @return true if success.
@@ -184,11 +255,12 @@ bool DynamicSpikingSynapse::updateInternal() {
  */
 void DynamicSpikingSynapse::initSpikeQueue()
 {
-	size_t size = total_delay / ( sizeof(uint8_t) * 8 ) + 1;
-	assert( size <= BYTES_OF_DELAYQUEUE );
-	delayQueue[0] = 0;
+	size_t size = total_delay / LENGTH_OF_DELAYQUEUE + 1;
+	assert( size <= WORDS_OF_DELAYQUEUE );
+	for (int i = 0; i < WORDS_OF_DELAYQUEUE; i++)
+		delayQueue[i] = 0;
 	delayIdx = 0;
-	ldelayQueue = LENGTH_OF_DELAYQUEUE;
+	ldelayQueue = size * LENGTH_OF_DELAYQUEUE;
 }
 
 /**
@@ -202,8 +274,10 @@ void DynamicSpikingSynapse::addSpikeQueue()
 		idx -= ldelayQueue;
 
 	// set a spike
-	assert( !(delayQueue[0] & (0x1 << idx)) );
-	delayQueue[0] |= (0x1 << idx);
+	uint32_t& word = delayQueue[idx / LENGTH_OF_DELAYQUEUE];
+	uint32_t bmask = 0x1 << (idx % LENGTH_OF_DELAYQUEUE);
+	assert( !(word & bmask) );
+	word |= bmask;
 }
 
 /**
@@ -213,90 +287,11 @@ void DynamicSpikingSynapse::addSpikeQueue()
  */
 bool DynamicSpikingSynapse::isSpikeQueue()
 {
-	bool r = delayQueue[0] & (0x1 << delayIdx);
-	delayQueue[0] &= ~(0x1 << delayIdx);
+	uint32_t& word = delayQueue[delayIdx / LENGTH_OF_DELAYQUEUE];
+	uint32_t bmask = 0x1 << (delayIdx % LENGTH_OF_DELAYQUEUE);
+	bool r = word & bmask;
+	word &= ~bmask;
 	if ( ++delayIdx >= ldelayQueue )
 		delayIdx = 0;
 	return r;
 }
-
-/**
- * Write the synapse data to the stream
- * @param[in] os	The filestream to write
- */
-void DynamicSpikingSynapse::write( ostream& os ) {
-	os.write( reinterpret_cast<const char*>(&summationCoord), sizeof(summationCoord) );
-	os.write( reinterpret_cast<const char*>(&synapseCoord), sizeof(synapseCoord) );
-	os.write( reinterpret_cast<const char*>(&deltaT), sizeof(deltaT) );
-	os.write( reinterpret_cast<const char*>(&W), sizeof(W) );
-	os.write( reinterpret_cast<const char*>(&psr), sizeof(psr) );
-	os.write( reinterpret_cast<const char*>(&decay), sizeof(decay) );
-	os.write( reinterpret_cast<const char*>(&total_delay), sizeof(total_delay) );
-	os.write( reinterpret_cast<const char*>(delayQueue), sizeof(uint32_t) );
-	os.write( reinterpret_cast<const char*>(&delayIdx), sizeof(delayIdx) );
-	os.write( reinterpret_cast<const char*>(&ldelayQueue), sizeof(ldelayQueue) );
-	os.write( reinterpret_cast<const char*>(&type), sizeof(type) );
-	os.write( reinterpret_cast<const char*>(&tau), sizeof(tau) );
-	os.write( reinterpret_cast<const char*>(&r), sizeof(r) );
-	os.write( reinterpret_cast<const char*>(&u), sizeof(u) );
-	os.write( reinterpret_cast<const char*>(&D), sizeof(D) );
-	os.write( reinterpret_cast<const char*>(&U), sizeof(U) );
-	os.write( reinterpret_cast<const char*>(&F), sizeof(F) );
-	os.write( reinterpret_cast<const char*>(&lastSpike), sizeof(lastSpike) );
-}
-
-/**
- * Read the synapse data from the stream
- * @param[in] os	The filestream to read
- */
-void DynamicSpikingSynapse::read( istream& is, FLOAT* pSummationMap, int width, vector<DynamicSpikingSynapse>* pSynapseMap ) {
-	Coordinate t_summationCoord, t_synapseCoord;
-	FLOAT t_deltaT, t_W, t_psr, t_decay, t_tau, t_r, t_u, t_D, t_U, t_F;
-	int t_total_delay, t_delayIdx, t_ldelayQueue;
-	uint32_t t_delayQueue[1];
-	uint64_t t_lastSpike;
-	synapseType t_type;
-
-	is.read( reinterpret_cast<char*>(&t_summationCoord), sizeof(t_summationCoord) );
-	is.read( reinterpret_cast<char*>(&t_synapseCoord), sizeof(t_synapseCoord) );
-	is.read( reinterpret_cast<char*>(&t_deltaT), sizeof(t_deltaT) );
-	is.read( reinterpret_cast<char*>(&t_W), sizeof(t_W) );
-	is.read( reinterpret_cast<char*>(&t_psr), sizeof(t_psr) );
-	is.read( reinterpret_cast<char*>(&t_decay), sizeof(t_decay) );
-	is.read( reinterpret_cast<char*>(&t_total_delay), sizeof(t_total_delay) );
-	is.read( reinterpret_cast<char*>(t_delayQueue), sizeof(uint32_t) );
-	is.read( reinterpret_cast<char*>(&t_delayIdx), sizeof(t_delayIdx) );
-	is.read( reinterpret_cast<char*>(&t_ldelayQueue), sizeof(t_ldelayQueue) );
-	is.read( reinterpret_cast<char*>(&t_type), sizeof(t_type) );
-	is.read( reinterpret_cast<char*>(&t_tau), sizeof(t_tau) );
-	is.read( reinterpret_cast<char*>(&t_r), sizeof(t_r) );
-	is.read( reinterpret_cast<char*>(&t_u), sizeof(t_u) );
-	is.read( reinterpret_cast<char*>(&t_D), sizeof(t_D) );
-	is.read( reinterpret_cast<char*>(&t_U), sizeof(t_U) );
-	is.read( reinterpret_cast<char*>(&t_F), sizeof(t_F) );
-	is.read( reinterpret_cast<char*>(&t_lastSpike), sizeof(t_lastSpike) );
-
-	// locate summation point
-	FLOAT* sp = &(pSummationMap[t_summationCoord.x + t_summationCoord.y * width]);
-
-	// create synapse
-	DynamicSpikingSynapse syn(t_synapseCoord.x, t_synapseCoord.y, t_summationCoord.x, t_summationCoord.y, *sp, DEFAULT_delay_weight, t_deltaT, t_type);
-
-	// copy read values
-	syn.W = t_W;
-	syn.psr = t_psr;
-	syn.decay = t_decay;
-	syn.total_delay = t_total_delay;
-	syn.delayQueue[0] = t_delayQueue[0];
-	syn.delayIdx = t_delayIdx;
-	syn.ldelayQueue = t_ldelayQueue;
-	syn.tau = t_tau;
-	syn.r = t_r;
-	syn.u = t_u;
-	syn.D = t_D;
-	syn.U = t_U;
-	syn.F = t_F;
-	syn.lastSpike = t_lastSpike;
-
-	pSynapseMap[t_synapseCoord.x + t_synapseCoord.y * width].push_back(syn);
-}
@@ -36,7 +36,9 @@ public:
 
     //! Constructor, with params.
     DynamicSpikingSynapse( int source_x, int source_y, int sumX, int sumY, FLOAT& sum_point, FLOAT delay, FLOAT deltaT,
-                           synapseType type );
+                           synapseType type, bool* pfDelayClipped = NULL );
+    //! Constructor for a synapse whose state is restored by the caller (see Checkpoint).
+    DynamicSpikingSynapse( int source_x, int source_y, int sumX, int sumY, FLOAT& sum_point, synapseType type );
     ~DynamicSpikingSynapse();
 
     //! Copy constructor.
@@ -45,6 +47,9 @@ public:
     //! Overloaded = operator.
     DynamicSpikingSynapse& operator= ( const DynamicSpikingSynapse &rhs );
 
+    //! The longest axonal delay (sec) that the delay queue holds for a synapse of any type.
+    static FLOAT maxAxonalDelay( FLOAT deltaT );
+
     //! Reset the synapse state.
     void reset();
 
@@ -52,7 +57,10 @@ public:
     void preSpikeHit();
 
     //! Advance a single time step.
-    void advance();
+    void advance( uint64_t step );
+
+    //! Update facilitation and depression for a spike arriving at the given step.
+    FLOAT spikeResponse( uint64_t step );
 
     //! Advance a single time step.
     void advance( FLOAT*& summationMap, int width );
@@ -69,12 +77,6 @@ public:
     //! Update the internal state.
     bool updateInternal();
 
-    //! Write the synapse data to the stream
-    void write( ostream& os );
-
-    //! Read the neuron data from the stream
-    static void read( istream& is, FLOAT* pSummationMap, int width, vector<DynamicSpikingSynapse>* pSynapseMap );
-
     //! This synapse's summation point's address.
     FLOAT& summationPoint;
 
@@ -97,8 +99,18 @@ public:
     int total_delay; 
     #define BYTES_OF_DELAYQUEUE         ( sizeof(uint32_t) / sizeof(uint8_t) )
     #define LENGTH_OF_DELAYQUEUE        ( BYTES_OF_DELAYQUEUE * 8 )
-    //! The delayed queue
-    uint32_t delayQueue[1];
+    // Distance-dependent delays may need more than one word of time slots; synapses
+    // whose delay fits in one word (all of them with fixed delays, and the GPU
+    // simulator) only ever touch delayQueue[0].  The queue holds delays of up to
+    // MAX_LENGTH_OF_DELAYQUEUE - 1 steps (9.5 ms at the default time step), so
+    // LoadSimParms rejects conduction velocities that need longer ones (see
+    // maxAxonalDelay()).  Every synapse carries all the words, whatever its delay;
+    // with fRemoved placed before lastSpike, they take the room that was padding,
+    // and a synapse is no larger than with a single word.
+    #define WORDS_OF_DELAYQUEUE         3
+    #define MAX_LENGTH_OF_DELAYQUEUE    ( WORDS_OF_DELAYQUEUE * LENGTH_OF_DELAYQUEUE )
+    //! The delayed queue (one bit per time slot)
+    uint32_t delayQueue[WORDS_OF_DELAYQUEUE];
     //! The index indicating the current time slot in the delayed queue
     int delayIdx;
     //! Length of the delayed queue
@@ -120,6 +132,9 @@ public:
     FLOAT U;
     //! The time constant of the facilitation of the dynamic synapse [range=(0,10); units=sec].
     FLOAT F;
+    //! True if the synapse has been pruned and is waiting to be removed from its list.
+    bool fRemoved;
+
     //! The time of the last spike.
     uint64_t lastSpike;
 
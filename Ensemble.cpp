@@ -0,0 +1,137 @@
+/**
+ *	\file Ensemble.cpp
+ *
+ *	\brief Runs replicas of a loaded network as child processes (warm-start ensembles).
+ */
+#include "Ensemble.h"
+#include "ChildProcesses.h"
+#include "Thread.h"
+#include <algorithm>
+
+/**
+ * Reports the batches of an ensemble as their child processes exit, and counts the replicas
+ * that failed.
+ */
+class BatchListener : public IJobListener
+{
+public:
+    BatchListener(int cReplicas, int cLanes) :
+        m_cReplicas(cReplicas),
+        m_cLanes(cLanes),
+        m_cFailed(0)
+    {
+    }
+
+    virtual void finished(int first, int status, double seconds)
+    {
+        string name = Ensemble::batchName(first, m_cReplicas, m_cLanes);
+        if (status == EXIT_SUCCESS)
+        {
+            cout << name << " done" << endl;
+            return;
+        }
+
+        if (status < 0)
+        {
+            cerr << "Cannot run " << name << endl;
+        }
+        else
+        {
+            cerr << name << " failed" << endl;
+        }
+        m_cFailed += Ensemble::batchSize(first, m_cReplicas, m_cLanes);
+    }
+
+    //! Number of replicas that did not finish successfully.
+    int getFailed() const { return m_cFailed; }
+
+private:
+    int m_cReplicas;
+    int m_cLanes;
+    int m_cFailed;
+};
+
+/**
+ * Start a child process for each batch of cLanes replicas, as many at a time as there are
+ * cores, and wait for them (see ChildProcesses).  The children return from this function and
+ * run the replicas of their batch; the parent returns once all of them have exited.
+ * @param[in] cReplicas	Number of replicas.
+ * @param[in] cLanes	Number of replicas a child runs (see LaneSim); the last batch may be smaller.
+ * @return the first replica of the batch to run, in a child; -1 in the parent.
+ * @throws KII_exception in the parent if a replica could not be run or failed.
+ */
+int Ensemble::forkReplicas(int cReplicas, int cLanes)
+{
+#ifdef _WIN32
+    throw KII_exception("Ensembles are not supported on Windows");
+#else
+    vector<int> rgFirst;
+    for (int first = 0; first < cReplicas; first += cLanes)
+    {
+        rgFirst.push_back(first);
+    }
+
+    BatchListener listener(cReplicas, cLanes);
+    int first = ChildProcesses::run(rgFirst, Thread::hardwareConcurrency(), listener);
+    if (first >= 0)
+    {
+        return first;
+    }
+
+    if (listener.getFailed() > 0)
+    {
+        stringstream ss;
+        ss << listener.getFailed() << " of " << cReplicas << " replicas failed";
+        throw KII_exception(ss.str());
+    }
+    return -1;
+#endif
+}
+
+/**
+ * The number of replicas of the batch that starts with a replica.
+ * @param[in] first	The first replica of the batch.
+ * @param[in] cReplicas	Number of replicas.
+ * @param[in] cLanes	Number of replicas in a batch.
+ * @return the number of replicas of the batch.
+ */
+int Ensemble::batchSize(int first, int cReplicas, int cLanes)
+{
+    return min(cLanes, cReplicas - first);
+}
+
+/**
+ * A name of the batch that starts with a replica, for messages.
+ * @param[in] first	The first replica of the batch.
+ * @param[in] cReplicas	Number of replicas.
+ * @param[in] cLanes	Number of replicas in a batch.
+ * @return "Replica 3" or "Replicas 4-7".
+ */
+string Ensemble::batchName(int first, int cReplicas, int cLanes)
+{
+    stringstream ss;
+    int cBatch = batchSize(first, cReplicas, cLanes);
+    if (cBatch == 1)
+    {
+        ss << "Replica " << first;
+    }
+    else
+    {
+        ss << "Replicas " << first << "-" << first + cBatch - 1;
+    }
+    return ss.str();
+}
+
+/**
+ * The name of an output file of a replica: the name of the file of a simulation that is not
+ * an ensemble, with .r and the replica before its extension (out.xml becomes out.r3.xml).
+ * @param[in] fileName	The name of the file.
+ * @param[in] replica	The replica.
+ * @return the name of the file of the replica.
+ */
+string Ensemble::replicaFileName(const string& fileName, int replica)
+{
+    stringstream ss;
+    ss << ".r" << replica;
+    return ChildProcesses::tagFileName(fileName, ss.str());
+}
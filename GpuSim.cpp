@@ -11,6 +11,8 @@
 #include "global.h"
 #include "GpuSim.h"
 #include "LifNeuron_struct.h"
+#include "SpikeRecorder.h"
+#include "SpikeHistogram.h"
 
 extern "C" {
 void advanceGPU( 
@@ -205,12 +207,14 @@ void GpuSim::advanceUntilGrowth(SimulationInfo* psi)
 	// record spike time
 	getSpikeCounts(neuron_count, spikeCounts);
 	for (int i = 0; i < neuron_count; i++) {
-		LifNeuron& neuron = (*(psi->pNeuronList))[i];
-		if (spikeCounts[i] > 0) {
-			assert(spikeCounts[i] < maxSpikes);
-			neuron.spikeHistory.insert(neuron.spikeHistory.end(), 
-					&(spikeArray[i * maxSpikes]), 
-					&(spikeArray[(i * maxSpikes) + spikeCounts[i]])); 
+		assert(spikeCounts[i] < maxSpikes);
+		for (int j = 0; j < spikeCounts[i]; j++) {
+			if (psi->pSpikeHistogram != NULL) {
+				psi->pSpikeHistogram->count(0, spikeArray[i * maxSpikes + j]);
+			}
+			if (psi->pSpikeRecorder != NULL) {
+				psi->pSpikeRecorder->record(0, i, spikeArray[i * maxSpikes + j]);
+			}
 		}
 	}
 #endif // STORE_SPIKEHISTORY
@@ -287,15 +291,15 @@ void GpuSim::printComparison(LifNeuron_struct& neuron_st, vector<LifNeuron>* neu
 
 /**
  * Calculate growth cycle firing rate for previous period.
- * Compute neuron radii change, assign new values, and record the radius to histroy matrix.
+ * Compute neuron radii change, assign new values, and return the new radii and rates.
  * Update distance between frontiers, and compute areas of overlap. 
  * Adjust the strength of the synapse or remove it from the synapse map if it has gone below 
  * zero, that is done by GPU kernel functions simultaneously.
  * @param[in] psi	Pointer to the simulation information.
- * @param[in] radiiHistory	Matrix to save radius history.
- * @param[in] ratesHistory	Matrix to save firing rate history.
+ * @param[out] newRadii	Receives the new radius of each neuron.
+ * @param[out] newRates	Receives the firing rate of each neuron.
  */
-void GpuSim::updateNetwork(SimulationInfo* psi, CompleteMatrix& radiiHistory, CompleteMatrix& ratesHistory)
+void GpuSim::updateNetwork(SimulationInfo* psi, VectorMatrix& newRadii, VectorMatrix& newRates)
 {
     int neuron_count = psi->cNeurons;
 
@@ -307,8 +311,8 @@ void GpuSim::updateNetwork(SimulationInfo* psi, CompleteMatrix& radiiHistory, Co
         // Calculate firing rate
         rates[i] = spikeCounts[i] / psi->stepDuration;
 
-        // record firing rate to history matrix
-        ratesHistory(psi->currentStep, i) = rates[i];
+        // return the firing rate
+        newRates[i] = rates[i];
     }
 
     // clear spike count
@@ -319,15 +323,15 @@ void GpuSim::updateNetwork(SimulationInfo* psi, CompleteMatrix& radiiHistory, Co
     deltaR = psi->stepDuration * psi->rho * outgrowth;
     radii += deltaR;
 
-    // Cap minimum radius size and record radii to history matrix
+    // Cap minimum radius size and return the radii
     for (int i = 0; i < radii.Size(); i++)
     {
         // TODO: find out why we cap this here.
         if (radii[i] < psi->minRadius)
             radii[i] = psi->minRadius;
 
-        // record radius to history matrix
-        radiiHistory(psi->currentStep, i) = radii[i];
+        // return the radius
+        newRadii[i] = radii[i];
 
         DEBUG2(cout << "radii[" << i << ":" << radii[i] << "]" << endl;);
     }
@@ -54,7 +54,7 @@ public:
     virtual void advanceUntilGrowth(SimulationInfo* psi);
 
     //! Updates the network.
-    virtual void updateNetwork(SimulationInfo* psi, CompleteMatrix& radiiHistory, CompleteMatrix& ratesHistory);
+    virtual void updateNetwork(SimulationInfo* psi, VectorMatrix& newRadii, VectorMatrix& newRates);
 
 #ifdef STORE_SPIKEHISTORY
     //! pointer to an array to keep spike history for one activity epoch
@@ -161,7 +161,7 @@ void allocDeviceStruct( SimulationInfo* psi,
 		)
 {
 	// Set device ID
-	HANDLE_ERROR( cudaSetDevice( g_deviceId ) );
+	HANDLE_ERROR( cudaSetDevice( psi->pContext->deviceId ) );
 
 	// CUDA parameters
 	const int threadsPerBlock = 256;
@@ -241,9 +241,9 @@ void advanceGPU( SimulationInfo* psi, int maxSynapses )
 	int synapse_count = neuron_count * maxSynapses;
 
         // simulate to next growth cycle
-        uint64_t endStep = g_simulationStep + static_cast<uint64_t>(psi->stepDuration / deltaT);
+        uint64_t endStep = psi->pContext->simulationStep + static_cast<uint64_t>(psi->stepDuration / deltaT);
 	
-	DEBUG(cout << "Beginning GPU sim cycle, simTime = " << g_simulationStep * deltaT << ", endTime = " << endStep * deltaT << endl;)
+	DEBUG(cout << "Beginning GPU sim cycle, simTime = " << psi->pContext->simulationStep * deltaT << ", endTime = " << endStep * deltaT << endl;)
 
 	// CUDA parameters
 	const int threadsPerBlock = 256;
@@ -262,12 +262,12 @@ void advanceGPU( SimulationInfo* psi, int maxSynapses )
 	cudaEventCreate( &start );
 	cudaEventCreate( &stop ); 
 #endif // PERFORMANCE_METRICS
-	while ( g_simulationStep < endStep )
+	while ( psi->pContext->simulationStep < endStep )
 	{
         	DEBUG( if (count %1000 == 0)
               	{
                   	cout << psi->currentStep << "/" << psi->maxSteps
-                      		<< " simulating time: " << g_simulationStep * deltaT << endl;
+                      		<< " simulating time: " << psi->pContext->simulationStep * deltaT << endl;
                   	count = 0;
               	}
 
@@ -291,9 +291,9 @@ void advanceGPU( SimulationInfo* psi, int maxSynapses )
 		cudaEventRecord( start, 0 );
 #endif // PERFORMANCE_METRICS
 #ifdef STORE_SPIKEHISTORY
-		advanceNeuronsDevice <<< blocksPerGrid, threadsPerBlock >>> ( neuron_count, spikeHistory_d, g_simulationStep, maxSpikes, delayIdx.getIndex(), maxSynapses );
+		advanceNeuronsDevice <<< blocksPerGrid, threadsPerBlock >>> ( neuron_count, spikeHistory_d, psi->pContext->simulationStep, maxSpikes, delayIdx.getIndex(), maxSynapses );
 #else
-		advanceNeuronsDevice <<< blocksPerGrid, threadsPerBlock >>> ( neuron_count, g_simulationStep, delayIdx.getIndex(), maxSynapses );
+		advanceNeuronsDevice <<< blocksPerGrid, threadsPerBlock >>> ( neuron_count, psi->pContext->simulationStep, delayIdx.getIndex(), maxSynapses );
 #endif // STORE_SPIKEHISTORY
 #ifdef PERFORMANCE_METRICS
 		cudaEventRecord( stop, 0 );
@@ -308,7 +308,7 @@ void advanceGPU( SimulationInfo* psi, int maxSynapses )
 		cudaEventRecord( start, 0 );
 #endif // PERFORMANCE_METRICS
 		uint32_t bmask = delayIdx.getBitmask(  );
-		advanceSynapsesDevice <<< blocksPerGrid, threadsPerBlock >>> ( synapse_count, width, g_simulationStep, bmask );
+		advanceSynapsesDevice <<< blocksPerGrid, threadsPerBlock >>> ( synapse_count, width, psi->pContext->simulationStep, bmask );
 #ifdef PERFORMANCE_METRICS
 		cudaEventRecord( stop, 0 );
 		cudaEventSynchronize( stop );
@@ -330,7 +330,7 @@ void advanceGPU( SimulationInfo* psi, int maxSynapses )
 #endif // PERFORMANCE_METRICS
 
 		// Advance the clock
-		g_simulationStep++;
+		psi->pContext->simulationStep++;
 		// Advance the delayed queue index
 		delayIdx.inc();
 	}
@@ -0,0 +1,56 @@
+/**
+ *	\file GrowthFileWriter.cpp
+ *
+ *	\brief Streams the radii and firing rates of each growth step to a binary file.
+ */
+#include "GrowthFileWriter.h"
+#include <cstring>
+
+/**
+ * Queue the file header.
+ * @param[in] pipeline	Writes the blocks.
+ * @param[in] os	The binary output stream.
+ * @param[in] cNeurons	Number of neurons.
+ * @param[in] growthStepDuration	Duration of a growth step.
+ */
+GrowthFileWriter::GrowthFileWriter(OutputPipeline& pipeline, ostream& os, int cNeurons, FLOAT growthStepDuration) :
+    m_pipeline(pipeline),
+    m_os(os),
+    m_cNeurons(cNeurons)
+{
+    uint32_t version = GROWTH_FILE_VERSION;
+    float duration = growthStepDuration;
+
+    vector<char>* pHeader = new vector<char>;
+    pHeader->insert(pHeader->end(), "BGGROWTH", "BGGROWTH" + 8);
+    pHeader->insert(pHeader->end(), reinterpret_cast<const char*>(&version),
+            reinterpret_cast<const char*>(&version) + sizeof(version));
+    pHeader->insert(pHeader->end(), reinterpret_cast<const char*>(&cNeurons),
+            reinterpret_cast<const char*>(&cNeurons) + sizeof(cNeurons));
+    pHeader->insert(pHeader->end(), reinterpret_cast<const char*>(&duration),
+            reinterpret_cast<const char*>(&duration) + sizeof(duration));
+    m_pipeline.write(m_os, pHeader);
+}
+
+/**
+ * Copy the radii and rates of a growth step into a block and hand it to the pipeline.
+ * @param[in] step	The growth step.
+ * @param[in] radii	The radius of each neuron.
+ * @param[in] rates	The firing rate of each neuron.
+ */
+void GrowthFileWriter::writeStep(int step, const VectorMatrix& radii, const VectorMatrix& rates)
+{
+    uint32_t uStep = step;
+    vector<char>* pBlock = new vector<char>(sizeof(uStep) + 2 * m_cNeurons * sizeof(float));
+    char* p = &(*pBlock)[0];
+
+    memcpy(p, &uStep, sizeof(uStep));
+    float* rgValues = reinterpret_cast<float*>(p + sizeof(uStep));
+    for (int i = 0; i < m_cNeurons; i++)
+    {
+        rgValues[i] = rates[i];
+        rgValues[m_cNeurons + i] = radii[i];
+    }
+
+    m_pipeline.write(m_os, pBlock);
+}
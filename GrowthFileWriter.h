@@ -0,0 +1,72 @@
+/**
+ *	@file GrowthFileWriter.h
+ *
+ *	@brief Header file for GrowthFileWriter.
+ */
+//! Streams the radii and firing rates of each growth step to a binary file.
+
+/**
+ ** \class GrowthFileWriter GrowthFileWriter.h "GrowthFileWriter.h"
+ **
+ ** \latexonly	\subsubsection*{Implementation} \endlatexonly
+ ** \htmlonly	<h3>Implementation</h3> \endhtmlonly
+ **
+ ** After each growth step the GrowthFileWriter copies the new radii and firing rates into a
+ ** block and hands it to an OutputPipeline, so they are written while the next growth cycle
+ ** is simulated.
+ **
+ ** The file starts with a header:
+ **	- char[8]	magic "BGGROWTH"
+ **	- uint32_t	format version (1)
+ **	- int32_t	number of neurons
+ **	- float	duration of a growth step (s)
+ **
+ ** followed by one record per growth step (starting with the initial state, step 0):
+ **	- uint32_t	growth step
+ **	- float[]	firing rate of each neuron, in row-major order
+ **	- float[]	radius of each neuron, in row-major order
+ **
+ ** All fields are in host byte order.
+ **
+ ** \latexonly	\subsubsection*{Credits} \endlatexonly
+ ** \htmlonly	<h3>Credits</h3> \endhtmlonly
+ **
+ ** This simulator is a rewrite of CSIM (2006) and other work (Stiber and Kawasaki (2007?))
+ **/
+
+#pragma once
+
+#ifndef _GROWTHFILEWRITER_H_
+#define _GROWTHFILEWRITER_H_
+
+#include "global.h"
+#include "OutputPipeline.h"
+#include "Matrix/VectorMatrix.h"
+
+//! Version of the growth file format.
+#define GROWTH_FILE_VERSION 1
+
+class GrowthFileWriter
+{
+public:
+    //! The constructor for GrowthFileWriter.
+    GrowthFileWriter(OutputPipeline& pipeline, ostream& os, int cNeurons, FLOAT growthStepDuration);
+
+    //! Queue the radii and rates of a growth step for writing.
+    void writeStep(int step, const VectorMatrix& radii, const VectorMatrix& rates);
+
+private:
+    //! Writes the blocks.
+    OutputPipeline& m_pipeline;
+
+    //! The output stream.
+    ostream& m_os;
+
+    //! Number of neurons.
+    int m_cNeurons;
+
+    GrowthFileWriter(const GrowthFileWriter&);
+    GrowthFileWriter& operator=(const GrowthFileWriter&);
+};
+
+#endif // _GROWTHFILEWRITER_H_
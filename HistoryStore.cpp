@@ -0,0 +1,307 @@
+/**
+ *	\file HistoryStore.cpp
+ *
+ *	\brief Holds a per-neuron history (radii or firing rates), in memory or in a file.
+ */
+#include "HistoryStore.h"
+#include "MatrixXmlWriter.h"
+
+/**
+ * Create a history that is kept in memory until it is opened on a file.
+ * @param[in] cRows	Number of rows (growth steps + 1).
+ * @param[in] cColumns	Number of columns (neurons).
+ */
+HistoryStore::HistoryStore(int cRows, int cColumns) :
+    m_cRows(cRows),
+    m_cColumns(cColumns),
+    m_pMatrix(NULL),
+    m_pPipeline(NULL),
+    m_chunkStart(0),
+    m_cChunkRows(0)
+{
+}
+
+/**
+ * Destructor
+ */
+HistoryStore::~HistoryStore()
+{
+    delete m_pMatrix;
+}
+
+/**
+ * Keep the history in a file instead of memory.  Must be called before any row is
+ * recorded; the pipeline must be closed before the XML is written.
+ * @param[in] fileName	The history file; it is overwritten.
+ * @param[in] pipeline	Writes the chunks.
+ * @return true if the file was opened.
+ */
+bool HistoryStore::open(const string& fileName, OutputPipeline& pipeline)
+{
+    assert(m_pPipeline == NULL && m_pMatrix == NULL);
+
+    m_file.open(fileName.c_str(), fstream::in | fstream::out | fstream::binary | fstream::trunc);
+    if (!m_file.is_open())
+        return false;
+
+    m_pPipeline = &pipeline;
+    m_chunk.resize(HISTORY_CHUNK_ROWS * m_cColumns);
+
+    uint32_t version = HISTORY_FILE_VERSION;
+    int cChunkRows = HISTORY_CHUNK_ROWS;
+
+    vector<char>* pHeader = new vector<char>;
+    pHeader->insert(pHeader->end(), "BGHISTRY", "BGHISTRY" + 8);
+    pHeader->insert(pHeader->end(), reinterpret_cast<const char*>(&version),
+            reinterpret_cast<const char*>(&version) + sizeof(version));
+    pHeader->insert(pHeader->end(), reinterpret_cast<const char*>(&m_cRows),
+            reinterpret_cast<const char*>(&m_cRows) + sizeof(m_cRows));
+    pHeader->insert(pHeader->end(), reinterpret_cast<const char*>(&m_cColumns),
+            reinterpret_cast<const char*>(&m_cColumns) + sizeof(m_cColumns));
+    pHeader->insert(pHeader->end(), reinterpret_cast<const char*>(&cChunkRows),
+            reinterpret_cast<const char*>(&cChunkRows) + sizeof(cChunkRows));
+    m_pPipeline->write(m_file, pHeader);
+
+    return true;
+}
+
+/**
+ * Record a row.  A history kept in a file must be recorded row by row, in order.
+ * @param[in] row	The row (growth step).
+ * @param[in] values	The value of each column (neuron).
+ */
+void HistoryStore::setRow(int row, const VectorMatrix& values)
+{
+    assert(row >= 0 && row < m_cRows);
+
+    if (m_pPipeline == NULL)
+    {
+        CompleteMatrix& history = matrix();
+        for (int i = 0; i < m_cColumns; i++)
+        {
+            history(row, i) = values[i];
+        }
+        return;
+    }
+
+    assert(row == m_chunkStart + m_cChunkRows);
+    float* rgRow = &m_chunk[m_cChunkRows * m_cColumns];
+    for (int i = 0; i < m_cColumns; i++)
+    {
+        rgRow[i] = values[i];
+    }
+    m_cChunkRows++;
+
+    if (m_cChunkRows == HISTORY_CHUNK_ROWS || row == m_cRows - 1)
+    {
+        writeChunk();
+    }
+}
+
+/**
+ * Copy the rows recorded so far.  The chunks of a history kept in a file are read
+ * back once the pipeline has written them.
+ * @param[in] cRows	Number of rows to copy, from the first; all of them must have been recorded.
+ * @param[out] rgValues	Receives the rows, row by row.
+ */
+void HistoryStore::getRows(int cRows, float* rgValues)
+{
+    assert(cRows >= 0 && cRows <= m_cRows);
+
+    if (m_pPipeline == NULL)
+    {
+        CompleteMatrix& history = matrix();
+        for (int r = 0; r < cRows; r++)
+        {
+            for (int i = 0; i < m_cColumns; i++)
+                rgValues[r * m_cColumns + i] = history(r, i);
+        }
+        return;
+    }
+
+    assert(cRows <= m_chunkStart + m_cChunkRows);
+
+    // rows of the chunks in the file
+    int cFileRows = min(cRows, m_chunkStart);
+    if (cFileRows > 0)
+    {
+        vector<FLOAT> rows(HISTORY_CHUNK_ROWS * m_cColumns);
+
+        m_pPipeline->drain();
+        m_file.seekg(HISTORY_HEADER_BYTES);
+        for (int chunkStart = 0; chunkStart < cFileRows; chunkStart += HISTORY_CHUNK_ROWS)
+        {
+            int cChunkRows = readChunk(chunkStart, &rows[0]);
+            int cCopy = min(cChunkRows, cFileRows - chunkStart) * m_cColumns;
+            for (int i = 0; i < cCopy; i++)
+                rgValues[chunkStart * m_cColumns + i] = rows[i];
+        }
+
+        // the pipeline appends the next chunks
+        m_file.clear();
+        m_file.seekp(0, ios_base::end);
+    }
+
+    // rows of the current chunk
+    for (int r = cFileRows; r < cRows; r++)
+    {
+        for (int i = 0; i < m_cColumns; i++)
+            rgValues[r * m_cColumns + i] = m_chunk[(r - m_chunkStart) * m_cColumns + i];
+    }
+}
+
+/**
+ * Record the first rows of a history that has no rows yet.
+ * @param[in] cRows	Number of rows.
+ * @param[in] rgValues	The rows, row by row.
+ */
+void HistoryStore::setRows(int cRows, const float* rgValues)
+{
+    VectorMatrix row("complete", "const", 1, m_cColumns);
+
+    for (int r = 0; r < cRows; r++)
+    {
+        for (int i = 0; i < m_cColumns; i++)
+            row[i] = rgValues[r * m_cColumns + i];
+        setRow(r, row);
+    }
+}
+
+/**
+ * Transpose the buffered rows into a chunk and hand it to the pipeline.
+ */
+void HistoryStore::writeChunk()
+{
+    vector<char>* pBlock = new vector<char>(m_cChunkRows * m_cColumns * sizeof(float));
+    float* rgValues = reinterpret_cast<float*>(&(*pBlock)[0]);
+
+    for (int i = 0; i < m_cColumns; i++)
+    {
+        for (int r = 0; r < m_cChunkRows; r++)
+        {
+            rgValues[i * m_cChunkRows + r] = m_chunk[r * m_cColumns + i];
+        }
+    }
+    m_pPipeline->write(m_file, pBlock);
+
+    m_chunkStart += m_cChunkRows;
+    m_cChunkRows = 0;
+}
+
+/**
+ * Write the history as an XML matrix, in the format of CompleteMatrix::toXML().
+ * @param[in] os	The output stream.
+ * @param[in] name	Name of the matrix.
+ */
+void HistoryStore::writeXML(ostream& os, const string& name)
+{
+    if (m_pPipeline == NULL)
+    {
+        matrix().toXML(os, name);
+        return;
+    }
+
+    // all rows must have been written to the file
+    assert(m_chunkStart == m_cRows);
+
+    os << "<Matrix ";
+    if (name != "")
+        os << "name=\"" << name << "\" ";
+    os << "type=\"complete\" rows=\"" << m_cRows
+       << "\" columns=\"" << m_cColumns
+       << "\" multiplier=\"1.0\">" << endl;
+    os << "   ";
+
+    // read the file back chunk by chunk, as rows
+    vector<FLOAT> rows(HISTORY_CHUNK_ROWS * m_cColumns);
+    const FLOAT* rgRows[HISTORY_CHUNK_ROWS];
+    for (int r = 0; r < HISTORY_CHUNK_ROWS; r++)
+    {
+        rgRows[r] = &rows[r * m_cColumns];
+    }
+
+    m_file.seekg(HISTORY_HEADER_BYTES);
+    for (int chunkStart = 0; chunkStart < m_cRows; chunkStart += HISTORY_CHUNK_ROWS)
+    {
+        int cChunkRows = readChunk(chunkStart, &rows[0]);
+        MatrixXmlWriter::writeValues(os, rgRows, cChunkRows, m_cColumns, true);
+    }
+
+    os << endl;
+    os << "</Matrix>";
+}
+
+/**
+ * Write the history as an array of a binary state file.
+ * @param[in] writer	Writes the state file.
+ * @param[in] name	Name of the array.
+ */
+void HistoryStore::writeBinary(SimStateWriter& writer, const string& name)
+{
+    writer.beginArray(name, SIMSTATE_FLOAT32, SIMSTATE_ROWS, m_cRows, m_cColumns);
+
+    if (m_pPipeline == NULL)
+    {
+        CompleteMatrix& history = matrix();
+        for (int r = 0; r < m_cRows; r++)
+        {
+            writer.writeValues(&history(r, 0), m_cColumns);
+        }
+    }
+    else
+    {
+        // all rows must have been written to the file
+        assert(m_chunkStart == m_cRows);
+
+        vector<FLOAT> rows(HISTORY_CHUNK_ROWS * m_cColumns);
+        m_file.seekg(HISTORY_HEADER_BYTES);
+        for (int chunkStart = 0; chunkStart < m_cRows; chunkStart += HISTORY_CHUNK_ROWS)
+        {
+            int cChunkRows = readChunk(chunkStart, &rows[0]);
+            writer.writeValues(&rows[0], cChunkRows * m_cColumns);
+        }
+    }
+
+    writer.endArray();
+}
+
+/**
+ * Read the next chunk of the history file and transpose it into rows.  The file must
+ * be positioned at the start of the chunk.
+ * @param[in] chunkStart	First row of the chunk.
+ * @param[out] rgRows	Receives the rows of the chunk, row by row.
+ * @return number of rows in the chunk.
+ */
+int HistoryStore::readChunk(int chunkStart, FLOAT* rgRows)
+{
+    int cChunkRows = min(HISTORY_CHUNK_ROWS, m_cRows - chunkStart);
+    m_readChunk.resize(HISTORY_CHUNK_ROWS * m_cColumns);
+    m_file.read(reinterpret_cast<char*>(&m_readChunk[0]), cChunkRows * m_cColumns * sizeof(float));
+    if (!m_file)
+    {
+        throw KII_exception("Failed reading the history file");
+    }
+
+    for (int r = 0; r < cChunkRows; r++)
+    {
+        for (int i = 0; i < m_cColumns; i++)
+            rgRows[r * m_cColumns + i] = m_readChunk[i * cChunkRows + r];
+    }
+    return cChunkRows;
+}
+
+/**
+ * The history kept in memory.  It is allocated on first use, so that a history
+ * opened on a file never holds all its rows.
+ * @return the history.
+ */
+CompleteMatrix& HistoryStore::matrix()
+{
+    assert(m_pPipeline == NULL);
+
+    if (m_pMatrix == NULL)
+    {
+        m_pMatrix = new CompleteMatrix("complete", "const", m_cRows, m_cColumns);
+    }
+    return *m_pMatrix;
+}
@@ -0,0 +1,126 @@
+/**
+ *	@file HistoryStore.h
+ *
+ *	@brief Header file for HistoryStore.
+ */
+//! Holds a per-neuron history (radii or firing rates), in memory or in a file.
+
+/**
+ ** \class HistoryStore HistoryStore.h "HistoryStore.h"
+ **
+ ** \latexonly	\subsubsection*{Implementation} \endlatexonly
+ ** \htmlonly	<h3>Implementation</h3> \endhtmlonly
+ **
+ ** A HistoryStore records one row of values per growth step, one value per neuron, and writes
+ ** the rows as an XML matrix at the end of the simulation.
+ **
+ ** By default the rows are kept in a CompleteMatrix, which is allocated when the first row is
+ ** recorded.  A store that is opened on a file never allocates it, and only
+ ** keeps the rows of the current chunk (HISTORY_CHUNK_ROWS rows) in memory; each full chunk is
+ ** handed to an OutputPipeline, which appends it to the file.  The XML is then written by
+ ** reading the file back one chunk at a time, so the memory used does not depend on the number
+ ** of growth steps.
+ **
+ ** The file starts with a header:
+ **	- char[8]	magic "BGHISTRY"
+ **	- uint32_t	format version (1)
+ **	- int32_t	number of rows (growth steps + 1)
+ **	- int32_t	number of columns (neurons)
+ **	- int32_t	number of rows per chunk
+ **
+ ** followed by the chunks.  A chunk holds the values of its rows column by column (neuron by
+ ** neuron) as floats, so the history of a neuron is contiguous within a chunk.  All chunks but
+ ** the last have the full number of rows.  All fields are in host byte order.
+ **
+ ** \latexonly	\subsubsection*{Credits} \endlatexonly
+ ** \htmlonly	<h3>Credits</h3> \endhtmlonly
+ **
+ ** This simulator is a rewrite of CSIM (2006) and other work (Stiber and Kawasaki (2007?))
+ **/
+
+#pragma once
+
+#ifndef _HISTORYSTORE_H_
+#define _HISTORYSTORE_H_
+
+#include "global.h"
+#include "OutputPipeline.h"
+#include "SimStateFile.h"
+#include "Matrix/CompleteMatrix.h"
+#include "Matrix/VectorMatrix.h"
+#include <fstream>
+
+//! Version of the history file format.
+#define HISTORY_FILE_VERSION 1
+
+//! Number of rows in a chunk of a history file.
+#define HISTORY_CHUNK_ROWS 16
+
+//! Size of the header of a history file (bytes).
+#define HISTORY_HEADER_BYTES (8 + 4 * 4)
+
+class HistoryStore
+{
+public:
+    //! The constructor for HistoryStore.
+    HistoryStore(int cRows, int cColumns);
+    ~HistoryStore();
+
+    //! Keep the history in a file instead of memory.
+    bool open(const string& fileName, OutputPipeline& pipeline);
+
+    //! Record a row.
+    void setRow(int row, const VectorMatrix& values);
+
+    //! Copy the rows recorded so far.
+    void getRows(int cRows, float* rgValues);
+
+    //! Record the first rows, e.g. those of a checkpoint.
+    void setRows(int cRows, const float* rgValues);
+
+    //! Write the history as an XML matrix.
+    void writeXML(ostream& os, const string& name);
+
+    //! Write the history as an array of a binary state file.
+    void writeBinary(SimStateWriter& writer, const string& name);
+
+private:
+    //! Hand the buffered rows to the pipeline as a chunk.
+    void writeChunk();
+
+    //! Read the next chunk of the history file as rows.
+    int readChunk(int chunkStart, FLOAT* rgRows);
+
+    //! The history kept in memory, allocated on first use.
+    CompleteMatrix& matrix();
+
+    //! Number of rows and columns.
+    int m_cRows;
+    int m_cColumns;
+
+    //! The history, when it is kept in memory and a row has been recorded.
+    CompleteMatrix* m_pMatrix;
+
+    //! The history file, when the history is kept in a file.
+    fstream m_file;
+
+    //! Writes the chunks to m_file; NULL when the history is kept in memory.
+    OutputPipeline* m_pPipeline;
+
+    //! Rows of the current chunk, row by row.
+    vector<float> m_chunk;
+
+    //! A chunk read back from the history file.
+    vector<float> m_readChunk;
+
+    //! First row of the current chunk.
+    int m_chunkStart;
+
+    //! Number of rows in the current chunk.
+    int m_cChunkRows;
+
+    HistoryStore(const HistoryStore&);
+    HistoryStore& operator=(const HistoryStore&);
+};
+
+#endif // _HISTORYSTORE_H_
@@ -6,6 +6,7 @@
  *	\brief A super class of MultiThreadedSim and SingleThreadedSim classes.
  */
 #include "HostSim.h"
+#include <algorithm>
 
 /**
  * Allocate all matixes that are used for updating the network.
@@ -16,13 +17,19 @@ HostSim::HostSim(SimulationInfo* psi) :
 	W("complete", "const", psi->cNeurons, psi->cNeurons, 0),
 	radii("complete", "const", 1, psi->cNeurons, psi->startRadius),
 	rates("complete", "const", 1, psi->cNeurons, 0),
-	dist2("complete", "const", psi->cNeurons, psi->cNeurons),
+	ownDistances(psi->pDistances == NULL ? new NeuronDistances(psi->cNeurons) : NULL),
+	dist2(ownDistances != NULL ? ownDistances->dist2 : psi->pDistances->dist2),
 	delta("complete", "const", psi->cNeurons, psi->cNeurons),
-	dist("complete", "const", psi->cNeurons, psi->cNeurons),
+	dist(ownDistances != NULL ? ownDistances->dist : psi->pDistances->dist),
 	area("complete", "const", psi->cNeurons, psi->cNeurons, 0),
 	outgrowth("complete", "const", 1, psi->cNeurons),
-	deltaR("complete", "const", 1, psi->cNeurons)
+	deltaR("complete", "const", 1, psi->cNeurons),
+	inputRing(NULL)
 { 
+    if (psi->fInputRingBuffers)
+    {
+        inputRing = new InputRingBuffer(psi->cNeurons, MAX_LENGTH_OF_DELAYQUEUE, psi->pSummationMap);
+    }
 }
 
 /**
@@ -30,6 +37,8 @@ HostSim::HostSim(SimulationInfo* psi) :
  */
 HostSim::~HostSim() 
 { 
+    delete inputRing;
+    delete ownDistances;
 }
 
 /**
@@ -40,10 +49,44 @@ HostSim::~HostSim()
  */
 void HostSim::init(SimulationInfo* psi, VectorMatrix& xloc, VectorMatrix& yloc)
 {
+    // the distances may have been computed in advance (e.g. once for the runs of a sweep);
+    // the simulation then reads them where they are
+    if (ownDistances != NULL)
+    {
+        computeDistances(xloc, yloc, ownDistances->dist2, ownDistances->dist);
+    }
+
+    // Init connection frontier distance change matrix with the current distances
+    delta = dist;
+
+    // Synapses of a memory image may not be in the order of the targets
+    for (int i = 0; i < psi->cNeurons; i++)
+    {
+        sortSynapses(psi->rgSynapseMap[i], 0);
+    }
+
+    // Take over the input pending in the synapses (of a memory image)
+    if (inputRing != NULL)
+    {
+        inputRing->load(psi->rgSynapseMap, psi->cNeurons, psi->pContext->simulationStep);
+    }
+}
+
+/**
+ * Compute the distance between each pair of neurons.
+ * @param[in] xloc      X location of neurons.
+ * @param[in] yloc      Y location of neurons.
+ * @param[out] dist2	Receives the distances squared.
+ * @param[out] dist	Receives the distances.
+ */
+void HostSim::computeDistances(const VectorMatrix& xloc, const VectorMatrix& yloc, CompleteMatrix& dist2, CompleteMatrix& dist)
+{
+    int cNeurons = xloc.Size();
+
     // calculate the distance between neurons
-    for (int n = 0; n < psi->cNeurons - 1; n++)
+    for (int n = 0; n < cNeurons - 1; n++)
     {
-        for (int n2 = n + 1; n2 < psi->cNeurons; n2++)
+        for (int n2 = n + 1; n2 < cNeurons; n2++)
         {
             // distance^2 between two points in point-slope form
             dist2(n, n2) = (xloc[n] - xloc[n2]) * (xloc[n] - xloc[n2]) +
@@ -57,9 +100,6 @@ void HostSim::init(SimulationInfo* psi, VectorMatrix& xloc, VectorMatrix& yloc)
     // take the square root to get actual distance (Pythagoras was right!)
     // (The CompleteMatrix class makes this assignment look so easy...)
     dist = sqrt(dist2);
-
-    // Init connection frontier distance change matrix with the current distances
-    delta = dist;
 }
 
 /**
@@ -82,27 +122,138 @@ void HostSim::initRadii(VectorMatrix& newRadii)
 /**
  * Adds a synapse to the network.  Requires the locations of the source and
  * destination neurons.
+ * If a conduction velocity is given, the synapse's delay is lengthened by the
+ * time the spike takes to travel from the source to the destination.
+ * @param[in] psi	Pointer to the simulation information.
  * @param[in] source_x	X location of source.
  * @param[in] source_y	Y location of source.
  * @param[in] dest_x	X location of destination.
  * @param[in] dest_y	Y location of destination.
+ * @param[in,out] cClippedDelays	Incremented if the delay of the synapse is clipped to fit the delay queue.
  * @return reference to a DSS
  */
-DynamicSpikingSynapse& HostSim::addSynapse(SimulationInfo* psi, int source_x, int source_y, int dest_x, int dest_y)
+DynamicSpikingSynapse& HostSim::addSynapse(SimulationInfo* psi, int source_x, int source_y, int dest_x, int dest_y,
+        int& cClippedDelays)
 {
     // locate summation point
-    FLOAT* sp = &(psi->pSummationMap[dest_x + dest_y * psi->width]);
+    FLOAT* sp = &(psi->pSummationMap[psi->rgStorageIndex[dest_x + dest_y * psi->width]]);
 
     // determine the synapse type
     synapseType type = synType(psi, Coordinate(source_x, source_y), Coordinate(dest_x, dest_y));
 
+    // axonal conduction delay between the two neurons
+    FLOAT delay = DEFAULT_delay_weight;
+    if (psi->conductionVelocity > 0)
+    {
+        delay += dist(source_x + source_y * psi->width, dest_x + dest_y * psi->width) / psi->conductionVelocity;
+    }
+
     // create synapse;
-    DynamicSpikingSynapse syn(source_x, source_y, dest_x, dest_y, *sp, DEFAULT_delay_weight, psi->deltaT, type);
+    bool fDelayClipped;
+    DynamicSpikingSynapse syn(source_x, source_y, dest_x, dest_y, *sp, delay, psi->deltaT, type, &fDelayClipped);
+    if (fDelayClipped)
+    {
+        cClippedDelays++;
+    }
 
     // add it to the list
-    psi->rgSynapseMap[source_x + source_y * psi->width].push_back(syn);
+    vector<DynamicSpikingSynapse>& synapses = psi->rgSynapseMap[psi->rgStorageIndex[source_x + source_y * psi->width]];
+    synapses.push_back(syn);
+
+    return synapses.back();
+}
+
+/**
+ * Reports the synapses added by a growth update whose delay was clipped to fit the delay
+ * queue.  They are counted in the SimulationContext, and reported the first time there are any.
+ * @param[in] psi	Pointer to the simulation information.
+ * @param[in] cClippedDelays	Number of synapses of the update whose delay was clipped.
+ */
+void HostSim::reportClippedDelays(SimulationInfo* psi, int cClippedDelays)
+{
+    if (cClippedDelays > 0 && psi->pContext->cClippedDelays == 0)
+    {
+        cerr << "WARNING: the delays of " << cClippedDelays << " synapses were clipped to the delay queue length of "
+             << MAX_LENGTH_OF_DELAYQUEUE << " steps" << endl;
+    }
+    psi->pContext->cClippedDelays += cClippedDelays;
+}
+
+/**
+ * Reserves room for all synapses a neuron will have during the growth update, the
+ * new ones and the pruned ones that are still in the list, so that its list is
+ * reallocated at most once per update instead of each time it outgrows its capacity.
+ * @param[in] psi	Pointer to the simulation information.
+ * @param[in] a	Row-major index of the neuron.
+ * @param[in,out] synapses	The synapses of the neuron.
+ * @pre W holds the weights of the update.
+ */
+void HostSim::reserveSynapses(SimulationInfo* psi, int a, vector<DynamicSpikingSynapse>& synapses)
+{
+    size_t cSynapses = 0;
+
+    // every target with a positive weight has a synapse after the update
+    for (int b = 0; b < psi->cNeurons; b++)
+    {
+        if (W(a, b) > 0)
+            cSynapses++;
+    }
+
+    // existing synapses of zero weight are kept as well, and those of negative weight
+    // stay in the list, marked as removed, until removeSynapses() runs after the update
+    for (size_t syn = 0; syn < synapses.size(); syn++)
+    {
+        const Coordinate& bCoord = synapses[syn].summationCoord;
+        if (W(a, bCoord.x + bCoord.y * psi->width) <= 0)
+            cSynapses++;
+    }
+
+    synapses.reserve(cSynapses);
+}
+
+/**
+ * Orders synapses by the storage index of their targets.  The summation points
+ * are in a single array, so the order of their addresses is the storage order.
+ */
+static bool targetLess(const DynamicSpikingSynapse& lhs, const DynamicSpikingSynapse& rhs)
+{
+    return &lhs.summationPoint < &rhs.summationPoint;
+}
+
+/**
+ * Returns true if a synapse has been marked as removed.
+ */
+static bool isRemoved(const DynamicSpikingSynapse& syn)
+{
+    return syn.fRemoved;
+}
+
+/**
+ * Removes the synapses that have been marked as removed during a growth update.
+ * All of them are removed in a single pass, and the order of the remaining
+ * synapses is kept.
+ * @param[in,out] synapses	The synapses of a neuron.
+ */
+void HostSim::removeSynapses(vector<DynamicSpikingSynapse>& synapses)
+{
+    synapses.erase(remove_if(synapses.begin(), synapses.end(), isRemoved), synapses.end());
+}
+
+/**
+ * Sorts the synapses of a neuron by target, so that the synapses of a firing
+ * neuron write the summation map in ascending address order.
+ * Only the synapses appended since the last sort are sorted; they are then
+ * merged into the sorted part in linear time.
+ * @param[in,out] synapses	The synapses of a neuron.
+ * @param[in] cSorted	Number of synapses at the front of the list that are sorted.
+ */
+void HostSim::sortSynapses(vector<DynamicSpikingSynapse>& synapses, size_t cSorted)
+{
+    if (cSorted >= synapses.size())
+        return;
 
-    return psi->rgSynapseMap[source_x + source_y * psi->width].back();
+    sort(synapses.begin() + cSorted, synapses.end(), targetLess);
+    inplace_merge(synapses.begin(), synapses.begin() + cSorted, synapses.end(), targetLess);
 }
 
 /**
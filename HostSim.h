@@ -29,6 +29,25 @@
 
 #include "ISimulation.h"
 #include "Matrix/VectorMatrix.h"
+#include "InputRingBuffer.h"
+#include "SpikeRecorder.h"
+#include "SpikeHistogram.h"
+
+//! The distances between the neurons of a network, and their squares.
+struct NeuronDistances
+{
+    NeuronDistances(int cNeurons) :
+        dist2("complete", "const", cNeurons, cNeurons),
+        dist("complete", "const", cNeurons, cNeurons)
+    {
+    }
+
+    //! Inter-neuron distance squared
+    CompleteMatrix dist2;
+
+    //! the true inter-neuron distance
+    CompleteMatrix dist;
+};
 
 class HostSim : public ISimulation
 {
@@ -46,9 +65,28 @@ public:
     //! Initialize radii
     virtual void initRadii(VectorMatrix& newRadii);
 
+    //! The input ring buffers, or NULL if synapses deliver their own input.
+    InputRingBuffer* getInputRing() const { return inputRing; }
+
+    //! Compute the distance between each pair of neurons.
+    static void computeDistances(const VectorMatrix& xloc, const VectorMatrix& yloc, CompleteMatrix& dist2, CompleteMatrix& dist);
+
 protected:
     //! Adds a synapse to the network.  Requires the locations of the source and destination neurons.
-    DynamicSpikingSynapse& addSynapse(SimulationInfo* psi, int source_x, int source_y, int dest_x, int dest_y);
+    DynamicSpikingSynapse& addSynapse(SimulationInfo* psi, int source_x, int source_y, int dest_x, int dest_y,
+            int& cClippedDelays);
+
+    //! Reports the synapses of a growth update whose delay was clipped, the first time there are any.
+    static void reportClippedDelays(SimulationInfo* psi, int cClippedDelays);
+
+    //! Reserves room for the synapses a neuron will have after the growth update.
+    void reserveSynapses(SimulationInfo* psi, int a, vector<DynamicSpikingSynapse>& synapses);
+
+    //! Removes the synapses of a list that have been marked as removed.
+    static void removeSynapses(vector<DynamicSpikingSynapse>& synapses);
+
+    //! Merges synapses appended to a list into its part that is sorted by target.
+    static void sortSynapses(vector<DynamicSpikingSynapse>& synapses, size_t cSorted);
 
     //! Returns the type of synapse at the given coordinates.
     synapseType synType(SimulationInfo* psi, Coordinate a, Coordinate b);
@@ -68,14 +106,17 @@ protected:
     //! spiking rate
     VectorMatrix rates;
 
+    //! The distances computed by this simulation; NULL if they were computed in advance (see SimulationInfo::pDistances).
+    NeuronDistances* ownDistances;
+
     //! Inter-neuron distance squared
-    CompleteMatrix dist2;
+    const CompleteMatrix& dist2;
 
     //! distance between connection frontiers
     CompleteMatrix delta;
 
     //! the true inter-neuron distance
-    CompleteMatrix dist;
+    const CompleteMatrix& dist;
 
     //! areas of overlap
     CompleteMatrix area;
@@ -85,6 +126,9 @@ protected:
 
     //! displacement of neuron radii
     VectorMatrix deltaR;
+
+    //! per-target input ring buffers (NULL when synapses deliver their own input)
+    InputRingBuffer* inputRing;
 };
 
 #endif // _HOSTSIM_H_
@@ -50,14 +50,14 @@ void SingleThreadedSim::worker1()
 			case IOCP_KEY_NEURON:
 				for( ; i < end_i; i++)
 				{
-					(*(m_psi->pNeuronList))[i].advance(m_psi->pSummationMap[i]);
+					(*(m_psi->pNeuronList))[i].advance(m_psi->pSummationMap[i], *m_psi->pContext->rgNormrnd[0]);
 
 					DEBUG2(cout << i << " " << (*(m_psi->pNeuronList))[i].Vm << endl;)
 
 					// notify outgoing synapses if neuron has fired
 					if ((*(m_psi->pNeuronList))[i].hasFired)
 					{
-						DEBUG2(cout << " !! Neuron" << i << "has Fired @ t: " << g_simulationStep * m_psi->deltaT << endl;)
+						DEBUG2(cout << " !! Neuron" << i << "has Fired @ t: " << m_psi->pContext->simulationStep * m_psi->deltaT << endl;)
 
 						for (int z = m_psi->rgSynapseMap[i].size() - 1; z >= 0; --z)
 						{
@@ -81,7 +81,7 @@ void SingleThreadedSim::worker1()
 				{
 					for (int z = m_psi->rgSynapseMap[i].size() - 1; z >= 0; --z)
 					{
-						m_psi->rgSynapseMap[i][z].advance();
+						m_psi->rgSynapseMap[i][z].advance(m_psi->pContext->simulationStep);
 					}
 				}
 				if(InterlockedExchangeAdd(&m_OpsCompleted, dwThisRange) == m_psi->cNeurons - dwThisRange)
@@ -147,7 +147,7 @@ void SingleThreadedSim::advanceUntilGrowth(SimulationInfo* psi)
     DEBUG2(printNetworkRadii(radii);)
 
 	m_Count = 0;
-	m_EndStep = g_simulationStep + static_cast<uint64_t>(psi->stepDuration / psi->deltaT);
+	m_EndStep = psi->pContext->simulationStep + static_cast<uint64_t>(psi->stepDuration / psi->deltaT);
 
 	AffinityMask = 1;
 	// Event not set -- no threads will progress yet
@@ -169,16 +169,16 @@ void SingleThreadedSim::advanceUntilGrowth(SimulationInfo* psi)
 
 /*
 	uint64_t count = 0;
-    uint64_t endStep = g_simulationStep + static_cast<uint64_t>(psi->stepDuration / psi->deltaT);
+    uint64_t endStep = psi->pContext->simulationStep + static_cast<uint64_t>(psi->stepDuration / psi->deltaT);
     
     DEBUG2(printNetworkRadii(radii);)
 
-    while (g_simulationStep < endStep)
+    while (psi->pContext->simulationStep < endStep)
     {
         DEBUG(if (count % 1000 == 0)
               {
                   cout << psi->currentStep << "/" << psi->maxSteps
-                      << " simulating time: " << g_simulationStep * psi->deltaT << endl;
+                      << " simulating time: " << psi->pContext->simulationStep * psi->deltaT << endl;
                   count = 0;
               }
 
@@ -188,7 +188,7 @@ void SingleThreadedSim::advanceUntilGrowth(SimulationInfo* psi)
         advanceNeurons(psi);
         
         advanceSynapses(psi);
-        g_simulationStep++;
+        psi->pContext->simulationStep++;
     }
 */
 }
@@ -204,14 +204,14 @@ void SingleThreadedSim::advanceNeurons(SimulationInfo* psi)
     for (int i = psi->cNeurons - 1; i >= 0; --i)
     {
         // advance neurons
-        (*(psi->pNeuronList))[i].advance(psi->pSummationMap[i]);
+        (*(psi->pNeuronList))[i].advance(psi->pSummationMap[i], *psi->pContext->rgNormrnd[0]);
 
         DEBUG2(cout << i << " " << (*(psi->pNeuronList))[i].Vm << endl;)
 
         // notify outgoing synapses if neuron has fired
         if ((*(psi->pNeuronList))[i].hasFired)
         {
-            DEBUG2(cout << " !! Neuron" << i << "has Fired @ t: " << g_simulationStep * psi->deltaT << endl;)
+            DEBUG2(cout << " !! Neuron" << i << "has Fired @ t: " << psi->pContext->simulationStep * psi->deltaT << endl;)
 
             for (int z = psi->rgSynapseMap[i].size() - 1; z >= 0; --z)
             {
@@ -224,7 +224,7 @@ void SingleThreadedSim::advanceNeurons(SimulationInfo* psi)
 
 #ifdef DUMP_VOLTAGES
     // ouput a row with every voltage level for each time step
-    cout << g_simulationStep * psi->deltaT;
+    cout << psi->pContext->simulationStep * psi->deltaT;
 
     for (int i = 0; i < psi->cNeurons; i++)
     {
@@ -244,34 +244,36 @@ void SingleThreadedSim::advanceSynapses(SimulationInfo* psi)
     {
         for (int z = psi->rgSynapseMap[i].size() - 1; z >= 0; --z)
         {
-            psi->rgSynapseMap[i][z].advance();
+            psi->rgSynapseMap[i][z].advance(psi->pContext->simulationStep);
         }
     }
 }
 
 /**
  * Calculate growth cycle firing rate for previous period.
- * Compute neuron radii change, assign new values, and record the radius to histroy matrix.
+ * Compute neuron radii change, assign new values, and return the new radii and rates.
  * Update distance between frontiers, and compute areas of overlap. 
  * Adjust the strength of the synapse or remove it from the synapse map if it has gone below 
  * zero.
  * @param[in] psi	Pointer to the simulation information.
- * @param[in] radiiHistory	Matrix to save radius history.
- * @param[in] ratesHistory	Matrix to save firing rates history. 
+ * @param[out] newRadii	Receives the new radius of each neuron.
+ * @param[out] newRates	Receives the firing rate of each neuron.
  */
-void SingleThreadedSim::updateNetwork(SimulationInfo* psi, CompleteMatrix& radiiHistory, CompleteMatrix& ratesHistory)
+void SingleThreadedSim::updateNetwork(SimulationInfo* psi, VectorMatrix& newRadii, VectorMatrix& newRates)
 {
     // Calculate growth cycle firing rate for previous period
     for (int i = 0; i < psi->cNeurons; i++)
     {
+        LifNeuron& neuron = (*(psi->pNeuronList))[psi->rgStorageIndex[i]];
+
         // Calculate firing rate
-        rates[i] = (*(psi->pNeuronList))[i].getSpikeCount() / psi->stepDuration;
+        rates[i] = neuron.getSpikeCount() / psi->stepDuration;
 
         // clear spike count
-        (*(psi->pNeuronList))[i].clearSpikeCount();
+        neuron.clearSpikeCount();
 
-        // record firing rate to history matrix
-        ratesHistory(psi->currentStep, i) = rates[i];
+        // return the firing rate
+        newRates[i] = rates[i];
     }
 
     // compute neuron radii change and assign new values
@@ -279,15 +281,15 @@ void SingleThreadedSim::updateNetwork(SimulationInfo* psi, CompleteMatrix& radii
     deltaR = psi->stepDuration * psi->rho * outgrowth;
     radii += deltaR;
 
-    // Cap minimum radius size and record radii to history matrix
+    // Cap minimum radius size and return the radii
     for (int i = 0; i < radii.Size(); i++)
     {
         // TODO: find out why we cap this here.
         if (radii[i] < psi->minRadius)
             radii[i] = psi->minRadius;
 
-        // record radius to history matrix
-        radiiHistory(psi->currentStep, i) = radii[i];
+        // return the radius
+        newRadii[i] = radii[i];
 
         DEBUG2(cout << "radii[" << i << ":" << radii[i] << "]" << endl;);
     }
@@ -355,6 +357,7 @@ void SingleThreadedSim::updateNetwork(SimulationInfo* psi, CompleteMatrix& radii
     int could_have_been_removed = 0; // TODO: use this value
     int removed = 0;
     int added = 0;
+    int cClippedDelays = 0;
 
     DEBUG(cout << "adjusting weights" << endl;)
 
@@ -365,6 +368,12 @@ void SingleThreadedSim::updateNetwork(SimulationInfo* psi, CompleteMatrix& radii
         int xa = a % psi->width;
         int ya = a / psi->width;
         Coordinate aCoord(xa, ya);
+        vector<DynamicSpikingSynapse>& synapses = psi->rgSynapseMap[psi->rgStorageIndex[a]];
+        size_t cAdded = 0;
+        bool fRemoved = false;
+
+        reserveSynapses(psi, a, synapses);
+        size_t cReserved = synapses.capacity();
 
         // and each destination neuron 'b'
         for (int b = 0; b < psi->cNeurons; b++)
@@ -377,10 +386,10 @@ void SingleThreadedSim::updateNetwork(SimulationInfo* psi, CompleteMatrix& radii
             bool connected = false;
 
             // for each existing synapse
-            for (size_t syn = 0; syn < psi->rgSynapseMap[a].size(); syn++)
+            for (size_t syn = 0; syn < synapses.size(); syn++)
             {
                 // if there is a synapse between a and b
-                if (psi->rgSynapseMap[a][syn].summationCoord == bCoord)
+                if (synapses[syn].summationCoord == bCoord)
                 {
                     connected = true;
                     adjusted++;
@@ -390,20 +399,25 @@ void SingleThreadedSim::updateNetwork(SimulationInfo* psi, CompleteMatrix& radii
                     // zero.
                     if (W(a, b) < 0)
                     {
+                        // removed from the list once all targets are visited
                         removed++;
-                        psi->rgSynapseMap[a].erase(psi->rgSynapseMap[a].begin() + syn);
+                        synapses[syn].fRemoved = true;
+                        fRemoved = true;
                     }
                     else
                     {
                         // adjust
                         // g_synapseStrengthAdjustmentConstant is 1.0e-8;
-                        psi->rgSynapseMap[a][syn].W = W(a, b) * 
+                        synapses[syn].W = W(a, b) * 
                             synSign(synType(psi, aCoord, bCoord)) * g_synapseStrengthAdjustmentConstant;
 
                         DEBUG2(cout << "weight of rgSynapseMap" << 
                                coordToString(xa, ya)<<"[" <<syn<<"]: " << 
-                               psi->rgSynapseMap[a][syn].W << endl;);
+                               synapses[syn].W << endl;);
                     }
+
+                    // there is at most one synapse between a and b
+                    break;
                 }
             }
 
@@ -411,13 +425,26 @@ void SingleThreadedSim::updateNetwork(SimulationInfo* psi, CompleteMatrix& radii
             if (!connected && (W(a, b) > 0))
             {
                 added++;
+                cAdded++;
 
-                DynamicSpikingSynapse& newSynapse = addSynapse(psi, xa, ya, xb, yb);
+                DynamicSpikingSynapse& newSynapse = addSynapse(psi, xa, ya, xb, yb, cClippedDelays);
                 newSynapse.W = W(a, b) * synSign(synType(psi, aCoord, bCoord)) * g_synapseStrengthAdjustmentConstant;
             }
         }
+
+        // the list must not have been reallocated while the pruned synapses were still in it
+        assert(synapses.capacity() == cReserved);
+
+        // remove the pruned synapses and keep the rest sorted by target
+        if (fRemoved)
+        {
+            removeSynapses(synapses);
+        }
+        sortSynapses(synapses, synapses.size() - cAdded);
     }
 
+    reportClippedDelays(psi, cClippedDelays);
+
     DEBUG (cout << "adjusted: " << adjusted << endl;)
     DEBUG (cout << "could have been removed (TODO: calculate this): " << could_have_been_removed << endl;)
     DEBUG (cout << "removed: " << removed << endl;)
@@ -64,10 +64,10 @@ public:
     /**
      * Updates synapses' weight between neurons.
      * @param psi
-     * @param radiiHistory
-     * @param ratesHistory
+     * @param newRadii
+     * @param newRates
      */
-    virtual void updateNetwork(SimulationInfo* psi, CompleteMatrix& radiiHistory, CompleteMatrix& ratesHistory) = 0;
+    virtual void updateNetwork(SimulationInfo* psi, VectorMatrix& newRadii, VectorMatrix& newRates) = 0;
 };
 
 #endif // _ISIMULATION_H_
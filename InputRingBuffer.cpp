@@ -0,0 +1,227 @@
+/**
+ *	\file InputRingBuffer.cpp
+ *
+ *	\brief Per-target, per-delay-slot accumulators for delayed synaptic input.
+ */
+#include "InputRingBuffer.h"
+
+/**
+ * Allocate the delay slots and the responses of the targets.
+ * @param[in] cNeurons		Number of target neurons.
+ * @param[in] cSlots		Number of delay slots; must be larger than the longest synapse delay.
+ * @param[in] pSummationMap	The summation map that the synapses point into.
+ */
+InputRingBuffer::InputRingBuffer(int cNeurons, int cSlots, FLOAT* pSummationMap) :
+    m_cNeurons(cNeurons),
+    m_cSlots(cSlots),
+    m_iSlot(0),
+    m_pSummationMap(pSummationMap)
+{
+    m_rgSlots = new FLOAT[m_cSlots * m_cNeurons * INPUT_CLASSES];
+    m_rgPsr = new FLOAT[m_cNeurons * INPUT_CLASSES];
+    m_rgDecay = new FLOAT[m_cNeurons * INPUT_CLASSES];
+
+    for (int i = 0; i < m_cSlots * m_cNeurons * INPUT_CLASSES; i++)
+    {
+        m_rgSlots[i] = 0;
+    }
+
+    // the decay of a class is taken from the synapses that feed it
+    for (int i = 0; i < m_cNeurons * INPUT_CLASSES; i++)
+    {
+        m_rgPsr[i] = 0;
+        m_rgDecay[i] = 0;
+    }
+}
+
+/**
+ * Destructor
+ */
+InputRingBuffer::~InputRingBuffer()
+{
+    delete[] m_rgSlots;
+    delete[] m_rgPsr;
+    delete[] m_rgDecay;
+}
+
+/**
+ * Schedule the input of all outgoing synapses of a neuron that has fired at the
+ * current time step.  The response is computed now, from the weight and the state of
+ * each synapse, for the time step at which the spike will arrive.
+ * @param[in] synapses	The outgoing synapses of the neuron.
+ * @param[in] step	The current time step.
+ */
+void InputRingBuffer::preSpikeHit(vector<DynamicSpikingSynapse>& synapses, uint64_t step)
+{
+    for (int z = synapses.size() - 1; z >= 0; --z)
+    {
+        DynamicSpikingSynapse& syn = synapses[z];
+
+        add(syn, syn.total_delay, syn.spikeResponse(step + syn.total_delay));
+    }
+}
+
+/**
+ * Add the input of the current slot to the response of each target, decay the
+ * response and apply it to the summation map.
+ * @post The ring is moved to the next time step.
+ */
+void InputRingBuffer::advance()
+{
+    FLOAT* pSlot = m_rgSlots + m_iSlot * m_cNeurons * INPUT_CLASSES;
+
+#ifdef USE_OMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int i = 0; i < m_cNeurons; i++)
+    {
+        FLOAT sum = 0;
+
+        for (int c = i * INPUT_CLASSES; c < (i + 1) * INPUT_CLASSES; c++)
+        {
+            m_rgPsr[c] = (m_rgPsr[c] + pSlot[c]) * m_rgDecay[c];
+            pSlot[c] = 0;
+            sum += m_rgPsr[c];
+        }
+
+        m_pSummationMap[i] += sum;
+    }
+
+    if (++m_iSlot >= m_cSlots)
+        m_iSlot = 0;
+}
+
+/**
+ * Move the psr and the queued spikes of every synapse into the ring, so that
+ * a network read from a memory image continues with its pending input.
+ * @param[in] rgSynapseMap	List of lists of synapses.
+ * @param[in] cNeurons		Number of source neurons.
+ * @param[in] step		The current time step.
+ * @post The psr and the delay queue of each synapse are cleared.
+ */
+void InputRingBuffer::load(vector<DynamicSpikingSynapse>* rgSynapseMap, int cNeurons, uint64_t step)
+{
+    for (int i = 0; i < cNeurons; i++)
+    {
+        for (size_t z = 0; z < rgSynapseMap[i].size(); z++)
+        {
+            DynamicSpikingSynapse& syn = rgSynapseMap[i][z];
+
+            // the psr is carried over as the response of the target
+            int c = inputIndex(syn);
+            m_rgPsr[c] += syn.psr;
+            m_rgDecay[c] = syn.decay;
+            syn.psr = 0;
+
+            // queued spikes, in order of arrival
+            for (int k = 0; k < syn.ldelayQueue; k++)
+            {
+                if (syn.isSpikeQueue())
+                {
+                    add(syn, k, syn.spikeResponse(step + k));
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Add a psr increment for the target of a synapse.
+ * @param[in] syn	The synapse that delivers the input.
+ * @param[in] delay	Number of time steps from now when the input arrives.
+ * @param[in] value	The psr increment.
+ */
+void InputRingBuffer::add(const DynamicSpikingSynapse& syn, int delay, FLOAT value)
+{
+    assert(delay >= 0 && delay < m_cSlots);
+
+    int slot = m_iSlot + delay;
+    if (slot >= m_cSlots)
+        slot -= m_cSlots;
+
+    int c = inputIndex(syn);
+
+    m_rgSlots[slot * m_cNeurons * INPUT_CLASSES + c] += value;
+    m_rgDecay[c] = syn.decay;
+}
+
+/**
+ * Locate the accumulator of the target and input class of a synapse.
+ * @param[in] syn	The synapse.
+ * @return index of the accumulator within a slot.
+ */
+int InputRingBuffer::inputIndex(const DynamicSpikingSynapse& syn) const
+{
+    int target = &syn.summationPoint - m_pSummationMap;
+    assert(target >= 0 && target < m_cNeurons);
+
+    // input from inhibitory and excitatory neurons decay differently
+    return target * INPUT_CLASSES + (syn.type == II || syn.type == IE ? 0 : 1);
+}
+
+/**
+ * Copy the pending input.  The slots are copied starting with that of the current
+ * time step, and the targets in row-major order, so that the input can be restored
+ * into a ring of a network with another storage order.
+ * @param[out] rgSlots	Receives the slots, [slot][target][class].
+ * @param[out] rgPsr	Receives the response of each target, [target][class].
+ * @param[out] rgDecay	Receives the psr decay of each target, [target][class].
+ * @param[in] rgStorageIndex	Storage index of each neuron, indexed by its row-major index.
+ */
+void InputRingBuffer::save(FLOAT* rgSlots, FLOAT* rgPsr, FLOAT* rgDecay, const int* rgStorageIndex) const
+{
+    for (int k = 0; k < m_cSlots; k++)
+    {
+        int slot = (m_iSlot + k) % m_cSlots;
+        for (int i = 0; i < m_cNeurons; i++)
+        {
+            for (int c = 0; c < INPUT_CLASSES; c++)
+            {
+                rgSlots[(k * m_cNeurons + i) * INPUT_CLASSES + c] =
+                        m_rgSlots[(slot * m_cNeurons + rgStorageIndex[i]) * INPUT_CLASSES + c];
+            }
+        }
+    }
+
+    for (int i = 0; i < m_cNeurons; i++)
+    {
+        for (int c = 0; c < INPUT_CLASSES; c++)
+        {
+            rgPsr[i * INPUT_CLASSES + c] = m_rgPsr[rgStorageIndex[i] * INPUT_CLASSES + c];
+            rgDecay[i * INPUT_CLASSES + c] = m_rgDecay[rgStorageIndex[i] * INPUT_CLASSES + c];
+        }
+    }
+}
+
+/**
+ * Replace the pending input with input copied by save().
+ * @param[in] rgSlots	The slots, [slot][target][class], starting with the current time step.
+ * @param[in] rgPsr	The response of each target, [target][class].
+ * @param[in] rgDecay	The psr decay of each target, [target][class].
+ * @param[in] rgStorageIndex	Storage index of each neuron, indexed by its row-major index.
+ */
+void InputRingBuffer::restore(const FLOAT* rgSlots, const FLOAT* rgPsr, const FLOAT* rgDecay, const int* rgStorageIndex)
+{
+    m_iSlot = 0;
+
+    for (int k = 0; k < m_cSlots; k++)
+    {
+        for (int i = 0; i < m_cNeurons; i++)
+        {
+            for (int c = 0; c < INPUT_CLASSES; c++)
+            {
+                m_rgSlots[(k * m_cNeurons + rgStorageIndex[i]) * INPUT_CLASSES + c] =
+                        rgSlots[(k * m_cNeurons + i) * INPUT_CLASSES + c];
+            }
+        }
+    }
+
+    for (int i = 0; i < m_cNeurons; i++)
+    {
+        for (int c = 0; c < INPUT_CLASSES; c++)
+        {
+            m_rgPsr[rgStorageIndex[i] * INPUT_CLASSES + c] = rgPsr[i * INPUT_CLASSES + c];
+            m_rgDecay[rgStorageIndex[i] * INPUT_CLASSES + c] = rgDecay[i * INPUT_CLASSES + c];
+        }
+    }
+}
@@ -0,0 +1,117 @@
+/**
+ *	@file InputRingBuffer.h
+ *
+ *	@brief Header file for InputRingBuffer.
+ */
+//! Per-target, per-delay-slot accumulators for delayed synaptic input.
+
+/**
+ ** \class InputRingBuffer InputRingBuffer.h "InputRingBuffer.h"
+ **
+ ** \latexonly	\subsubsection*{Implementation} \endlatexonly
+ ** \htmlonly	<h3>Implementation</h3> \endhtmlonly
+ **
+ ** In the default delivery model every synapse is advanced at every time step and adds its
+ ** psr to the summation point of its target, so each step writes all over the summation map.
+ ** The InputRingBuffer is an alternative delivery model.  When a neuron fires, each of its
+ ** outgoing synapses updates its facilitation and depression for the time the spike will
+ ** arrive, and adds its psr increment into the slot of the ring that corresponds to that
+ ** arrival time.  The slot holds one accumulator for each target neuron and each class
+ ** of input.  Input from inhibitory and from excitatory neurons are separate classes because
+ ** the two decay with different time constants.
+ **
+ ** At each time step the current slot is read sequentially, added to the decaying post
+ ** synaptic response of each target, and the response is applied to the summation map.
+ ** Writes happen only on spike events, and the synapses do not have to be visited at every
+ ** time step.  The responses of the synapses of one class are summed before they decay, which
+ ** changes the results only by floating point rounding.
+ **
+ ** The two models do differ in when the response of a spike is computed: the default model
+ ** computes it from W and the synapse state when the spike arrives, this model when the
+ ** neuron fires.  Spikes are processed in the order they are fired in both models, so the
+ ** facilitation and depression are the same, but a change to the synapse while a spike is in
+ ** flight is not seen by that spike.  A growth update that falls within the delay of a spike
+ ** changes W after the response was computed, and a synapse removed by it still delivers the
+ ** spikes it has in the ring, while the default model drops them with its delay queue.  So
+ ** the two models can differ from the first growth update on, the more so the longer the delays.
+ **
+ ** The per-synapse psr and delay queue are not used in this model.  Their contents are moved
+ ** into the ring when it is loaded (e.g. after reading a memory image), but the ring itself is
+ ** not saved in the memory image; only the checkpoints of a simulation in progress save it
+ ** (save() and restore()).
+ **
+ ** \latexonly	\subsubsection*{Credits} \endlatexonly
+ ** \htmlonly	<h3>Credits</h3> \endhtmlonly
+ **
+ ** This simulator is a rewrite of CSIM (2006) and other work (Stiber and Kawasaki (2007?))
+ **/
+
+#pragma once
+
+#ifndef _INPUTRINGBUFFER_H_
+#define _INPUTRINGBUFFER_H_
+
+#include "global.h"
+#include "DynamicSpikingSynapse.h"
+
+//! Number of input classes per target (input from inhibitory / excitatory neurons).
+#define INPUT_CLASSES 2
+
+class InputRingBuffer
+{
+public:
+    //! The constructor for InputRingBuffer.
+    InputRingBuffer(int cNeurons, int cSlots, FLOAT* pSummationMap);
+    ~InputRingBuffer();
+
+    //! Schedule the input of all synapses of a neuron that has fired.
+    void preSpikeHit(vector<DynamicSpikingSynapse>& synapses, uint64_t step);
+
+    //! Apply the input of the current time step to the summation map.
+    void advance();
+
+    //! Move the psr and queued spikes of the synapses into the ring.
+    void load(vector<DynamicSpikingSynapse>* rgSynapseMap, int cNeurons, uint64_t step);
+
+    //! Copy the pending input, e.g. into a checkpoint.
+    void save(FLOAT* rgSlots, FLOAT* rgPsr, FLOAT* rgDecay, const int* rgStorageIndex) const;
+
+    //! Replace the pending input with input saved by save().
+    void restore(const FLOAT* rgSlots, const FLOAT* rgPsr, const FLOAT* rgDecay, const int* rgStorageIndex);
+
+    //! Number of delay slots.
+    int getSlots() const { return m_cSlots; }
+
+private:
+    //! Add a psr increment for a target, to be applied after delay time steps.
+    void add(const DynamicSpikingSynapse& syn, int delay, FLOAT value);
+
+    //! Locate the accumulator of the target and input class of a synapse.
+    int inputIndex(const DynamicSpikingSynapse& syn) const;
+
+    //! Number of target neurons.
+    int m_cNeurons;
+
+    //! Number of delay slots in the ring.
+    int m_cSlots;
+
+    //! The slot of the current time step.
+    int m_iSlot;
+
+    //! The summation map that the synapses point into.
+    FLOAT* m_pSummationMap;
+
+    //! The delay slots, [slot][target][class].
+    FLOAT* m_rgSlots;
+
+    //! The post synaptic response of each target, [target][class].
+    FLOAT* m_rgPsr;
+
+    //! The psr decay of each target, [target][class].
+    FLOAT* m_rgDecay;
+
+    InputRingBuffer(const InputRingBuffer&);
+    InputRingBuffer& operator=(const InputRingBuffer&);
+};
+
+#endif // _INPUTRINGBUFFER_H_
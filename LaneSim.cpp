@@ -0,0 +1,552 @@
+/**
+ *	\file LaneSim.cpp
+ *
+ *	\brief Simulates several replicas of a network with frozen connectivity in lockstep, one per lane.
+ */
+#include "LaneSim.h"
+
+/**
+ * Copy the parameters and the structure of the network, and its state into every lane.
+ * @param[in] psi	Pointer to the simulation information.
+ * @param[in] pInputRing	The input ring buffers, or NULL if the synapses deliver their own input.
+ * @param[in] cLanes	Number of lanes (1 to MAX_LANES).
+ */
+LaneSim::LaneSim(SimulationInfo* psi, const InputRingBuffer* pInputRing, int cLanes) :
+    m_cLanes(cLanes),
+    m_cNeurons(psi->cNeurons),
+    m_cSlots(0),
+    m_iSlot(0)
+{
+    assert(m_cLanes >= 1 && m_cLanes <= MAX_LANES);
+    uint32_t allLanes = m_cLanes == MAX_LANES ? ~0u : (1u << m_cLanes) - 1;
+
+    for (int l = 0; l < m_cLanes; l++)
+    {
+        m_rgNormrnd.push_back(new Norm(0, 1, 1));
+    }
+
+    // the neurons
+    m_rgVthresh.resize(m_cNeurons);
+    m_rgVreset.resize(m_cNeurons);
+    m_rgInoise.resize(m_cNeurons);
+    m_rgC1.resize(m_cNeurons);
+    m_rgC2.resize(m_cNeurons);
+    m_rgI0.resize(m_cNeurons);
+    m_rgRefract.resize(m_cNeurons);
+    m_rgVm.resize(m_cNeurons * m_cLanes);
+    m_rgStepsInRefr.resize(m_cNeurons * m_cLanes);
+    m_rgSpikeCount.resize(m_cNeurons * m_cLanes);
+    m_rgSummation.resize(m_cNeurons * m_cLanes);
+    for (int i = 0; i < m_cNeurons; i++)
+    {
+        const LifNeuron& neuron = (*(psi->pNeuronList))[i];
+
+        m_rgVthresh[i] = neuron.Vthresh;
+        m_rgVreset[i] = neuron.Vreset;
+        m_rgInoise[i] = neuron.Inoise;
+        m_rgC1[i] = neuron.C1;
+        m_rgC2[i] = neuron.C2;
+        m_rgI0[i] = neuron.I0;
+        m_rgRefract[i] = static_cast<int> ( neuron.Trefract / neuron.deltaT + 0.5 );
+        for (int l = 0; l < m_cLanes; l++)
+        {
+            m_rgVm[i * m_cLanes + l] = neuron.Vm;
+            m_rgStepsInRefr[i * m_cLanes + l] = neuron.nStepsInRefr;
+            m_rgSpikeCount[i * m_cLanes + l] = neuron.spikeCount;
+            m_rgSummation[i * m_cLanes + l] = psi->pSummationMap[i];
+        }
+    }
+
+    // the synapses, in the order of their sources
+    m_rgFirstSynapse.resize(m_cNeurons + 1);
+    m_rgFirstSynapse[0] = 0;
+    for (int i = 0; i < m_cNeurons; i++)
+    {
+        m_rgFirstSynapse[i + 1] = m_rgFirstSynapse[i] + psi->rgSynapseMap[i].size();
+    }
+    int cSynapses = m_rgFirstSynapse[m_cNeurons];
+    m_rgTarget.resize(cSynapses);
+    m_rgInputClass.resize(cSynapses);
+    m_rgDeltaT.resize(cSynapses);
+    m_rgW.resize(cSynapses);
+    m_rgDecay.resize(cSynapses);
+    m_rgD.resize(cSynapses);
+    m_rgUse.resize(cSynapses);
+    m_rgF.resize(cSynapses);
+    m_rgTotalDelay.resize(cSynapses);
+    m_rgDelayQueueLength.resize(cSynapses);
+    m_rgDelayIdx.resize(cSynapses);
+    m_rgFirstSlot.resize(cSynapses);
+    m_rgPsr.resize(cSynapses * m_cLanes);
+    m_rgR.resize(cSynapses * m_cLanes);
+    m_rgU.resize(cSynapses * m_cLanes);
+    m_rgLastSpike.resize(cSynapses * m_cLanes);
+    for (int i = 0; i < m_cNeurons; i++)
+    {
+        for (size_t z = 0; z < psi->rgSynapseMap[i].size(); z++)
+        {
+            const DynamicSpikingSynapse& syn = psi->rgSynapseMap[i][z];
+            int s = m_rgFirstSynapse[i] + z;
+
+            m_rgTarget[s] = &syn.summationPoint - psi->pSummationMap;
+            assert(m_rgTarget[s] >= 0 && m_rgTarget[s] < m_cNeurons);
+            // input from inhibitory and excitatory neurons decay differently (see InputRingBuffer)
+            m_rgInputClass[s] = syn.type == II || syn.type == IE ? 0 : 1;
+            m_rgDeltaT[s] = syn.deltaT;
+            m_rgW[s] = syn.W;
+            m_rgDecay[s] = syn.decay;
+            m_rgD[s] = syn.D;
+            m_rgUse[s] = syn.U;
+            m_rgF[s] = syn.F;
+            m_rgTotalDelay[s] = syn.total_delay;
+            m_rgDelayQueueLength[s] = syn.ldelayQueue;
+            m_rgDelayIdx[s] = syn.delayIdx;
+
+            m_rgFirstSlot[s] = m_rgDelayQueue.size();
+            for (int k = 0; k < syn.ldelayQueue; k++)
+            {
+                bool fSpike = (syn.delayQueue[k / LENGTH_OF_DELAYQUEUE] >> (k % LENGTH_OF_DELAYQUEUE)) & 0x1;
+                m_rgDelayQueue.push_back(fSpike ? allLanes : 0);
+            }
+
+            for (int l = 0; l < m_cLanes; l++)
+            {
+                m_rgPsr[s * m_cLanes + l] = syn.psr;
+                m_rgR[s * m_cLanes + l] = syn.r;
+                m_rgU[s * m_cLanes + l] = syn.u;
+                m_rgLastSpike[s * m_cLanes + l] = syn.lastSpike;
+            }
+        }
+    }
+
+    // the pending input of the ring buffers, in storage order and starting with the current slot
+    if (pInputRing != NULL)
+    {
+        m_cSlots = pInputRing->getSlots();
+
+        int cInputs = m_cNeurons * INPUT_CLASSES;
+        vector<int> rgIdentity(m_cNeurons);
+        vector<FLOAT> rgSlots(m_cSlots * cInputs);
+        vector<FLOAT> rgPsr(cInputs);
+        for (int i = 0; i < m_cNeurons; i++)
+        {
+            rgIdentity[i] = i;
+        }
+        m_rgTargetDecay.resize(cInputs);
+        pInputRing->save(&rgSlots[0], &rgPsr[0], &m_rgTargetDecay[0], &rgIdentity[0]);
+
+        m_rgSlots.resize(rgSlots.size() * m_cLanes);
+        for (size_t i = 0; i < rgSlots.size(); i++)
+        {
+            for (int l = 0; l < m_cLanes; l++)
+            {
+                m_rgSlots[i * m_cLanes + l] = rgSlots[i];
+            }
+        }
+        m_rgTargetPsr.resize(cInputs * m_cLanes);
+        for (int c = 0; c < cInputs; c++)
+        {
+            for (int l = 0; l < m_cLanes; l++)
+            {
+                m_rgTargetPsr[c * m_cLanes + l] = rgPsr[c];
+            }
+        }
+    }
+}
+
+/**
+ * Destructor
+ */
+LaneSim::~LaneSim()
+{
+    for (unsigned int l = 0; l < m_rgNormrnd.size(); l++)
+    {
+        delete m_rgNormrnd[l];
+    }
+}
+
+/**
+ * Restart the noise of a lane from a new seed.
+ * @param[in] lane	The lane.
+ * @param[in] seed	The seed.
+ */
+void LaneSim::seed(int lane, uint32_t seed)
+{
+    m_rgNormrnd[lane]->reseed(seed);
+}
+
+/**
+ * @param[in] psi	Pointer to the simulation information.
+ * @param[in] rgHistogram	The spike histograms of the lanes (NULL where spikes are not counted).
+ * @param[in] rgRecorder	The spike recorders of the lanes (NULL where spikes are not recorded).
+ */
+void LaneSim::advanceUntilGrowth(SimulationInfo* psi, const vector<SpikeHistogram*>& rgHistogram,
+        const vector<SpikeRecorder*>& rgRecorder)
+{
+    switch (m_cLanes)
+    {
+    case 4:
+        advanceEpoch<4>(psi, rgHistogram, rgRecorder);
+        break;
+    case 8:
+        advanceEpoch<8>(psi, rgHistogram, rgRecorder);
+        break;
+    case 16:
+        advanceEpoch<16>(psi, rgHistogram, rgRecorder);
+        break;
+    default:
+        advanceEpoch<0>(psi, rgHistogram, rgRecorder);
+        break;
+    }
+}
+
+/**
+ * @param[in] psi	Pointer to the simulation information.
+ * @param[in] rgHistogram	The spike histograms of the lanes.
+ * @param[in] rgRecorder	The spike recorders of the lanes.
+ */
+template <int LANES>
+void LaneSim::advanceEpoch(SimulationInfo* psi, const vector<SpikeHistogram*>& rgHistogram,
+        const vector<SpikeRecorder*>& rgRecorder)
+{
+    uint64_t count = 0;
+    uint64_t endStep = psi->pContext->simulationStep + static_cast<uint64_t>(psi->stepDuration / psi->deltaT);
+
+    while (psi->pContext->simulationStep < endStep)
+    {
+        DEBUG(if (count % 1000 == 0)
+              {
+                  cout << psi->currentStep << "/" << psi->maxSteps
+                      << " simulating time: " << psi->pContext->simulationStep * psi->deltaT << endl;
+                  count = 0;
+              }
+
+              count++;
+             )
+
+        advanceNeurons<LANES>(psi, rgHistogram, rgRecorder);
+
+        if (m_cSlots > 0)
+        {
+            advanceRing<LANES>();
+        }
+        else
+        {
+            advanceSynapses<LANES>(psi->pContext->simulationStep);
+        }
+        psi->pContext->simulationStep++;
+    }
+}
+
+/**
+ * The lanes of a neuron are advanced as LifNeuron::advance() advances the neuron, in two
+ * passes: the first draws the noise of the lanes that integrate their input, the second
+ * updates all lanes without branches.  The neurons are visited in row-major order, like
+ * SingleThreadedSim::advanceNeurons() visits them.
+ * @param[in] psi	Pointer to the simulation information.
+ * @param[in] rgHistogram	The spike histograms of the lanes.
+ * @param[in] rgRecorder	The spike recorders of the lanes.
+ */
+template <int LANES>
+void LaneSim::advanceNeurons(SimulationInfo* psi, const vector<SpikeHistogram*>& rgHistogram,
+        const vector<SpikeRecorder*>& rgRecorder)
+{
+    const int cLanes = LANES > 0 ? LANES : m_cLanes;
+    uint64_t step = psi->pContext->simulationStep;
+    FLOAT rgNoise[LANES > 0 ? LANES : MAX_LANES];
+
+    for (int k = m_cNeurons - 1; k >= 0; --k)
+    {
+        const int i = psi->rgStorageIndex[k];
+        FLOAT* pVm = &m_rgVm[i * cLanes];
+        int* pStepsInRefr = &m_rgStepsInRefr[i * cLanes];
+        int* pSpikeCount = &m_rgSpikeCount[i * cLanes];
+        FLOAT* pSummation = &m_rgSummation[i * cLanes];
+        const FLOAT Vthresh = m_rgVthresh[i];
+        const FLOAT Vreset = m_rgVreset[i];
+        const FLOAT Inoise = m_rgInoise[i];
+        const FLOAT C1 = m_rgC1[i];
+        const FLOAT C2 = m_rgC2[i];
+        const FLOAT I0 = m_rgI0[i];
+        const int cRefract = m_rgRefract[i];
+
+        uint32_t fired = 0;
+        for (int l = 0; l < cLanes; l++)
+        {
+            rgNoise[l] = 0;
+            if (pStepsInRefr[l] > 0)
+                continue;
+            if (pVm[l] >= Vthresh)
+                fired |= 1u << l;
+            else
+                rgNoise[l] = (*m_rgNormrnd[l])( );
+        }
+
+        for (int l = 0; l < cLanes; l++)
+        {
+            bool fRefractory = pStepsInRefr[l] > 0;
+            bool fFire = !fRefractory && pVm[l] >= Vthresh;
+            FLOAT summation = pSummation[l] + I0 + rgNoise[l] * Inoise;
+            FLOAT Vm = C1 * pVm[l] + C2 * summation;
+
+            pVm[l] = fRefractory ? pVm[l] : ( fFire ? Vreset : Vm );
+            pStepsInRefr[l] = fRefractory ? pStepsInRefr[l] - 1 : ( fFire ? cRefract : pStepsInRefr[l] );
+            pSpikeCount[l] += fFire ? 1 : 0;
+            pSummation[l] = 0;
+        }
+
+        // notify outgoing synapses of the lanes in which the neuron has fired
+        for (int l = 0; fired != 0; l++, fired >>= 1)
+        {
+            if (!(fired & 0x1))
+                continue;
+
+            if (rgHistogram[l] != NULL)
+            {
+                rgHistogram[l]->count(0, step);
+            }
+            if (rgRecorder[l] != NULL)
+            {
+                rgRecorder[l]->record(0, psi->rgNeuronIndex[i], step);
+            }
+            preSpikeHit(l, i, step);
+        }
+    }
+}
+
+/**
+ * The lanes of each synapse are advanced as DynamicSpikingSynapse::advance() advances the synapse.
+ * @param[in] step	The current time step.
+ */
+template <int LANES>
+void LaneSim::advanceSynapses(uint64_t step)
+{
+    const int cLanes = LANES > 0 ? LANES : m_cLanes;
+
+    for (int s = m_rgFirstSynapse[m_cNeurons] - 1; s >= 0; --s)
+    {
+        // the lanes in which an input is in the queue
+        int idx = m_rgDelayIdx[s];
+        uint32_t& slot = m_rgDelayQueue[m_rgFirstSlot[s] + idx];
+        uint32_t arrived = slot;
+        slot = 0;
+        if (++idx >= m_rgDelayQueueLength[s])
+            idx = 0;
+        m_rgDelayIdx[s] = idx;
+
+        FLOAT* pPsr = &m_rgPsr[s * cLanes];
+        for (int l = 0; arrived != 0; l++, arrived >>= 1)
+        {
+            if (arrived & 0x1)
+                pPsr[l] += spikeResponse(s, l, step);
+        }
+
+        // decay the post spike response and apply it to the summation point
+        const FLOAT decay = m_rgDecay[s];
+        FLOAT* pSummation = &m_rgSummation[m_rgTarget[s] * cLanes];
+        for (int l = 0; l < cLanes; l++)
+        {
+            pPsr[l] *= decay;
+            pSummation[l] += pPsr[l];
+        }
+    }
+}
+
+/**
+ * The lanes of each target are advanced as InputRingBuffer::advance() advances the target.
+ * @post The rings are moved to the next time step.
+ */
+template <int LANES>
+void LaneSim::advanceRing()
+{
+    const int cLanes = LANES > 0 ? LANES : m_cLanes;
+    FLOAT* pSlot = &m_rgSlots[m_iSlot * m_cNeurons * INPUT_CLASSES * cLanes];
+    FLOAT rgSum[LANES > 0 ? LANES : MAX_LANES];
+
+    for (int i = 0; i < m_cNeurons; i++)
+    {
+        for (int l = 0; l < cLanes; l++)
+        {
+            rgSum[l] = 0;
+        }
+
+        for (int c = i * INPUT_CLASSES; c < (i + 1) * INPUT_CLASSES; c++)
+        {
+            const FLOAT decay = m_rgTargetDecay[c];
+            FLOAT* pPsr = &m_rgTargetPsr[c * cLanes];
+            FLOAT* pInput = &pSlot[c * cLanes];
+            for (int l = 0; l < cLanes; l++)
+            {
+                pPsr[l] = (pPsr[l] + pInput[l]) * decay;
+                pInput[l] = 0;
+                rgSum[l] += pPsr[l];
+            }
+        }
+
+        FLOAT* pSummation = &m_rgSummation[i * cLanes];
+        for (int l = 0; l < cLanes; l++)
+        {
+            pSummation[l] += rgSum[l];
+        }
+    }
+
+    if (++m_iSlot >= m_cSlots)
+        m_iSlot = 0;
+}
+
+/**
+ * Add the input of the synapses of a neuron that has fired in a lane to the delay
+ * queues, or to the ring, of the lane.
+ * @param[in] lane	The lane.
+ * @param[in] neuron	The neuron (storage index).
+ * @param[in] step	The current time step.
+ */
+void LaneSim::preSpikeHit(int lane, int neuron, uint64_t step)
+{
+    uint32_t bmask = 0x1u << lane;
+
+    for (int s = m_rgFirstSynapse[neuron + 1] - 1; s >= m_rgFirstSynapse[neuron]; --s)
+    {
+        int delay = m_rgTotalDelay[s];
+
+        if (m_cSlots > 0)
+        {
+            assert(delay >= 0 && delay < m_cSlots);
+
+            int slot = m_iSlot + delay;
+            if (slot >= m_cSlots)
+                slot -= m_cSlots;
+
+            int c = m_rgTarget[s] * INPUT_CLASSES + m_rgInputClass[s];
+            FLOAT value = spikeResponse(s, lane, step + delay);
+            m_rgSlots[(slot * m_cNeurons * INPUT_CLASSES + c) * m_cLanes + lane] += value;
+            m_rgTargetDecay[c] = m_rgDecay[s];
+        }
+        else
+        {
+            int idx = m_rgDelayIdx[s] + delay;
+            if (idx >= m_rgDelayQueueLength[s])
+                idx -= m_rgDelayQueueLength[s];
+
+            uint32_t& slot = m_rgDelayQueue[m_rgFirstSlot[s] + idx];
+            assert(!(slot & bmask));
+            slot |= bmask;
+        }
+    }
+}
+
+/**
+ * Adjust the facilitation and depression of a synapse in a lane for a spike that arrives
+ * at the given time step, as DynamicSpikingSynapse::spikeResponse() does.
+ * @param[in] s		The synapse.
+ * @param[in] lane	The lane.
+ * @param[in] step	The time step at which the spike arrives.
+ * @return the increment of the psr caused by the spike.
+ */
+FLOAT LaneSim::spikeResponse(int s, int lane, uint64_t step)
+{
+    FLOAT& r = m_rgR[s * m_cLanes + lane];
+    FLOAT& u = m_rgU[s * m_cLanes + lane];
+    uint64_t& lastSpike = m_rgLastSpike[s * m_cLanes + lane];
+
+    // adjust synapse paramaters
+    if (lastSpike != ULONG_MAX) {
+        FLOAT isi = (step - lastSpike) * m_rgDeltaT[s] ;
+        r = 1 + ( r * ( 1 - u ) - 1 ) * exp( -isi / m_rgD[s] );
+        u = m_rgUse[s] + u * ( 1 - m_rgUse[s] ) * exp( -isi / m_rgF[s] );
+    }
+    lastSpike = step; // record the time of the spike
+    return ( ( m_rgW[s] / m_rgDecay[s] ) * u * r );
+}
+
+/**
+ * Calculate the firing rate of each neuron of a lane for the epoch, as the growth update
+ * of a network with frozen connectivity does.
+ * @param[in] lane	The lane.
+ * @param[in] psi	Pointer to the simulation information.
+ * @param[out] newRates	Receives the firing rate of each neuron.
+ * @post The spike counts of the lane are cleared.
+ */
+void LaneSim::updateRates(int lane, SimulationInfo* psi, VectorMatrix& newRates)
+{
+    for (int i = 0; i < m_cNeurons; i++)
+    {
+        int& spikeCount = m_rgSpikeCount[psi->rgStorageIndex[i] * m_cLanes + lane];
+
+        newRates[i] = spikeCount / psi->stepDuration;
+        spikeCount = 0;
+    }
+}
+
+/**
+ * Copy the dynamic state of a lane into the neurons, synapses and summation map of the
+ * network, into its input ring buffers and into a noise generator, e.g. to write the
+ * memory image of the replica of the lane.
+ * @param[in] lane	The lane.
+ * @param[in] psi	Pointer to the simulation information.
+ * @param[in] pInputRing	The input ring buffers, or NULL if the synapses deliver their own input.
+ * @param[out] normrnd	Receives the state of the noise generator of the lane.
+ */
+void LaneSim::store(int lane, SimulationInfo* psi, InputRingBuffer* pInputRing, Norm& normrnd) const
+{
+    for (int i = 0; i < m_cNeurons; i++)
+    {
+        LifNeuron& neuron = (*(psi->pNeuronList))[i];
+
+        neuron.Vm = m_rgVm[i * m_cLanes + lane];
+        neuron.nStepsInRefr = m_rgStepsInRefr[i * m_cLanes + lane];
+        neuron.spikeCount = m_rgSpikeCount[i * m_cLanes + lane];
+        neuron.hasFired = false;
+        psi->pSummationMap[i] = m_rgSummation[i * m_cLanes + lane];
+
+        for (size_t z = 0; z < psi->rgSynapseMap[i].size(); z++)
+        {
+            DynamicSpikingSynapse& syn = psi->rgSynapseMap[i][z];
+            int s = m_rgFirstSynapse[i] + z;
+
+            syn.psr = m_rgPsr[s * m_cLanes + lane];
+            syn.r = m_rgR[s * m_cLanes + lane];
+            syn.u = m_rgU[s * m_cLanes + lane];
+            syn.lastSpike = m_rgLastSpike[s * m_cLanes + lane];
+            syn.delayIdx = m_rgDelayIdx[s];
+            for (int k = 0; k < WORDS_OF_DELAYQUEUE; k++)
+                syn.delayQueue[k] = 0;
+            for (int k = 0; k < m_rgDelayQueueLength[s]; k++)
+            {
+                if ((m_rgDelayQueue[m_rgFirstSlot[s] + k] >> lane) & 0x1)
+                    syn.delayQueue[k / LENGTH_OF_DELAYQUEUE] |= 0x1u << (k % LENGTH_OF_DELAYQUEUE);
+            }
+        }
+    }
+
+    if (pInputRing != NULL && m_cSlots > 0)
+    {
+        int cInputs = m_cNeurons * INPUT_CLASSES;
+        vector<int> rgIdentity(m_cNeurons);
+        vector<FLOAT> rgSlots(m_cSlots * cInputs);
+        vector<FLOAT> rgPsr(cInputs);
+        for (int i = 0; i < m_cNeurons; i++)
+        {
+            rgIdentity[i] = i;
+        }
+        for (int k = 0; k < m_cSlots; k++)
+        {
+            int slot = (m_iSlot + k) % m_cSlots;
+            for (int c = 0; c < cInputs; c++)
+            {
+                rgSlots[k * cInputs + c] = m_rgSlots[(slot * cInputs + c) * m_cLanes + lane];
+            }
+        }
+        for (int c = 0; c < cInputs; c++)
+        {
+            rgPsr[c] = m_rgTargetPsr[c * m_cLanes + lane];
+        }
+        pInputRing->restore(&rgSlots[0], &rgPsr[0], &m_rgTargetDecay[0], &rgIdentity[0]);
+    }
+
+    MTRand::uint32 state[MTRand::SAVE];
+    bool fOdd;
+    FLOAT x2;
+    m_rgNormrnd[lane]->saveState(state, fOdd, x2);
+    normrnd.loadState(state, fOdd, x2);
+}
@@ -0,0 +1,178 @@
+/**
+ *	@file LaneSim.h
+ *
+ *	@brief Header file for LaneSim.
+ */
+//! Simulates several replicas of a network with frozen connectivity in lockstep, one per lane.
+
+/**
+ ** \class LaneSim LaneSim.h "LaneSim.h"
+ **
+ ** \latexonly	\subsubsection*{Implementation} \endlatexonly
+ ** \htmlonly	<h3>Implementation</h3> \endhtmlonly
+ **
+ ** The replicas of an ensemble (see Ensemble) all run on the same network, and their
+ ** connectivity is frozen, so they differ only in their dynamic state.  A LaneSim simulates
+ ** a batch of them in one loop: it keeps the parameters of the neurons and the structure of
+ ** the synapses once, in flat arrays in the storage order of the network, and the dynamic
+ ** state of each neuron and synapse once per replica (lane), with the lanes of a neuron or
+ ** synapse next to each other.  Each neuron and synapse is then visited once per time step
+ ** for all lanes, and the update of its lanes is a short loop with a fixed trip count that
+ ** the compiler turns into SIMD operations; the kernels are instantiated for 4, 8 and 16 lanes,
+ ** other numbers of lanes use the same code with a variable trip count.
+ **
+ ** The delay queue of a synapse holds a lane mask per time slot (up to 32 lanes), so the
+ ** arrival of spikes is checked once for all lanes, and only the lanes whose bit is set
+ ** update their facilitation and depression.  With input ring buffers (see InputRingBuffer)
+ ** each lane has its own delay slots and responses of the targets.  Each lane draws its noise
+ ** from a generator of its own, in the order in which a replica run on its own draws it, and
+ ** the floating point operations of a lane are those of SingleThreadedSim, so each lane
+ ** produces exactly the results of the replica simulated by itself.
+ **
+ ** The LaneSim copies the state of the network it is created from into every lane.  Only the
+ ** state that changes while the replicas run is kept per lane; a growth update would change
+ ** the connectivity of each replica differently, so networks that grow are not run in lanes.
+ ** For the same reason the runs of a parameter sweep, which grow, are not run in lanes, and
+ ** all the lanes of a LaneSim have the same neuron parameters: only their seeds differ.
+ ** store() copies the state of a lane back into the network, e.g. to write its memory image.
+ **
+ ** \latexonly	\subsubsection*{Credits} \endlatexonly
+ ** \htmlonly	<h3>Credits</h3> \endhtmlonly
+ **
+ ** This simulator is a rewrite of CSIM (2006) and other work (Stiber and Kawasaki (2007?))
+ **/
+
+#pragma once
+
+#ifndef _LANESIM_H_
+#define _LANESIM_H_
+
+#include "SimulationInfo.h"
+#include "InputRingBuffer.h"
+#include "SpikeRecorder.h"
+#include "SpikeHistogram.h"
+#include "Matrix/VectorMatrix.h"
+
+//! Largest number of lanes (the bits of a lane mask).
+#define MAX_LANES 32
+
+class LaneSim
+{
+public:
+    //! The constructor for LaneSim.
+    LaneSim(SimulationInfo* psi, const InputRingBuffer* pInputRing, int cLanes);
+    ~LaneSim();
+
+    //! Seed the noise generator of a lane.
+    void seed(int lane, uint32_t seed);
+
+    //! Performs updating neurons and synapses of all lanes for one activity epoch.
+    void advanceUntilGrowth(SimulationInfo* psi, const vector<SpikeHistogram*>& rgHistogram,
+            const vector<SpikeRecorder*>& rgRecorder);
+
+    //! Return the firing rates of a lane for the epoch, and clear its spike counts.
+    void updateRates(int lane, SimulationInfo* psi, VectorMatrix& newRates);
+
+    //! Copy the state of a lane into the network.
+    void store(int lane, SimulationInfo* psi, InputRingBuffer* pInputRing, Norm& normrnd) const;
+
+    //! Number of lanes.
+    int getLanes() const { return m_cLanes; }
+
+private:
+    //! Advance the neurons and synapses of all lanes until the next growth update.
+    template <int LANES> void advanceEpoch(SimulationInfo* psi, const vector<SpikeHistogram*>& rgHistogram,
+            const vector<SpikeRecorder*>& rgRecorder);
+
+    //! Advance the neurons of all lanes, and notify the synapses of the neurons that fire.
+    template <int LANES> void advanceNeurons(SimulationInfo* psi, const vector<SpikeHistogram*>& rgHistogram,
+            const vector<SpikeRecorder*>& rgRecorder);
+
+    //! Advance the synapses of all lanes and apply their responses to the summation points.
+    template <int LANES> void advanceSynapses(uint64_t step);
+
+    //! Apply the input of the current slot of the ring of each lane to the summation points.
+    template <int LANES> void advanceRing();
+
+    //! Schedule the input of the synapses of a neuron that has fired in a lane.
+    void preSpikeHit(int lane, int neuron, uint64_t step);
+
+    //! Update the facilitation and depression of a synapse in a lane for a spike arriving at a step.
+    FLOAT spikeResponse(int s, int lane, uint64_t step);
+
+    //! Number of lanes.
+    int m_cLanes;
+
+    //! Number of neurons.
+    int m_cNeurons;
+
+    //! The noise generator of each lane.
+    vector<Norm*> m_rgNormrnd;
+
+    // The parameters of the neurons, [neuron]
+    vector<FLOAT> m_rgVthresh;
+    vector<FLOAT> m_rgVreset;
+    vector<FLOAT> m_rgInoise;
+    vector<FLOAT> m_rgC1;
+    vector<FLOAT> m_rgC2;
+    vector<FLOAT> m_rgI0;
+    //! Number of time steps of the absolute refractory period.
+    vector<int> m_rgRefract;
+
+    // The state of the neurons, [neuron][lane]
+    vector<FLOAT> m_rgVm;
+    vector<int> m_rgStepsInRefr;
+    vector<int> m_rgSpikeCount;
+    //! The summation points.
+    vector<FLOAT> m_rgSummation;
+
+    //! The first synapse of each neuron, [neuron + 1].
+    vector<int> m_rgFirstSynapse;
+
+    // The parameters of the synapses, [synapse]
+    vector<int> m_rgTarget;
+    vector<int> m_rgInputClass;
+    vector<FLOAT> m_rgDeltaT;
+    vector<FLOAT> m_rgW;
+    vector<FLOAT> m_rgDecay;
+    vector<FLOAT> m_rgD;
+    vector<FLOAT> m_rgUse;
+    vector<FLOAT> m_rgF;
+    vector<int> m_rgTotalDelay;
+    vector<int> m_rgDelayQueueLength;
+
+    //! The current time slot of the delay queue of each synapse (the same in all lanes), [synapse].
+    vector<int> m_rgDelayIdx;
+
+    //! The first time slot of the delay queue of each synapse in m_rgDelayQueue, [synapse].
+    vector<int> m_rgFirstSlot;
+
+    //! The delay queues, one lane mask per time slot.
+    vector<uint32_t> m_rgDelayQueue;
+
+    // The state of the synapses, [synapse][lane]
+    vector<FLOAT> m_rgPsr;
+    vector<FLOAT> m_rgR;
+    vector<FLOAT> m_rgU;
+    vector<uint64_t> m_rgLastSpike;
+
+    //! Number of delay slots of the input ring buffers; 0 if the synapses deliver their own input.
+    int m_cSlots;
+
+    //! The slot of the current time step.
+    int m_iSlot;
+
+    //! The delay slots of the input ring buffers, [slot][target][class][lane].
+    vector<FLOAT> m_rgSlots;
+
+    //! The post synaptic response of each target, [target][class][lane].
+    vector<FLOAT> m_rgTargetPsr;
+
+    //! The psr decay of each target (the same in all lanes), [target][class].
+    vector<FLOAT> m_rgTargetDecay;
+
+    LaneSim(const LaneSim&);
+    LaneSim& operator=(const LaneSim&);
+};
+
+#endif // _LANESIM_H_
@@ -24,6 +24,7 @@ LifNeuron::LifNeuron() :
     Trefract(DEFAULT_Trefract), 
     Inoise(DEFAULT_Inoise), 
     Iinject(DEFAULT_Iinject),
+    Isyn(0),
     Tau(DEFAULT_Cm * DEFAULT_Rm)
 {
 	reset( );
@@ -59,20 +60,16 @@ LifNeuron::~LifNeuron() {
  * If \f$V_m\f$ exceeds \f$V_{thresh}\f$ a spike is emmited. 
  * Otherwise, decay \f$Vm\f$ and add inputs.
  * @param[in] summationPoint
+ * @param[in] normrnd	The noise generator of the thread that advances the neuron.
  */
-void LifNeuron::advance(FLOAT& summationPoint) {
+void LifNeuron::advance(FLOAT& summationPoint, Norm& normrnd) {
 	if (nStepsInRefr > 0) { // is neuron refractory?
 		--nStepsInRefr;
 	} else if (Vm >= Vthresh) { // should it fire?
 		fire( );
 	} else {
 		summationPoint += I0; // add IO
-#ifdef USE_OMP
-		int tid = OMP(omp_get_thread_num());
-		summationPoint += ( (*rgNormrnd[tid])( ) * Inoise ); // add noise
-#else
-		summationPoint += ( (*rgNormrnd[0])( ) * Inoise ); // add noise
-#endif
+		summationPoint += ( normrnd( ) * Inoise ); // add noise
 		Vm = C1 * Vm + C2 * summationPoint; // decay Vm and add inputs
 	}
 	// clear synaptic input for next time step
@@ -81,18 +78,13 @@ void LifNeuron::advance(FLOAT& summationPoint) {
 
 /**
  * Propagate the spike to the synapse and reset the neuron.
- * If STORE_SPIKEHISTORY is set, spike time is recorded. 
+ * The simulator counts the spike (see SpikeHistogram) and records its time if requested (see SpikeRecorder).
  */
 void LifNeuron::fire()
 {
 	// Note that the neuron has fired!
 	hasFired = true;
 
-#ifdef STORE_SPIKEHISTORY
-	// record spike time
-	spikeHistory.push_back(g_simulationStep);
-#endif // STORE_SPIKEHISTORY
-
 	// increment spike count
 	spikeCount++;
 
@@ -105,13 +97,9 @@ void LifNeuron::fire()
 
 /**
  * Reset time varying state vars.
- * If STORE_SPIKEHISTORY is set, reset spike history.
  */
 void LifNeuron::reset(void) {
 	hasFired = false;
-#ifdef STORE_SPIKEHISTORY
-	spikeHistory.clear( );
-#endif // STORE_SPIKEHISTORY
 	nStepsInRefr = 0;
 	Vm = Vinit;
 	updateInternal( );
@@ -189,35 +177,6 @@ bool LifNeuron::isRefractory(void) {
 	return ( nStepsInRefr > 0 );
 }
 
-#ifdef STORE_SPIKEHISTORY
-/**
- * @return the number of spikes emitted.
- */
-int LifNeuron::nSpikes(void) {
-	return spikeHistory.size( );
-}
-
-/**
- * @return the count of spikes that occur at or after begin_time.
- */
-int LifNeuron::nSpikesSince(uint64_t begin_step)
-{
-	int count = 0;
-	for (size_t i = 0; i < spikeHistory.size(); i++)
-	{
-		if (spikeHistory[i] >= begin_step) count++;
-	}
-	return count;
-}
-
-/**
- * @returns a pointer to a vector of spike times.
- */
-vector<uint64_t>* LifNeuron::getSpikes(void) {
-	return &spikeHistory;
-}
-#endif // STORE_SPIKEHISTORY
-
 /**
  * Set spikeCount to 0.
  */
@@ -231,51 +190,3 @@ void LifNeuron::clearSpikeCount(void) {
 int LifNeuron::getSpikeCount(void) {
 	return spikeCount;
 }
-
-/**
- * @param[in] os	The filestream to write
- */
-void LifNeuron::write(ostream& os) {
-	os.write( reinterpret_cast<const char*>(&deltaT), sizeof(deltaT) );
-	os.write( reinterpret_cast<const char*>(&Cm), sizeof(Cm) );
-	os.write( reinterpret_cast<const char*>(&Rm), sizeof(Rm) );
-	os.write( reinterpret_cast<const char*>(&Vthresh), sizeof(Vthresh) );
-	os.write( reinterpret_cast<const char*>(&Vrest), sizeof(Vrest) );
-	os.write( reinterpret_cast<const char*>(&Vreset), sizeof(Vreset) );
-	os.write( reinterpret_cast<const char*>(&Vinit), sizeof(Vinit) );
-	os.write( reinterpret_cast<const char*>(&Trefract), sizeof(Trefract) );
-	os.write( reinterpret_cast<const char*>(&Inoise), sizeof(Inoise) );
-	os.write( reinterpret_cast<const char*>(&Iinject), sizeof(Iinject) );
-	os.write( reinterpret_cast<const char*>(&Isyn), sizeof(Isyn) );
-	os.write( reinterpret_cast<const char*>(&nStepsInRefr), sizeof(nStepsInRefr) );
-	os.write( reinterpret_cast<const char*>(&C1), sizeof(C1) );
-	os.write( reinterpret_cast<const char*>(&C2), sizeof(C2) );
-	os.write( reinterpret_cast<const char*>(&I0), sizeof(I0) );
-	os.write( reinterpret_cast<const char*>(&Vm), sizeof(Vm) );
-	os.write( reinterpret_cast<const char*>(&hasFired), sizeof(hasFired) );
-	os.write( reinterpret_cast<const char*>(&Tau), sizeof(Tau) );
-}
-
-/**
- * @param[in] os	The filestream to read
- */
-void LifNeuron::read(istream& is) {
-	is.read( reinterpret_cast<char*>(&deltaT), sizeof(deltaT) );
-	is.read( reinterpret_cast<char*>(&Cm), sizeof(Cm) );
-	is.read( reinterpret_cast<char*>(&Rm), sizeof(Rm) );
-	is.read( reinterpret_cast<char*>(&Vthresh), sizeof(Vthresh) );
-	is.read( reinterpret_cast<char*>(&Vrest), sizeof(Vrest) );
-	is.read( reinterpret_cast<char*>(&Vreset), sizeof(Vreset) );
-	is.read( reinterpret_cast<char*>(&Vinit), sizeof(Vinit) );
-	is.read( reinterpret_cast<char*>(&Trefract), sizeof(Trefract) );
-	is.read( reinterpret_cast<char*>(&Inoise), sizeof(Inoise) );
-	is.read( reinterpret_cast<char*>(&Iinject), sizeof(Iinject) );
-	is.read( reinterpret_cast<char*>(&Isyn), sizeof(Isyn) );
-	is.read( reinterpret_cast<char*>(&nStepsInRefr), sizeof(nStepsInRefr) );
-	is.read( reinterpret_cast<char*>(&C1), sizeof(C1) );
-	is.read( reinterpret_cast<char*>(&C2), sizeof(C2) );
-	is.read( reinterpret_cast<char*>(&I0), sizeof(I0) );
-	is.read( reinterpret_cast<char*>(&Vm), sizeof(Vm) );
-	is.read( reinterpret_cast<char*>(&hasFired), sizeof(hasFired) );
-	is.read( reinterpret_cast<char*>(&Tau), sizeof(Tau) );
-}
@@ -56,7 +56,7 @@ public:
 			FLOAT new_Vreset, FLOAT new_Vinit, FLOAT new_deltaT);
 
 	//! Process another time step.
-	void advance(FLOAT& summationPoint);
+	void advance(FLOAT& summationPoint, Norm& normrnd);
 
 	//! Reset to initial state.
 	void reset();
@@ -134,20 +134,6 @@ public:
 	//! The membrane time constant \f$(R_m \cdot C_m)\f$
 	FLOAT Tau;
 
-#ifdef STORE_SPIKEHISTORY
-	//! The history of spike times.
-	vector <uint64_t> spikeHistory;
-
-	//! Return the number of spikes emitted.
-	int nSpikes(void);
-
-	//! Returns a pointer to a vector of spike times
-	vector<uint64_t>* getSpikes(void);
-
-	//! Return the count of spikes that occur at or after begin_time
-	int nSpikesSince(uint64_t begin_step);
-#endif // STORE_SPIKEHISTORY
-
 	//! The number of spikes since the last growth cycle
 	int spikeCount;
 
@@ -156,12 +142,6 @@ public:
 
 	//! Return the spike count
 	int getSpikeCount(void);
-
-	//! Write the neuron data to the stream
-	void write(ostream& os);
-
-	//! Read the neuron data from the stream
-	void read(istream& is);
 };
 
 #endif
@@ -39,6 +39,8 @@
 
 #include "KIIexceptions.h"
 #include "CompleteMatrix.h"
+#include "MatrixXmlReader.h"
+#include "MatrixXmlWriter.h"
 
 #include "SourceVersions.h"
 
@@ -68,22 +70,23 @@ CompleteMatrix::CompleteMatrix(string t, string i, int r,
   alloc(rows, columns);
 
   if (values != "") {     // Initialize from the text string
-    istringstream valStream(values);
+    const char* pVal = values.c_str();
+    const char* pEnd = pVal + values.size();
     if (type == "diag") {       // diagonal matrix with values given
       for (int i=0; i<rows; i++)
 	for (int j=0; j<columns; j++) {
 	  theMatrix[i][j] = 0.0;    // Non-diagonal elements are zero
 	  if (i == j) {
-	    valStream >> theMatrix[i][j];
+	    pVal = MatrixXmlReader::parseValues(pVal, pEnd, &theMatrix[i][j], 1);
 	    theMatrix[i][j] *= multiplier;
 	  }
 	}
     } else if (type == "complete") { // complete matrix with values given
-      for (int i=0; i<rows; i++)
-	for (int j=0; j<columns; j++) {
-	  valStream >> theMatrix[i][j];
+      for (int i=0; i<rows; i++) {
+	pVal = MatrixXmlReader::parseValues(pVal, pEnd, theMatrix[i], columns);
+	for (int j=0; j<columns; j++)
 	  theMatrix[i][j] *= multiplier;
-	}
+      }
     } else {
       clear();
       throw KII_invalid_argument("Illegal type for CompleteMatrix with 'none' init: " + type);
@@ -230,16 +233,25 @@ string CompleteMatrix::toXML(string name) const
 {
   stringstream os;
 
+  toXML(os, name);
+
+  return os.str();
+}
+
+// write Matrix as XML to a stream; the values are formatted as Print()
+// would, but faster
+void CompleteMatrix::toXML(ostream& os, string name) const
+{
   os << "<Matrix ";
   if (name != "")
     os << "name=\"" << name << "\" ";
   os << "type=\"complete\" rows=\"" << rows
      << "\" columns=\"" << columns
      << "\" multiplier=\"1.0\">" << endl;
-  os << "   " << *this << endl;
+  os << "   ";
+  MatrixXmlWriter::writeValues(os, theMatrix, rows, columns, true);
+  os << endl;
   os << "</Matrix>";
-
-  return os.str();
 }
 
 
@@ -107,6 +107,15 @@ public:
   inline FLOAT& operator()(int row, int column) 
   { return theMatrix[row][column]; }
 
+  /*!
+    @brief access element at (row, column) -- accessor
+    @param row element row
+    @param column element column
+    @return value of element
+  */
+  inline FLOAT operator()(int row, int column) const
+  { return theMatrix[row][column]; }
+
   /*!
     @brief Polymorphic output. Produces text output on stream os
     @param os stream to output to
@@ -119,6 +128,14 @@ public:
   */
   virtual string toXML(string name="") const;
 
+  /*!
+    @brief Write XML representation of Matrix to a stream, without
+    building it in memory first. Same text as toXML(name).
+    @param os stream to output to
+    @param name name attribute for XML
+  */
+  virtual void toXML(ostream& os, string name="") const;
+
   /*! @name Math operations
 
     For efficiency's sake, these methods will be
@@ -35,6 +35,7 @@
 #include "InputGenerator.h"
 #include "KIIexceptions.h"
 #include "MatrixFactory.h"
+#include "MatrixXmlReader.h"
 
 #include "SourceVersions.h"
 
@@ -154,4 +155,39 @@ void InputGenerator::Load(TiXmlElement* is)
     throw KII_invalid_argument("No vectors in InputSequence in XML.");
 }
 
+/*
+  @method Load
+  @discussion Parse the first XML InputSequence element of a stream,
+  reading its vectors directly into VectorMatrix storage.
+  @param is Stream containing an XML InputSequence element
+  @throws KII_invalid_argument
+*/
+void InputGenerator::Load(istream& is)
+{
+  MatrixXmlReader reader(is);
+
+  while (reader.nextElement() && reader.name() != "InputSequence")
+    ;
+  if (reader.name() != "InputSequence")
+    throw KII_invalid_argument("No InputSequence in XML.");
+
+  if (!reader.intAttribute("interval", updateInterval))
+    throw KII_invalid_argument("Update interval not specified for InputSequence in XML.");
+
+  // Looping defaults to "no"
+  const char* loopCStr = reader.attribute("loop");
+  loop = loopCStr != NULL && string(loopCStr) != "no";
+
+  // Load all the vectors (Matrix children) into the list
+  int depth = reader.depth();
+  while (reader.nextElement() && reader.depth() > depth)
+    if (reader.depth() == depth + 1 && reader.name() == "Matrix")
+      inputs.push_back(reader.readVector());
+
+  // If no vectors were read, we need to bail, because we don't know
+  // the input vector size
+  if (inputs.size() == 0)
+    throw KII_invalid_argument("No vectors in InputSequence in XML.");
+}
+
 
@@ -150,6 +150,14 @@ public:
   */
   void Load(TiXmlElement* is);
 
+  /*!
+    Parse the first XML InputSequence element of a stream, without
+    building a DOM for it (see MatrixXmlReader).
+    @param is Stream containing an XML InputSequence element
+    @throws KII_invalid_argument
+  */
+  void Load(istream& is);
+
   /*!
     Returns iterator that presents input vectors starting
     with simulation step 0.
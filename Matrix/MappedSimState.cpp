@@ -0,0 +1,235 @@
+/*!
+  @file MappedSimState.cpp
+  @brief Random access to the arrays of a binary state file mapped into memory
+*/
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include <cstring>
+
+#include "MappedSimState.h"
+#include "KIIexceptions.h"
+
+#include "SourceVersions.h"
+
+static VersionInfo version("$Id: MappedSimState.cpp $");
+
+void SimStateView::copyTo(vector<FLOAT>& values) const
+{
+  values.resize(m_cValues);
+  for (size_t i = 0; i < m_cValues; i++)
+    values[i] = (*this)[i];
+}
+
+MappedSimState::MappedSimState(const string& fileName)
+  : m_fileName(fileName), m_pData(NULL), m_cBytes(0), m_chunkBytes(0)
+{
+#ifdef _WIN32
+  m_hMapping = NULL;
+  m_hFile = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                        FILE_FLAG_RANDOM_ACCESS, NULL);
+  if (m_hFile == INVALID_HANDLE_VALUE)
+    throw KII_exception("Cannot open " + fileName);
+
+  LARGE_INTEGER size;
+  if (GetFileSizeEx(m_hFile, &size))
+    m_cBytes = size.QuadPart;
+  if (m_cBytes >= SIMSTATE_ALIGNMENT + SIMSTATE_TRAILER_BYTES) {
+    m_hMapping = CreateFileMapping(m_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (m_hMapping != NULL)
+      m_pData = static_cast<const char*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+  }
+  if (m_pData == NULL) {
+    if (m_hMapping != NULL)
+      CloseHandle(m_hMapping);
+    CloseHandle(m_hFile);
+    throw KII_exception("Cannot map " + fileName);
+  }
+#else
+  m_fd = open(fileName.c_str(), O_RDONLY);
+  if (m_fd < 0)
+    throw KII_exception("Cannot open " + fileName);
+
+  struct stat st;
+  if (fstat(m_fd, &st) == 0)
+    m_cBytes = st.st_size;
+  if (m_cBytes >= SIMSTATE_ALIGNMENT + SIMSTATE_TRAILER_BYTES) {
+    void* p = mmap(NULL, m_cBytes, PROT_READ, MAP_SHARED, m_fd, 0);
+    if (p != MAP_FAILED) {
+      m_pData = static_cast<const char*>(p);
+      // views typically touch a few values per page
+      posix_madvise(p, m_cBytes, POSIX_MADV_RANDOM);
+    }
+  }
+  if (m_pData == NULL) {
+    close(m_fd);
+    throw KII_exception("Cannot map " + fileName);
+  }
+#endif
+
+  try {
+    parse();
+  } catch (...) {
+    unmap();
+    throw;
+  }
+}
+
+MappedSimState::MappedSimState(const string& fileName, string& contents)
+  : m_fileName(fileName), m_pData(NULL), m_cBytes(0), m_chunkBytes(0)
+{
+#ifdef _WIN32
+  m_hFile = INVALID_HANDLE_VALUE;
+  m_hMapping = NULL;
+#else
+  m_fd = -1;
+#endif
+  m_contents.swap(contents);
+  if (m_contents.size() < SIMSTATE_ALIGNMENT + SIMSTATE_TRAILER_BYTES)
+    throw KII_exception("Not a binary simulation state file");
+  m_pData = m_contents.data();
+  m_cBytes = m_contents.size();
+  parse();
+}
+
+MappedSimState::~MappedSimState()
+{
+  unmap();
+}
+
+void MappedSimState::parse()
+{
+  uint32_t version, cArrays, dirCrc;
+
+  m_chunkBytes = SimStateFormat::parseHeader(m_pData, version);
+  uint64_t dirOffset = SimStateFormat::parseTrailer(m_pData + m_cBytes - SIMSTATE_TRAILER_BYTES,
+                                                    m_cBytes, cArrays, dirCrc);
+  SimStateFormat::parseDirectory(m_pData + dirOffset, m_cBytes - SIMSTATE_TRAILER_BYTES - dirOffset,
+                                 cArrays, dirCrc, version, m_chunkBytes, dirOffset, m_arrays);
+  unpack();
+}
+
+void MappedSimState::unpack()
+{
+  m_rgUnpacked.resize(m_arrays.size());
+  for (size_t i = 0; i < m_arrays.size(); i++) {
+    const SimStateArray& array = m_arrays[i];
+    if (array.encoding != SIMSTATE_PACKED)
+      continue;
+
+    // a chunk that does not unpack is left zero, and fails verify()
+    m_rgUnpacked[i].assign(array.cBytes, 0);
+    const char* pStored = m_pData + array.offset;
+    for (size_t k = 0; k < array.rgPackedBytes.size(); k++) {
+      char* pValues = &m_rgUnpacked[i][static_cast<uint64_t>(k) * m_chunkBytes];
+      if (!SimStateFormat::unpackChunk(array, m_chunkBytes, k, pStored, pValues))
+        memset(pValues, 0, SimStateFormat::chunkValueBytes(array, m_chunkBytes, k));
+      pStored += array.rgPackedBytes[k];
+    }
+  }
+}
+
+const char* MappedSimState::valuesOf(const SimStateArray& array) const
+{
+  if (array.encoding != SIMSTATE_PACKED)
+    return m_pData + array.offset;
+
+  const vector<char>& unpacked = m_rgUnpacked[&array - &m_arrays[0]];
+  return unpacked.empty() ? NULL : &unpacked[0];
+}
+
+void MappedSimState::unmap()
+{
+  if (!m_contents.empty())
+    return;
+#ifdef _WIN32
+  UnmapViewOfFile(m_pData);
+  CloseHandle(m_hMapping);
+  CloseHandle(m_hFile);
+#else
+  munmap(const_cast<char*>(m_pData), m_cBytes);
+  close(m_fd);
+#endif
+}
+
+const SimStateArray* MappedSimState::find(const string& name) const
+{
+  for (size_t i = 0; i < m_arrays.size(); i++)
+    if (m_arrays[i].name == name)
+      return &m_arrays[i];
+  return NULL;
+}
+
+SimStateView MappedSimState::row(const string& name, int row) const
+{
+  const SimStateArray& array = floatArray(name);
+
+  if (row < 0 || row >= array.cRows)
+    throw KII_exception("Row out of range of " + name);
+  return slice(name, row, 0, array.cColumns, 0, 1);
+}
+
+SimStateView MappedSimState::column(const string& name, int column) const
+{
+  const SimStateArray& array = floatArray(name);
+
+  if (column < 0 || column >= array.cColumns)
+    throw KII_exception("Column out of range of " + name);
+  return slice(name, 0, column, array.cRows, 1, 0);
+}
+
+SimStateView MappedSimState::slice(const string& name, int row, int column, size_t cValues,
+                                   int rowStep, int columnStep) const
+{
+  const SimStateArray& array = floatArray(name);
+
+  if (cValues == 0)
+    return SimStateView(NULL, 0, 0);
+
+  // both ends of the slice must be inside the array
+  int64_t lastRow = row + static_cast<int64_t>(rowStep) * (cValues - 1);
+  int64_t lastColumn = column + static_cast<int64_t>(columnStep) * (cValues - 1);
+  if (row < 0 || row >= array.cRows || column < 0 || column >= array.cColumns
+      || lastRow < 0 || lastRow >= array.cRows || lastColumn < 0 || lastColumn >= array.cColumns)
+    throw KII_exception("Slice out of range of " + name);
+
+  const float* pValues = reinterpret_cast<const float*>(valuesOf(array));
+  ptrdiff_t stride = static_cast<ptrdiff_t>(rowStep) * array.cColumns + columnStep;
+  return SimStateView(pValues + static_cast<ptrdiff_t>(row) * array.cColumns + column, cValues, stride);
+}
+
+const void* MappedSimState::values(const string& name, simStateType type, uint64_t cValues) const
+{
+  const SimStateArray* pArray = find(name);
+
+  if (pArray == NULL || pArray->type != type
+      || static_cast<uint64_t>(pArray->cRows) * pArray->cColumns != cValues)
+    throw KII_exception("No array " + name + " of the expected type and size in the binary simulation state file");
+  return valuesOf(*pArray);
+}
+
+bool MappedSimState::verify(const string& name) const
+{
+  const SimStateArray* pArray = find(name);
+
+  if (pArray == NULL)
+    throw KII_exception("No array " + name + " in the binary simulation state file");
+  const char* pValues = valuesOf(*pArray);
+  for (size_t i = 0; i < pArray->rgChunkCrc.size(); i++)
+    if (!SimStateFormat::checkChunk(*pArray, m_chunkBytes, i, pValues + static_cast<uint64_t>(i) * m_chunkBytes))
+      return false;
+  return true;
+}
+
+const SimStateArray& MappedSimState::floatArray(const string& name) const
+{
+  const SimStateArray* pArray = find(name);
+
+  if (pArray == NULL || pArray->type != SIMSTATE_FLOAT32)
+    throw KII_exception("No float array " + name + " in the binary simulation state file");
+  return *pArray;
+}
@@ -0,0 +1,191 @@
+/*!
+  @file MappedSimState.h
+  @brief Random access to the arrays of a binary state file mapped into memory
+*/
+
+#ifndef _MAPPEDSIMSTATE_H_
+#define _MAPPEDSIMSTATE_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "SimStateFormat.h"
+
+using namespace std;
+
+/*!
+  @class SimStateView
+  @brief A zero-copy, strided view of float values of a MappedSimState.
+
+  The view points into the mapping, so it is valid only as long as the
+  MappedSimState it was obtained from. Element i of the view is the
+  value at data() + i * stride().
+*/
+class SimStateView
+{
+public:
+  SimStateView() : m_pData(NULL), m_cValues(0), m_stride(0) {}
+  SimStateView(const float* pData, size_t cValues, ptrdiff_t stride)
+    : m_pData(pData), m_cValues(cValues), m_stride(stride) {}
+
+  /*! @brief Number of values in the view */
+  size_t size() const { return m_cValues; }
+
+  /*! @brief Distance between consecutive values, in floats */
+  ptrdiff_t stride() const { return m_stride; }
+
+  /*! @brief The first value; with a stride of 1 the values are contiguous */
+  const float* data() const { return m_pData; }
+
+  /*! @brief Value i of the view */
+  float operator[](size_t i) const { return m_pData[static_cast<ptrdiff_t>(i) * m_stride]; }
+
+  /*!
+    @brief Copy the values of the view.
+    @param values receives the values
+  */
+  void copyTo(vector<FLOAT>& values) const;
+
+private:
+  const float* m_pData;
+  size_t m_cValues;
+  ptrdiff_t m_stride;
+};
+
+/*!
+  @class MappedSimState
+  @brief Maps a binary state file (see SimStateFormat) into memory and
+  returns views of the rows, columns and strided slices of its arrays.
+
+  Only the header, the trailer and the directory are read when the
+  file is opened; the values of an array are paged in by the operating
+  system as a view is used, so extracting the trajectory of one neuron
+  from radiiHistory or ratesHistory does not read the rest of the file.
+  The mapping is advised for random access.
+
+  Because the values are not read, their checksums are not checked by
+  the views; verify() checks the chunks of an array on request.
+
+  Packed arrays cannot be used in place; they are unpacked into memory
+  when the file is opened.
+*/
+class MappedSimState
+{
+public:
+  /*!
+    @brief Map a binary state file.
+    @param fileName the file
+    @throws KII_exception if the file cannot be mapped or is not a valid binary state file
+  */
+  MappedSimState(const string& fileName);
+
+  /*!
+    @brief Use a binary state file that is held in memory, e.g. one that was
+    assembled from several files.
+    @param fileName name of the file, for messages
+    @param contents the contents of the file; taken over, it is left empty
+    @throws KII_exception if it is not a valid binary state file
+  */
+  MappedSimState(const string& fileName, string& contents);
+  ~MappedSimState();
+
+  /*! @brief Name of the file */
+  const string& fileName() const { return m_fileName; }
+
+  /*! @brief The arrays of the file, in the order they were written */
+  const vector<SimStateArray>& arrays() const { return m_arrays; }
+
+  /*!
+    @brief Find an array by name.
+    @return the array, or NULL if the file has no array with that name
+  */
+  const SimStateArray* find(const string& name) const;
+
+  /*!
+    @brief A row of a float array, e.g. the radii of all neurons at a growth step.
+    @throws KII_exception if there is no such float array or row
+  */
+  SimStateView row(const string& name, int row) const;
+
+  /*!
+    @brief A column of a float array, e.g. the radius of a neuron at each growth step.
+    @throws KII_exception if there is no such float array or column
+  */
+  SimStateView column(const string& name, int column) const;
+
+  /*!
+    @brief A strided slice of a float array.
+    @param name name of the array
+    @param row row of the first value
+    @param column column of the first value
+    @param cValues number of values
+    @param rowStep rows between consecutive values; may be negative
+    @param columnStep columns between consecutive values; may be negative
+    @throws KII_exception if there is no such float array or a value is outside of it
+  */
+  SimStateView slice(const string& name, int row, int column, size_t cValues,
+                     int rowStep, int columnStep) const;
+
+  /*!
+    @brief The values of an array, in place, as they are stored.
+    @param name name of the array
+    @param type type of the values
+    @param cValues number of values
+    @throws KII_exception if there is no such array of that type and size
+  */
+  const void* values(const string& name, simStateType type, uint64_t cValues) const;
+
+  /*!
+    @brief Check the chunks of an array against their checksums; reads the whole array.
+    @return true if all chunks are intact
+    @throws KII_exception if there is no such array
+  */
+  bool verify(const string& name) const;
+
+private:
+  /*! Parse the header, trailer and directory of the file, or throw */
+  void parse();
+
+  /*! Unmap the file, if it is mapped */
+  void unmap();
+
+  /*! Unpack the packed arrays */
+  void unpack();
+
+  /*! The values of an array, in the mapping or unpacked */
+  const char* valuesOf(const SimStateArray& array) const;
+
+  /*! Find a float array by name, or throw */
+  const SimStateArray& floatArray(const string& name) const;
+
+  string m_fileName;
+
+  /*! The mapping */
+  const char* m_pData;
+  uint64_t m_cBytes;
+
+  /*! The contents of a file held in memory; empty if the file is mapped */
+  string m_contents;
+
+#ifdef _WIN32
+  HANDLE m_hFile;
+  HANDLE m_hMapping;
+#else
+  int m_fd;
+#endif
+
+  /*! Size of a chunk (bytes) */
+  uint32_t m_chunkBytes;
+
+  /*! The directory */
+  vector<SimStateArray> m_arrays;
+
+  /*! The values of each packed array, unpacked; empty for the others */
+  vector<vector<char> > m_rgUnpacked;
+
+  MappedSimState(const MappedSimState&);
+  MappedSimState& operator=(const MappedSimState&);
+};
+
+#endif
@@ -0,0 +1,483 @@
+/*!
+  @file MatrixXmlReader.cpp
+  @brief Streaming deserialization of Matrices from XML, with fast value parsing
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+#include <inttypes.h>
+#include "MatrixXmlReader.h"
+#include "KIIexceptions.h"
+
+#include "SourceVersions.h"
+
+static VersionInfo version("$Id: MatrixXmlReader.cpp $");
+
+// Powers of ten that are exact in a double
+static const double s_rgPow10[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Whitespace, as isspace() in the "C" locale
+static inline bool isSpace(int c)
+{
+  return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static inline bool isDigit(int c)
+{
+  return c >= '0' && c <= '9';
+}
+
+// Replace the predefined entities of an attribute value
+static string decodeEntities(const string& s)
+{
+  static const char* const rgEntities[][2] = {
+    { "&lt;", "<" }, { "&gt;", ">" }, { "&quot;", "\"" }, { "&apos;", "'" }, { "&amp;", "&" }
+  };
+
+  if (s.find('&') == string::npos)
+    return s;
+
+  string result;
+  for (size_t i = 0; i < s.size(); ) {
+    size_t e = 0;
+    if (s[i] == '&')
+      for (e = 0; e < sizeof(rgEntities) / sizeof(rgEntities[0]); e++)
+        if (s.compare(i, strlen(rgEntities[e][0]), rgEntities[e][0]) == 0)
+          break;
+    if (s[i] == '&' && e < sizeof(rgEntities) / sizeof(rgEntities[0])) {
+      result += rgEntities[e][1];
+      i += strlen(rgEntities[e][0]);
+    } else
+      result += s[i++];
+  }
+  return result;
+}
+
+const char* MatrixXmlReader::parseValue(const char* p, const char* pEnd, FLOAT& value)
+{
+  while (p < pEnd && isSpace(*p))
+    p++;
+  if (p == pEnd || *p == '<')
+    return NULL;
+
+  const char* start = p;
+  bool fNeg = false;
+  if (*p == '-' || *p == '+') {
+    fNeg = *p == '-';
+    p++;
+  }
+
+  // Up to 19 significant digits fit in the mantissa; further digits
+  // only make the value inexact
+  uint64_t mantissa = 0;
+  int cDigits = 0;
+  int exp10 = 0;
+  bool fDigits = false;
+  bool fExact = true;
+  for (; p < pEnd && isDigit(*p); p++) {
+    fDigits = true;
+    if (cDigits < 19) {
+      mantissa = mantissa * 10 + (*p - '0');
+      if (mantissa != 0)
+        cDigits++;
+    } else {
+      fExact = fExact && *p == '0';
+      exp10++;
+    }
+  }
+  if (p < pEnd && *p == '.') {
+    for (p++; p < pEnd && isDigit(*p); p++) {
+      fDigits = true;
+      if (cDigits < 19) {
+        mantissa = mantissa * 10 + (*p - '0');
+        if (mantissa != 0)
+          cDigits++;
+        exp10--;
+      } else
+        fExact = fExact && *p == '0';
+    }
+  }
+  if (!fDigits)
+    return parseSlow(start, pEnd, value);
+
+  if (p < pEnd && (*p == 'e' || *p == 'E')) {
+    const char* q = p + 1;
+    bool fExpNeg = false;
+    if (q < pEnd && (*q == '-' || *q == '+')) {
+      fExpNeg = *q == '-';
+      q++;
+    }
+    if (q == pEnd || !isDigit(*q))
+      return parseSlow(start, pEnd, value);
+    int e = 0;
+    for (; q < pEnd && isDigit(*q); q++)
+      if (e < 10000)
+        e = e * 10 + (*q - '0');
+    exp10 += fExpNeg ? -e : e;
+    p = q;
+  }
+
+  // Anything else attached to the value is left to strtof
+  if (p < pEnd && !isSpace(*p) && *p != '<')
+    return parseSlow(start, pEnd, value);
+
+  if (mantissa == 0) {
+    value = fNeg ? -0.0f : 0.0f;
+    return p;
+  }
+  if (!fExact || mantissa > (static_cast<uint64_t>(1) << 53) || exp10 < -22 || exp10 > 22)
+    return parseSlow(start, pEnd, value);
+
+  // Both operands are exact, so d is the correctly rounded double
+  double d = static_cast<double>(mantissa);
+  d = exp10 >= 0 ? d * s_rgPow10[exp10] : d / s_rgPow10[-exp10];
+
+  // Rounding d to a float gives the correctly rounded float, unless d
+  // is (next to) a tie between two floats, or outside of the normal floats
+  if (sizeof(FLOAT) < sizeof(double)) {
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    uint32_t low = static_cast<uint32_t>(bits & 0x1fffffff);
+    if (d < FLT_MIN || d > FLT_MAX || (low >= 0x0fffffff && low <= 0x10000001))
+      return parseSlow(start, pEnd, value);
+  }
+
+  value = static_cast<FLOAT>(fNeg ? -d : d);
+  return p;
+}
+
+const char* MatrixXmlReader::parseSlow(const char* p, const char* pEnd, FLOAT& value)
+{
+  const char* e = p;
+  while (e < pEnd && !isSpace(*e) && *e != '<')
+    e++;
+
+  // strtof needs a terminated string
+  string token(p, e);
+  char* pParsed;
+  if (sizeof(FLOAT) < sizeof(double))
+    value = strtof(token.c_str(), &pParsed);
+  else
+    value = strtod(token.c_str(), &pParsed);
+  if (pParsed == token.c_str())
+    return NULL;
+  return p + (pParsed - token.c_str());
+}
+
+const char* MatrixXmlReader::parseValues(const char* p, const char* pEnd, FLOAT* rgValues,
+                                         size_t cValues)
+{
+  for (size_t i = 0; i < cValues; i++) {
+    if (p != NULL)
+      p = parseValue(p, pEnd, rgValues[i]);
+    if (p == NULL)
+      rgValues[i] = 0;
+  }
+  return p;
+}
+
+MatrixXmlReader::MatrixXmlReader(istream& is)
+  : m_is(is), m_buf(XML_READ_BYTES), m_pos(0), m_end(0), m_fEmpty(true),
+    m_elementDepth(-1), m_depth(0)
+{
+}
+
+bool MatrixXmlReader::fill()
+{
+  if (m_pos > 0) {
+    memmove(&m_buf[0], &m_buf[m_pos], m_end - m_pos);
+    m_end -= m_pos;
+    m_pos = 0;
+  }
+  if (m_end == m_buf.size())
+    m_buf.resize(m_buf.size() * 2);
+
+  m_is.read(&m_buf[m_end], m_buf.size() - m_end);
+  size_t cRead = static_cast<size_t>(m_is.gcount());
+  m_end += cRead;
+  return cRead > 0;
+}
+
+int MatrixXmlReader::get()
+{
+  if (m_pos == m_end && !fill())
+    return -1;
+  return static_cast<unsigned char>(m_buf[m_pos++]);
+}
+
+void MatrixXmlReader::skipPast(const char* terminator)
+{
+  size_t cTerm = strlen(terminator);
+  string last;
+
+  for (;;) {
+    int c = get();
+    if (c < 0)
+      throw KII_invalid_argument("Unexpected end of XML");
+    last += static_cast<char>(c);
+    if (last.size() > cTerm)
+      last.erase(0, 1);
+    if (last == terminator)
+      return;
+  }
+}
+
+bool MatrixXmlReader::nextElement()
+{
+  for (;;) {
+    // Skip the rest of the text up to the next tag
+    for (;;) {
+      const char* p = m_pos < m_end
+        ? static_cast<const char*>(memchr(&m_buf[m_pos], '<', m_end - m_pos)) : NULL;
+      if (p != NULL) {
+        m_pos = p - &m_buf[0] + 1;
+        break;
+      }
+      m_pos = m_end;
+      if (!fill())
+        return false;
+    }
+
+    int c = get();
+    if (c < 0) {
+      return false;
+    } else if (c == '/') {        // end tag
+      skipPast(">");
+      m_depth--;
+    } else if (c == '?') {        // processing instruction
+      skipPast("?>");
+    } else if (c == '!') {        // comment or declaration
+      c = get();
+      if (c == '-' && (c = get()) == '-')
+        skipPast("-->");
+      else if (c != '>')
+        skipPast(">");
+    } else {
+      m_pos--;
+      readStartTag();
+      return true;
+    }
+  }
+}
+
+void MatrixXmlReader::readStartTag()
+{
+  int c;
+
+  m_name.clear();
+  m_attributes.clear();
+  m_fEmpty = false;
+
+  while ((c = get()) >= 0 && !isSpace(c) && c != '/' && c != '>')
+    m_name += static_cast<char>(c);
+
+  for (;;) {
+    while (c >= 0 && isSpace(c))
+      c = get();
+    if (c < 0)
+      throw KII_invalid_argument("Unexpected end of XML in <" + m_name + ">");
+    if (c == '>')
+      break;
+    if (c == '/') {
+      if (get() != '>')
+        throw KII_invalid_argument("Malformed XML tag <" + m_name + ">");
+      m_fEmpty = true;
+      break;
+    }
+
+    string attrName, value;
+    while (c >= 0 && !isSpace(c) && c != '=' && c != '/' && c != '>') {
+      attrName += static_cast<char>(c);
+      c = get();
+    }
+    while (c >= 0 && isSpace(c))
+      c = get();
+    if (c == '=')
+      c = get();
+    else
+      throw KII_invalid_argument("Malformed XML tag <" + m_name + ">");
+    while (c >= 0 && isSpace(c))
+      c = get();
+    if (c != '"' && c != '\'')
+      throw KII_invalid_argument("Malformed XML tag <" + m_name + ">");
+
+    int quote = c;
+    while ((c = get()) >= 0 && c != quote)
+      value += static_cast<char>(c);
+    if (c < 0)
+      throw KII_invalid_argument("Unexpected end of XML in <" + m_name + ">");
+    m_attributes.push_back(make_pair(attrName, decodeEntities(value)));
+    c = get();
+  }
+
+  m_elementDepth = m_depth;
+  if (!m_fEmpty)
+    m_depth++;
+}
+
+const char* MatrixXmlReader::attribute(const string& name) const
+{
+  for (size_t i = 0; i < m_attributes.size(); i++)
+    if (m_attributes[i].first == name)
+      return m_attributes[i].second.c_str();
+  return NULL;
+}
+
+bool MatrixXmlReader::intAttribute(const string& name, int& value) const
+{
+  const char* v = attribute(name);
+
+  return v != NULL && sscanf(v, "%d", &value) == 1;
+}
+
+// Same rules as MatrixFactory::GetAttributes()
+void MatrixXmlReader::getMatrixAttributes(string& type, string& init, int& rows, int& columns,
+                                          FLOAT& multiplier) const
+{
+  const char* temp = NULL;
+
+  temp = attribute("type");
+  if (temp != NULL)
+    type = temp;
+  else
+    type = "undefined";
+  if ((type != "diag") && (type != "complete") && (type != "sparse"))
+    throw KII_invalid_argument("Illegal matrix type: " + type);
+
+  if (!intAttribute("rows", rows))
+    throw KII_invalid_argument("Number of rows not specified for Matrix.");
+
+  if (!intAttribute("columns", columns))
+    throw KII_invalid_argument("Number of columns not specified for Matrix.");
+
+  temp = attribute("multiplier");
+  if (temp == NULL || parseValue(temp, temp + strlen(temp), multiplier) == NULL)
+    multiplier = 1.0;
+
+  temp = attribute("init");
+  if (temp != NULL)
+    init = temp;
+  else
+    init = "none";
+}
+
+size_t MatrixXmlReader::readValues(FLOAT* rgValues, size_t cValues)
+{
+  if (m_fEmpty)
+    return 0;
+
+  size_t i;
+  for (i = 0; i < cValues; i++) {
+    // Skip whitespace
+    for (;;) {
+      while (m_pos < m_end && isSpace(m_buf[m_pos]))
+        m_pos++;
+      if (m_pos < m_end || !fill())
+        break;
+    }
+    if (m_pos == m_end || m_buf[m_pos] == '<')
+      break;
+
+    // Make sure the whole value is in the buffer
+    size_t e = m_pos;
+    for (;;) {
+      while (e < m_end && !isSpace(m_buf[e]) && m_buf[e] != '<')
+        e++;
+      if (e < m_end)
+        break;
+      size_t cChars = e - m_pos;
+      if (!fill())
+        break;
+      e = m_pos + cChars;
+    }
+
+    const char* p = &m_buf[m_pos];
+    const char* pEnd = &m_buf[0] + e;
+    if (parseValue(p, pEnd, rgValues[i]) != pEnd)
+      throw KII_invalid_argument("Illegal value in <" + m_name + ">: " + string(p, pEnd));
+    m_pos = e;
+  }
+
+  return i;
+}
+
+VectorMatrix MatrixXmlReader::readVector()
+{
+  string type;
+  string init;
+  int rows, columns;
+  FLOAT multiplier;
+
+  getMatrixAttributes(type, init, rows, columns, multiplier);
+
+  if (init == "implementation")
+    throw KII_invalid_argument("MatrixFactory cannot create implementation-dependent Matrices; client program must perform creation");
+  if (type == "sparse")
+    throw KII_invalid_argument("Sparse matrix requested in XML but CreateVector called");
+  if ((rows > 1) && (columns > 1))
+    throw KII_domain_error("Cannot create Vector with more than one dimension.");
+  if (init != "none")
+    return VectorMatrix(type, init, rows, columns, multiplier);
+  if (type != "complete")
+    throw KII_invalid_argument("Illegal type for VectorMatrix with 'none' init: " + type);
+
+  // Allocate, then parse the values in place
+  VectorMatrix v(type, "const", rows, columns, multiplier);
+  size_t cValues = readValues(&v[0], v.Size());
+  if (cValues == 0)
+    throw KII_invalid_argument("Contents not specified for Vector with init='none'.");
+  if (cValues < static_cast<size_t>(v.Size()))
+    throw KII_invalid_argument("Too few values for Vector.");
+  for (int i = 0; i < v.Size(); i++)
+    v[i] *= multiplier;
+
+  return v;
+}
+
+CompleteMatrix MatrixXmlReader::readComplete()
+{
+  string type;
+  string init;
+  int rows, columns;
+  FLOAT multiplier;
+
+  getMatrixAttributes(type, init, rows, columns, multiplier);
+
+  if (init == "implementation")
+    throw KII_invalid_argument("MatrixFactory cannot create implementation-dependent Matrices; client program must perform creation.");
+  if (type == "sparse")
+    throw KII_invalid_argument("Sparse matrix requested by XML but CreateComplete called");
+  if (init != "none")
+    return CompleteMatrix(type, init, rows, columns, multiplier);
+
+  // Allocate, then parse the values in place; off-diagonal elements
+  // of a diagonal matrix are zero
+  CompleteMatrix m(type, "const", rows, columns, multiplier);
+  size_t cValues = 0, cExpected = 0;
+  if (type == "complete") {
+    for (int i = 0; i < rows; i++) {
+      cValues += readValues(&m(i, 0), columns);
+      cExpected += columns;
+      for (int j = 0; j < columns; j++)
+        m(i, j) *= multiplier;
+    }
+  } else {
+    for (int i = 0; i < rows && i < columns; i++) {
+      cValues += readValues(&m(i, i), 1);
+      cExpected++;
+      m(i, i) *= multiplier;
+    }
+  }
+  if (cValues == 0)
+    throw KII_invalid_argument("Contents not specified for Matrix with init='none'.");
+  if (cValues < cExpected)
+    throw KII_invalid_argument("Too few values for Matrix.");
+
+  return m;
+}
@@ -0,0 +1,168 @@
+/*!
+  @file MatrixXmlReader.h
+  @brief Streaming deserialization of Matrices from XML, with fast value parsing
+*/
+
+#ifndef _MATRIXXMLREADER_H_
+#define _MATRIXXMLREADER_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "CompleteMatrix.h"
+#include "VectorMatrix.h"
+
+using namespace std;
+
+/*! Number of bytes read from the stream at a time */
+#define XML_READ_BYTES 65536
+
+/*!
+  @class MatrixXmlReader
+  @brief Reads Matrix elements from an XML stream without building a DOM.
+
+  The reader moves through the XML one start tag at a time
+  (nextElement()), in document order, keeping only a buffer of
+  XML_READ_BYTES and the attributes of the current element in
+  memory. The values of a Matrix element are parsed by parseValue()
+  directly into the storage of the VectorMatrix or CompleteMatrix that
+  is created for them, so loading a Matrix takes little more memory
+  than the Matrix itself.
+
+  Only the subset of XML written by the simulator and used for its
+  input files is supported: elements, attributes, text, comments and
+  processing instructions. Character references and CDATA sections
+  in Matrix values are not.
+
+  parseValue() converts a value as istream's operator>> (strtof) does,
+  with the same result; the common case, a decimal value with at most
+  19 significant digits and a moderate exponent, is computed exactly
+  in double precision and rounded once to FLOAT, and everything else
+  is handed to strtof.
+*/
+class MatrixXmlReader
+{
+public:
+  /*!
+    @brief Read XML from a stream.
+    @param is the stream
+  */
+  MatrixXmlReader(istream& is);
+
+  /*!
+    @brief Advance to the next start tag.
+    @return false at the end of the stream
+  */
+  bool nextElement();
+
+  /*! @brief Name of the current element */
+  const string& name() const { return m_name; }
+
+  /*! @brief Nesting depth of the current element; the root element is at depth 0 */
+  int depth() const { return m_elementDepth; }
+
+  /*!
+    @brief An attribute of the current element.
+    @param name name of the attribute
+    @return the value, or NULL if the element has no such attribute
+  */
+  const char* attribute(const string& name) const;
+
+  /*!
+    @brief An integer attribute of the current element.
+    @param name name of the attribute
+    @param value receives the value
+    @return true if the element has the attribute and it is an integer
+  */
+  bool intAttribute(const string& name, int& value) const;
+
+  /*!
+    @brief Read the attributes of the current Matrix element, as
+    MatrixFactory does.
+    @throws KII_invalid_argument
+  */
+  void getMatrixAttributes(string& type, string& init, int& rows, int& columns,
+                           FLOAT& multiplier) const;
+
+  /*!
+    @brief Parse values from the text of the current element.
+    @param rgValues receives the values
+    @param cValues number of values to parse
+    @return number of values parsed; fewer at the end of the text
+    @throws KII_invalid_argument if the text holds something other than values
+  */
+  size_t readValues(FLOAT* rgValues, size_t cValues);
+
+  /*!
+    @brief Create a VectorMatrix from the current Matrix element, as
+    MatrixFactory::CreateVector() does.
+    @throws KII_invalid_argument
+    @throws KII_domain_error
+  */
+  VectorMatrix readVector();
+
+  /*!
+    @brief Create a CompleteMatrix from the current Matrix element, as
+    MatrixFactory::CreateComplete() does.
+    @throws KII_invalid_argument
+  */
+  CompleteMatrix readComplete();
+
+  /*!
+    @brief Parse a value, skipping leading whitespace.
+    @param p first character
+    @param pEnd end of the characters
+    @param value receives the value
+    @return the character after the value, or NULL if there is no value
+  */
+  static const char* parseValue(const char* p, const char* pEnd, FLOAT& value);
+
+  /*!
+    @brief Parse whitespace separated values, as reading them with an
+    istringstream would.
+    @param p first character, or NULL if the values ran out before
+    @param pEnd end of the characters
+    @param rgValues receives the values; those that are missing are set to 0
+    @param cValues number of values
+    @return the character after the last value, or NULL if values were missing
+  */
+  static const char* parseValues(const char* p, const char* pEnd, FLOAT* rgValues, size_t cValues);
+
+private:
+  /*! Parse a value with strtof */
+  static const char* parseSlow(const char* p, const char* pEnd, FLOAT& value);
+
+  /*! Read more of the stream, keeping the unread characters; false at the end */
+  bool fill();
+
+  /*! Next character, or -1 at the end of the stream */
+  int get();
+
+  /*! Skip characters up to and including a terminator */
+  void skipPast(const char* terminator);
+
+  /*! Read a start tag, after its '<' */
+  void readStartTag();
+
+  istream& m_is;
+
+  /*! Buffered characters; m_pos is the next one to read */
+  vector<char> m_buf;
+  size_t m_pos;
+  size_t m_end;
+
+  /*! The current element */
+  string m_name;
+  vector<pair<string, string> > m_attributes;
+  bool m_fEmpty;
+  int m_elementDepth;
+
+  /*! Number of elements open after the current position */
+  int m_depth;
+
+  MatrixXmlReader(const MatrixXmlReader&);
+  MatrixXmlReader& operator=(const MatrixXmlReader&);
+};
+
+#endif
@@ -0,0 +1,195 @@
+/*!
+  @file MatrixXmlWriter.cpp
+  @brief Fast, parallel formatting of Matrix values for XML output
+*/
+
+#include <cstdio>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include "MatrixXmlWriter.h"
+#include "Thread.h"
+
+#include "SourceVersions.h"
+
+static VersionInfo version("$Id: MatrixXmlWriter.cpp $");
+
+// Powers of ten that are exact in a double
+static const double s_rgPow10[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Scale a value by 10^p, p in [-22, 22]; one rounding step at most
+static inline double scale(double a, int p)
+{
+  return p >= 0 ? a * s_rgPow10[p] : a / s_rgPow10[-p];
+}
+
+// Format a value with printf, for the cases the fast path does not handle
+static int formatSlow(double v, char* buf)
+{
+  char tmp[32];
+  int cChars = snprintf(tmp, sizeof(tmp), "%g", v);
+  memcpy(buf, tmp, cChars);
+  return cChars;
+}
+
+int MatrixXmlWriter::formatValue(FLOAT value, char* buf)
+{
+  double v = value;
+
+  // zeros, infinities and NaNs
+  if (v == 0.0 || v - v != 0.0)
+    return formatSlow(v, buf);
+
+  bool fNegative = v < 0;
+  double a = fNegative ? -v : v;
+
+  // Find the decimal exponent e such that the 6 significant digits are
+  // round(a * 10^(5 - e)), in [100000, 999999]. log10 may be off by one.
+  int e = static_cast<int>(floor(log10(a)));
+  if (e > 26 || e < -16)
+    return formatSlow(v, buf);
+  double r = scale(a, 5 - e);
+  if (r < 100000.0) {
+    e--;
+    r = scale(a, 5 - e);
+  } else if (r >= 1000000.0) {
+    e++;
+    r = scale(a, 5 - e);
+  }
+
+  // r carries a relative error of at most one rounding step, which can only
+  // matter when the value is (nearly) halfway between two 6-digit results
+  double whole = floor(r);
+  double frac = r - whole;
+  if (fabs(frac - 0.5) < 1e-6)
+    return formatSlow(v, buf);
+
+  long digits = static_cast<long>(whole) + (frac > 0.5 ? 1 : 0);
+  if (digits == 1000000) {
+    digits = 100000;
+    e++;
+  }
+
+  // the digits, most significant first, without trailing zeros
+  char rgDigits[6];
+  for (int i = 5; i >= 0; i--) {
+    rgDigits[i] = static_cast<char>('0' + digits % 10);
+    digits /= 10;
+  }
+  int cDigits = 6;
+  while (cDigits > 1 && rgDigits[cDigits - 1] == '0')
+    cDigits--;
+
+  char* p = buf;
+  if (fNegative)
+    *p++ = '-';
+
+  if (e < -4 || e >= 6) {
+    // exponential notation: d.ddddde+XX
+    *p++ = rgDigits[0];
+    if (cDigits > 1) {
+      *p++ = '.';
+      for (int i = 1; i < cDigits; i++)
+        *p++ = rgDigits[i];
+    }
+    *p++ = 'e';
+    *p++ = e < 0 ? '-' : '+';
+    int x = e < 0 ? -e : e;
+    if (x >= 100)
+      *p++ = static_cast<char>('0' + x / 100);
+    *p++ = static_cast<char>('0' + (x / 10) % 10);
+    *p++ = static_cast<char>('0' + x % 10);
+  } else if (e >= 0) {
+    // fixed notation, at least one digit before the point
+    for (int i = 0; i <= e; i++)
+      *p++ = i < cDigits ? rgDigits[i] : '0';
+    if (cDigits > e + 1) {
+      *p++ = '.';
+      for (int i = e + 1; i < cDigits; i++)
+        *p++ = rgDigits[i];
+    }
+  } else {
+    // fixed notation, below one: 0.000ddd
+    *p++ = '0';
+    *p++ = '.';
+    for (int i = -1; i > e; i--)
+      *p++ = '0';
+    for (int i = 0; i < cDigits; i++)
+      *p++ = rgDigits[i];
+  }
+
+  return static_cast<int>(p - buf);
+}
+
+void MatrixXmlWriter::formatSegment(void* pSegment)
+{
+  Segment& seg = *static_cast<Segment*>(pSegment);
+  char* p = seg.buf;
+
+  int row = static_cast<int>(seg.begin / seg.cColumns);
+  int column = static_cast<int>(seg.begin % seg.cColumns);
+  for (size_t i = seg.begin; i < seg.end; i++) {
+    p += formatValue(seg.rgRows[row][column], p);
+    *p++ = ' ';
+    if (++column == seg.cColumns) {
+      if (seg.fRowNewlines)
+        *p++ = '\n';
+      column = 0;
+      row++;
+    }
+  }
+
+  seg.cChars = p - seg.buf;
+}
+
+void MatrixXmlWriter::writeValues(ostream& os, const FLOAT* const* rgRows, int cRows, int cColumns,
+                                  bool fRowNewlines)
+{
+  size_t cValues = static_cast<size_t>(cRows) * cColumns;
+  if (cValues == 0) {
+    if (fRowNewlines)
+      for (int i = 0; i < cRows; i++)
+        os << '\n';
+    return;
+  }
+
+  size_t cSegments = (cValues + XML_SEGMENT_VALUES - 1) / XML_SEGMENT_VALUES;
+  int cThreads = Thread::hardwareConcurrency();
+  if (static_cast<size_t>(cThreads) > cSegments)
+    cThreads = static_cast<int>(cSegments);
+
+  vector<char> buffers(static_cast<size_t>(cThreads) * XML_SEGMENT_VALUES * XML_VALUE_CHARS);
+  vector<Segment> segments(cThreads);
+  Thread* rgThreads = new Thread[cThreads];
+
+  // Each round formats one segment per thread (the calling thread takes the
+  // first), then writes the segments in order
+  for (size_t first = 0; first < cSegments; first += cThreads) {
+    int cRound = static_cast<int>(min(static_cast<size_t>(cThreads), cSegments - first));
+
+    for (int t = 0; t < cRound; t++) {
+      Segment& seg = segments[t];
+      seg.rgRows = rgRows;
+      seg.cColumns = cColumns;
+      seg.fRowNewlines = fRowNewlines;
+      seg.begin = (first + t) * XML_SEGMENT_VALUES;
+      seg.end = min(seg.begin + XML_SEGMENT_VALUES, cValues);
+      seg.buf = &buffers[static_cast<size_t>(t) * XML_SEGMENT_VALUES * XML_VALUE_CHARS];
+      if (t > 0 && rgThreads[t].start(formatSegment, &seg))
+        continue;
+      if (t > 0)
+        formatSegment(&seg);
+    }
+    formatSegment(&segments[0]);
+
+    for (int t = 0; t < cRound; t++) {
+      rgThreads[t].join();
+      os.write(segments[t].buf, segments[t].cChars);
+    }
+  }
+
+  delete[] rgThreads;
+}
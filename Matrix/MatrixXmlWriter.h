@@ -0,0 +1,73 @@
+/*!
+  @file MatrixXmlWriter.h
+  @brief Fast, parallel formatting of Matrix values for XML output
+*/
+
+#ifndef _MATRIXXMLWRITER_H_
+#define _MATRIXXMLWRITER_H_
+
+#include <iostream>
+
+#include "bgtypes.h" // for FLOAT
+
+using namespace std;
+
+/*! Number of values formatted into one buffer */
+#define XML_SEGMENT_VALUES 65536
+
+/*! Maximum number of characters of a formatted value, its separator and a newline */
+#define XML_VALUE_CHARS 16
+
+/*!
+  @class MatrixXmlWriter
+  @brief Writes the values of a Matrix as text, as operator<< on the
+  Matrix would, but faster.
+
+  Values are formatted by formatValue(), which produces the same
+  characters as inserting the value into an ostream with default
+  flags (printf's %g with precision 6), without the overhead of
+  iostreams. The values are split into segments of XML_SEGMENT_VALUES,
+  which are formatted into fixed-size buffers by a group of threads
+  and written to the stream in order, so the memory used does not
+  depend on the size of the Matrix.
+*/
+class MatrixXmlWriter
+{
+public:
+  /*!
+    @brief Write the values of a Matrix, each followed by a space.
+    @param os stream to output to
+    @param rgRows pointers to the rows of the Matrix
+    @param cRows number of rows
+    @param cColumns number of columns
+    @param fRowNewlines if true, each row is followed by a newline
+  */
+  static void writeValues(ostream& os, const FLOAT* const* rgRows, int cRows, int cColumns,
+                          bool fRowNewlines);
+
+  /*!
+    @brief Format a value as an ostream with default flags would.
+    @param value the value
+    @param buf receives the characters, at least XML_VALUE_CHARS of them; not terminated
+    @return number of characters
+  */
+  static int formatValue(FLOAT value, char* buf);
+
+private:
+  /*! A segment of values and the buffer they are formatted into */
+  struct Segment
+  {
+    const FLOAT* const* rgRows;
+    int cColumns;
+    bool fRowNewlines;
+    size_t begin;
+    size_t end;
+    char* buf;
+    size_t cChars;
+  };
+
+  /*! Format the values of a segment into its buffer */
+  static void formatSegment(void* pSegment);
+};
+
+#endif
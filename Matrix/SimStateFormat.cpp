@@ -0,0 +1,189 @@
+/*!
+  @file SimStateFormat.cpp
+  @brief Layout of binary simulation state files
+*/
+
+#include <cstring>
+#include <algorithm>
+#include "SimStateFormat.h"
+#include "KIIexceptions.h"
+#include "Crc32.h"
+#include "BlockCodec.h"
+
+#include "SourceVersions.h"
+
+static VersionInfo version("$Id: SimStateFormat.cpp $");
+
+const char SimStateFormat::magic[8] = { 'B', 'G', 'S', 'T', 'A', 'T', 'E', '\0' };
+
+size_t SimStateFormat::valueBytes(simStateType type)
+{
+  switch (type) {
+  case SIMSTATE_FLOAT32:
+  case SIMSTATE_INT32:
+  case SIMSTATE_UINT32:
+    return 4;
+  case SIMSTATE_UINT64:
+    return 8;
+  }
+  return 0;
+}
+
+// Copy a field out of a buffer and advance past it
+template <class T>
+static inline void getField(const char*& p, T& value)
+{
+  memcpy(&value, p, sizeof(value));
+  p += sizeof(value);
+}
+
+uint32_t SimStateFormat::parseHeader(const char* pHeader, uint32_t& version)
+{
+  const char* p = pHeader + sizeof(magic);
+  uint32_t alignment, chunkBytes;
+
+  if (memcmp(pHeader, magic, sizeof(magic)) != 0)
+    throw KII_exception("Not a binary simulation state file");
+  getField(p, version);
+  getField(p, alignment);
+  getField(p, chunkBytes);
+  if (version < 1 || version > SIMSTATE_FILE_VERSION)
+    throw KII_exception("Unsupported version of the binary simulation state file");
+  if (alignment != SIMSTATE_ALIGNMENT || chunkBytes == 0 || chunkBytes % sizeof(uint32_t) != 0)
+    throw KII_exception("Bad header in the binary simulation state file");
+
+  return chunkBytes;
+}
+
+uint64_t SimStateFormat::parseTrailer(const char* pTrailer, uint64_t cFileBytes, uint32_t& cArrays,
+                                      uint32_t& dirCrc)
+{
+  const char* p = pTrailer;
+  uint64_t dirOffset;
+
+  getField(p, dirOffset);
+  getField(p, cArrays);
+  getField(p, dirCrc);
+  if (memcmp(p, magic, sizeof(magic)) != 0 || dirOffset < SIMSTATE_ALIGNMENT
+      || dirOffset > cFileBytes - SIMSTATE_TRAILER_BYTES)
+    throw KII_exception("Truncated binary simulation state file");
+
+  return dirOffset;
+}
+
+void SimStateFormat::parseDirectory(const char* pDir, size_t cBytes, uint32_t cArrays, uint32_t dirCrc,
+                                    uint32_t version, uint32_t chunkBytes, uint64_t dirOffset,
+                                    vector<SimStateArray>& arrays)
+{
+  // size of the fixed part of an entry; version 3 adds the encoding
+  const size_t cEntryBytes = SIMSTATE_NAME_CHARS + (version >= 3 ? 6 : 5) * sizeof(uint32_t)
+                             + 2 * sizeof(uint64_t);
+
+  if (crc32(pDir, cBytes) != dirCrc)
+    throw KII_exception("Corrupt directory in the binary simulation state file");
+
+  const char* p = pDir;
+  const char* pEnd = pDir + cBytes;
+  arrays.clear();
+  for (uint32_t i = 0; i < cArrays; i++) {
+    char name[SIMSTATE_NAME_CHARS];
+    uint32_t type, layout, cChunks, encoding = SIMSTATE_RAW;
+    SimStateArray array;
+
+    if (static_cast<size_t>(pEnd - p) < cEntryBytes)
+      throw KII_exception("Corrupt directory in the binary simulation state file");
+    memcpy(name, p, sizeof(name));
+    p += sizeof(name);
+    getField(p, type);
+    getField(p, layout);
+    getField(p, array.cRows);
+    getField(p, array.cColumns);
+    getField(p, array.offset);
+    getField(p, array.cBytes);
+    getField(p, cChunks);
+    if (version >= 3)
+      getField(p, encoding);
+
+    name[sizeof(name) - 1] = '\0';
+    array.name = name;
+    array.type = static_cast<simStateType>(type);
+    array.layout = static_cast<simStateLayout>(layout);
+    array.encoding = static_cast<simStateEncoding>(encoding);
+
+    // a packed array has the stored size of each chunk after the checksums
+    size_t cWords = encoding == SIMSTATE_PACKED ? 2 * static_cast<size_t>(cChunks) : cChunks;
+    if (static_cast<size_t>(pEnd - p) / sizeof(uint32_t) < cWords
+        || valueBytes(array.type) == 0
+        || layout > SIMSTATE_SCALAR
+        || encoding > SIMSTATE_PACKED
+        || array.cRows < 0 || array.cColumns < 0
+        || array.cBytes != static_cast<uint64_t>(array.cRows) * array.cColumns * valueBytes(array.type)
+        || cChunks != (array.cBytes + chunkBytes - 1) / chunkBytes
+        || array.offset % SIMSTATE_ALIGNMENT != 0)
+      throw KII_exception("Corrupt directory in the binary simulation state file");
+
+    array.rgChunkCrc.resize(cChunks);
+    if (cChunks > 0)
+      memcpy(&array.rgChunkCrc[0], p, cChunks * sizeof(uint32_t));
+    p += cChunks * sizeof(uint32_t);
+
+    uint64_t cStoredBytes = array.cBytes;
+    if (encoding == SIMSTATE_PACKED) {
+      array.rgPackedBytes.resize(cChunks);
+      if (cChunks > 0)
+        memcpy(&array.rgPackedBytes[0], p, cChunks * sizeof(uint32_t));
+      p += cChunks * sizeof(uint32_t);
+
+      cStoredBytes = 0;
+      for (uint32_t k = 0; k < cChunks; k++) {
+        if (array.rgPackedBytes[k] == 0 || array.rgPackedBytes[k] > chunkValueBytes(array, chunkBytes, k))
+          throw KII_exception("Corrupt directory in the binary simulation state file");
+        cStoredBytes += array.rgPackedBytes[k];
+      }
+    }
+    if (array.offset + cStoredBytes > dirOffset)
+      throw KII_exception("Corrupt directory in the binary simulation state file");
+
+    arrays.push_back(array);
+  }
+}
+
+bool SimStateFormat::checkChunk(const SimStateArray& array, uint32_t chunkBytes, size_t iChunk,
+                                const char* pChunk)
+{
+  return crc32(pChunk, chunkValueBytes(array, chunkBytes, iChunk)) == array.rgChunkCrc[iChunk];
+}
+
+size_t SimStateFormat::chunkValueBytes(const SimStateArray& array, uint32_t chunkBytes, size_t iChunk)
+{
+  uint64_t start = static_cast<uint64_t>(iChunk) * chunkBytes;
+
+  return static_cast<size_t>(min(static_cast<uint64_t>(chunkBytes), array.cBytes - start));
+}
+
+uint64_t SimStateFormat::chunkOffset(const SimStateArray& array, uint32_t chunkBytes, size_t iChunk,
+                                     size_t& cStoredBytes)
+{
+  if (array.encoding != SIMSTATE_PACKED) {
+    cStoredBytes = chunkValueBytes(array, chunkBytes, iChunk);
+    return array.offset + static_cast<uint64_t>(iChunk) * chunkBytes;
+  }
+
+  uint64_t offset = array.offset;
+  for (size_t k = 0; k < iChunk; k++)
+    offset += array.rgPackedBytes[k];
+  cStoredBytes = array.rgPackedBytes[iChunk];
+  return offset;
+}
+
+bool SimStateFormat::unpackChunk(const SimStateArray& array, uint32_t chunkBytes, size_t iChunk,
+                                 const char* pStored, char* pValues)
+{
+  size_t cBytes = chunkValueBytes(array, chunkBytes, iChunk);
+
+  if (array.encoding != SIMSTATE_PACKED || array.rgPackedBytes[iChunk] == cBytes) {
+    memcpy(pValues, pStored, cBytes);
+    return true;
+  }
+  return unpackBlock(pStored, array.rgPackedBytes[iChunk], valueBytes(array.type), pValues, cBytes);
+}
@@ -0,0 +1,231 @@
+/*!
+  @file SimStateFormat.h
+  @brief Layout of binary simulation state files
+*/
+
+#ifndef _SIMSTATEFORMAT_H_
+#define _SIMSTATEFORMAT_H_
+
+#include <string>
+#include <vector>
+#ifndef _WIN32
+#include <inttypes.h>
+#endif
+
+#include "bgtypes.h"
+
+using namespace std;
+
+/*! Version of the binary state file format; version 1 files, which
+    only hold SIMSTATE_FLOAT32 and SIMSTATE_INT32 arrays, and version 2
+    files, which have no packed arrays, are still read */
+#define SIMSTATE_FILE_VERSION 3
+
+/*! Version of the files that have no packed arrays; they are written
+    in this version so that earlier versions can read them */
+#define SIMSTATE_UNPACKED_VERSION 2
+
+/*! Alignment of the header and of the values of each array (bytes) */
+#define SIMSTATE_ALIGNMENT 64
+
+/*! Size of a chunk of the values of an array (bytes) */
+#define SIMSTATE_CHUNK_BYTES (1 << 20)
+
+/*! Size of the name of an array (bytes) */
+#define SIMSTATE_NAME_CHARS 32
+
+/*! Size of the trailer (bytes) */
+#define SIMSTATE_TRAILER_BYTES 24
+
+/*!
+  @brief Types of the values of an array.
+
+  SIMSTATE_FLOAT32 - IEEE single-precision floats.
+  SIMSTATE_INT32 - 32-bit signed integers.
+  SIMSTATE_UINT32 - 32-bit unsigned integers.
+  SIMSTATE_UINT64 - 64-bit unsigned integers.
+*/
+enum simStateType { SIMSTATE_FLOAT32 = 1, SIMSTATE_INT32 = 2, SIMSTATE_UINT32 = 3, SIMSTATE_UINT64 = 4 };
+
+/*!
+  @brief How an array is written in the XML state format.
+
+  SIMSTATE_ROWS - A matrix with a line per row, as CompleteMatrix::toXML().
+  SIMSTATE_VECTOR - A matrix with one row, on one line, as VectorMatrix::toXML().
+  SIMSTATE_SCALAR - A single value, as Tsim and simulationEndTime are written.
+*/
+enum simStateLayout { SIMSTATE_ROWS = 0, SIMSTATE_VECTOR = 1, SIMSTATE_SCALAR = 2 };
+
+/*!
+  @brief How the values of an array are stored.
+
+  SIMSTATE_RAW - As they are.
+  SIMSTATE_PACKED - Each chunk packed by packBlock(), or as it is if
+  packing does not make it smaller.
+*/
+enum simStateEncoding { SIMSTATE_RAW = 0, SIMSTATE_PACKED = 1 };
+
+/*! @brief An entry of the directory of a binary state file */
+struct SimStateArray
+{
+  string name;
+  simStateType type;
+  simStateLayout layout;
+  int cRows;
+  int cColumns;
+
+  /*! Offset of the values from the start of the file, and their size */
+  uint64_t offset;
+  uint64_t cBytes;
+
+  /*! CRC-32 of each chunk of the values */
+  vector<uint32_t> rgChunkCrc;
+
+  /*! How the values are stored, and the stored size of each chunk of
+      a packed array (bytes); the chunks are stored one after another */
+  simStateEncoding encoding;
+  vector<uint32_t> rgPackedBytes;
+};
+
+/*!
+  @class SimStateFormat
+  @brief Parses the header, trailer and directory of a binary state file.
+
+  A binary state file holds the matrices of a \<SimState\> as named,
+  typed arrays of values. The values of an array are stored row by
+  row, contiguously, starting at a multiple of SIMSTATE_ALIGNMENT
+  bytes from the start of the file, so that a file mapped into memory
+  can be used in place.
+
+  The file starts with a header of SIMSTATE_ALIGNMENT bytes:
+  - char[8]	magic "BGSTATE\0"
+  - uint32_t	format version (3, or 2 if no array is packed)
+  - uint32_t	alignment of the arrays (bytes)
+  - uint32_t	size of a chunk (bytes)
+  - zero padding
+
+  followed by the values of the arrays, each padded with zeros to the
+  alignment. The values of each array are divided into chunks of the
+  chunk size (the last one may be shorter), and a CRC-32 of each chunk
+  is kept in the directory, which follows the last array:
+  - char[32]	name of the array, zero padded
+  - uint32_t	type of the values (simStateType)
+  - uint32_t	layout of the array in the XML (simStateLayout)
+  - int32_t	number of rows
+  - int32_t	number of columns
+  - uint64_t	offset of the values from the start of the file
+  - uint64_t	number of bytes of the values
+  - uint32_t	number of chunks
+  - uint32_t	how the values are stored (simStateEncoding; not in
+		versions 1 and 2)
+  - uint32_t[]	CRC-32 of each chunk
+  - uint32_t[]	stored size of each chunk, only if the array is packed
+
+  for each array, in the order they were written. The CRC-32 of a
+  chunk is that of its values, so a packed chunk is checked once it
+  is unpacked; a chunk that is stored with the size of its values is
+  stored as it is. Packed arrays cannot be used in place: readers
+  unpack them into memory. The file ends with
+  a trailer:
+  - uint64_t	offset of the directory
+  - uint32_t	number of arrays
+  - uint32_t	CRC-32 of the directory
+  - char[8]	magic "BGSTATE\0"
+
+  The directory is written last so that the file can be written in
+  one pass, to any stream. All fields are in host byte order.
+*/
+class SimStateFormat
+{
+public:
+  /*! Magic number at the start and at the end of a file */
+  static const char magic[8];
+
+  /*!
+    @brief Size of a value of a type.
+    @return the size (bytes), or 0 if the type is not known
+  */
+  static size_t valueBytes(simStateType type);
+
+  /*!
+    @brief Check the header of a file.
+    @param pHeader the first SIMSTATE_ALIGNMENT bytes of the file
+    @param version receives the format version
+    @return the size of a chunk (bytes)
+    @throws KII_exception if the header is not valid
+  */
+  static uint32_t parseHeader(const char* pHeader, uint32_t& version);
+
+  /*!
+    @brief Check the trailer of a file.
+    @param pTrailer the last SIMSTATE_TRAILER_BYTES bytes of the file
+    @param cFileBytes size of the file
+    @param cArrays receives the number of arrays
+    @param dirCrc receives the CRC-32 of the directory
+    @return the offset of the directory
+    @throws KII_exception if the trailer is not valid
+  */
+  static uint64_t parseTrailer(const char* pTrailer, uint64_t cFileBytes, uint32_t& cArrays,
+                               uint32_t& dirCrc);
+
+  /*!
+    @brief Check and decode the directory of a file.
+    @param pDir the directory
+    @param cBytes size of the directory
+    @param cArrays number of arrays, from the trailer
+    @param dirCrc CRC-32 of the directory, from the trailer
+    @param version format version, from the header
+    @param chunkBytes size of a chunk, from the header
+    @param dirOffset offset of the directory; the arrays must end before it
+    @param arrays receives the arrays
+    @throws KII_exception if the directory is not valid
+  */
+  static void parseDirectory(const char* pDir, size_t cBytes, uint32_t cArrays, uint32_t dirCrc,
+                             uint32_t version, uint32_t chunkBytes, uint64_t dirOffset,
+                             vector<SimStateArray>& arrays);
+
+  /*!
+    @brief Size of the values of a chunk of an array.
+    @param array the array
+    @param chunkBytes size of a chunk, from the header
+    @param iChunk index of the chunk
+    @return the size (bytes); only the last chunk may be shorter than chunkBytes
+  */
+  static size_t chunkValueBytes(const SimStateArray& array, uint32_t chunkBytes, size_t iChunk);
+
+  /*!
+    @brief Where a chunk of an array is stored.
+    @param array the array
+    @param chunkBytes size of a chunk, from the header
+    @param iChunk index of the chunk
+    @param cStoredBytes receives the size of the stored chunk (bytes)
+    @return the offset of the stored chunk from the start of the file
+  */
+  static uint64_t chunkOffset(const SimStateArray& array, uint32_t chunkBytes, size_t iChunk,
+                              size_t& cStoredBytes);
+
+  /*!
+    @brief Get the values of a stored chunk of an array.
+    @param array the array
+    @param chunkBytes size of a chunk, from the header
+    @param iChunk index of the chunk
+    @param pStored the stored chunk
+    @param pValues receives the values, chunkValueBytes() of them
+    @return false if a packed chunk is corrupt
+  */
+  static bool unpackChunk(const SimStateArray& array, uint32_t chunkBytes, size_t iChunk,
+                          const char* pStored, char* pValues);
+
+  /*!
+    @brief Check a chunk of an array against its CRC-32.
+    @param array the array
+    @param chunkBytes size of a chunk, from the header
+    @param iChunk index of the chunk
+    @param pChunk the values of the chunk
+    @return true if the chunk is intact
+  */
+  static bool checkChunk(const SimStateArray& array, uint32_t chunkBytes, size_t iChunk,
+                         const char* pChunk);
+};
+
+#endif
@@ -52,10 +52,12 @@
 
 #include <iostream>
 #include <sstream>
+#include <cstring>
 #include <algorithm>
 
 #include "KIIexceptions.h"
 #include "SparseMatrix.h"
+#include "MatrixXmlReader.h"
 
 #include "SourceVersions.h"
 
@@ -309,11 +311,12 @@ SparseMatrix::SparseMatrix(int r, int c, FLOAT m, const char* v)
     return;
 
   if (v != NULL) {     // Initialize from string of numeric data
-    istringstream valStream(v);
+    const char* pVal = v;
+    const char* pEnd = v + strlen(v);
     for (int i=0; i<rows; i++) {
       Element* el;
       FLOAT val;
-      valStream >> val;
+      pVal = MatrixXmlReader::parseValues(pVal, pEnd, &val, 1);
       if ((el = new Element(i, i, val*multiplier)) == NULL)
 	throw KII_bad_alloc("Failed allocating storage for SparseMatrix.");
       theRows[i].push_back(el);
@@ -40,6 +40,8 @@
 
 #include "KIIexceptions.h"
 #include "VectorMatrix.h"
+#include "MatrixXmlReader.h"
+#include "MatrixXmlWriter.h"
 
 #include "SourceVersions.h"
 
@@ -69,12 +71,10 @@ VectorMatrix::VectorMatrix(string t, string i, int r, int c, FLOAT m, string val
 	alloc(size);
 
 	if (values != "") { // Initialize from the text string
-		istringstream valStream(values);
 		if (type == "complete") { // complete matrix with values given
-			for (int i = 0; i < size; i++) {
-				valStream >> theVector[i];
+			MatrixXmlReader::parseValues(values.c_str(), values.c_str() + values.size(), theVector, size);
+			for (int i = 0; i < size; i++)
 				theVector[i] *= multiplier;
-			}
 		} else {
 			clear();
 			throw KII_invalid_argument("Illegal type for VectorMatrix with 'none' init: " + type);
@@ -176,14 +176,22 @@ void VectorMatrix::Print(ostream& os) const {
 string VectorMatrix::toXML(string name) const {
 	stringstream os;
 
+	toXML(os, name);
+
+	return os.str();
+}
+
+// write vector as XML to a stream; the values are formatted as Print()
+// would, but faster
+void VectorMatrix::toXML(ostream& os, string name) const {
 	os << "<Matrix ";
 	if (name != "")
 		os << "name=\"" << name << "\" ";
 	os << "type=\"complete\" rows=\"1\" columns=\"" << size << "\" multiplier=\"1.0\">" << endl;
-	os << "   " << *this << endl;
+	os << "   ";
+	MatrixXmlWriter::writeValues(os, &theVector, 1, size, false);
+	os << endl;
 	os << "</Matrix>";
-
-	return os.str();
 }
 
 // The math operations
@@ -138,6 +138,14 @@ friend class csimInterface;
   */
   virtual string toXML(string name="") const;
 
+  /*!
+    @brief Write XML representation of vector to a stream, without
+    building it in memory first. Same text as toXML(name).
+    @param os stream to output to
+    @param name name attribute for XML
+  */
+  virtual void toXML(ostream& os, string name="") const;
+
   /*! @name Accessors
    */
   //@{
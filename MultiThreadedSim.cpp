@@ -25,17 +25,17 @@ MultiThreadedSim::~MultiThreadedSim()
 void MultiThreadedSim::advanceUntilGrowth(SimulationInfo* psi)
 {
     uint64_t count = 0;
-    uint64_t endStep = g_simulationStep + static_cast<uint64_t>(psi->stepDuration / psi->deltaT);
+    uint64_t endStep = psi->pContext->simulationStep + static_cast<uint64_t>(psi->stepDuration / psi->deltaT);
 
     cout << "OMP advance" << endl;
     cout << "Thread: " << omp_get_thread_num() << " in par: " << omp_in_parallel() << endl;
 
-    while (g_simulationStep < endStep)
+    while (psi->pContext->simulationStep < endStep)
     {
         DEBUG(if (count %1000 == 0)
               {
                   cout << psi->currentStep << "/" << psi->maxSteps
-                      << " simulating time: " << g_simulationStep * psi->deltaT << endl;
+                      << " simulating time: " << psi->pContext->simulationStep * psi->deltaT << endl;
                   count = 0;
               }
 
@@ -46,7 +46,7 @@ void MultiThreadedSim::advanceUntilGrowth(SimulationInfo* psi)
         advanceNeurons(psi);
 
         advanceSynapses(psi);
-        g_simulationStep++;
+        psi->pContext->simulationStep++;
     } 
 }
 
@@ -68,27 +68,52 @@ void MultiThreadedSim::advanceNeurons(SimulationInfo* psi)
     // the results of the simulation step. This prevents neurons from interfering with each other's input
     // in a multi-threaded scenario.
 
+    // The neurons are visited in row-major order, so that the noise each neuron draws
+    // does not depend on the storage order.
 #pragma omp parallel for schedule(static, chunk_size) 
 
-    for (int i = psi->cNeurons - 1; i >= 0; --i)
+    for (int k = psi->cNeurons - 1; k >= 0; --k)
     {
+        int i = psi->rgStorageIndex[k];
+
         // advance neurons
-        (*(psi->pNeuronList))[i].advance(psi->pSummationMap[i]);
+        (*(psi->pNeuronList))[i].advance(psi->pSummationMap[i], *psi->pContext->rgNormrnd[omp_get_thread_num()]);
 
         DEBUG2(cout << i << " " << (*(psi->pNeuronList))[i].Vm << endl;)
+
+        if ((*(psi->pNeuronList))[i].hasFired)
+        {
+            if (psi->pSpikeHistogram != NULL)
+            {
+                psi->pSpikeHistogram->count(omp_get_thread_num(), psi->pContext->simulationStep);
+            }
+            if (psi->pSpikeRecorder != NULL)
+            {
+                psi->pSpikeRecorder->record(omp_get_thread_num(), psi->rgNeuronIndex[i], psi->pContext->simulationStep);
+            }
+        }
     }
 
     // For the performance reason, this loop should be executed sequentially to avoid critical region for DelayList
-    for (int i = psi->cNeurons - 1; i >= 0; --i)
+    for (int k = psi->cNeurons - 1; k >= 0; --k)
     {
+        int i = psi->rgStorageIndex[k];
+
         // notify outgoing synapses if neuron has fired
         if ((*(psi->pNeuronList))[i].hasFired)
         {
-            DEBUG2(cout << " !! Neuron" << i << "has Fired @ t: " << g_simulationStep * psi->deltaT << endl;)
+            DEBUG2(cout << " !! Neuron" << i << "has Fired @ t: " << psi->pContext->simulationStep * psi->deltaT << endl;)
 
-            for (int z = psi->rgSynapseMap[i].size() - 1; z >= 0; --z)
+            if (inputRing != NULL)
+            {
+                inputRing->preSpikeHit(psi->rgSynapseMap[i], psi->pContext->simulationStep);
+            }
+            else
             {
-                psi->rgSynapseMap[i][z].preSpikeHit();
+                for (int z = psi->rgSynapseMap[i].size() - 1; z >= 0; --z)
+                {
+                    psi->rgSynapseMap[i][z].preSpikeHit();
+                }
             }
 
             (*(psi->pNeuronList))[i].hasFired = false;
@@ -100,7 +125,7 @@ void MultiThreadedSim::advanceNeurons(SimulationInfo* psi)
 
 #ifdef DUMP_VOLTAGES
     // ouput a row with every voltage level for each time step
-    cout << g_simulationStep * psi->deltaT;
+    cout << psi->pContext->simulationStep * psi->deltaT;
 
     for (int i = 0; i < psi->cNeurons; i++)
     {
@@ -116,6 +141,13 @@ void MultiThreadedSim::advanceNeurons(SimulationInfo* psi)
  */
 void MultiThreadedSim::advanceSynapses(SimulationInfo* psi)
 {
+    // the ring buffers already hold the input of the synapses
+    if (inputRing != NULL)
+    {
+        inputRing->advance();
+        return;
+    }
+
     int chunk_size = psi->cNeurons / omp_get_max_threads();
 
     // TODO: move global g_nMaxChunkSize into the GPU simulation object
@@ -133,22 +165,22 @@ void MultiThreadedSim::advanceSynapses(SimulationInfo* psi)
         // GPU/PARALLEL optimization point.
         for (int z = psi->rgSynapseMap[i].size() - 1; z >= 0; --z)
         {
-            psi->rgSynapseMap[i][z].advance();
+            psi->rgSynapseMap[i][z].advance(psi->pContext->simulationStep);
         }
     }
 }
 
 /**
  * Calculate growth cycle firing rate for previous period.
- * Compute neuron radii change, assign new values, and record the radius to histroy matrix.
+ * Compute neuron radii change, assign new values, and return the new radii and rates.
  * Update distance between frontiers, and compute areas of overlap. 
  * Adjust the strength of the synapse or remove it from the synapse map if it has gone below 
  * zero.
  * @param[in] psi       Pointer to the simulation information.
- * @param[in] radiiHistory     Matrix to save radius history.
- * @param[in] ratesHistory     Matrix to save firing rates history. 
+ * @param[out] newRadii     Receives the new radius of each neuron.
+ * @param[out] newRates     Receives the firing rate of each neuron.
  */
-void MultiThreadedSim::updateNetwork(SimulationInfo* psi, CompleteMatrix& radiiHistory, CompleteMatrix& ratesHistory)
+void MultiThreadedSim::updateNetwork(SimulationInfo* psi, VectorMatrix& newRadii, VectorMatrix& newRates)
 {
     //// Calculate OpenMP chunk size
     int max_threads = 1;
@@ -160,14 +192,26 @@ void MultiThreadedSim::updateNetwork(SimulationInfo* psi, CompleteMatrix& radiiH
     // Calculate growth cycle firing rate for previous period
     for (int i = 0; i < psi->cNeurons; i++)
     {
+        LifNeuron& neuron = (*(psi->pNeuronList))[psi->rgStorageIndex[i]];
+
         // Calculate firing rate
-        rates[i] = (*(psi->pNeuronList))[i].getSpikeCount() / psi->stepDuration;
+        rates[i] = neuron.getSpikeCount() / psi->stepDuration;
 
         // clear spike count
-        (*(psi->pNeuronList))[i].clearSpikeCount();
+        neuron.clearSpikeCount();
+
+        // return the firing rate
+        newRates[i] = rates[i];
+    }
 
-        // record firing rate to history matrix
-        ratesHistory(psi->currentStep, i) = rates[i];
+    // the radii and synapses of a network with frozen connectivity stay as they are
+    if (psi->fFrozenConnectivity)
+    {
+        for (int i = 0; i < radii.Size(); i++)
+        {
+            newRadii[i] = radii[i];
+        }
+        return;
     }
 
     // compute neuron radii change and assign new values
@@ -175,15 +219,15 @@ void MultiThreadedSim::updateNetwork(SimulationInfo* psi, CompleteMatrix& radiiH
     deltaR = psi->stepDuration * psi->rho * outgrowth;
     radii += deltaR;
 
-    // Cap minimum radius size and record radii to history matrix
+    // Cap minimum radius size and return the radii
     for (int i = 0; i < radii.Size(); i++)
     {
         // TODO: find out why we cap this here.
         if (radii[i] < psi->minRadius)
             radii[i] = psi->minRadius;
 
-        // record radius to history matrix
-        radiiHistory(psi->currentStep, i) = radii[i];
+        // return the radius
+        newRadii[i] = radii[i];
 
         DEBUG2(cout << "radii[" << i << ":" << radii[i] << "]" << endl;);
     }
@@ -252,10 +296,11 @@ void MultiThreadedSim::updateNetwork(SimulationInfo* psi, CompleteMatrix& radiiH
     int could_have_been_removed = 0; // TODO: use this value
     int removed = 0;
     int added = 0;
+    int cClippedDelays = 0;
 
     DEBUG(cout << "adjusting weights" << endl;)
 
-#pragma omp parallel for schedule(static, chunk_size)
+#pragma omp parallel for schedule(static, chunk_size) reduction(+:cClippedDelays)
 
     // Scale and add sign to the areas
     // visit each neuron 'a'
@@ -264,6 +309,12 @@ void MultiThreadedSim::updateNetwork(SimulationInfo* psi, CompleteMatrix& radiiH
         int xa = a % psi->width;
         int ya = a / psi->width;
         Coordinate aCoord(xa, ya);
+        vector<DynamicSpikingSynapse>& synapses = psi->rgSynapseMap[psi->rgStorageIndex[a]];
+        size_t cAdded = 0;
+        bool fRemoved = false;
+
+        reserveSynapses(psi, a, synapses);
+        size_t cReserved = synapses.capacity();
 
         // and each destination neuron 'b'
         for (int b = 0; b < psi->cNeurons; b++)
@@ -276,10 +327,10 @@ void MultiThreadedSim::updateNetwork(SimulationInfo* psi, CompleteMatrix& radiiH
             bool connected = false;
 
             // for each existing synapse
-            for (size_t syn = 0; syn < psi->rgSynapseMap[a].size(); syn++)
+            for (size_t syn = 0; syn < synapses.size(); syn++)
             {
                 // if there is a synapse between a and b
-                if (psi->rgSynapseMap[a][syn].summationCoord == bCoord)
+                if (synapses[syn].summationCoord == bCoord)
                 {
                     connected = true;
                     adjusted++;
@@ -289,20 +340,25 @@ void MultiThreadedSim::updateNetwork(SimulationInfo* psi, CompleteMatrix& radiiH
                     // zero.
                     if (W(a, b) < 0)
                     {
+                        // removed from the list once all targets are visited
                         removed++;
-                        psi->rgSynapseMap[a].erase(psi->rgSynapseMap[a].begin() + syn);
+                        synapses[syn].fRemoved = true;
+                        fRemoved = true;
                     }
                     else
                     {
                         // adjust
                         // g_synapseStrengthAdjustmentConstant is 1.0e-8;
-                        psi->rgSynapseMap[a][syn].W = W(a, b) * 
+                        synapses[syn].W = W(a, b) * 
                             synSign(synType(psi, aCoord, bCoord)) * g_synapseStrengthAdjustmentConstant;
 
                         DEBUG2(cout << "weight of rgSynapseMap" << 
                                coordToString(xa, ya)<<"[" <<syn<<"]: " << 
-                               psi->rgSynapseMap[a][syn].W << endl;);
+                               synapses[syn].W << endl;);
                     }
+
+                    // there is at most one synapse between a and b
+                    break;
                 }
             }
 
@@ -310,13 +366,26 @@ void MultiThreadedSim::updateNetwork(SimulationInfo* psi, CompleteMatrix& radiiH
             if (!connected && (W(a, b) > 0))
             {
                 added++;
+                cAdded++;
 
-                DynamicSpikingSynapse& newSynapse = addSynapse(psi, xa, ya, xb, yb);
+                DynamicSpikingSynapse& newSynapse = addSynapse(psi, xa, ya, xb, yb, cClippedDelays);
                 newSynapse.W = W(a, b) * synSign(synType(psi, aCoord, bCoord)) * g_synapseStrengthAdjustmentConstant;
             }
         }
+
+        // the list must not have been reallocated while the pruned synapses were still in it
+        assert(synapses.capacity() == cReserved);
+
+        // remove the pruned synapses and keep the rest sorted by target
+        if (fRemoved)
+        {
+            removeSynapses(synapses);
+        }
+        sortSynapses(synapses, synapses.size() - cAdded);
     }
 
+    reportClippedDelays(psi, cClippedDelays);
+
     DEBUG (cout << "adjusted: " << adjusted << endl;)
     DEBUG (cout << "could have been removed (TODO: calculate this): " << could_have_been_removed << endl;)
     DEBUG (cout << "removed: " << removed << endl;)
@@ -43,7 +43,7 @@ public:
     virtual void advanceUntilGrowth(SimulationInfo* psi);
 
     //! Updates the network.
-    virtual void updateNetwork(SimulationInfo* psi, CompleteMatrix& radiiHistory, CompleteMatrix& ratesHistory);
+    virtual void updateNetwork(SimulationInfo* psi, VectorMatrix& newRadii, VectorMatrix& newRates);
 
 private:
     //! Perform updating neurons for one time step.
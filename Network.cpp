@@ -6,6 +6,11 @@
  *  @brief A grid of LIF Neurons and their interconnecting synapses.
  */
 #include "Network.h"
+#include "Checkpoint.h"
+#include "CheckpointWriter.h"
+#include "Ensemble.h"
+#include "LaneSim.h"
+#include <fstream>
 
 /** 
  * The constructor for Network.
@@ -15,8 +20,13 @@ Network::Network(int cols, int rows, FLOAT inhFrac, FLOAT excFrac, FLOAT startFr
         FLOAT Inoise[2], FLOAT Vthresh[2], FLOAT Vresting[2], FLOAT Vreset[2], FLOAT Vinit[2],
         FLOAT starter_Vthresh[2], FLOAT starter_Vreset[2], FLOAT new_epsilon, FLOAT new_beta, FLOAT new_rho,
         FLOAT new_targetRate, FLOAT new_maxRate, FLOAT new_minRadius, FLOAT new_startRadius, FLOAT new_deltaT,
-        ostream& new_stateout, ostream& new_memoutput, bool fWriteMemImage, istream& new_meminput, bool fReadMemImage, 
-	bool fFixedLayout, vector<int>* pEndogenouslyActiveNeuronLayout, vector<int>* pInhibitoryNeuronLayout) :
+        FLOAT new_conductionVelocity, ostream& new_stateout, ostream& new_memoutput, bool fWriteMemImage, const string& memInputFileName, bool fReadMemImage, 
+	bool fFixedLayout, vector<int>* pEndogenouslyActiveNeuronLayout, vector<int>* pInhibitoryNeuronLayout,
+	bool fInputRingBuffers, neuronOrder order, ostream& new_spikeoutput, bool fWriteSpikes,
+	ostream& new_growthoutput, bool fWriteGrowth, const string& historyFileName, bool fBinaryState,
+	bool fPackOutput, const string& checkpointFileName, int checkpointInterval, int checkpointBaseInterval, const string& resumeFileName,
+	int cReplicas, int cLanes, const string& stateOutputFileName, const string& memOutputFileName, const string& spikeOutputFileName,
+	const string& growthOutputFileName) :
     m_width(cols),
     m_height(rows),
     m_cNeurons(cols * rows),
@@ -35,16 +45,49 @@ Network::Network(int cols, int rows, FLOAT inhFrac, FLOAT excFrac, FLOAT startFr
     m_maxRate(new_maxRate),
     m_minRadius(new_minRadius),
     m_startRadius(new_startRadius),
+    m_conductionVelocity(new_conductionVelocity),
     state_out(new_stateout),
     memory_out(new_memoutput),
     m_fWriteMemImage(fWriteMemImage),
-    memory_in(new_meminput),
+    m_memInputFileName(memInputFileName),
     m_fReadMemImage(fReadMemImage),
+    spike_out(new_spikeoutput),
+    m_fWriteSpikes(fWriteSpikes),
+    growth_out(new_growthoutput),
+    m_fWriteGrowth(fWriteGrowth),
+    m_historyFileName(historyFileName),
+    m_fBinaryState(fBinaryState),
+    m_fPackOutput(fPackOutput),
+    m_checkpointFileName(checkpointFileName),
+    m_checkpointInterval(checkpointInterval),
+    m_checkpointBaseInterval(checkpointBaseInterval),
+    m_resumeFileName(resumeFileName),
+    m_cReplicas(cReplicas),
+    m_cLanes(cLanes),
+    m_replica(-1),
+    m_stateOutputFileName(stateOutputFileName),
+    m_memOutputFileName(memOutputFileName),
+    m_spikeOutputFileName(spikeOutputFileName),
+    m_growthOutputFileName(growthOutputFileName),
     m_fFixedLayout(fFixedLayout),
     m_pEndogenouslyActiveNeuronLayout(pEndogenouslyActiveNeuronLayout),
-    m_pInhibitoryNeuronLayout(pInhibitoryNeuronLayout)
+    m_pInhibitoryNeuronLayout(pInhibitoryNeuronLayout),
+    m_fInputRingBuffers(fInputRingBuffers),
+    m_order(order),
+    m_rgStorageIndex(NULL),
+    m_rgNeuronIndex(NULL),
+    m_cThreads(0),
+    m_pDistances(NULL)
 {
     cout << "Neuron count: " << m_cNeurons << endl;
+
+#if defined(USE_GPU)
+    if (m_order != ROW_MAJOR)
+    {
+        cerr << "Warning: neuron orders other than row-major are not supported by the GPU simulation; ignored" << endl;
+        m_order = ROW_MAJOR;
+    }
+#endif
  
     // init data structures
     reset();
@@ -62,6 +105,60 @@ Network::~Network()
     freeResources();
 }
 
+/**
+ * The outputs of a run, or of a replica of an ensemble: its output files, its histories and
+ * the writers that stream its spikes and its growth during the simulation.
+ */
+struct RunOutput
+{
+    RunOutput(int cNeurons, FLOAT growthStepDuration, FLOAT maxGrowthSteps, FLOAT deltaT, int cThreads) :
+        pStateOut(NULL),
+        pMemOut(NULL),
+        pSpikeOut(NULL),
+        pGrowthOut(NULL),
+        burstinessHist("complete", "const", 1, (int)(growthStepDuration * maxGrowthSteps), 0),
+        spikesHistory("complete", "const", 1, (int)(growthStepDuration * maxGrowthSteps * 100), 0),
+        radiiHistory(static_cast<int>(maxGrowthSteps + 1), cNeurons),
+        ratesHistory(static_cast<int>(maxGrowthSteps + 1), cNeurons),
+        spikeHistogram(burstinessHist, spikesHistory, deltaT, cThreads),
+        spikeRecorder(cThreads),
+        pSpikeWriter(NULL),
+        pGrowthWriter(NULL)
+    {
+    }
+
+    //! The output files of a replica; a run that is not a replica writes to the streams of the Network.
+    ofstream stateOut;
+    ofstream memOut;
+    ofstream spikeOut;
+    ofstream growthOut;
+
+    //! The streams the outputs are written to.
+    ostream* pStateOut;
+    ostream* pMemOut;
+    ostream* pSpikeOut;
+    ostream* pGrowthOut;
+
+    //! burstiness histogram (1 s bins)
+    VectorMatrix burstinessHist;
+
+    //! spikes history - history of accumulated spikes count of all neurons (10 ms bins)
+    VectorMatrix spikesHistory;
+
+    //! track radii and firing rate, in memory or in files
+    HistoryStore radiiHistory;
+    HistoryStore ratesHistory;
+
+    //! counts the spikes into the histograms as they are fired
+    SpikeHistogram spikeHistogram;
+
+    //! records the spikes into chunks for the spike file
+    SpikeRecorder spikeRecorder;
+
+    SpikeFileWriter* pSpikeWriter;
+    GrowthFileWriter* pGrowthWriter;
+};
+
 /**
 * Run simulation
 *
@@ -75,8 +172,8 @@ void Network::simulate(FLOAT growthStepDuration, FLOAT maxGrowthSteps, int maxFi
 
     matrixType = "complete";
     init = "const";
-    VectorMatrix radii(matrixType, init, 1, m_cNeurons);	// previous saved radii
-    VectorMatrix rates(matrixType, init, 1, m_cNeurons);	// previous saved rates
+    VectorMatrix radii(matrixType, init, 1, m_cNeurons);	// current radii
+    VectorMatrix rates(matrixType, init, 1, m_cNeurons);	// current rates
 
     // Init SimulationInfo parameters
     m_si.stepDuration = growthStepDuration;
@@ -93,18 +190,32 @@ void Network::simulate(FLOAT growthStepDuration, FLOAT maxGrowthSteps, int maxFi
     m_si.maxRate = m_maxRate;
     m_si.minRadius = m_minRadius;
     m_si.startRadius = m_startRadius;
-
-    // burstiness Histogram goes through the
-    VectorMatrix burstinessHist(matrixType, init, 1, (int)(growthStepDuration * maxGrowthSteps), 0);
-
-    // spikes history - history of accumulated spikes count of all neurons (10 ms bin)
-    VectorMatrix spikesHistory(matrixType, init, 1, (int)(growthStepDuration * maxGrowthSteps * 100), 0);
-
-    // track radii
-    CompleteMatrix radiiHistory(matrixType, init, static_cast<int>(maxGrowthSteps + 1), m_cNeurons);
-
-    // track firing rate
-    CompleteMatrix ratesHistory(matrixType, init, static_cast<int>(maxGrowthSteps + 1), m_cNeurons);
+    m_si.conductionVelocity = m_conductionVelocity;
+    m_si.fInputRingBuffers = m_fInputRingBuffers;
+    m_si.pContext = &m_context;
+    m_si.pDistances = m_pDistances;
+#if defined(USE_GPU)
+    if (m_conductionVelocity > 0)
+    {
+        cerr << "Warning: distance-dependent delays are not supported by the GPU simulation; using fixed delays" << endl;
+    }
+    if (m_fInputRingBuffers)
+    {
+        cerr << "Warning: input ring buffers are not supported by the GPU simulation; ignored" << endl;
+    }
+#if !defined(STORE_SPIKEHISTORY)
+    if (m_fWriteSpikes)
+    {
+        cerr << "Warning: the GPU simulation only returns spikes with STORE_SPIKEHISTORY; the spike file will be empty" << endl;
+    }
+#endif
+    if (m_checkpointInterval > 0 || !m_resumeFileName.empty())
+    {
+        cerr << "Warning: checkpoints are not supported by the GPU simulation; ignored" << endl;
+        m_checkpointInterval = 0;
+        m_resumeFileName.clear();
+    }
+#endif
 
     // neuron types
     VectorMatrix neuronTypes(matrixType, init, 1, m_cNeurons, EXC);
@@ -113,7 +224,7 @@ void Network::simulate(FLOAT growthStepDuration, FLOAT maxGrowthSteps, int maxFi
     VectorMatrix neuronThresh(matrixType, init, 1, m_cNeurons, 0);
     for (int i = 0; i < m_cNeurons; i++) 
     {
-        neuronThresh[i] = m_neuronList[i].Vthresh;
+        neuronThresh[i] = m_neuronList[m_rgStorageIndex[i]].Vthresh;
     }
 
     // neuron locations matrices
@@ -130,22 +241,35 @@ void Network::simulate(FLOAT growthStepDuration, FLOAT maxGrowthSteps, int maxFi
     // Populate neuron types with current values
     getNeuronTypes(neuronTypes);
 
-    // Init radii and rates history matrices with current radii and rates
+    // Init radii and rates history with current radii and rates
     for (int i = 0; i < m_cNeurons; i++)
     {
-        radiiHistory(0, i) = m_startRadius;
-        ratesHistory(0, i) = 0;
+        radii[i] = m_startRadius;
+        rates[i] = 0;
+    }
+
+    // The replicas of an ensemble run on the frozen network of the memory image; they are
+    // forked before any OpenMP threads are started, and each runs on one core
+    bool fEnsemble = m_cReplicas > 0;
+    if (fEnsemble)
+    {
+        m_si.fFrozenConnectivity = true;
+        OMP(omp_set_num_threads(1);)
     }
 
-    // Read a simulation memory image
+    // Read the network of a simulation memory image or of a checkpoint to resume from;
+    // the rest of it is restored once the simulation is initialized
+    bool fResume = !m_resumeFileName.empty();
+    MappedSimState* pImage = NULL;
     if (m_fReadMemImage)
     {
-        readSimMemory(memory_in, radii, rates);
-        for (int i = 0; i < m_cNeurons; i++)
-        {
-            radiiHistory(0, i) = radii[i];
-            ratesHistory(0, i) = rates[i];
-        }
+        pImage = new MappedSimState(m_memInputFileName);
+        readSimMemory(*pImage, radii, rates);
+    }
+    else if (fResume)
+    {
+        pImage = CheckpointDelta::open(m_resumeFileName);
+        readSimMemory(*pImage, radii, rates);
     }
 
     // Start the timer
@@ -159,32 +283,122 @@ void Network::simulate(FLOAT growthStepDuration, FLOAT maxGrowthSteps, int maxFi
 #elif defined(USE_OMP)
     pSim = new MultiThreadedSim(&m_si);
 
-    // Initialize OpenMP - one thread per core
-    OMP(omp_set_num_threads(omp_get_num_procs());)
-
-    int max_threads = 1;
-    max_threads = omp_get_max_threads();
+    // Initialize OpenMP - one thread per core, or per replica of an ensemble, or as many as given
+    OMP(omp_set_num_threads(fEnsemble ? 1 : (m_cThreads > 0 ? m_cThreads : omp_get_num_procs()));)
 
     // Create normalized random number generators for each thread
-    for (int i = 0; i < max_threads; i++)
-        rgNormrnd.push_back(new Norm(0, 1, 1));
+    m_context.initNormrnd(omp_get_max_threads());
 #else
     pSim = new SingleThreadedSim(&m_si);
 
     // Create a normalized random number generator
-    rgNormrnd.push_back(new Norm(0, 1, 1));
+    m_context.initNormrnd(1);
 #endif
 
+    // Count spikes into the spike histograms as they are fired, and record them
+    // into chunks for the spike file
+    int cThreads = 1;
+    OMP(cThreads = omp_get_max_threads();)
+    RunOutput out(m_cNeurons, growthStepDuration, maxGrowthSteps, m_deltaT, cThreads);
+    m_si.pSpikeHistogram = &out.spikeHistogram;
+
     pSim->init(&m_si, xloc, yloc);
 
+#if defined(USE_GPU)
+    InputRingBuffer* pInputRing = NULL;
+#else
+    InputRingBuffer* pInputRing = static_cast<HostSim*>(pSim)->getInputRing();
+#endif
+
     // Set the previous saved radii
-    if (m_fReadMemImage)
+    if (pImage != NULL)
     {
         pSim->initRadii(radii);
     }
 
+    // Continue the time of the run that wrote the memory image
+#if !defined(USE_GPU)
+    if (!fResume && pImage != NULL)
+    {
+        if (Checkpoint::restoreContinuation(*pImage, *this, pInputRing))
+        {
+            out.spikeHistogram.setOrigin(m_context.simulationStep);
+        }
+        else
+        {
+            cerr << "Warning: simulation memory image " << m_memInputFileName
+                 << " has no time step and random number generator state; the run starts at time 0" << endl;
+        }
+    }
+#endif
+
+    // Run each replica, or batch of replicas, of an ensemble in a process of its own from
+    // here on, with its own noise and output files; the parent waits for them
+    if (fEnsemble)
+    {
+        m_replica = Ensemble::forkReplicas(m_cReplicas, m_cLanes);
+        if (m_replica < 0)
+        {
+            delete pImage;
+            pSim->term(&m_si);
+            delete pSim;
+            m_context.clearNormrnd();
+            return;
+        }
+
+        if (m_cLanes > 1)
+        {
+            delete pImage;
+            simulateLanes(Ensemble::batchSize(m_replica, m_cReplicas, m_cLanes), pInputRing, radii, rates,
+                    xloc, yloc, neuronTypes, neuronThresh, growthStepDuration, maxGrowthSteps);
+            pSim->term(&m_si);
+            delete pSim;
+            m_context.clearNormrnd();
+            return;
+        }
+
+        for (unsigned int i = 0; i < m_context.rgNormrnd.size(); i++)
+        {
+            m_context.rgNormrnd[i]->reseed(Ensemble::replicaSeed(m_replica));
+        }
+    }
+
+    // Output produced during the simulation is written by a background thread
+    OutputPipeline* pOutput = createOutputPipeline();
+    openOutput(out, m_replica, pOutput, growthStepDuration);
+    if (!fResume)
+    {
+        out.radiiHistory.setRow(0, radii);
+        out.ratesHistory.setRow(0, rates);
+    }
+    if (out.spikeRecorder.hasConsumers())
+    {
+        m_si.pSpikeRecorder = &out.spikeRecorder;
+    }
+
+    // Continue the run of the checkpoint after the growth step it was taken at
+    int startStep = 0;
+    if (fResume)
+    {
+        startStep = Checkpoint::restoreProgress(*pImage, *this, m_si.maxSteps, out.radiiHistory, out.ratesHistory,
+                out.burstinessHist, out.spikesHistory, pInputRing);
+        cout << "Resuming after growth step " << startStep << endl;
+    }
+    delete pImage;
+    if (out.pGrowthWriter != NULL)
+    {
+        out.pGrowthWriter->writeStep(startStep, radii, rates);
+    }
+
+    // Checkpoints are captured between growth steps and written in the background
+    CheckpointWriter* pCheckpointWriter = NULL;
+    if (m_checkpointInterval > 0)
+    {
+        pCheckpointWriter = new CheckpointWriter(m_checkpointFileName, m_checkpointBaseInterval, m_fPackOutput);
+    }
+
     // Main simulation loop - execute maxGrowthSteps
-    for (int currentStep = 1; currentStep <= maxGrowthSteps; currentStep++)
+    for (int currentStep = startStep + 1; currentStep <= maxGrowthSteps; currentStep++)
     {
 #ifdef PERFORMANCE_METRICS
         m_timer.start();
@@ -196,7 +410,10 @@ void Network::simulate(FLOAT growthStepDuration, FLOAT maxGrowthSteps, int maxFi
         DEBUG(cout << "\n\nPerforming simulation number " << currentStep << endl;)
         DEBUG(cout << "Begin network state:" << endl;)
 
-        // Advance simulation to next growth cycle
+        // Advance simulation to next growth cycle; the spikes of the previous
+        // cycle are added to the histograms and handed over to be written
+        out.spikeHistogram.beginEpoch(m_context.simulationStep, static_cast<uint64_t>(m_si.stepDuration / m_si.deltaT));
+        out.spikeRecorder.beginEpoch(m_context.simulationStep);
         pSim->advanceUntilGrowth(&m_si);
 
         DEBUG(cout << "\n\nDone with simulation cycle, beginning growth update " << currentStep << endl;)
@@ -205,7 +422,25 @@ void Network::simulate(FLOAT growthStepDuration, FLOAT maxGrowthSteps, int maxFi
 #ifdef PERFORMANCE_METRICS
         m_short_timer.start();
 #endif
-	pSim->updateNetwork(&m_si, radiiHistory, ratesHistory);
+	pSim->updateNetwork(&m_si, radii, rates);
+        out.radiiHistory.setRow(currentStep, radii);
+        out.ratesHistory.setRow(currentStep, rates);
+        if (out.pGrowthWriter != NULL)
+        {
+            out.pGrowthWriter->writeStep(currentStep, radii, rates);
+        }
+
+        // the spikes of the cycle are added to the histograms before they are captured
+        if (pCheckpointWriter != NULL && currentStep % m_checkpointInterval == 0)
+        {
+            out.spikeHistogram.flush();
+
+            Checkpoint& checkpoint = pCheckpointWriter->next();
+            checkpoint.capture(*this, radii, rates);
+            checkpoint.captureProgress(*this, currentStep, out.radiiHistory, out.ratesHistory, out.burstinessHist,
+                    out.spikesHistory, pInputRing);
+            pCheckpointWriter->commit(currentStep);
+        }
 
 #ifdef PERFORMANCE_METRICS
         t_host_adjustSynapses = m_short_timer.lap() / 1000.0f;
@@ -224,31 +459,39 @@ void Network::simulate(FLOAT growthStepDuration, FLOAT maxGrowthSteps, int maxFi
 #endif
     }
 
-#ifdef STORE_SPIKEHISTORY
-    // output spikes
-    for (int i = 0; i < m_width; i++)
+    if (pCheckpointWriter != NULL)
     {
-        for (int j = 0; j < m_height; j++)
-        {
-            vector<uint64_t>* pSpikes = m_neuronList[i + j * m_width].getSpikes();
-
-            DEBUG2 (cout << endl << coordToString(i, j) << endl);
+        pCheckpointWriter->close();
+        pCheckpointWriter->printStats(cout);
+        delete pCheckpointWriter;
+    }
 
-            for (unsigned int i = 0; i < (*pSpikes).size(); i++)
-            {
-                DEBUG2 (cout << i << " ");
-                int idx1 = (*pSpikes)[i] * m_deltaT;
-                burstinessHist[idx1] = burstinessHist[idx1] + 1.0;
-                int idx2 = (*pSpikes)[i] * m_deltaT * 100;
-                spikesHistory[idx2] = spikesHistory[idx2] + 1.0;
-            }
-        }
+    // add the spikes of the last cycle to the histograms and finish the output files
+    out.spikeHistogram.flush();
+    m_si.pSpikeHistogram = NULL;
+    out.spikeRecorder.flush();
+    m_si.pSpikeRecorder = NULL;
+    if (pOutput != NULL)
+    {
+        pOutput->close();
+        pOutput->printStats(cout);
+        delete out.pSpikeWriter;
+        delete out.pGrowthWriter;
+        delete pOutput;
     }
-#endif // STORE_SPIKEHISTORY
 
-    saveSimState(state_out, radiiHistory, ratesHistory, 
-                 xloc, yloc, neuronTypes, burstinessHist, spikesHistory,
-                 growthStepDuration, neuronThresh);
+    if (m_fBinaryState)
+    {
+        saveSimStateBinary(*out.pStateOut, out.radiiHistory, out.ratesHistory,
+                           xloc, yloc, neuronTypes, out.burstinessHist, out.spikesHistory,
+                           growthStepDuration, neuronThresh);
+    }
+    else
+    {
+        saveSimState(*out.pStateOut, out.radiiHistory, out.ratesHistory, 
+                     xloc, yloc, neuronTypes, out.burstinessHist, out.spikesHistory,
+                     growthStepDuration, neuronThresh);
+    }
 
     // Terminate the simulator
     pSim->term(&m_si);
@@ -256,16 +499,254 @@ void Network::simulate(FLOAT growthStepDuration, FLOAT maxGrowthSteps, int maxFi
     // write the simulation memory image
     if (m_fWriteMemImage)
     {
-        writeSimMemory(memory_out, radiiHistory, ratesHistory);
+        writeSimMemory(*out.pMemOut, radii, rates, pInputRing);
     }
 
     delete pSim;
 
-#ifdef USE_OMP
-    for (unsigned int i = 0; i < rgNormrnd.size(); i++)
-        delete rgNormrnd[i];
-#endif
-    rgNormrnd.clear();
+    m_context.clearNormrnd();
+}
+
+/**
+ * Compute the distances between the neurons of a network of the given size, as the simulation
+ * of the network computes them, so that the simulations of several networks of the size (e.g.
+ * the runs of a sweep) can share them (see m_pDistances).
+ * @param[in] cols	The width of the network, in unit neurons.
+ * @param[in] rows	The height of the network, in unit neurons.
+ * @return the distances, to be deleted by the caller.
+ */
+NeuronDistances* Network::computeDistances(int cols, int rows)
+{
+    int cNeurons = cols * rows;
+    VectorMatrix xloc("complete", "const", 1, cNeurons);
+    VectorMatrix yloc("complete", "const", 1, cNeurons);
+    for (int i = 0; i < cNeurons; i++)
+    {
+        xloc[i] = i % cols;
+        yloc[i] = i / cols;
+    }
+
+    NeuronDistances* pDistances = new NeuronDistances(cNeurons);
+    HostSim::computeDistances(xloc, yloc, pDistances->dist2, pDistances->dist);
+    return pDistances;
+}
+
+/**
+ * The outputs of a replica of an ensemble that runs in a lane of a LaneSim, and the rates of
+ * the lane.
+ */
+struct LaneOutput : public RunOutput
+{
+    LaneOutput(int cNeurons, FLOAT growthStepDuration, FLOAT maxGrowthSteps, FLOAT deltaT, const VectorMatrix& initialRates) :
+        RunOutput(cNeurons, growthStepDuration, maxGrowthSteps, deltaT, 1),
+        rates(initialRates)
+    {
+    }
+
+    VectorMatrix rates;
+};
+
+/**
+ * A pipeline for the output that is written during the simulation, by a background thread.
+ * @return the pipeline, to be deleted by the caller; NULL if no output is written during the simulation.
+ */
+OutputPipeline* Network::createOutputPipeline() const
+{
+    if (m_fWriteSpikes || m_fWriteGrowth || !m_historyFileName.empty())
+    {
+        return new OutputPipeline();
+    }
+    return NULL;
+}
+
+/**
+ * Open the output files of the run, or of a replica of an ensemble, the files the histories
+ * are kept in, and the writers that stream the spikes and the growth during the simulation.
+ * @param[in,out] out	The outputs of the run.
+ * @param[in] replica	The replica, whose files are named by Ensemble::replicaFileName(); -1 if the run is not a replica.
+ * @param[in] pOutput	The pipeline the output is written by (see createOutputPipeline()).
+ * @param[in] growthStepDuration	The length of each growth step in simulation time.
+ */
+void Network::openOutput(RunOutput& out, int replica, OutputPipeline* pOutput, FLOAT growthStepDuration)
+{
+    out.pStateOut = &state_out;
+    out.pMemOut = &memory_out;
+    out.pSpikeOut = &spike_out;
+    out.pGrowthOut = &growth_out;
+    string historyFileName = m_historyFileName;
+    if (replica >= 0)
+    {
+        string stateFileName = Ensemble::replicaFileName(m_stateOutputFileName, replica);
+        cout << "Replica " << replica << " writes " << stateFileName << endl;
+        out.stateOut.open(stateFileName.c_str(), m_fBinaryState ? ofstream::out | ofstream::binary : ofstream::out);
+        out.pStateOut = &out.stateOut;
+        if (m_fWriteMemImage)
+        {
+            out.memOut.open(Ensemble::replicaFileName(m_memOutputFileName, replica).c_str(),
+                    ofstream::binary | ofstream::trunc);
+            out.pMemOut = &out.memOut;
+        }
+        if (m_fWriteSpikes)
+        {
+            out.spikeOut.open(Ensemble::replicaFileName(m_spikeOutputFileName, replica).c_str(),
+                    ofstream::binary | ofstream::trunc);
+            out.pSpikeOut = &out.spikeOut;
+        }
+        if (m_fWriteGrowth)
+        {
+            out.growthOut.open(Ensemble::replicaFileName(m_growthOutputFileName, replica).c_str(),
+                    ofstream::binary | ofstream::trunc);
+            out.pGrowthOut = &out.growthOut;
+        }
+        if (!historyFileName.empty())
+        {
+            historyFileName = Ensemble::replicaFileName(historyFileName, replica);
+        }
+    }
+
+    if (!historyFileName.empty())
+    {
+        if (!out.radiiHistory.open(historyFileName + ".radii", *pOutput))
+        {
+            cerr << "Warning: cannot open " << historyFileName << ".radii; the radii history is kept in memory" << endl;
+        }
+        if (!out.ratesHistory.open(historyFileName + ".rates", *pOutput))
+        {
+            cerr << "Warning: cannot open " << historyFileName << ".rates; the rates history is kept in memory" << endl;
+        }
+    }
+
+    if (m_fWriteSpikes)
+    {
+        out.pSpikeWriter = new SpikeFileWriter(*pOutput, *out.pSpikeOut, m_cNeurons, m_deltaT, m_fPackOutput);
+        out.spikeRecorder.addConsumer(out.pSpikeWriter);
+    }
+    if (m_fWriteGrowth)
+    {
+        out.pGrowthWriter = new GrowthFileWriter(*pOutput, *out.pGrowthOut, m_cNeurons, growthStepDuration);
+    }
+}
+
+/**
+ * Run the replicas of a batch of an ensemble in the lanes of a LaneSim, from the state of the
+ * simulation this process has initialized.  The replicas are seeded, and write their output
+ * files, as they do when each runs in a process of its own.
+ * @param[in] cLanes	Number of replicas of the batch; the first is m_replica.
+ * @param[in] pInputRing	The input ring buffers, or NULL if the synapses deliver their own input.
+ * @param[in] radii	The radii of the network.
+ * @param[in] rates	The rates of the network when the replicas start.
+ * @param[in] xloc	X locations of the neurons.
+ * @param[in] yloc	Y locations of the neurons.
+ * @param[in] neuronTypes	The types of the neurons.
+ * @param[in] neuronThresh	The thresholds of the neurons.
+ * @param[in] growthStepDuration	The length of each growth step in simulation time.
+ * @param[in] maxGrowthSteps	Number of growth steps.
+ */
+void Network::simulateLanes(int cLanes, InputRingBuffer* pInputRing, VectorMatrix& radii, VectorMatrix& rates,
+        VectorMatrix& xloc, VectorMatrix& yloc, VectorMatrix& neuronTypes, VectorMatrix& neuronThresh,
+        FLOAT growthStepDuration, FLOAT maxGrowthSteps)
+{
+    LaneSim lanes(&m_si, pInputRing, cLanes);
+
+    // Output produced during the simulation is written by a background thread
+    OutputPipeline* pOutput = createOutputPipeline();
+
+    vector<LaneOutput*> rgOutput;
+    vector<SpikeHistogram*> rgHistogram;
+    vector<SpikeRecorder*> rgRecorder;
+    for (int l = 0; l < cLanes; l++)
+    {
+        int replica = m_replica + l;
+        LaneOutput* pOut = new LaneOutput(m_cNeurons, growthStepDuration, maxGrowthSteps, m_deltaT, rates);
+        rgOutput.push_back(pOut);
+        lanes.seed(l, Ensemble::replicaSeed(replica));
+
+        openOutput(*pOut, replica, pOutput, growthStepDuration);
+        pOut->radiiHistory.setRow(0, radii);
+        pOut->ratesHistory.setRow(0, rates);
+        pOut->spikeHistogram.setOrigin(m_context.simulationStep);
+        if (pOut->pGrowthWriter != NULL)
+        {
+            pOut->pGrowthWriter->writeStep(0, radii, rates);
+        }
+
+        rgHistogram.push_back(&pOut->spikeHistogram);
+        rgRecorder.push_back(pOut->spikeRecorder.hasConsumers() ? &pOut->spikeRecorder : NULL);
+    }
+
+    // Main simulation loop - the replicas advance together, and their connectivity is frozen
+    for (int currentStep = 1; currentStep <= maxGrowthSteps; currentStep++)
+    {
+        m_si.currentStep = currentStep;
+
+        DEBUG(cout << "\n\nPerforming simulation number " << currentStep << " in " << cLanes << " lanes" << endl;)
+
+        for (int l = 0; l < cLanes; l++)
+        {
+            rgOutput[l]->spikeHistogram.beginEpoch(m_context.simulationStep,
+                    static_cast<uint64_t>(m_si.stepDuration / m_si.deltaT));
+            rgOutput[l]->spikeRecorder.beginEpoch(m_context.simulationStep);
+        }
+        lanes.advanceUntilGrowth(&m_si, rgHistogram, rgRecorder);
+
+        for (int l = 0; l < cLanes; l++)
+        {
+            LaneOutput* pOut = rgOutput[l];
+
+            lanes.updateRates(l, &m_si, pOut->rates);
+            pOut->radiiHistory.setRow(currentStep, radii);
+            pOut->ratesHistory.setRow(currentStep, pOut->rates);
+            if (pOut->pGrowthWriter != NULL)
+            {
+                pOut->pGrowthWriter->writeStep(currentStep, radii, pOut->rates);
+            }
+        }
+    }
+
+    // add the spikes of the last cycle to the histograms and finish the output files
+    for (int l = 0; l < cLanes; l++)
+    {
+        rgOutput[l]->spikeHistogram.flush();
+        rgOutput[l]->spikeRecorder.flush();
+    }
+    if (pOutput != NULL)
+    {
+        pOutput->close();
+        pOutput->printStats(cout);
+        for (int l = 0; l < cLanes; l++)
+        {
+            delete rgOutput[l]->pSpikeWriter;
+            delete rgOutput[l]->pGrowthWriter;
+        }
+        delete pOutput;
+    }
+
+    for (int l = 0; l < cLanes; l++)
+    {
+        LaneOutput* pOut = rgOutput[l];
+
+        if (m_fBinaryState)
+        {
+            saveSimStateBinary(*pOut->pStateOut, pOut->radiiHistory, pOut->ratesHistory,
+                               xloc, yloc, neuronTypes, pOut->burstinessHist, pOut->spikesHistory,
+                               growthStepDuration, neuronThresh);
+        }
+        else
+        {
+            saveSimState(*pOut->pStateOut, pOut->radiiHistory, pOut->ratesHistory,
+                         xloc, yloc, neuronTypes, pOut->burstinessHist, pOut->spikesHistory,
+                         growthStepDuration, neuronThresh);
+        }
+
+        // write the simulation memory image of the replica from the state of its lane
+        if (m_fWriteMemImage)
+        {
+            lanes.store(l, &m_si, pInputRing, *m_context.rgNormrnd[0]);
+            writeSimMemory(*pOut->pMemOut, radii, pOut->rates, pInputRing);
+        }
+
+        delete pOut;
+    }
 }
 
 /**
@@ -279,6 +760,8 @@ void Network::freeResources()
     if (m_rgSynapseMap != NULL) delete[] m_rgSynapseMap;
     if (m_rgNeuronTypeMap != NULL) delete[] m_rgNeuronTypeMap;
     if (m_summationMap != NULL) delete[] m_summationMap;
+    if (m_rgStorageIndex != NULL) delete[] m_rgStorageIndex;
+    if (m_rgNeuronIndex != NULL) delete[] m_rgNeuronIndex;
 }
 
 /**
@@ -291,8 +774,8 @@ void Network::reset()
 
     freeResources();
 
-    // Reset global simulation Step to 0
-    g_simulationStep = 0;
+    // Reset the simulation step to 0
+    m_context.simulationStep = 0;
 
     // initial maximum firing rate
     m_maxRate = m_targetRate / m_epsilon;
@@ -310,6 +793,10 @@ void Network::reset()
 
     m_summationMap = new FLOAT[m_cNeurons];
 
+    m_rgStorageIndex = new int[m_cNeurons];
+    m_rgNeuronIndex = new int[m_cNeurons];
+    initStorageOrder();
+
     // initialize maps
     for (int i = 0; i < m_cNeurons; i++)
     {
@@ -321,6 +808,8 @@ void Network::reset()
     m_si.pNeuronList = &m_neuronList;
     m_si.rgSynapseMap = m_rgSynapseMap;
     m_si.pSummationMap = m_summationMap;
+    m_si.rgStorageIndex = m_rgStorageIndex;
+    m_si.rgNeuronIndex = m_rgNeuronIndex;
     m_si.deltaT = m_deltaT;
 
     DEBUG(cout << "\nExiting Network::reset()";)
@@ -356,26 +845,27 @@ void Network::initNeurons(FLOAT Iinject[2], FLOAT Inoise[2], FLOAT Vthresh[2], F
         // deterministic order. THIS CANNOT BE ASSURED IF THE CALLS
         // ARE WRITTEN AS PART OF THE ARGUMENTS IN A FUNCTION CALL!!
         // Thank you, C++ standards committee.
-        FLOAT Ii = rng.inRange(Iinject[0], Iinject[1]);
-        FLOAT In = rng.inRange(Inoise[0], Inoise[1]);
-        FLOAT Vth = rng.inRange(Vthresh[0], Vthresh[1]);
-        FLOAT Vrest = rng.inRange(Vresting[0], Vresting[1]);
-        FLOAT Vres = rng.inRange(Vreset[0],Vreset[1]);
-        FLOAT Vin = rng.inRange(Vinit[0], Vinit[1]);
-        m_neuronList[i].setParams(Ii, In, Vth, Vrest, Vres, Vin, m_deltaT);
+        FLOAT Ii = m_context.rng.inRange(Iinject[0], Iinject[1]);
+        FLOAT In = m_context.rng.inRange(Inoise[0], Inoise[1]);
+        FLOAT Vth = m_context.rng.inRange(Vthresh[0], Vthresh[1]);
+        FLOAT Vrest = m_context.rng.inRange(Vresting[0], Vresting[1]);
+        FLOAT Vres = m_context.rng.inRange(Vreset[0],Vreset[1]);
+        FLOAT Vin = m_context.rng.inRange(Vinit[0], Vinit[1]);
+        LifNeuron& neuron = m_neuronList[m_rgStorageIndex[i]];
+        neuron.setParams(Ii, In, Vth, Vrest, Vres, Vin, m_deltaT);
 
         switch (m_rgNeuronTypeMap[i])
         {
         case INH:
             DEBUG2(cout << "setting inhibitory neuron: "<< i << endl;)
             // set inhibitory absolute refractory period
-            m_neuronList[i].Trefract = DEFAULT_InhibTrefract;
+            neuron.Trefract = DEFAULT_InhibTrefract;
             break;
 
         case EXC:
             DEBUG2(cout << "setting exitory neuron: " << i << endl;)
             // set excitory absolute refractory period
-            m_neuronList[i].Trefract = DEFAULT_ExcitTrefract;
+            neuron.Trefract = DEFAULT_ExcitTrefract;
             break;
 
         default:
@@ -387,15 +877,109 @@ void Network::initNeurons(FLOAT Iinject[2], FLOAT Inoise[2], FLOAT Vthresh[2], F
         {
             DEBUG2(cout << "setting endogenously active neuron properties" << endl;)
             // set endogenously active threshold voltage, reset voltage, and refractory period
-            m_neuronList[i].Vthresh = rng.inRange(starter_Vthresh[0], starter_Vthresh[1]);
-            m_neuronList[i].Vreset = rng.inRange(starter_Vreset[0], starter_Vreset[1]);
-            m_neuronList[i].Trefract = DEFAULT_ExcitTrefract;
+            neuron.Vthresh = m_context.rng.inRange(starter_Vthresh[0], starter_Vthresh[1]);
+            neuron.Vreset = m_context.rng.inRange(starter_Vreset[0], starter_Vreset[1]);
+            neuron.Trefract = DEFAULT_ExcitTrefract;
         }
-        DEBUG2(cout << m_neuronList[i].toStringAll() << endl;)
+        DEBUG2(cout << neuron.toStringAll() << endl;)
     }
     DEBUG(cout << "Done initializing neurons..." << endl;)
 }
 
+/**
+ * Position of a grid location along a Z-order (Morton) curve.
+ * @param x	The x coordinate.
+ * @param y	The y coordinate.
+ * @return the bits of x and y interleaved.
+ */
+static uint64_t mortonCode(uint32_t x, uint32_t y)
+{
+    uint64_t d = 0;
+    for (int bit = 0; bit < 32; bit++)
+    {
+        d |= static_cast<uint64_t>((x >> bit) & 1) << (2 * bit);
+        d |= static_cast<uint64_t>((y >> bit) & 1) << (2 * bit + 1);
+    }
+    return d;
+}
+
+/**
+ * Position of a grid location along a Hilbert curve.
+ * @param n	Side of the square covered by the curve; a power of 2.
+ * @param x	The x coordinate.
+ * @param y	The y coordinate.
+ * @return distance of x,y from the start of the curve.
+ */
+static uint64_t hilbertCode(uint32_t n, uint32_t x, uint32_t y)
+{
+    uint64_t d = 0;
+    for (uint32_t s = n / 2; s > 0; s /= 2)
+    {
+        uint32_t rx = (x & s) > 0;
+        uint32_t ry = (y & s) > 0;
+        d += static_cast<uint64_t>(s) * s * ((3 * rx) ^ ry);
+
+        // rotate the quadrant
+        if (ry == 0)
+        {
+            if (rx == 1)
+            {
+                x = n - 1 - x;
+                y = n - 1 - y;
+            }
+            uint32_t t = x;
+            x = y;
+            y = t;
+        }
+    }
+    return d;
+}
+
+/**
+ * Numbers the neurons in the order selected by m_order.
+ * Neurons are sorted by their position along the curve; ties (none for the curves
+ * used here) keep the row-major order.
+ * @post m_rgStorageIndex and m_rgNeuronIndex are populated.
+ */
+void Network::initStorageOrder()
+{
+    // side of the smallest square with power of 2 side that covers the grid
+    uint32_t n = 1;
+    while (n < static_cast<uint32_t>(m_width) || n < static_cast<uint32_t>(m_height))
+        n <<= 1;
+
+    vector<pair<uint64_t, int> > order(m_cNeurons);
+    for (int i = 0; i < m_cNeurons; i++)
+    {
+        uint32_t x = i % m_width;
+        uint32_t y = i / m_width;
+        uint64_t d;
+
+        switch (m_order)
+        {
+        case MORTON:
+            d = mortonCode(x, y);
+            break;
+
+        case HILBERT:
+            d = hilbertCode(n, x, y);
+            break;
+
+        default:
+            d = i;
+            break;
+        }
+        order[i] = make_pair(d, i);
+    }
+    sort(order.begin(), order.end());
+
+    for (int i = 0; i < m_cNeurons; i++)
+    {
+        m_rgStorageIndex[order[i].second] = i;
+        m_rgNeuronIndex[i] = order[i].second;
+    }
+}
+
 /**
  * Randomly populates the m_rgNeuronTypeMap with the specified number of inhibitory and
  * excitory neurons.
@@ -448,7 +1032,7 @@ void Network::initStarterMap()
         while (starters_allocated < m_cStarterNeurons)
         {
             // Get a random integer
-            int i = static_cast<int>(rng.inRange(0, m_cNeurons));
+            int i = static_cast<int>(m_context.rng.inRange(0, m_cNeurons));
 
             // If the neuron at that index is excitatory and a starter map
             // entry does not already exist, add an entry.
@@ -512,7 +1096,7 @@ vector<neuronType>* Network::getNeuronOrder()
         // Shuffle ordered list into an unordered list
         while (!orderedNeurons.empty())
         {
-            int i = static_cast<int>(rng() * orderedNeurons.size());
+            int i = static_cast<int>(m_context.rng() * orderedNeurons.size());
 
             neuronType t = orderedNeurons[i];
             
@@ -550,8 +1134,8 @@ vector<neuronType>* Network::getNeuronOrder()
 * @param spikesHistory
 * @param Tsim
 */
-void Network::saveSimState(ostream& os, CompleteMatrix& radiiHistory, 
-                           CompleteMatrix& ratesHistory, VectorMatrix& xloc,
+void Network::saveSimState(ostream& os, HistoryStore& radiiHistory, 
+                           HistoryStore& ratesHistory, VectorMatrix& xloc,
                            VectorMatrix& yloc, VectorMatrix& neuronTypes, 
                            VectorMatrix& burstinessHist, VectorMatrix& spikesHistory, FLOAT Tsim, VectorMatrix& neuronThresh)
 {
@@ -561,13 +1145,27 @@ void Network::saveSimState(ostream& os, CompleteMatrix& radiiHistory,
 
     // Write the core state information:
     os << "<SimState>\n";
-    os << "   " << radiiHistory.toXML("radiiHistory") << endl;
-    os << "   " << ratesHistory.toXML("ratesHistory") << endl;
-    os << "   " << burstinessHist.toXML("burstinessHist") << endl;
-    os << "   " << spikesHistory.toXML("spikesHistory") << endl;
-    os << "   " << xloc.toXML("xloc") << endl;
-    os << "   " << yloc.toXML("yloc") << endl;
-    os << "   " << neuronTypes.toXML("neuronTypes") << endl;
+    os << "   ";
+    radiiHistory.writeXML(os, "radiiHistory");
+    os << endl;
+    os << "   ";
+    ratesHistory.writeXML(os, "ratesHistory");
+    os << endl;
+    os << "   ";
+    burstinessHist.toXML(os, "burstinessHist");
+    os << endl;
+    os << "   ";
+    spikesHistory.toXML(os, "spikesHistory");
+    os << endl;
+    os << "   ";
+    xloc.toXML(os, "xloc");
+    os << endl;
+    os << "   ";
+    yloc.toXML(os, "yloc");
+    os << endl;
+    os << "   ";
+    neuronTypes.toXML(os, "neuronTypes");
+    os << endl;
 
     if (m_cStarterNeurons > 0)
     {
@@ -575,11 +1173,15 @@ void Network::saveSimState(ostream& os, CompleteMatrix& radiiHistory,
 
         getStarterNeuronMatrix(starterNeuronsM);
 
-        os << "   " << starterNeuronsM.toXML("starterNeurons") << endl;
+        os << "   ";
+        starterNeuronsM.toXML(os, "starterNeurons");
+        os << endl;
     }
 
     // Write neuron thresold
-    os << "   " << neuronThresh.toXML("neuronThresh") << endl;
+    os << "   ";
+    neuronThresh.toXML(os, "neuronThresh");
+    os << endl;
 
     // write time between growth cycles
     os << "   <Matrix name=\"Tsim\" type=\"complete\" rows=\"1\" columns=\"1\" multiplier=\"1.0\">" << endl;
@@ -588,90 +1190,88 @@ void Network::saveSimState(ostream& os, CompleteMatrix& radiiHistory,
 
     // write simulation end time
     os << "   <Matrix name=\"simulationEndTime\" type=\"complete\" rows=\"1\" columns=\"1\" multiplier=\"1.0\">" << endl;
-    os << "   " << g_simulationStep * m_deltaT << endl;
+    os << "   " << m_context.simulationStep * m_deltaT << endl;
     os << "</Matrix>" << endl;
     os << "</SimState>" << endl;
 }
 
 /**
-* Write the simulation memory image
+* Save current simulation state as a binary state file, with the same matrices as
+* saveSimState(); SimStateReader::toXML() converts it to XML
 *
-* @param os	The filestream to write
+* @param os	The binary output stream
+* @param radiiHistory
+* @param ratesHistory
+* @param xloc
+* @param yloc
+* @param neuronTypes
+* @param burstinessHist
+* @param spikesHistory
+* @param Tsim
+* @param neuronThresh
 */
-void Network::writeSimMemory(ostream& os, CompleteMatrix& radiiHistory, CompleteMatrix& ratesHistory)
+void Network::saveSimStateBinary(ostream& os, HistoryStore& radiiHistory,
+                                 HistoryStore& ratesHistory, VectorMatrix& xloc,
+                                 VectorMatrix& yloc, VectorMatrix& neuronTypes,
+                                 VectorMatrix& burstinessHist, VectorMatrix& spikesHistory, FLOAT Tsim, VectorMatrix& neuronThresh)
 {
-    // write the neurons data
-    os.write(reinterpret_cast<const char*>(&m_cNeurons), sizeof(m_cNeurons));
-    for (int i = 0; i < m_cNeurons; i++)
-    {
-        m_neuronList[i].write(os);
-    }
+    SimStateWriter writer(os, m_fPackOutput);
 
-    // write the synapse data
-    int synapse_count = 0;
-    for (int i = 0; i < m_cNeurons; i++)
-    {
-        synapse_count += m_rgSynapseMap[i].size();
-    }
-    os.write(reinterpret_cast<const char*>(&synapse_count), sizeof(synapse_count));
-    for (int i = 0; i < m_cNeurons; i++)
-    {
-        for (unsigned int j = 0; j < m_rgSynapseMap[i].size(); j++)
-        {
-            m_rgSynapseMap[i][j].write(os);
-        }
-    }
+    radiiHistory.writeBinary(writer, "radiiHistory");
+    ratesHistory.writeBinary(writer, "ratesHistory");
+    writer.writeArray("burstinessHist", SIMSTATE_FLOAT32, burstinessHist);
+    writer.writeArray("spikesHistory", SIMSTATE_FLOAT32, spikesHistory);
+    writer.writeArray("xloc", SIMSTATE_FLOAT32, xloc);
+    writer.writeArray("yloc", SIMSTATE_FLOAT32, yloc);
+    writer.writeArray("neuronTypes", SIMSTATE_INT32, neuronTypes);
 
-    // write the final radii
-    for (int i = 0; i < m_cNeurons; i++)
+    if (m_cStarterNeurons > 0)
     {
-        os.write(reinterpret_cast<const char*>(&radiiHistory(m_si.currentStep, i)), sizeof(FLOAT));
-    }
+        VectorMatrix starterNeuronsM("complete", "const", 1, m_cStarterNeurons);
 
-    // write the final rates
-    for (int i = 0; i < m_cNeurons; i++)
-    {
-        os.write(reinterpret_cast<const char*>(&ratesHistory(m_si.currentStep, i)), sizeof(FLOAT));
+        getStarterNeuronMatrix(starterNeuronsM);
+        writer.writeArray("starterNeurons", SIMSTATE_INT32, starterNeuronsM);
     }
-    os.flush();
+
+    writer.writeArray("neuronThresh", SIMSTATE_FLOAT32, neuronThresh);
+    writer.writeScalar("Tsim", Tsim);
+    writer.writeScalar("simulationEndTime", m_context.simulationStep * m_deltaT);
+    writer.close();
 }
 
 /**
-* Read the simulation memory image
+* Write the simulation memory image, as a Checkpoint
 *
-* @param is	The filestream to read
+* @param os	The filestream to write
+* @param radii	The final radii
+* @param rates	The final rates
+* @param pInputRing	The input ring buffers, or NULL if they are not used
 */
-void Network::readSimMemory(istream& is, VectorMatrix& radii, VectorMatrix& rates)
+void Network::writeSimMemory(ostream& os, VectorMatrix& radii, VectorMatrix& rates, const InputRingBuffer* pInputRing)
 {
-    // read the neuron data
-    int cNeurons;
-    is.read(reinterpret_cast<char*>(&cNeurons), sizeof(cNeurons));
-    assert( cNeurons == m_cNeurons );
-    for (int i = 0; i < m_cNeurons; i++)
-    {
-        m_neuronList[i].read(is);
-    }
+    Checkpoint checkpoint;
 
-    // read the synapse data & create synapses
-    int synapse_count;
-    is.read(reinterpret_cast<char*>(&synapse_count), sizeof(synapse_count));
-    for (int i = 0; i < synapse_count; i++)
-    {
-	// read the synapse data and add it to the list
-        DynamicSpikingSynapse::read(is, m_summationMap, m_width, m_rgSynapseMap);
-    }
-
-    // read the radii
-    for (int i = 0; i < m_cNeurons; i++)
-    {
-        is.read(reinterpret_cast<char*>(&radii[i]), sizeof(FLOAT));
-    }
+    checkpoint.capture(*this, radii, rates);
+#if !defined(USE_GPU)
+    // the GPU simulation keeps its random number generators on the device
+    checkpoint.captureContinuation(*this, pInputRing);
+#endif
+    checkpoint.write(os, m_fPackOutput);
+    os.flush();
+}
 
-    // read the rates
-    for (int i = 0; i < m_cNeurons; i++)
-    {
-        is.read(reinterpret_cast<char*>(&rates[i]), sizeof(FLOAT));
-    }
+/**
+* Read the network of a simulation memory image, a Checkpoint
+*
+* @param file	The mapped file to read
+* @param radii	[out] The radii
+* @param rates	[out] The rates
+* @throws KII_exception if the file is not a checkpoint of this network
+*/
+void Network::readSimMemory(const MappedSimState& file, VectorMatrix& radii, VectorMatrix& rates)
+{
+    Checkpoint::verify(file);
+    Checkpoint::restore(file, *this, radii, rates);
 }
 
 /**
@@ -29,6 +29,22 @@
  ** in their corresponding m_summationMap bin to their \f$V_m\f$ and resets the m_summationMap bin to
  ** zero.
  **
+ ** The neurons, synapse lists and summation points are stored in the same order, which is
+ ** either row-major or along a space-filling curve over the grid (see neuronOrder), so that
+ ** neighboring neurons and their summation points are near each other in memory.
+ ** m_rgStorageIndex maps the row-major index of a neuron to its position in these arrays.
+ ** All other maps, and all inputs and outputs, are in row-major order.  The neurons are advanced,
+ ** and draw their noise, in row-major order too, so the storage order does not change the
+ ** noise of a neuron; only the order in which the synapses add into a summation point
+ ** depends on it, which can change the sums in the last bit.
+ **
+ ** An ensemble (m_cReplicas > 0) reads the network of a memory image and initializes the
+ ** simulation once, and then runs m_cReplicas activity-only replicas of it, each in a child
+ ** process with its own noise and output files (see Ensemble).  The connectivity of the
+ ** replicas is frozen: growth updates measure the rates, but do not change the radii or the
+ ** synapses.  With m_cLanes > 1, each child process runs a batch of replicas in the lanes of
+ ** a LaneSim (simulateLanes()).
+ **
  ** \latexonly \subsubsection*{Credits} \endlatexonly
  ** \htmlonly <h3>Credits</h3> \endhtmlonly
  **
@@ -53,7 +69,18 @@
 #include "GpuSim.h"
 #include "SingleThreadedSim.h"
 #include "MultiThreadedSim.h"
+#include "SpikeRecorder.h"
+#include "SpikeHistogram.h"
+#include "SpikeFileWriter.h"
+#include "GrowthFileWriter.h"
+#include "HistoryStore.h"
+#include "InputRingBuffer.h"
+#include "Matrix/MappedSimState.h"
 #include <vector>
+#include <algorithm>
+
+class OutputPipeline;
+struct RunOutput;
 
 class Network
 {
@@ -62,9 +89,14 @@ public:
 	Network(int rows, int cols, FLOAT inhFrac, FLOAT excFrac, FLOAT startFrac, FLOAT Iinject[2], FLOAT Inoise[2],
 			FLOAT Vthresh[2], FLOAT Vresting[2], FLOAT Vreset[2], FLOAT Vinit[2], FLOAT starter_Vthresh[2],
 			FLOAT starter_Vreset[2], FLOAT m_epsilon, FLOAT m_beta, FLOAT m_rho, FLOAT m_targetRate, FLOAT m_maxRate,
-			FLOAT m_minRadius, FLOAT m_startRadius, FLOAT m_deltaT, ostream& new_outstate, 
-			ostream& new_memoutput, bool fWriteMemImage, istream& new_meminput, bool fReadMemImage, bool fFixedLayout, 
-            		vector<int>* pEndogenouslyActiveNeuronLayout, vector<int>* pInhibitoryNeuronLayout);
+			FLOAT m_minRadius, FLOAT m_startRadius, FLOAT m_deltaT, FLOAT m_conductionVelocity, ostream& new_outstate, 
+			ostream& new_memoutput, bool fWriteMemImage, const string& memInputFileName, bool fReadMemImage, bool fFixedLayout, 
+            		vector<int>* pEndogenouslyActiveNeuronLayout, vector<int>* pInhibitoryNeuronLayout,
+			bool fInputRingBuffers, neuronOrder order, ostream& new_spikeoutput, bool fWriteSpikes,
+			ostream& new_growthoutput, bool fWriteGrowth, const string& historyFileName, bool fBinaryState,
+			bool fPackOutput, const string& checkpointFileName, int checkpointInterval, int checkpointBaseInterval, const string& resumeFileName,
+			int cReplicas, int cLanes, const string& stateOutputFileName, const string& memOutputFileName,
+			const string& spikeOutputFileName, const string& growthOutputFileName);
 	~Network();
 
 	//! Frees dynamically allocated memory associated with the maps.
@@ -77,6 +109,9 @@ public:
 	void initNeurons(FLOAT Iinject[2], FLOAT Inoise[2], FLOAT Vthresh[2], FLOAT Vresting[2], FLOAT Vreset[2],
 			FLOAT Vinit[2], FLOAT starter_Vthresh[2], FLOAT starter_Vreset[2]);
 
+	//! Number the neurons in the storage order.
+	void initStorageOrder();
+
 	//! Initialize entries in the neuron type map from random values
 	void initNeuronTypeMap();
 
@@ -87,19 +122,38 @@ public:
 	vector<neuronType>* getNeuronOrder();
     
 	//! Write the network state to an ostream.
-	void saveSimState(ostream& os, CompleteMatrix& radiiHistory, CompleteMatrix& ratesHistory, VectorMatrix& xloc,
+	void saveSimState(ostream& os, HistoryStore& radiiHistory, HistoryStore& ratesHistory, VectorMatrix& xloc,
 			VectorMatrix& yloc, VectorMatrix& neuronTypes, VectorMatrix& burstinessHist, VectorMatrix& spikesHistory,
 			FLOAT Tsim, VectorMatrix& neuronThresh);
 
-	//! Write the simulation memory image to an ostream
-	void writeSimMemory(ostream& os, CompleteMatrix& radiiHistory, CompleteMatrix& ratesHistory);
+	//! Write the simulation's state as a binary state file.
+	void saveSimStateBinary(ostream& os, HistoryStore& radiiHistory, HistoryStore& ratesHistory, VectorMatrix& xloc,
+			VectorMatrix& yloc, VectorMatrix& neuronTypes, VectorMatrix& burstinessHist, VectorMatrix& spikesHistory,
+			FLOAT Tsim, VectorMatrix& neuronThresh);
+
+	//! Write the simulation memory image (a Checkpoint) to an ostream
+	void writeSimMemory(ostream& os, VectorMatrix& radii, VectorMatrix& rates, const InputRingBuffer* pInputRing);
 
-	//! Read the simulation memory image from an istream
-	void readSimMemory(istream& is, VectorMatrix& radii, VectorMatrix& rates);
+	//! Read the network of a simulation memory image (a Checkpoint) from a mapped file
+	void readSimMemory(const MappedSimState& file, VectorMatrix& radii, VectorMatrix& rates);
 
 	//! Performs the simulation.
 	void simulate(FLOAT growthStepDuration, FLOAT num_growth_steps, int maxFiringRate, int maxSynapsesPerNeuron);
 
+	//! Compute the distances between the neurons of a network of the given size in advance.
+	static NeuronDistances* computeDistances(int cols, int rows);
+
+	//! Runs the replicas of a batch of an ensemble in the lanes of a LaneSim.
+	void simulateLanes(int cLanes, InputRingBuffer* pInputRing, VectorMatrix& radii, VectorMatrix& rates,
+			VectorMatrix& xloc, VectorMatrix& yloc, VectorMatrix& neuronTypes, VectorMatrix& neuronThresh,
+			FLOAT growthStepDuration, FLOAT maxGrowthSteps);
+
+	//! A pipeline for the output written during the simulation, or NULL if there is none.
+	OutputPipeline* createOutputPipeline() const;
+
+	//! Open the output files of the run or of a replica of an ensemble, and the writers that stream them.
+	void openOutput(RunOutput& out, int replica, OutputPipeline* pOutput, FLOAT growthStepDuration);
+
 	//! Output the m_rgNeuronTypeMap to a VectorMatrix.
 	void getNeuronTypes(VectorMatrix& neuronTypes);
 
@@ -163,6 +217,9 @@ public:
 	//! The starting connectivity radius for all neurons.
 	FLOAT m_startRadius;
 
+	//! Axonal conduction velocity (grid units/sec); 0 disables distance-dependent delays.
+	FLOAT m_conductionVelocity;
+
 	//! A file stream for xml output.
 	ostream& state_out;
 
@@ -172,12 +229,60 @@ public:
 	//! True if dumped memory image is written after simulation. 
 	bool m_fWriteMemImage;
 
-	//! An input file stream for memory image 	
-	istream& memory_in;
+	//! The memory image file to read
+	string m_memInputFileName;
 
 	//! True if dumped memory image is read before starting simulation. 
 	bool m_fReadMemImage;
 
+	//! A binary output stream for the spikes (see SpikeFileWriter)
+	ostream& spike_out;
+
+	//! True if the spikes are streamed to spike_out during the simulation.
+	bool m_fWriteSpikes;
+
+	//! A binary output stream for the radii and rates of each growth step (see GrowthFileWriter)
+	ostream& growth_out;
+
+	//! True if the radii and rates are streamed to growth_out during the simulation.
+	bool m_fWriteGrowth;
+
+	//! If not empty, the radii and rates history are kept in the files with this name and .radii/.rates.
+	string m_historyFileName;
+
+	//! True if the state is written as a binary state file instead of XML.
+	bool m_fBinaryState;
+
+	//! True if checkpoints, memory images, binary state files and the spike file are packed (compressed).
+	bool m_fPackOutput;
+
+	//! The file that checkpoints of the running simulation are written to (see CheckpointWriter).
+	string m_checkpointFileName;
+
+	//! Number of growth steps between checkpoints; 0 if no checkpoints are written.
+	int m_checkpointInterval;
+
+	//! Number of checkpoints from one full checkpoint to the next; the others are deltas.
+	int m_checkpointBaseInterval;
+
+	//! If not empty, the simulation is resumed from this checkpoint.
+	string m_resumeFileName;
+
+	//! Number of replicas of an ensemble run on the network of the memory image; 0 if not an ensemble.
+	int m_cReplicas;
+
+	//! Number of replicas of an ensemble a process runs in lockstep (see LaneSim); 1 runs each in a process of its own.
+	int m_cLanes;
+
+	//! The replica of an ensemble this process runs (the first of its batch); -1 in a process that does not run one.
+	int m_replica;
+
+	//! The output files, named for the replicas of an ensemble (see Ensemble::replicaFileName()).
+	string m_stateOutputFileName;
+	string m_memOutputFileName;
+	string m_spikeOutputFileName;
+	string m_growthOutputFileName;
+
 	//! True if a fixed layout has been provided
 	bool m_fFixedLayout;
 
@@ -185,6 +290,27 @@ public:
 
 	vector<int>* m_pInhibitoryNeuronLayout;
 
+	//! True if delayed input is delivered through per-target ring buffers.
+	bool m_fInputRingBuffers;
+
+	//! The order in which neurons are stored in m_neuronList, m_rgSynapseMap and m_summationMap.
+	neuronOrder m_order;
+
+	//! Storage index of each neuron, indexed by its row-major index.
+	int* m_rgStorageIndex;
+
+	//! Row-major index of each neuron, indexed by its storage index.
+	int* m_rgNeuronIndex;
+
+	//! The clock and random number generators of the simulation of this network.
+	SimulationContext m_context;
+
+	//! Number of threads that simulate the network; 0 runs one per core.
+	int m_cThreads;
+
+	//! The distances between the neurons computed in advance (see computeDistances()), or NULL.
+	const NeuronDistances* m_pDistances;
+
 private:
 	// Struct that holds information about a simulation
 	SimulationInfo m_si;
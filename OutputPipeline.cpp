@@ -0,0 +1,187 @@
+/**
+ *	\file OutputPipeline.cpp
+ *
+ *	\brief Writes output blocks to their streams from a background thread.
+ */
+#include "OutputPipeline.h"
+
+/**
+ * Start the writer thread.  If the thread cannot be started, blocks are written
+ * by the producers instead.
+ * @param[in] cMaxQueued	Maximum number of blocks waiting to be written.
+ */
+OutputPipeline::OutputPipeline(size_t cMaxQueued) :
+    m_cMaxQueued(cMaxQueued),
+    m_cQueued(0),
+    m_fClosing(false)
+{
+    assert(m_cMaxQueued > 0);
+
+    m_stats.cBlocks = 0;
+    m_stats.cBytes = 0;
+    m_stats.maxQueued = 0;
+    m_stats.cStalls = 0;
+    m_stats.stallTime = 0;
+
+    if (!m_thread.start(writerThread, this))
+    {
+        cerr << "Warning: cannot start the output writer thread; output is written synchronously" << endl;
+    }
+}
+
+/**
+ * Destructor
+ */
+OutputPipeline::~OutputPipeline()
+{
+    close();
+}
+
+/**
+ * Queue a block to be written to a stream.  Waits while the queue is full.
+ * @param[in] os	The output stream; it must not be written otherwise until the pipeline is closed.
+ * @param[in] pBlock	The block, allocated with new; the pipeline deletes it once written.
+ */
+void OutputPipeline::write(ostream& os, vector<char>* pBlock)
+{
+    Block block;
+    block.pOs = &os;
+    block.pData = pBlock;
+
+    if (!m_thread.running())
+    {
+        {
+            Mutex::Lock lock(m_mutex);
+            m_cQueued++;
+        }
+        writeBlock(block);
+        return;
+    }
+
+    Mutex::Lock lock(m_mutex);
+    assert(!m_fClosing);
+    m_cQueued++;
+    if (m_queue.size() >= m_cMaxQueued)
+    {
+        m_stats.cStalls++;
+        m_stallTimer.start();
+        while (m_queue.size() >= m_cMaxQueued)
+        {
+            m_dequeued.wait(m_mutex);
+        }
+        m_stats.stallTime += m_stallTimer.lap() / 1000000.0;
+    }
+
+    m_queue.push_back(block);
+    if (m_queue.size() > m_stats.maxQueued)
+    {
+        m_stats.maxQueued = m_queue.size();
+    }
+    m_queued.broadcast();
+}
+
+/**
+ * Wait until the writer thread has written all blocks queued so far, e.g. before a
+ * stream that is written through the pipeline is read back.
+ */
+void OutputPipeline::drain()
+{
+    Mutex::Lock lock(m_mutex);
+    while (m_stats.cBlocks < m_cQueued)
+    {
+        m_written.wait(m_mutex);
+    }
+}
+
+/**
+ * Write all queued blocks, then stop the writer thread.
+ */
+void OutputPipeline::close()
+{
+    {
+        Mutex::Lock lock(m_mutex);
+        m_fClosing = true;
+        m_queued.broadcast();
+    }
+    m_thread.join();
+}
+
+/**
+ * @return the back-pressure metrics.
+ */
+OutputStats OutputPipeline::getStats()
+{
+    Mutex::Lock lock(m_mutex);
+    return m_stats;
+}
+
+/**
+ * Print the back-pressure metrics.
+ * @param[in] os	The output stream.
+ */
+void OutputPipeline::printStats(ostream& os)
+{
+    OutputStats stats = getStats();
+
+    os << "output blocks written: " << stats.cBlocks << " (" << stats.cBytes << " bytes)" << endl;
+    os << "output queue max depth: " << stats.maxQueued << " of " << m_cMaxQueued << endl;
+    os << "output stalls: " << stats.cStalls << " (" << stats.stallTime << " s)" << endl;
+}
+
+/**
+ * Entry point of the writer thread.
+ * @param[in] pPipeline	The OutputPipeline.
+ */
+void OutputPipeline::writerThread(void* pPipeline)
+{
+    static_cast<OutputPipeline*>(pPipeline)->writeBlocks();
+}
+
+/**
+ * Write queued blocks, in the order they were queued, until the pipeline is
+ * closed and the queue is empty.
+ */
+void OutputPipeline::writeBlocks()
+{
+    for (;;)
+    {
+        Block block;
+        {
+            Mutex::Lock lock(m_mutex);
+            while (m_queue.empty() && !m_fClosing)
+            {
+                m_queued.wait(m_mutex);
+            }
+            if (m_queue.empty())
+                return;
+
+            block = m_queue.front();
+            m_queue.pop_front();
+            m_dequeued.broadcast();
+        }
+
+        writeBlock(block);
+    }
+}
+
+/**
+ * Write a block to its stream and free it.
+ * @param[in] block	The block.
+ */
+void OutputPipeline::writeBlock(const Block& block)
+{
+    if (!block.pData->empty())
+    {
+        block.pOs->write(&(*block.pData)[0], block.pData->size());
+    }
+    block.pOs->flush();
+
+    {
+        Mutex::Lock lock(m_mutex);
+        m_stats.cBlocks++;
+        m_stats.cBytes += block.pData->size();
+        m_written.broadcast();
+    }
+
+    delete block.pData;
+}
@@ -0,0 +1,137 @@
+/**
+ *	@file OutputPipeline.h
+ *
+ *	@brief Header file for OutputPipeline.
+ */
+//! Writes output blocks to their streams from a background thread.
+
+/**
+ ** \class OutputPipeline OutputPipeline.h "OutputPipeline.h"
+ **
+ ** \latexonly	\subsubsection*{Implementation} \endlatexonly
+ ** \htmlonly	<h3>Implementation</h3> \endhtmlonly
+ **
+ ** Output that is produced while the simulation runs (spike chunks, radii and rates rows) is
+ ** serialized by its producer into a block, an immutable snapshot, which is handed to the
+ ** OutputPipeline together with the stream it goes to.  A writer thread writes the blocks in
+ ** the order they were handed over, so writing the output of a growth cycle overlaps the
+ ** simulation of the next one.  Each block is flushed once written, so an interrupted run keeps
+ ** the output written so far.
+ **
+ ** The queue is bounded: a producer that finds it full waits until the writer has written a
+ ** block (back-pressure), so a slow disk slows the simulation down rather than exhausting the
+ ** memory.  How often and how long producers waited is reported by getStats().
+ **
+ ** If the writer thread cannot be started, blocks are written by the producer.
+ **
+ ** \latexonly	\subsubsection*{Credits} \endlatexonly
+ ** \htmlonly	<h3>Credits</h3> \endhtmlonly
+ **
+ ** This simulator is a rewrite of CSIM (2006) and other work (Stiber and Kawasaki (2007?))
+ **/
+
+#pragma once
+
+#ifndef _OUTPUTPIPELINE_H_
+#define _OUTPUTPIPELINE_H_
+
+#include "global.h"
+#include "Thread.h"
+#include "Timer.h"
+#include <deque>
+
+//! Default maximum number of blocks waiting to be written.
+#define OUTPUT_QUEUE_BLOCKS 64
+
+//! Back-pressure metrics of an OutputPipeline.
+struct OutputStats
+{
+    //! Number of blocks and bytes written.
+    uint64_t cBlocks;
+    uint64_t cBytes;
+
+    //! Largest number of blocks waiting to be written.
+    size_t maxQueued;
+
+    //! Number of times a producer found the queue full, and the time it waited (s).
+    uint64_t cStalls;
+    double stallTime;
+};
+
+class OutputPipeline
+{
+public:
+    //! The constructor for OutputPipeline.
+    OutputPipeline(size_t cMaxQueued = OUTPUT_QUEUE_BLOCKS);
+    ~OutputPipeline();
+
+    //! Queue a block to be written to a stream.
+    void write(ostream& os, vector<char>* pBlock);
+
+    //! Wait until all queued blocks have been written.
+    void drain();
+
+    //! Write all queued blocks and stop the writer thread.
+    void close();
+
+    //! Get the back-pressure metrics.
+    OutputStats getStats();
+
+    //! Print the back-pressure metrics.
+    void printStats(ostream& os);
+
+private:
+    //! A block and the stream it is written to.
+    struct Block
+    {
+        ostream* pOs;
+        vector<char>* pData;
+    };
+
+    //! Entry point of the writer thread.
+    static void writerThread(void* pPipeline);
+
+    //! Write queued blocks until the pipeline is closed.
+    void writeBlocks();
+
+    //! Write a block to its stream and free it.
+    void writeBlock(const Block& block);
+
+    //! Maximum number of blocks waiting to be written.
+    size_t m_cMaxQueued;
+
+    //! Blocks waiting to be written.
+    std::deque<Block> m_queue;
+
+    //! Protects m_queue, m_fClosing, m_cQueued and m_stats.
+    Mutex m_mutex;
+
+    //! Signaled when a block is queued or the pipeline is closed.
+    Condition m_queued;
+
+    //! Signaled when a block is taken from the queue.
+    Condition m_dequeued;
+
+    //! Signaled when a block has been written.
+    Condition m_written;
+
+    //! Number of blocks handed to the pipeline.
+    uint64_t m_cQueued;
+
+    //! True once close() has been called.
+    bool m_fClosing;
+
+    //! The back-pressure metrics.
+    OutputStats m_stats;
+
+    //! Measures how long producers wait.
+    Timer m_stallTimer;
+
+    //! The writer thread.
+    Thread m_thread;
+
+    OutputPipeline(const OutputPipeline&);
+    OutputPipeline& operator=(const OutputPipeline&);
+};
+
+#endif // _OUTPUTPIPELINE_H_
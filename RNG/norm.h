@@ -68,7 +68,7 @@ public:
     @param seed seed for random number generator
   */
   Norm(FLOAT m = 0.0, FLOAT s = 1.0, unsigned long seed = 0)
-    : RNG(seed), odd(true), mu(m), sigma(s) {}
+    : RNG(seed), odd(true), X2(0), mu(m), sigma(s) {}
 
   /*!
     This method makes instances functors; it returns normally
@@ -76,6 +76,34 @@ public:
     @return pseudorandom number drawn from a normal distribution.
   */
   virtual FLOAT operator() (void);
+
+  /*!
+    Saves the state of the generator, including the second number
+    of the last pair, so that a generator that loads it continues
+    the same sequence.
+    @param saveArray receives the state of the uniform generator (SAVE values)
+    @param fOdd receives which of the pair was last returned
+    @param x2 receives the second number of the pair
+  */
+  void saveState(uint32* saveArray, bool& fOdd, FLOAT& x2) const
+    { save(saveArray); fOdd = odd; x2 = X2; }
+
+  /*!
+    Loads a state saved by saveState().
+    @param loadArray the state of the uniform generator (SAVE values)
+    @param fOdd which of the pair was last returned
+    @param x2 the second number of the pair
+  */
+  void loadState(uint32* const loadArray, bool fOdd, FLOAT x2)
+    { load(loadArray); odd = fOdd; X2 = x2; }
+
+  /*!
+    Restarts the sequence from a new seed.
+    @param newSeed the seed
+  */
+  void reseed(uint32 newSeed)
+    { seed(newSeed); odd = true; }
+
 private:
   // Additional state information
 
@@ -0,0 +1,568 @@
+/**
+ *	\file SimStateFile.cpp
+ *
+ *	\brief Binary simulation state files, and their conversion to the XML state format.
+ */
+#include "SimStateFile.h"
+#include "Crc32.h"
+#include "BlockCodec.h"
+#include "MatrixXmlWriter.h"
+#include <cstring>
+
+/**
+ * Write the file header.
+ * @param[in] os	The binary output stream.
+ * @param[in] fPack	True to pack the arrays.
+ */
+SimStateWriter::SimStateWriter(ostream& os, bool fPack) :
+    m_os(os),
+    m_fPack(fPack),
+    m_offset(0),
+    m_fInArray(false),
+    m_cValuesLeft(0)
+{
+    uint32_t version = m_fPack ? SIMSTATE_FILE_VERSION : SIMSTATE_UNPACKED_VERSION;
+    uint32_t alignment = SIMSTATE_ALIGNMENT;
+    uint32_t chunkBytes = SIMSTATE_CHUNK_BYTES;
+
+    writeBytes(SimStateFormat::magic, sizeof(SimStateFormat::magic));
+    writeBytes(&version, sizeof(version));
+    writeBytes(&alignment, sizeof(alignment));
+    writeBytes(&chunkBytes, sizeof(chunkBytes));
+    pad();
+
+    m_chunk.reserve(SIMSTATE_CHUNK_BYTES);
+}
+
+/**
+ * Start an array.  Exactly cRows * cColumns values must be written before endArray().
+ * @param[in] name	Name of the array; at most SIMSTATE_NAME_CHARS - 1 characters.
+ * @param[in] type	Type the values are stored as.
+ * @param[in] layout	How the array is written in the XML state format.
+ * @param[in] cRows	Number of rows.
+ * @param[in] cColumns	Number of columns.
+ */
+void SimStateWriter::beginArray(const string& name, simStateType type, simStateLayout layout, int cRows, int cColumns)
+{
+    assert(!m_fInArray);
+    assert(name.size() < SIMSTATE_NAME_CHARS);
+
+    pad();
+
+    SimStateArray array;
+    array.name = name;
+    array.type = type;
+    array.layout = layout;
+    array.cRows = cRows;
+    array.cColumns = cColumns;
+    array.offset = m_offset;
+    array.cBytes = 0;
+    array.encoding = m_fPack ? SIMSTATE_PACKED : SIMSTATE_RAW;
+    m_arrays.push_back(array);
+
+    m_fInArray = true;
+    m_cValuesLeft = static_cast<uint64_t>(cRows) * cColumns;
+}
+
+/**
+ * Append values to the current array, converted to its type.
+ * @param[in] rgValues	The values.
+ * @param[in] cValues	Number of values.
+ */
+void SimStateWriter::writeValues(const FLOAT* rgValues, size_t cValues)
+{
+    assert(m_fInArray && cValues <= m_cValuesLeft);
+    assert(m_arrays.back().type == SIMSTATE_FLOAT32 || m_arrays.back().type == SIMSTATE_INT32);
+
+    bool fInt = m_arrays.back().type == SIMSTATE_INT32;
+    for (size_t i = 0; i < cValues; i++)
+    {
+        char bytes[4];
+        if (fInt)
+        {
+            int32_t value = static_cast<int32_t>(rgValues[i]);
+            memcpy(bytes, &value, sizeof(bytes));
+        }
+        else
+        {
+            float value = rgValues[i];
+            memcpy(bytes, &value, sizeof(bytes));
+        }
+        m_chunk.insert(m_chunk.end(), bytes, bytes + sizeof(bytes));
+
+        if (m_chunk.size() == SIMSTATE_CHUNK_BYTES)
+        {
+            writeChunks(&m_chunk[0], m_chunk.size());
+            m_chunk.clear();
+        }
+    }
+    m_cValuesLeft -= cValues;
+}
+
+/**
+ * Append values to the current array as they are, in blocks of up to a chunk.  The whole
+ * chunks among them are written straight from the values, several at a time.
+ * @param[in] pValues	The values, of the type of the array (see SimStateFormat::valueBytes()).
+ * @param[in] cValues	Number of values.
+ */
+void SimStateWriter::writeRaw(const void* pValues, size_t cValues)
+{
+    assert(m_fInArray && cValues <= m_cValuesLeft);
+
+    const char* p = static_cast<const char*>(pValues);
+    size_t cBytes = cValues * SimStateFormat::valueBytes(m_arrays.back().type);
+    while (cBytes > 0)
+    {
+        if (m_chunk.empty() && cBytes >= SIMSTATE_CHUNK_BYTES)
+        {
+            size_t cWhole = (cBytes / SIMSTATE_CHUNK_BYTES) * SIMSTATE_CHUNK_BYTES;
+            writeChunks(p, cWhole);
+            p += cWhole;
+            cBytes -= cWhole;
+            continue;
+        }
+
+        size_t cCopy = min(cBytes, SIMSTATE_CHUNK_BYTES - m_chunk.size());
+        m_chunk.insert(m_chunk.end(), p, p + cCopy);
+        p += cCopy;
+        cBytes -= cCopy;
+
+        if (m_chunk.size() == SIMSTATE_CHUNK_BYTES)
+        {
+            writeChunks(&m_chunk[0], m_chunk.size());
+            m_chunk.clear();
+        }
+    }
+    m_cValuesLeft -= cValues;
+}
+
+/**
+ * Finish the current array.
+ */
+void SimStateWriter::endArray()
+{
+    assert(m_fInArray && m_cValuesLeft == 0);
+
+    if (!m_chunk.empty())
+    {
+        writeChunks(&m_chunk[0], m_chunk.size());
+        m_chunk.clear();
+    }
+    m_fInArray = false;
+}
+
+/**
+ * Write a vector as an array with one row, in the layout of VectorMatrix::toXML().
+ * @param[in] name	Name of the array.
+ * @param[in] type	Type the values are stored as.
+ * @param[in] values	The values.
+ */
+void SimStateWriter::writeArray(const string& name, simStateType type, const VectorMatrix& values)
+{
+    beginArray(name, type, SIMSTATE_VECTOR, 1, values.Size());
+    if (values.Size() > 0)
+    {
+        writeValues(&values[0], values.Size());
+    }
+    endArray();
+}
+
+/**
+ * Write a single value, as a float.
+ * @param[in] name	Name of the array.
+ * @param[in] value	The value.
+ */
+void SimStateWriter::writeScalar(const string& name, FLOAT value)
+{
+    beginArray(name, SIMSTATE_FLOAT32, SIMSTATE_SCALAR, 1, 1);
+    writeValues(&value, 1);
+    endArray();
+}
+
+/**
+ * Write the directory and the trailer, and flush the stream.
+ */
+void SimStateWriter::close()
+{
+    assert(!m_fInArray);
+
+    pad();
+    uint64_t dirOffset = m_offset;
+
+    vector<char> dir;
+    for (size_t i = 0; i < m_arrays.size(); i++)
+    {
+        const SimStateArray& array = m_arrays[i];
+        char name[SIMSTATE_NAME_CHARS];
+        uint32_t type = array.type;
+        uint32_t layout = array.layout;
+        uint32_t cChunks = array.rgChunkCrc.size();
+        uint32_t encoding = array.encoding;
+
+        memset(name, 0, sizeof(name));
+        strncpy(name, array.name.c_str(), sizeof(name) - 1);
+        dir.insert(dir.end(), name, name + sizeof(name));
+        dir.insert(dir.end(), reinterpret_cast<const char*>(&type),
+                reinterpret_cast<const char*>(&type) + sizeof(type));
+        dir.insert(dir.end(), reinterpret_cast<const char*>(&layout),
+                reinterpret_cast<const char*>(&layout) + sizeof(layout));
+        dir.insert(dir.end(), reinterpret_cast<const char*>(&array.cRows),
+                reinterpret_cast<const char*>(&array.cRows) + sizeof(array.cRows));
+        dir.insert(dir.end(), reinterpret_cast<const char*>(&array.cColumns),
+                reinterpret_cast<const char*>(&array.cColumns) + sizeof(array.cColumns));
+        dir.insert(dir.end(), reinterpret_cast<const char*>(&array.offset),
+                reinterpret_cast<const char*>(&array.offset) + sizeof(array.offset));
+        dir.insert(dir.end(), reinterpret_cast<const char*>(&array.cBytes),
+                reinterpret_cast<const char*>(&array.cBytes) + sizeof(array.cBytes));
+        dir.insert(dir.end(), reinterpret_cast<const char*>(&cChunks),
+                reinterpret_cast<const char*>(&cChunks) + sizeof(cChunks));
+        if (m_fPack)
+        {
+            dir.insert(dir.end(), reinterpret_cast<const char*>(&encoding),
+                    reinterpret_cast<const char*>(&encoding) + sizeof(encoding));
+        }
+        if (cChunks > 0)
+        {
+            dir.insert(dir.end(), reinterpret_cast<const char*>(&array.rgChunkCrc[0]),
+                    reinterpret_cast<const char*>(&array.rgChunkCrc[0]) + cChunks * sizeof(uint32_t));
+        }
+        if (array.encoding == SIMSTATE_PACKED && cChunks > 0)
+        {
+            dir.insert(dir.end(), reinterpret_cast<const char*>(&array.rgPackedBytes[0]),
+                    reinterpret_cast<const char*>(&array.rgPackedBytes[0]) + cChunks * sizeof(uint32_t));
+        }
+    }
+
+    uint32_t cArrays = m_arrays.size();
+    uint32_t dirCrc = crc32(dir.empty() ? NULL : &dir[0], dir.size());
+    if (!dir.empty())
+    {
+        writeBytes(&dir[0], dir.size());
+    }
+    writeBytes(&dirOffset, sizeof(dirOffset));
+    writeBytes(&cArrays, sizeof(cArrays));
+    writeBytes(&dirCrc, sizeof(dirCrc));
+    writeBytes(SimStateFormat::magic, sizeof(SimStateFormat::magic));
+
+    m_os.flush();
+}
+
+/**
+ * Write chunks of the current array and record their checksums.  The chunks are
+ * checksummed, and packed if the writer packs, independently of each other, so several
+ * at a time.
+ * @param[in] pData	The values of the chunks.
+ * @param[in] cBytes	Size of the values; only the last chunk may be shorter than SIMSTATE_CHUNK_BYTES.
+ */
+void SimStateWriter::writeChunks(const char* pData, size_t cBytes)
+{
+    SimStateArray& array = m_arrays.back();
+    size_t cValueBytes = SimStateFormat::valueBytes(array.type);
+    int cChunks = static_cast<int>((cBytes + SIMSTATE_CHUNK_BYTES - 1) / SIMSTATE_CHUNK_BYTES);
+    size_t first = array.rgChunkCrc.size();
+
+    array.rgChunkCrc.resize(first + cChunks);
+    if (m_fPack)
+    {
+        array.rgPackedBytes.resize(first + cChunks);
+        if (m_rgPacked.size() < static_cast<size_t>(cChunks))
+        {
+            m_rgPacked.resize(cChunks);
+        }
+    }
+
+#ifdef USE_OMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int i = 0; i < cChunks; i++)
+    {
+        const char* pChunk = pData + static_cast<size_t>(i) * SIMSTATE_CHUNK_BYTES;
+        size_t cChunkBytes = min(static_cast<size_t>(SIMSTATE_CHUNK_BYTES), cBytes - static_cast<size_t>(i) * SIMSTATE_CHUNK_BYTES);
+
+        array.rgChunkCrc[first + i] = crc32(pChunk, cChunkBytes);
+        if (m_fPack)
+        {
+            m_rgPacked[i].clear();
+            packBlock(pChunk, cChunkBytes, cValueBytes, m_rgPacked[i]);
+        }
+    }
+
+    for (int i = 0; i < cChunks; i++)
+    {
+        const char* pChunk = pData + static_cast<size_t>(i) * SIMSTATE_CHUNK_BYTES;
+        size_t cChunkBytes = min(static_cast<size_t>(SIMSTATE_CHUNK_BYTES), cBytes - static_cast<size_t>(i) * SIMSTATE_CHUNK_BYTES);
+
+        // a chunk that does not get smaller is stored as it is
+        if (m_fPack && m_rgPacked[i].size() < cChunkBytes)
+        {
+            writeBytes(&m_rgPacked[i][0], m_rgPacked[i].size());
+            array.rgPackedBytes[first + i] = m_rgPacked[i].size();
+        }
+        else
+        {
+            writeBytes(pChunk, cChunkBytes);
+            if (m_fPack)
+            {
+                array.rgPackedBytes[first + i] = cChunkBytes;
+            }
+        }
+    }
+    array.cBytes += cBytes;
+}
+
+/**
+ * Write zeros up to the next multiple of SIMSTATE_ALIGNMENT.
+ */
+void SimStateWriter::pad()
+{
+    static const char zeros[SIMSTATE_ALIGNMENT] = { 0 };
+
+    size_t cPad = (SIMSTATE_ALIGNMENT - m_offset % SIMSTATE_ALIGNMENT) % SIMSTATE_ALIGNMENT;
+    writeBytes(zeros, cPad);
+}
+
+/**
+ * @param[in] pData	The bytes.
+ * @param[in] cBytes	Number of bytes.
+ */
+void SimStateWriter::writeBytes(const void* pData, size_t cBytes)
+{
+    m_os.write(static_cast<const char*>(pData), cBytes);
+    m_offset += cBytes;
+}
+
+/**
+ * Read the header and the directory of a binary state file.
+ * @param[in] is	The binary input stream; it must support seeking.
+ * @throws KII_exception if the stream is not a valid binary state file.
+ */
+SimStateReader::SimStateReader(istream& is) :
+    m_is(is),
+    m_chunkBytes(0),
+    m_pChunkArray(NULL),
+    m_iChunk(0)
+{
+    char header[SIMSTATE_ALIGNMENT];
+    char trailer[SIMSTATE_TRAILER_BYTES];
+
+    m_is.seekg(0, ios::end);
+    uint64_t cFileBytes = m_is.tellg();
+    if (!m_is || cFileBytes < SIMSTATE_ALIGNMENT + SIMSTATE_TRAILER_BYTES)
+    {
+        throw KII_exception("Truncated binary simulation state file");
+    }
+
+    m_is.seekg(0);
+    m_is.read(header, sizeof(header));
+    m_is.seekg(cFileBytes - SIMSTATE_TRAILER_BYTES);
+    m_is.read(trailer, sizeof(trailer));
+    if (!m_is)
+    {
+        throw KII_exception("Failed reading the binary simulation state file");
+    }
+    uint32_t version = 0;
+    m_chunkBytes = SimStateFormat::parseHeader(header, version);
+
+    // the trailer locates the directory
+    uint32_t cArrays = 0;
+    uint32_t dirCrc = 0;
+    uint64_t dirOffset = SimStateFormat::parseTrailer(trailer, cFileBytes, cArrays, dirCrc);
+
+    vector<char> dir(cFileBytes - SIMSTATE_TRAILER_BYTES - dirOffset);
+    m_is.seekg(dirOffset);
+    if (!dir.empty())
+    {
+        m_is.read(&dir[0], dir.size());
+    }
+    if (!m_is)
+    {
+        throw KII_exception("Failed reading the binary simulation state file");
+    }
+    SimStateFormat::parseDirectory(dir.empty() ? NULL : &dir[0], dir.size(), cArrays, dirCrc,
+            version, m_chunkBytes, dirOffset, m_arrays);
+}
+
+/**
+ * @param[in] name	Name of the array.
+ * @return the array, or NULL if the file has no array with that name.
+ */
+const SimStateArray* SimStateReader::find(const string& name) const
+{
+    for (size_t i = 0; i < m_arrays.size(); i++)
+    {
+        if (m_arrays[i].name == name)
+            return &m_arrays[i];
+    }
+    return NULL;
+}
+
+/**
+ * Read values of an array, in row-major order, converted to FLOAT.
+ * @param[in] array	The array; one of arrays().
+ * @param[in] first	Index of the first value.
+ * @param[in] cValues	Number of values.
+ * @param[out] rgValues	Receives the values.
+ * @throws KII_exception if the values cannot be read or a chunk is corrupt.
+ */
+void SimStateReader::readValues(const SimStateArray& array, uint64_t first, size_t cValues, FLOAT* rgValues)
+{
+    size_t cValueBytes = SimStateFormat::valueBytes(array.type);
+    assert((first + cValues) * cValueBytes <= array.cBytes);
+
+    for (size_t i = 0; i < cValues; i++)
+    {
+        uint64_t pos = (first + i) * cValueBytes;
+        size_t chunk = pos / m_chunkBytes;
+        if (m_pChunkArray != &array || m_iChunk != chunk)
+        {
+            loadChunk(array, chunk);
+        }
+
+        const char* p = &m_chunk[pos - static_cast<uint64_t>(chunk) * m_chunkBytes];
+        switch (array.type)
+        {
+        case SIMSTATE_INT32:
+            {
+                int32_t value;
+                memcpy(&value, p, sizeof(value));
+                rgValues[i] = static_cast<FLOAT>(value);
+            }
+            break;
+
+        case SIMSTATE_UINT32:
+            {
+                uint32_t value;
+                memcpy(&value, p, sizeof(value));
+                rgValues[i] = static_cast<FLOAT>(value);
+            }
+            break;
+
+        case SIMSTATE_UINT64:
+            {
+                uint64_t value;
+                memcpy(&value, p, sizeof(value));
+                rgValues[i] = static_cast<FLOAT>(value);
+            }
+            break;
+
+        default:
+            {
+                float value;
+                memcpy(&value, p, sizeof(value));
+                rgValues[i] = value;
+            }
+            break;
+        }
+    }
+}
+
+/**
+ * Write the file in the XML state format, exactly as Network::saveSimState() writes
+ * the same state.
+ * @param[in] os	The output stream.
+ * @throws KII_exception if the values cannot be read or a chunk is corrupt.
+ */
+void SimStateReader::toXML(ostream& os)
+{
+    os << "<?xml version=\"1.0\" standalone=\"no\"?>\n" << "<!-- State output file for the DCT growth modeling-->\n";
+    os << "<SimState>\n";
+
+    for (size_t i = 0; i < m_arrays.size(); i++)
+    {
+        const SimStateArray& array = m_arrays[i];
+
+        if (array.layout == SIMSTATE_SCALAR)
+        {
+            FLOAT value;
+            char buf[XML_VALUE_CHARS];
+
+            readValues(array, 0, 1, &value);
+            os << "   <Matrix name=\"" << array.name << "\" type=\"complete\" rows=\"1\" columns=\"1\" multiplier=\"1.0\">" << endl;
+            os << "   ";
+            os.write(buf, MatrixXmlWriter::formatValue(value, buf));
+            os << endl;
+            os << "</Matrix>" << endl;
+            continue;
+        }
+
+        os << "   <Matrix ";
+        if (array.name != "")
+            os << "name=\"" << array.name << "\" ";
+        os << "type=\"complete\" rows=\"" << array.cRows
+           << "\" columns=\"" << array.cColumns
+           << "\" multiplier=\"1.0\">" << endl;
+        os << "   ";
+
+        // convert a bounded number of values at a time
+        if (array.layout == SIMSTATE_ROWS)
+        {
+            int cBatchRows = max(1, min(array.cRows, static_cast<int>(XML_SEGMENT_VALUES / max(1, array.cColumns))));
+            vector<FLOAT> rows(static_cast<size_t>(cBatchRows) * array.cColumns);
+            vector<const FLOAT*> rgRows(cBatchRows);
+            for (int r = 0; r < cBatchRows; r++)
+            {
+                rgRows[r] = rows.empty() ? NULL : &rows[static_cast<size_t>(r) * array.cColumns];
+            }
+
+            for (int first = 0; first < array.cRows; first += cBatchRows)
+            {
+                int cRows = min(cBatchRows, array.cRows - first);
+                if (!rows.empty())
+                {
+                    readValues(array, static_cast<uint64_t>(first) * array.cColumns,
+                            static_cast<size_t>(cRows) * array.cColumns, &rows[0]);
+                }
+                MatrixXmlWriter::writeValues(os, &rgRows[0], cRows, array.cColumns, true);
+            }
+        }
+        else
+        {
+            uint64_t cValues = static_cast<uint64_t>(array.cRows) * array.cColumns;
+            vector<FLOAT> values(min(cValues, static_cast<uint64_t>(XML_SEGMENT_VALUES)));
+            for (uint64_t first = 0; first < cValues; first += values.size())
+            {
+                int cBatch = static_cast<int>(min(cValues - first, static_cast<uint64_t>(values.size())));
+                const FLOAT* rgValues = &values[0];
+                readValues(array, first, cBatch, &values[0]);
+                MatrixXmlWriter::writeValues(os, &rgValues, 1, cBatch, false);
+            }
+        }
+
+        os << endl;
+        os << "</Matrix>" << endl;
+    }
+
+    os << "</SimState>" << endl;
+}
+
+/**
+ * Read a chunk of an array, unpack it if it is packed, and check its CRC-32.
+ * @param[in] array	The array.
+ * @param[in] chunk	Index of the chunk.
+ * @throws KII_exception if the chunk cannot be read or is corrupt.
+ */
+void SimStateReader::loadChunk(const SimStateArray& array, size_t chunk)
+{
+    assert(chunk < array.rgChunkCrc.size());
+
+    size_t cStoredBytes = 0;
+    uint64_t offset = SimStateFormat::chunkOffset(array, m_chunkBytes, chunk, cStoredBytes);
+    m_chunk.resize(SimStateFormat::chunkValueBytes(array, m_chunkBytes, chunk));
+    m_stored.resize(cStoredBytes);
+    m_pChunkArray = NULL;
+
+    m_is.seekg(offset);
+    m_is.read(&m_stored[0], m_stored.size());
+    if (!m_is)
+    {
+        throw KII_exception("Failed reading the binary simulation state file");
+    }
+    if (!SimStateFormat::unpackChunk(array, m_chunkBytes, chunk, &m_stored[0], &m_chunk[0])
+            || !SimStateFormat::checkChunk(array, m_chunkBytes, chunk, &m_chunk[0]))
+    {
+        throw KII_exception("Checksum mismatch in array " + array.name + " of the binary simulation state file");
+    }
+
+    m_pChunkArray = &array;
+    m_iChunk = chunk;
+}
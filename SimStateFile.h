@@ -0,0 +1,158 @@
+/**
+ *	@file SimStateFile.h
+ *
+ *	@brief Header file for SimStateWriter and SimStateReader.
+ */
+//! Binary simulation state files, and their conversion to the XML state format.
+
+/**
+ ** \class SimStateWriter SimStateFile.h "SimStateFile.h"
+ **
+ ** \latexonly	\subsubsection*{Implementation} \endlatexonly
+ ** \htmlonly	<h3>Implementation</h3> \endhtmlonly
+ **
+ ** A SimStateWriter writes the same matrices as the \<SimState\> XML written by
+ ** Network::saveSimState() to a binary state file, as named, typed arrays of values.  The
+ ** layout of the file is described in SimStateFormat.h.  The values of each array are passed
+ ** to the writer as they are produced and written chunk by chunk, and the directory is
+ ** written last, so the whole state never has to be held in memory.
+ **
+ ** A writer that packs its arrays packs each chunk with packBlock(); a chunk that does not get
+ ** smaller is written as it is.  The whole chunks passed to writeRaw() at once are checksummed
+ ** and packed in parallel when the simulator is built with OpenMP.
+ **
+ ** \class SimStateReader SimStateFile.h "SimStateFile.h"
+ **
+ ** \latexonly	\subsubsection*{Implementation} \endlatexonly
+ ** \htmlonly	<h3>Implementation</h3> \endhtmlonly
+ **
+ ** A SimStateReader reads the directory of a binary state file, and the values of its arrays
+ ** one chunk at a time; each chunk is unpacked, if it is packed, and checked against its CRC-32
+ ** as it is read.  toXML() writes the file as the \<SimState\> XML that Network::saveSimState()
+ ** would have written, so that existing tools can read the state of a simulation that wrote a
+ ** binary file.
+ **
+ ** \latexonly	\subsubsection*{Credits} \endlatexonly
+ ** \htmlonly	<h3>Credits</h3> \endhtmlonly
+ **
+ ** This simulator is a rewrite of CSIM (2006) and other work (Stiber and Kawasaki (2007?))
+ **/
+
+#pragma once
+
+#ifndef _SIMSTATEFILE_H_
+#define _SIMSTATEFILE_H_
+
+#include "global.h"
+#include "Matrix/VectorMatrix.h"
+#include "Matrix/SimStateFormat.h"
+
+class SimStateWriter
+{
+public:
+    //! The constructor for SimStateWriter.
+    SimStateWriter(ostream& os, bool fPack = false);
+
+    //! Start an array; its values are passed to writeValues().
+    void beginArray(const string& name, simStateType type, simStateLayout layout, int cRows, int cColumns);
+
+    //! Append values to the current array.
+    void writeValues(const FLOAT* rgValues, size_t cValues);
+
+    //! Append values, already of the type of the current array.
+    void writeRaw(const void* pValues, size_t cValues);
+
+    //! Finish the current array.
+    void endArray();
+
+    //! Write a vector as an array with one row.
+    void writeArray(const string& name, simStateType type, const VectorMatrix& values);
+
+    //! Write a single value.
+    void writeScalar(const string& name, FLOAT value);
+
+    //! Write the directory and the trailer.
+    void close();
+
+private:
+    //! Write chunks of the current array and record their checksums.
+    void writeChunks(const char* pData, size_t cBytes);
+
+    //! Write zeros up to the next multiple of SIMSTATE_ALIGNMENT.
+    void pad();
+
+    //! Write bytes and advance the offset.
+    void writeBytes(const void* pData, size_t cBytes);
+
+    //! The output stream.
+    ostream& m_os;
+
+    //! True if the arrays are packed.
+    bool m_fPack;
+
+    //! Number of bytes written.
+    uint64_t m_offset;
+
+    //! The arrays written so far; the last one is the current array.
+    vector<SimStateArray> m_arrays;
+
+    //! True between beginArray() and endArray().
+    bool m_fInArray;
+
+    //! Number of values of the current array not yet written.
+    uint64_t m_cValuesLeft;
+
+    //! Values of the current chunk.
+    vector<char> m_chunk;
+
+    //! The packed chunks being written.
+    vector<vector<char> > m_rgPacked;
+
+    SimStateWriter(const SimStateWriter&);
+    SimStateWriter& operator=(const SimStateWriter&);
+};
+
+class SimStateReader
+{
+public:
+    //! The constructor for SimStateReader.
+    SimStateReader(istream& is);
+
+    //! The arrays of the file, in the order they were written.
+    const vector<SimStateArray>& arrays() const { return m_arrays; }
+
+    //! Find an array by name.
+    const SimStateArray* find(const string& name) const;
+
+    //! Read values of an array, converted to FLOAT.
+    void readValues(const SimStateArray& array, uint64_t first, size_t cValues, FLOAT* rgValues);
+
+    //! Write the file in the XML state format.
+    void toXML(ostream& os);
+
+private:
+    //! Read and check a chunk of an array.
+    void loadChunk(const SimStateArray& array, size_t chunk);
+
+    //! The input stream.
+    istream& m_is;
+
+    //! Size of a chunk (bytes).
+    uint32_t m_chunkBytes;
+
+    //! The directory.
+    vector<SimStateArray> m_arrays;
+
+    //! The last chunk read, and the array and index it belongs to.
+    vector<char> m_chunk;
+    const SimStateArray* m_pChunkArray;
+    size_t m_iChunk;
+
+    //! The chunk as it is stored, if it is packed.
+    vector<char> m_stored;
+
+    SimStateReader(const SimStateReader&);
+    SimStateReader& operator=(const SimStateReader&);
+};
+
+#endif // _SIMSTATEFILE_H_
@@ -0,0 +1,47 @@
+/**
+ **	@file SimStateToXml.cpp
+ **  Converts a binary simulation state file, written with "-f binary", to the
+ **  \<SimState\> XML that braingrid writes by default.\n
+ **  Usage: simstate2xml statefile [xmlfile]\n
+ **  The XML is written to standard output if no xmlfile is given.
+ **/
+
+#include <iostream>
+#include <fstream>
+
+#include "global.h"
+#include "SimStateFile.h"
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+	if (argc < 2 || argc > 3) {
+		cerr << "Usage: " << argv[0] << " statefile [xmlfile]" << endl;
+		return EXIT_FAILURE;
+	}
+
+	ifstream state_in( argv[1], ifstream::in | ifstream::binary );
+	if (!state_in.is_open()) {
+		cerr << "Cannot open " << argv[1] << endl;
+		return EXIT_FAILURE;
+	}
+
+	ofstream xml_out;
+	if (argc == 3) {
+		xml_out.open( argv[2] );
+		if (!xml_out.is_open()) {
+			cerr << "Cannot open " << argv[2] << endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	try {
+		SimStateReader reader( state_in );
+		reader.toXML( argc == 3 ? static_cast<ostream&>(xml_out) : cout );
+	} catch (const KII_exception& e) {
+		cerr << "Failure converting " << argv[1] << ":\n\t" << e.what( ) << endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
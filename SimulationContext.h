@@ -0,0 +1,84 @@
+/**
+ *      @file SimulationContext.h
+ *
+ *      @brief Header file for SimulationContext.
+ */
+//! The mutable state of a simulation that is not part of its network.
+
+/**
+ ** \class SimulationContext SimulationContext.h "SimulationContext.h"
+ **
+ ** \latexonly  \subsubsection*{Implementation} \endlatexonly
+ ** \htmlonly   <h3>Implementation</h3> \endhtmlonly
+ **
+ ** The SimulationContext holds the clock and the random number generators of one simulation.
+ ** Each Network has its own, and passes it to its simulator through SimulationInfo::pContext;
+ ** the neurons and synapses are given the time step and the noise generator they use by the
+ ** simulator.  Nothing that changes while a network is built or simulated is kept in process
+ ** globals, so several networks can be simulated at the same time, on threads of one process.
+ **
+ ** \latexonly  \subsubsection*{Credits} \endlatexonly
+ ** \htmlonly   <h3>Credits</h3> \endhtmlonly
+ **
+ ** This simulator is a rewrite of CSIM (2006) and other work (Stiber and Kawasaki (2007?))
+ **/
+
+#pragma once
+
+#ifndef _SIMULATIONCONTEXT_H_
+#define _SIMULATIONCONTEXT_H_
+
+#include "global.h"
+
+struct SimulationContext
+{
+    SimulationContext() :
+        simulationStep(0),
+        rng(1),
+        deviceId(0),
+        cClippedDelays(0)
+    {
+    }
+
+    ~SimulationContext()
+    {
+        clearNormrnd();
+    }
+
+    //! Create a normalized random number generator for each of cThreads threads.
+    void initNormrnd(int cThreads)
+    {
+        clearNormrnd();
+        for (int i = 0; i < cThreads; i++)
+            rgNormrnd.push_back(new Norm(0, 1, 1));
+    }
+
+    //! Delete the normalized random number generators.
+    void clearNormrnd()
+    {
+        for (unsigned int i = 0; i < rgNormrnd.size(); i++)
+            delete rgNormrnd[i];
+        rgNormrnd.clear();
+    }
+
+    //! The current simulation step.
+    uint64_t simulationStep;
+
+    //! A random number generator (the layout and the parameters of the neurons).
+    RNG rng;
+
+    //! A normalized random number generator for each thread (the noise of the neurons).
+    vector<Norm*> rgNormrnd;
+
+    //! CUDA device ID (only used by GPU simulation)
+    int deviceId;
+
+    //! Number of synapses whose delay was clipped to the delay queue (see HostSim::reportClippedDelays()).
+    int cClippedDelays;
+
+private:
+    SimulationContext(const SimulationContext&);
+    SimulationContext& operator=(const SimulationContext&);
+};
+
+#endif // _SIMULATIONCONTEXT_H_
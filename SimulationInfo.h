@@ -29,6 +29,11 @@
 
 #include "LifNeuron.h"
 #include "DynamicSpikingSynapse.h"
+#include "SimulationContext.h"
+
+class SpikeRecorder;
+class SpikeHistogram;
+struct NeuronDistances;
 
 struct SimulationInfo
 {
@@ -47,8 +52,17 @@ struct SimulationInfo
         maxRate(0),
         minRadius(0),
         startRadius(0),
+        conductionVelocity(0),
+        fInputRingBuffers(false),
+        fFrozenConnectivity(false),
+        rgStorageIndex(NULL),
+        rgNeuronIndex(NULL),
+        pSpikeRecorder(NULL),
+        pSpikeHistogram(NULL),
         rgSynapseMap(NULL),
-        pSummationMap(NULL)
+        pSummationMap(NULL),
+        pContext(NULL),
+        pDistances(NULL)
 		
     {
     }
@@ -107,11 +121,38 @@ struct SimulationInfo
 	//! The starting connectivity radius for all neurons.
 	FLOAT startRadius;
 
+	//! Axonal conduction velocity (grid units/sec); 0 keeps the fixed per-type synaptic delays.
+	FLOAT conductionVelocity;
+
+	//! True if delayed input is delivered through per-target ring buffers (see InputRingBuffer).
+	bool fInputRingBuffers;
+
+	//! True if growth updates only measure the rates, and leave the radii and synapses as they are.
+	bool fFrozenConnectivity;
+
+	//! Storage index of each neuron (row-major) in pNeuronList, rgSynapseMap and pSummationMap.
+	int* rgStorageIndex;
+
+	//! Row-major index of each neuron in storage order (the inverse of rgStorageIndex).
+	int* rgNeuronIndex;
+
+	//! Receives the spikes of the neurons (NULL if spikes are not recorded).
+	SpikeRecorder* pSpikeRecorder;
+
+	//! Counts the spikes of the neurons into the population histograms (NULL if not counted).
+	SpikeHistogram* pSpikeHistogram;
+
 	//! List of lists of synapses (3d array)
 	vector<DynamicSpikingSynapse>* rgSynapseMap;
 
 	//! List of summation points
 	FLOAT* pSummationMap;
+
+	//! The clock and random number generators of the simulation.
+	SimulationContext* pContext;
+
+	//! The distances between the neurons computed in advance, or NULL if the simulation computes them.
+	const NeuronDistances* pDistances;
 };
 
 #endif // _SIMULATIONINFO_H_
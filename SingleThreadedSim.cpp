@@ -24,16 +24,16 @@ SingleThreadedSim::~SingleThreadedSim()
 void SingleThreadedSim::advanceUntilGrowth(SimulationInfo* psi)
 {
     uint64_t count = 0;
-    uint64_t endStep = g_simulationStep + static_cast<uint64_t>(psi->stepDuration / psi->deltaT);
+    uint64_t endStep = psi->pContext->simulationStep + static_cast<uint64_t>(psi->stepDuration / psi->deltaT);
     
     DEBUG2(printNetworkRadii(radii);)
 
-    while (g_simulationStep < endStep)
+    while (psi->pContext->simulationStep < endStep)
     {
         DEBUG(if (count % 1000 == 0)
               {
                   cout << psi->currentStep << "/" << psi->maxSteps
-                      << " simulating time: " << g_simulationStep * psi->deltaT << endl;
+                      << " simulating time: " << psi->pContext->simulationStep * psi->deltaT << endl;
                   count = 0;
               }
 
@@ -43,7 +43,7 @@ void SingleThreadedSim::advanceUntilGrowth(SimulationInfo* psi)
         advanceNeurons(psi);
         
         advanceSynapses(psi);
-        g_simulationStep++;
+        psi->pContext->simulationStep++;
     }
 }
 
@@ -54,22 +54,41 @@ void SingleThreadedSim::advanceUntilGrowth(SimulationInfo* psi)
 void SingleThreadedSim::advanceNeurons(SimulationInfo* psi)
 {
     // TODO: move this code into a helper class - it's being used in multiple places.
-    // For each neuron in the network
-    for (int i = psi->cNeurons - 1; i >= 0; --i)
+    // For each neuron in the network, in row-major order so that the noise each neuron
+    // draws does not depend on the storage order
+    for (int k = psi->cNeurons - 1; k >= 0; --k)
     {
+        int i = psi->rgStorageIndex[k];
+
         // advance neurons
-        (*(psi->pNeuronList))[i].advance(psi->pSummationMap[i]);
+        (*(psi->pNeuronList))[i].advance(psi->pSummationMap[i], *psi->pContext->rgNormrnd[0]);
 
         DEBUG2(cout << i << " " << (*(psi->pNeuronList))[i].Vm << endl;)
 
         // notify outgoing synapses if neuron has fired
         if ((*(psi->pNeuronList))[i].hasFired)
         {
-            DEBUG2(cout << " !! Neuron" << i << "has Fired @ t: " << g_simulationStep * psi->deltaT << endl;)
+            DEBUG2(cout << " !! Neuron" << i << "has Fired @ t: " << psi->pContext->simulationStep * psi->deltaT << endl;)
+
+            if (psi->pSpikeHistogram != NULL)
+            {
+                psi->pSpikeHistogram->count(0, psi->pContext->simulationStep);
+            }
+            if (psi->pSpikeRecorder != NULL)
+            {
+                psi->pSpikeRecorder->record(0, psi->rgNeuronIndex[i], psi->pContext->simulationStep);
+            }
 
-            for (int z = psi->rgSynapseMap[i].size() - 1; z >= 0; --z)
+            if (inputRing != NULL)
             {
-                psi->rgSynapseMap[i][z].preSpikeHit();
+                inputRing->preSpikeHit(psi->rgSynapseMap[i], psi->pContext->simulationStep);
+            }
+            else
+            {
+                for (int z = psi->rgSynapseMap[i].size() - 1; z >= 0; --z)
+                {
+                    psi->rgSynapseMap[i][z].preSpikeHit();
+                }
             }
 
             (*(psi->pNeuronList))[i].hasFired = false;
@@ -78,7 +97,7 @@ void SingleThreadedSim::advanceNeurons(SimulationInfo* psi)
 
 #ifdef DUMP_VOLTAGES
     // ouput a row with every voltage level for each time step
-    cout << g_simulationStep * psi->deltaT;
+    cout << psi->pContext->simulationStep * psi->deltaT;
 
     for (int i = 0; i < psi->cNeurons; i++)
     {
@@ -94,38 +113,57 @@ void SingleThreadedSim::advanceNeurons(SimulationInfo* psi)
  */
 void SingleThreadedSim::advanceSynapses(SimulationInfo* psi)
 {
+    // the ring buffers already hold the input of the synapses
+    if (inputRing != NULL)
+    {
+        inputRing->advance();
+        return;
+    }
+
     for (int i = psi->cNeurons - 1; i >= 0; --i)
     {
         for (int z = psi->rgSynapseMap[i].size() - 1; z >= 0; --z)
         {
-            psi->rgSynapseMap[i][z].advance();
+            psi->rgSynapseMap[i][z].advance(psi->pContext->simulationStep);
         }
     }
 }
 
 /**
  * Calculate growth cycle firing rate for previous period.
- * Compute neuron radii change, assign new values, and record the radius to histroy matrix.
+ * Compute neuron radii change, assign new values, and return the new radii and rates.
  * Update distance between frontiers, and compute areas of overlap. 
  * Adjust the strength of the synapse or remove it from the synapse map if it has gone below 
  * zero.
  * @param[in] psi	Pointer to the simulation information.
- * @param[in] radiiHistory	Matrix to save radius history.
- * @param[in] ratesHistory	Matrix to save firing rates history. 
+ * @param[out] newRadii	Receives the new radius of each neuron.
+ * @param[out] newRates	Receives the firing rate of each neuron.
  */
-void SingleThreadedSim::updateNetwork(SimulationInfo* psi, CompleteMatrix& radiiHistory, CompleteMatrix& ratesHistory)
+void SingleThreadedSim::updateNetwork(SimulationInfo* psi, VectorMatrix& newRadii, VectorMatrix& newRates)
 {
     // Calculate growth cycle firing rate for previous period
     for (int i = 0; i < psi->cNeurons; i++)
     {
+        LifNeuron& neuron = (*(psi->pNeuronList))[psi->rgStorageIndex[i]];
+
         // Calculate firing rate
-        rates[i] = (*(psi->pNeuronList))[i].getSpikeCount() / psi->stepDuration;
+        rates[i] = neuron.getSpikeCount() / psi->stepDuration;
 
         // clear spike count
-        (*(psi->pNeuronList))[i].clearSpikeCount();
+        neuron.clearSpikeCount();
 
-        // record firing rate to history matrix
-        ratesHistory(psi->currentStep, i) = rates[i];
+        // return the firing rate
+        newRates[i] = rates[i];
+    }
+
+    // the radii and synapses of a network with frozen connectivity stay as they are
+    if (psi->fFrozenConnectivity)
+    {
+        for (int i = 0; i < radii.Size(); i++)
+        {
+            newRadii[i] = radii[i];
+        }
+        return;
     }
 
     // compute neuron radii change and assign new values
@@ -133,15 +171,15 @@ void SingleThreadedSim::updateNetwork(SimulationInfo* psi, CompleteMatrix& radii
     deltaR = psi->stepDuration * psi->rho * outgrowth;
     radii += deltaR;
 
-    // Cap minimum radius size and record radii to history matrix
+    // Cap minimum radius size and return the radii
     for (int i = 0; i < radii.Size(); i++)
     {
         // TODO: find out why we cap this here.
         if (radii[i] < psi->minRadius)
             radii[i] = psi->minRadius;
 
-        // record radius to history matrix
-        radiiHistory(psi->currentStep, i) = radii[i];
+        // return the radius
+        newRadii[i] = radii[i];
 
         DEBUG2(cout << "radii[" << i << ":" << radii[i] << "]" << endl;);
     }
@@ -209,6 +247,7 @@ void SingleThreadedSim::updateNetwork(SimulationInfo* psi, CompleteMatrix& radii
     int could_have_been_removed = 0; // TODO: use this value
     int removed = 0;
     int added = 0;
+    int cClippedDelays = 0;
 
     DEBUG(cout << "adjusting weights" << endl;)
 
@@ -219,6 +258,12 @@ void SingleThreadedSim::updateNetwork(SimulationInfo* psi, CompleteMatrix& radii
         int xa = a % psi->width;
         int ya = a / psi->width;
         Coordinate aCoord(xa, ya);
+        vector<DynamicSpikingSynapse>& synapses = psi->rgSynapseMap[psi->rgStorageIndex[a]];
+        size_t cAdded = 0;
+        bool fRemoved = false;
+
+        reserveSynapses(psi, a, synapses);
+        size_t cReserved = synapses.capacity();
 
         // and each destination neuron 'b'
         for (int b = 0; b < psi->cNeurons; b++)
@@ -231,10 +276,10 @@ void SingleThreadedSim::updateNetwork(SimulationInfo* psi, CompleteMatrix& radii
             bool connected = false;
 
             // for each existing synapse
-            for (size_t syn = 0; syn < psi->rgSynapseMap[a].size(); syn++)
+            for (size_t syn = 0; syn < synapses.size(); syn++)
             {
                 // if there is a synapse between a and b
-                if (psi->rgSynapseMap[a][syn].summationCoord == bCoord)
+                if (synapses[syn].summationCoord == bCoord)
                 {
                     connected = true;
                     adjusted++;
@@ -244,20 +289,25 @@ void SingleThreadedSim::updateNetwork(SimulationInfo* psi, CompleteMatrix& radii
                     // zero.
                     if (W(a, b) < 0)
                     {
+                        // removed from the list once all targets are visited
                         removed++;
-                        psi->rgSynapseMap[a].erase(psi->rgSynapseMap[a].begin() + syn);
+                        synapses[syn].fRemoved = true;
+                        fRemoved = true;
                     }
                     else
                     {
                         // adjust
                         // g_synapseStrengthAdjustmentConstant is 1.0e-8;
-                        psi->rgSynapseMap[a][syn].W = W(a, b) * 
+                        synapses[syn].W = W(a, b) * 
                             synSign(synType(psi, aCoord, bCoord)) * g_synapseStrengthAdjustmentConstant;
 
                         DEBUG2(cout << "weight of rgSynapseMap" << 
                                coordToString(xa, ya)<<"[" <<syn<<"]: " << 
-                               psi->rgSynapseMap[a][syn].W << endl;);
+                               synapses[syn].W << endl;);
                     }
+
+                    // there is at most one synapse between a and b
+                    break;
                 }
             }
 
@@ -265,13 +315,26 @@ void SingleThreadedSim::updateNetwork(SimulationInfo* psi, CompleteMatrix& radii
             if (!connected && (W(a, b) > 0))
             {
                 added++;
+                cAdded++;
 
-                DynamicSpikingSynapse& newSynapse = addSynapse(psi, xa, ya, xb, yb);
+                DynamicSpikingSynapse& newSynapse = addSynapse(psi, xa, ya, xb, yb, cClippedDelays);
                 newSynapse.W = W(a, b) * synSign(synType(psi, aCoord, bCoord)) * g_synapseStrengthAdjustmentConstant;
             }
         }
+
+        // the list must not have been reallocated while the pruned synapses were still in it
+        assert(synapses.capacity() == cReserved);
+
+        // remove the pruned synapses and keep the rest sorted by target
+        if (fRemoved)
+        {
+            removeSynapses(synapses);
+        }
+        sortSynapses(synapses, synapses.size() - cAdded);
     }
 
+    reportClippedDelays(psi, cClippedDelays);
+
     DEBUG (cout << "adjusted: " << adjusted << endl;)
     DEBUG (cout << "could have been removed (TODO: calculate this): " << could_have_been_removed << endl;)
     DEBUG (cout << "removed: " << removed << endl;)
@@ -46,7 +46,7 @@ public:
     virtual void advanceUntilGrowth(SimulationInfo* psi);
 
     //! Update the network.
-    virtual void updateNetwork(SimulationInfo* psi, CompleteMatrix& radiiHistory, CompleteMatrix& ratesHistory);
+    virtual void updateNetwork(SimulationInfo* psi, VectorMatrix& newRadii, VectorMatrix& newRates);
 
 	void worker1();
 
@@ -0,0 +1,118 @@
+/**
+ *	\file SpikeFileWriter.cpp
+ *
+ *	\brief Streams recorded spikes to a binary file while the simulation runs.
+ */
+#include "SpikeFileWriter.h"
+#include "BlockCodec.h"
+#include <cstring>
+
+/**
+ * Queue the file header.
+ * @param[in] pipeline	Writes the blocks.
+ * @param[in] os	The binary output stream.
+ * @param[in] cNeurons	Number of neurons.
+ * @param[in] deltaT	The simulation time step.
+ * @param[in] fPack	True to pack the blocks.
+ */
+SpikeFileWriter::SpikeFileWriter(OutputPipeline& pipeline, ostream& os, int cNeurons, FLOAT deltaT, bool fPack) :
+    m_pipeline(pipeline),
+    m_os(os),
+    m_fPack(fPack)
+{
+    uint32_t version = m_fPack ? SPIKE_FILE_VERSION : SPIKE_FILE_UNPACKED_VERSION;
+    float dt = deltaT;
+
+    vector<char>* pHeader = new vector<char>;
+    pHeader->insert(pHeader->end(), "BGSPIKES", "BGSPIKES" + 8);
+    pHeader->insert(pHeader->end(), reinterpret_cast<const char*>(&version),
+            reinterpret_cast<const char*>(&version) + sizeof(version));
+    pHeader->insert(pHeader->end(), reinterpret_cast<const char*>(&cNeurons),
+            reinterpret_cast<const char*>(&cNeurons) + sizeof(cNeurons));
+    pHeader->insert(pHeader->end(), reinterpret_cast<const char*>(&dt),
+            reinterpret_cast<const char*>(&dt) + sizeof(dt));
+    m_pipeline.write(m_os, pHeader);
+}
+
+/**
+ * Encode the spikes of a chunk as a block and hand it to the pipeline.
+ * @param[in] chunk	Spikes recorded during an epoch.
+ */
+void SpikeFileWriter::consume(const SpikeChunk& chunk)
+{
+    vector<char>* pBlock = new vector<char>;
+    pBlock->reserve(16 + chunk.cRecords * 4);
+
+    // block header, the byte counts are filled in below
+    uint32_t cRecords = chunk.cRecords;
+    uint32_t cBytes = 0;
+    uint32_t cPackedBytes = 0;
+    pBlock->insert(pBlock->end(), reinterpret_cast<const char*>(&chunk.epochStart),
+            reinterpret_cast<const char*>(&chunk.epochStart) + sizeof(chunk.epochStart));
+    pBlock->insert(pBlock->end(), reinterpret_cast<const char*>(&cRecords),
+            reinterpret_cast<const char*>(&cRecords) + sizeof(cRecords));
+    pBlock->insert(pBlock->end(), reinterpret_cast<const char*>(&cBytes),
+            reinterpret_cast<const char*>(&cBytes) + sizeof(cBytes));
+    if (m_fPack)
+    {
+        pBlock->insert(pBlock->end(), reinterpret_cast<const char*>(&cPackedBytes),
+                reinterpret_cast<const char*>(&cPackedBytes) + sizeof(cPackedBytes));
+    }
+    size_t header = pBlock->size();
+
+    // a packed block is encoded aside first
+    vector<char>& encoded = m_fPack ? m_encoded : *pBlock;
+    if (m_fPack)
+    {
+        m_encoded.clear();
+    }
+
+    uint32_t last = 0;
+    for (int i = 0; i < chunk.cRecords; i++)
+    {
+        const SpikeRecord& rec = chunk.records[i];
+        assert(rec.offset >= last);
+
+        putVarint(encoded, rec.offset - last);
+        putVarint(encoded, rec.neuron);
+        last = rec.offset;
+    }
+
+    if (m_fPack)
+    {
+        cBytes = m_encoded.size();
+        packBlock(&m_encoded[0], m_encoded.size(), 1, *pBlock);
+        cPackedBytes = pBlock->size() - header;
+        if (cPackedBytes >= cBytes)
+        {
+            pBlock->resize(header);
+            pBlock->insert(pBlock->end(), m_encoded.begin(), m_encoded.end());
+            cPackedBytes = cBytes;
+        }
+        memcpy(&(*pBlock)[header - sizeof(cPackedBytes)], &cPackedBytes, sizeof(cPackedBytes));
+        memcpy(&(*pBlock)[header - sizeof(cPackedBytes) - sizeof(cBytes)], &cBytes, sizeof(cBytes));
+    }
+    else
+    {
+        cBytes = pBlock->size() - header;
+        memcpy(&(*pBlock)[header - sizeof(cBytes)], &cBytes, sizeof(cBytes));
+    }
+
+    m_pipeline.write(m_os, pBlock);
+}
+
+/**
+ * Append an unsigned LEB128 varint to a buffer: 7 bits per byte, least
+ * significant first, with the high bit set on all but the last byte.
+ * @param[in,out] buf	The buffer.
+ * @param[in] value	The value to append.
+ */
+void SpikeFileWriter::putVarint(vector<char>& buf, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        buf.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    buf.push_back(static_cast<char>(value));
+}
@@ -0,0 +1,88 @@
+/**
+ *	@file SpikeFileWriter.h
+ *
+ *	@brief Header file for SpikeFileWriter.
+ */
+//! Streams recorded spikes to a binary file while the simulation runs.
+
+/**
+ ** \class SpikeFileWriter SpikeFileWriter.h "SpikeFileWriter.h"
+ **
+ ** \latexonly	\subsubsection*{Implementation} \endlatexonly
+ ** \htmlonly	<h3>Implementation</h3> \endhtmlonly
+ **
+ ** The SpikeFileWriter receives the chunks of a SpikeRecorder, encodes each of them as a block
+ ** of address events and hands the block to an OutputPipeline, which writes it to the output
+ ** stream from a background thread.  The spikes of an epoch are therefore written while the
+ ** next epoch is simulated.
+ **
+ ** The file starts with a header:
+ **	- char[8]	magic "BGSPIKES"
+ **	- uint32_t	format version (1, or 2 if the blocks are packed)
+ **	- int32_t	number of neurons
+ **	- float	simulation time step (s)
+ **
+ ** followed by blocks, one per chunk:
+ **	- uint64_t	time step at which the epoch of the block started
+ **	- uint32_t	number of spikes in the block
+ **	- uint32_t	number of bytes of the encoded spikes
+ **	- uint32_t	number of bytes of the packed spikes (version 2 only)
+ **	- the encoded spikes, packed by packBlock() (as bytes) in version 2 unless that does not make them
+ **	  smaller; they are then stored as they are, with both sizes equal
+ **
+ ** Each spike is encoded as two unsigned LEB128 varints: the time step relative to the previous
+ ** spike of the block (to the start of the epoch for the first one), then the row-major index
+ ** of the neuron.  Within a block spikes are in time order; blocks recorded by different threads
+ ** may interleave in time.  All fixed-size fields are in host byte order.
+ **
+ ** \latexonly	\subsubsection*{Credits} \endlatexonly
+ ** \htmlonly	<h3>Credits</h3> \endhtmlonly
+ **
+ ** This simulator is a rewrite of CSIM (2006) and other work (Stiber and Kawasaki (2007?))
+ **/
+
+#pragma once
+
+#ifndef _SPIKEFILEWRITER_H_
+#define _SPIKEFILEWRITER_H_
+
+#include "global.h"
+#include "SpikeRecorder.h"
+#include "OutputPipeline.h"
+
+//! Version of the spike file format.
+#define SPIKE_FILE_VERSION 2
+
+//! Version of the spike files whose blocks are not packed.
+#define SPIKE_FILE_UNPACKED_VERSION 1
+
+class SpikeFileWriter : public ISpikeConsumer
+{
+public:
+    //! The constructor for SpikeFileWriter.
+    SpikeFileWriter(OutputPipeline& pipeline, ostream& os, int cNeurons, FLOAT deltaT, bool fPack);
+
+    //! Encode the spikes of a chunk and queue them for writing.
+    virtual void consume(const SpikeChunk& chunk);
+
+private:
+    //! Append an unsigned LEB128 varint to a buffer.
+    static void putVarint(vector<char>& buf, uint32_t value);
+
+    //! Writes the blocks.
+    OutputPipeline& m_pipeline;
+
+    //! The output stream.
+    ostream& m_os;
+
+    //! True if the blocks are packed.
+    bool m_fPack;
+
+    //! The encoded spikes of a block that is packed.
+    vector<char> m_encoded;
+
+    SpikeFileWriter(const SpikeFileWriter&);
+    SpikeFileWriter& operator=(const SpikeFileWriter&);
+};
+
+#endif // _SPIKEFILEWRITER_H_
@@ -0,0 +1,101 @@
+/**
+ *	\file SpikeHistogram.cpp
+ *
+ *	\brief Accumulates the population spike histograms while the simulation runs.
+ */
+#include "SpikeHistogram.h"
+
+/**
+ * @param[in] burstinessHist	Histogram with 1 s bins.
+ * @param[in] spikesHistory	Histogram with 10 ms bins.
+ * @param[in] deltaT	The simulation time step.
+ * @param[in] cThreads	Number of threads that count spikes.
+ */
+SpikeHistogram::SpikeHistogram(VectorMatrix& burstinessHist, VectorMatrix& spikesHistory, FLOAT deltaT, int cThreads) :
+    m_burstinessHist(burstinessHist),
+    m_spikesHistory(spikesHistory),
+    m_deltaT(deltaT),
+    m_cThreads(cThreads),
+    m_origin(0),
+    m_base1(0),
+    m_base2(0)
+{
+    m_rgBins = new ThreadBins[m_cThreads];
+}
+
+/**
+ * Destructor
+ */
+SpikeHistogram::~SpikeHistogram()
+{
+    delete[] m_rgBins;
+}
+
+/**
+ * Set the time step at which the first bins of the histograms start, before the
+ * first epoch.
+ * @param[in] step	The first time step of the run.
+ */
+void SpikeHistogram::setOrigin(uint64_t step)
+{
+    m_origin = step;
+}
+
+/**
+ * Start a new epoch.  The counts of the previous epoch are added to the histograms,
+ * and the bins of each thread are set up to cover the new epoch.
+ * @param[in] step	The time step at which the epoch starts.
+ * @param[in] cSteps	Number of time steps in the epoch.
+ */
+void SpikeHistogram::beginEpoch(uint64_t step, uint64_t cSteps)
+{
+    flush();
+    step -= m_origin;
+
+    // bins are computed exactly as in count(), so that the last step of the epoch is covered
+    uint64_t last = step + (cSteps > 0 ? cSteps - 1 : 0);
+    m_base1 = static_cast<int>(step * m_deltaT);
+    m_base2 = static_cast<int>(step * m_deltaT * 100);
+    size_t cBins1 = static_cast<int>(last * m_deltaT) - m_base1 + 1;
+    size_t cBins2 = static_cast<int>(last * m_deltaT * 100) - m_base2 + 1;
+
+    for (int i = 0; i < m_cThreads; i++)
+    {
+        // the bins are cleared by flush(), so only new bins need to be zeroed
+        if (m_rgBins[i].burstiness.size() < cBins1)
+            m_rgBins[i].burstiness.resize(cBins1, 0);
+        if (m_rgBins[i].spikes.size() < cBins2)
+            m_rgBins[i].spikes.resize(cBins2, 0);
+    }
+}
+
+/**
+ * Add the counts of all threads to the histograms and clear them.  The histograms
+ * have a whole number of bins, so spikes in a partial bin at the end of the
+ * simulation are not counted.
+ */
+void SpikeHistogram::flush()
+{
+    for (int i = 0; i < m_cThreads; i++)
+    {
+        vector<int>& burstiness = m_rgBins[i].burstiness;
+        for (size_t j = 0; j < burstiness.size(); j++)
+        {
+            if (burstiness[j] != 0 && m_base1 + static_cast<int>(j) < m_burstinessHist.Size())
+            {
+                m_burstinessHist[m_base1 + j] = m_burstinessHist[m_base1 + j] + burstiness[j];
+            }
+            burstiness[j] = 0;
+        }
+
+        vector<int>& spikes = m_rgBins[i].spikes;
+        for (size_t j = 0; j < spikes.size(); j++)
+        {
+            if (spikes[j] != 0 && m_base2 + static_cast<int>(j) < m_spikesHistory.Size())
+            {
+                m_spikesHistory[m_base2 + j] = m_spikesHistory[m_base2 + j] + spikes[j];
+            }
+            spikes[j] = 0;
+        }
+    }
+}
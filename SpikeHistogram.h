@@ -0,0 +1,114 @@
+/**
+ *	@file SpikeHistogram.h
+ *
+ *	@brief Header file for SpikeHistogram.
+ */
+//! Accumulates the population spike histograms while the simulation runs.
+
+/**
+ ** \class SpikeHistogram SpikeHistogram.h "SpikeHistogram.h"
+ **
+ ** \latexonly	\subsubsection*{Implementation} \endlatexonly
+ ** \htmlonly	<h3>Implementation</h3> \endhtmlonly
+ **
+ ** The SpikeHistogram counts the spikes of all neurons in 1 s bins (burstinessHist) and in
+ ** 10 ms bins (spikesHistory) as they are fired, so no spike times need to be stored.
+ ** Every thread counts into its own bins, which only cover the current epoch (growth cycle);
+ ** they are added to the histograms, and cleared, when the next epoch begins and when the
+ ** histogram is flushed.  The memory used is therefore independent of the number of spikes
+ ** and of the length of the run.
+ **
+ ** Bin 0 of the histograms starts at the origin, time step 0 unless the run continues the
+ ** time of an earlier one (setOrigin()).
+ **
+ ** \latexonly	\subsubsection*{Credits} \endlatexonly
+ ** \htmlonly	<h3>Credits</h3> \endhtmlonly
+ **
+ ** This simulator is a rewrite of CSIM (2006) and other work (Stiber and Kawasaki (2007?))
+ **/
+
+#pragma once
+
+#ifndef _SPIKEHISTOGRAM_H_
+#define _SPIKEHISTOGRAM_H_
+
+#include "global.h"
+#include "Matrix/VectorMatrix.h"
+
+class SpikeHistogram
+{
+public:
+    //! The constructor for SpikeHistogram.
+    SpikeHistogram(VectorMatrix& burstinessHist, VectorMatrix& spikesHistory, FLOAT deltaT, int cThreads);
+    ~SpikeHistogram();
+
+    //! Set the time step at which the first bins start.
+    void setOrigin(uint64_t step);
+
+    //! Start a new epoch.
+    void beginEpoch(uint64_t step, uint64_t cSteps);
+
+    //! Count a spike.
+    inline void count(int thread, uint64_t step);
+
+    //! Add the counts of all threads to the histograms.
+    void flush();
+
+private:
+    //! Bins of one thread for the current epoch.
+    struct ThreadBins
+    {
+        //! Spike counts in 1 s bins, starting with bin m_base1.
+        vector<int> burstiness;
+
+        //! Spike counts in 10 ms bins, starting with bin m_base2.
+        vector<int> spikes;
+    };
+
+    //! Spike count of all neurons in 1 s bins.
+    VectorMatrix& m_burstinessHist;
+
+    //! Spike count of all neurons in 10 ms bins.
+    VectorMatrix& m_spikesHistory;
+
+    //! The simulation time step.
+    FLOAT m_deltaT;
+
+    //! Number of counting threads.
+    int m_cThreads;
+
+    //! The time step at which the first bins start.
+    uint64_t m_origin;
+
+    //! First 1 s and 10 ms bin of the current epoch.
+    int m_base1;
+    int m_base2;
+
+    //! The bins of each thread.
+    ThreadBins* m_rgBins;
+
+    SpikeHistogram(const SpikeHistogram&);
+    SpikeHistogram& operator=(const SpikeHistogram&);
+};
+
+/**
+ * Count a spike.  Each thread must pass its own thread number.
+ * @param[in] thread	Number of the calling thread.
+ * @param[in] step	The time step of the spike; within the current epoch.
+ */
+inline void SpikeHistogram::count(int thread, uint64_t step)
+{
+    assert(thread >= 0 && thread < m_cThreads);
+    ThreadBins& bins = m_rgBins[thread];
+
+    step -= m_origin;
+    int idx1 = step * m_deltaT;
+    int idx2 = step * m_deltaT * 100;
+    assert(idx1 >= m_base1 && idx1 - m_base1 < static_cast<int>(bins.burstiness.size()));
+    assert(idx2 >= m_base2 && idx2 - m_base2 < static_cast<int>(bins.spikes.size()));
+
+    bins.burstiness[idx1 - m_base1]++;
+    bins.spikes[idx2 - m_base2]++;
+}
+
+#endif // _SPIKEHISTOGRAM_H_
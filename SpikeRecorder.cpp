@@ -0,0 +1,120 @@
+/**
+ *	\file SpikeRecorder.cpp
+ *
+ *	\brief Records spikes into fixed-size chunks and hands full chunks to a consumer.
+ */
+#include "SpikeRecorder.h"
+
+/**
+ * Allocate one chunk for each thread.
+ * @param[in] cThreads	Number of threads that record spikes.
+ */
+SpikeRecorder::SpikeRecorder(int cThreads) :
+    m_cThreads(cThreads),
+    m_epochStart(0)
+{
+    m_rgChunks = new SpikeChunk[m_cThreads];
+
+    for (int i = 0; i < m_cThreads; i++)
+    {
+        m_rgChunks[i].epochStart = m_epochStart;
+        m_rgChunks[i].cRecords = 0;
+    }
+}
+
+/**
+ * Destructor
+ */
+SpikeRecorder::~SpikeRecorder()
+{
+    delete[] m_rgChunks;
+}
+
+/**
+ * Add a receiver of the recorded spikes.  Consumers receive the chunks in the order
+ * they were added.
+ * @param[in] pConsumer	The receiver.
+ */
+void SpikeRecorder::addConsumer(ISpikeConsumer* pConsumer)
+{
+    m_rgConsumers.push_back(pConsumer);
+}
+
+/**
+ * @return true if any consumer has been added.
+ */
+bool SpikeRecorder::hasConsumers() const
+{
+    return !m_rgConsumers.empty();
+}
+
+/**
+ * Start a new epoch.  The spikes of the previous epoch are handed to the consumers.
+ * @param[in] step	The time step at which the epoch starts.
+ */
+void SpikeRecorder::beginEpoch(uint64_t step)
+{
+    flush();
+
+    m_epochStart = step;
+    for (int i = 0; i < m_cThreads; i++)
+    {
+        m_rgChunks[i].epochStart = m_epochStart;
+    }
+}
+
+/**
+ * Record a spike.  Each thread must pass its own thread number.
+ * @param[in] thread	Number of the calling thread.
+ * @param[in] neuron	Row-major index of the neuron that fired.
+ * @param[in] step	The time step of the spike; not before the start of the epoch.
+ */
+void SpikeRecorder::record(int thread, int neuron, uint64_t step)
+{
+    assert(thread >= 0 && thread < m_cThreads);
+    assert(step >= m_epochStart && step - m_epochStart < (static_cast<uint64_t>(1) << 32));
+
+    SpikeChunk& chunk = m_rgChunks[thread];
+    SpikeRecord& rec = chunk.records[chunk.cRecords++];
+    rec.neuron = neuron;
+    rec.offset = static_cast<uint32_t>(step - m_epochStart);
+
+    if (chunk.cRecords == SPIKE_CHUNK_RECORDS)
+    {
+        handOff(chunk);
+    }
+}
+
+/**
+ * Hand the spikes recorded by all threads to the consumers.
+ */
+void SpikeRecorder::flush()
+{
+    for (int i = 0; i < m_cThreads; i++)
+    {
+        handOff(m_rgChunks[i]);
+    }
+}
+
+/**
+ * Hand a chunk to the consumers and empty it.
+ * @param[in,out] chunk	The chunk.
+ */
+void SpikeRecorder::handOff(SpikeChunk& chunk)
+{
+    if (chunk.cRecords == 0)
+        return;
+
+    // the consumers are not required to be thread safe
+#ifdef USE_OMP
+#pragma omp critical (SpikeRecorder)
+#endif
+    {
+        for (size_t i = 0; i < m_rgConsumers.size(); i++)
+        {
+            m_rgConsumers[i]->consume(chunk);
+        }
+    }
+
+    chunk.cRecords = 0;
+}
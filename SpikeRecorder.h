@@ -0,0 +1,113 @@
+/**
+ *	@file SpikeRecorder.h
+ *
+ *	@brief Header file for SpikeRecorder.
+ */
+//! Records spikes into fixed-size chunks and hands full chunks to a consumer.
+
+/**
+ ** \class SpikeRecorder SpikeRecorder.h "SpikeRecorder.h"
+ **
+ ** \latexonly	\subsubsection*{Implementation} \endlatexonly
+ ** \htmlonly	<h3>Implementation</h3> \endhtmlonly
+ **
+ ** Each spike is recorded as the (row-major) index of the neuron and the time step at which
+ ** it fired, relative to the start of the current epoch (growth cycle), in 32 bits.
+ ** Records are appended to a chunk of fixed size.  Every thread has its own chunk, so threads
+ ** record without locking; all chunks are allocated once, as a single arena.
+ ** When a chunk is full it is handed to each ISpikeConsumer and then reused, so the memory used
+ ** for spikes does not depend on the length of the run.  At the start of an epoch, and when the
+ ** recorder is flushed, the partly filled chunks are handed over as well.
+ **
+ ** \latexonly	\subsubsection*{Credits} \endlatexonly
+ ** \htmlonly	<h3>Credits</h3> \endhtmlonly
+ **
+ ** This simulator is a rewrite of CSIM (2006) and other work (Stiber and Kawasaki (2007?))
+ **/
+
+#pragma once
+
+#ifndef _SPIKERECORDER_H_
+#define _SPIKERECORDER_H_
+
+#include "global.h"
+
+//! Number of spike records in a chunk.
+#define SPIKE_CHUNK_RECORDS 4096
+
+//! A spike: the neuron and the time step relative to the start of the epoch.
+struct SpikeRecord
+{
+    //! Row-major index of the neuron.
+    uint32_t neuron;
+
+    //! Time step of the spike, relative to the start of the epoch.
+    uint32_t offset;
+};
+
+//! A block of spikes recorded by one thread during one epoch.
+struct SpikeChunk
+{
+    //! The time step at which the epoch started.
+    uint64_t epochStart;
+
+    //! Number of records in use.
+    int cRecords;
+
+    //! The records, in the order they were recorded.
+    SpikeRecord records[SPIKE_CHUNK_RECORDS];
+};
+
+//! Interface of the receivers of recorded spikes.
+class ISpikeConsumer
+{
+public:
+    virtual ~ISpikeConsumer() {}
+
+    //! Process a chunk of spikes; the chunk is reused once this returns.
+    virtual void consume(const SpikeChunk& chunk) = 0;
+};
+
+class SpikeRecorder
+{
+public:
+    //! The constructor for SpikeRecorder.
+    SpikeRecorder(int cThreads);
+    ~SpikeRecorder();
+
+    //! Add a receiver of the recorded spikes.
+    void addConsumer(ISpikeConsumer* pConsumer);
+
+    //! True if any consumer has been added.
+    bool hasConsumers() const;
+
+    //! Start a new epoch.
+    void beginEpoch(uint64_t step);
+
+    //! Record a spike.
+    void record(int thread, int neuron, uint64_t step);
+
+    //! Hand all recorded spikes to the consumers.
+    void flush();
+
+private:
+    //! Hand a chunk to the consumers and empty it.
+    void handOff(SpikeChunk& chunk);
+
+    //! Number of recording threads.
+    int m_cThreads;
+
+    //! The receivers of the chunks.
+    vector<ISpikeConsumer*> m_rgConsumers;
+
+    //! The time step at which the current epoch started.
+    uint64_t m_epochStart;
+
+    //! The chunk of each thread.
+    SpikeChunk* m_rgChunks;
+
+    SpikeRecorder(const SpikeRecorder&);
+    SpikeRecorder& operator=(const SpikeRecorder&);
+};
+
+#endif // _SPIKERECORDER_H_
@@ -0,0 +1,277 @@
+/**
+ *	\file Sweep.cpp
+ *
+ *	\brief Runs a parameter sweep of a base configuration as child processes.
+ */
+#include "Sweep.h"
+#include "ChildProcesses.h"
+#include <algorithm>
+
+/**
+ * Orders runs by their estimated cost, the most expensive first, and by their number.
+ */
+struct CostOrder
+{
+    CostOrder(const vector<double>& rgCost) : m_rgCost(rgCost) { }
+
+    bool operator()(int a, int b) const
+    {
+        if (m_rgCost[a] != m_rgCost[b])
+            return m_rgCost[a] > m_rgCost[b];
+        return a < b;
+    }
+
+    const vector<double>& m_rgCost;
+};
+
+/**
+ * The constructor for Sweep.
+ */
+Sweep::Sweep() :
+    m_cRuns(0)
+{
+}
+
+/**
+ * Read a sweep specification: a Sweep element with an Axis element for each swept parameter.
+ * @param[in] fileName	The name of the sweep specification file.
+ * @throws KII_exception if the file cannot be read or does not specify a sweep.
+ */
+void Sweep::load(const string& fileName)
+{
+    TiXmlDocument doc(fileName.c_str());
+    if (!doc.LoadFile())
+    {
+        stringstream ss;
+        ss << "Failed loading sweep specification " << fileName << ": " << doc.ErrorDesc()
+           << " (" << doc.ErrorRow() << ", " << doc.ErrorCol() << ")";
+        throw KII_exception(ss.str());
+    }
+
+    TiXmlElement* pSweep = doc.FirstChildElement("Sweep");
+    if (pSweep == NULL)
+    {
+        throw KII_exception("Could not find <Sweep> in sweep specification " + fileName);
+    }
+
+    m_fileName = fileName;
+    m_rgAxis.clear();
+    m_cRuns = 1;
+    for (TiXmlElement* pAxis = pSweep->FirstChildElement("Axis"); pAxis != NULL; pAxis = pAxis->NextSiblingElement("Axis"))
+    {
+        const char* element = pAxis->Attribute("element");
+        const char* attribute = pAxis->Attribute("attribute");
+        const char* values = pAxis->Attribute("values");
+        if (element == NULL || attribute == NULL || values == NULL)
+        {
+            throw KII_exception("An <Axis> of sweep specification " + fileName + " needs an element, an attribute and values");
+        }
+
+        Axis axis;
+        axis.element = element;
+        axis.attribute = attribute;
+        istringstream valStream(values);
+        string value;
+        while (valStream >> value)
+        {
+            axis.values.push_back(value);
+        }
+        if (axis.values.empty())
+        {
+            throw KII_exception("The <Axis> of " + axis.element + " " + axis.attribute + " in sweep specification " + fileName + " has no values");
+        }
+
+        m_cRuns *= static_cast<int>(axis.values.size());
+        m_rgAxis.push_back(axis);
+    }
+    if (m_rgAxis.empty())
+    {
+        throw KII_exception("Sweep specification " + fileName + " has no <Axis>");
+    }
+
+    m_rgStatus.assign(m_cRuns, -1);
+    m_rgSeconds.assign(m_cRuns, 0);
+}
+
+/**
+ * The value of an axis in a run: the values of the last axis change fastest.
+ * @param[in] run	The run.
+ * @param[in] axis	The axis.
+ * @return the value of the parameter of the axis in the run.
+ */
+const string& Sweep::value(int run, int axis) const
+{
+    for (int a = static_cast<int>(m_rgAxis.size()) - 1; a > axis; a--)
+    {
+        run /= static_cast<int>(m_rgAxis[a].values.size());
+    }
+    return m_rgAxis[axis].values[run % m_rgAxis[axis].values.size()];
+}
+
+/**
+ * Set the parameters of a run in a copy of the base SimParams; an element that the base does
+ * not have (e.g. the optional SynapseParams) is added.
+ * @param[in] run	The run.
+ * @param[in,out] pParams	The SimParams element of the run.
+ */
+void Sweep::apply(int run, TiXmlElement* pParams) const
+{
+    for (int a = 0; a < static_cast<int>(m_rgAxis.size()); a++)
+    {
+        TiXmlElement* pElement = pParams->FirstChildElement(m_rgAxis[a].element.c_str());
+        if (pElement == NULL)
+        {
+            pElement = new TiXmlElement(m_rgAxis[a].element.c_str());
+            pParams->LinkEndChild(pElement);
+        }
+        pElement->SetAttribute(m_rgAxis[a].attribute, value(run, a));
+    }
+}
+
+/**
+ * Number of runs that did not finish successfully.
+ * @return the number of runs that failed or were not run.
+ */
+int Sweep::getFailed() const
+{
+    int cFailed = 0;
+    for (int run = 0; run < m_cRuns; run++)
+    {
+        if (m_rgStatus[run] != EXIT_SUCCESS)
+            cFailed++;
+    }
+    return cFailed;
+}
+
+/**
+ * Start a child process for each run, keeping cJobs of them going at a time, and wait for
+ * them.  The runs with the highest estimated cost are started first (longest processing time
+ * first), so that the cores are packed well to the end of the sweep.  The children return from
+ * this function and perform their run; the parent returns once all of them have exited, and
+ * keeps the outcome and the time of each run for the index.
+ * @param[in] rgCost	The estimated cost of each run, in any unit.
+ * @param[in] cJobs	Number of runs to keep going at a time.
+ * @return the run to perform, in a child; -1 in the parent.
+ * @throws KII_exception in the parent if sweeps are not supported.
+ */
+int Sweep::forkRuns(const vector<double>& rgCost, int cJobs)
+{
+#ifdef _WIN32
+    throw KII_exception("Sweeps are not supported on Windows");
+#else
+    vector<int> rgOrder(m_cRuns);
+    for (int run = 0; run < m_cRuns; run++)
+    {
+        rgOrder[run] = run;
+    }
+    stable_sort(rgOrder.begin(), rgOrder.end(), CostOrder(rgCost));
+
+    return ChildProcesses::run(rgOrder, cJobs, *this);
+#endif
+}
+
+/**
+ * Keep the outcome and the time of a run as its child process exits.
+ * @param[in] run	The run.
+ * @param[in] status	The exit status of the run, 128 + the signal that ended it, or -1 if it did not run.
+ * @param[in] seconds	The time the run took.
+ */
+void Sweep::finished(int run, int status, double seconds)
+{
+    m_rgStatus[run] = status;
+    m_rgSeconds[run] = seconds;
+    if (status < 0)
+    {
+        cerr << "Cannot run run " << run << endl;
+    }
+    else if (status != EXIT_SUCCESS)
+    {
+        cerr << "Run " << run << " failed" << endl;
+    }
+    else
+    {
+        cout << "Run " << run << " done (" << seconds << " s)" << endl;
+    }
+}
+
+/**
+ * Write the index of a sweep: the swept parameters, and the values of the parameters, the
+ * output files, the exit status and the time of each run.
+ * @param[in] os	The stream to write the index to.
+ * @param[in] baseFileName	The name of the base configuration.
+ * @param[in] rgOutput	The name of each kind of output file (e.g. stateOutputFileName) and the name of its file in a run that is not part of a sweep.
+ */
+void Sweep::writeIndex(ostream& os, const string& baseFileName, const vector<pair<string, string> >& rgOutput) const
+{
+    TiXmlDocument doc;
+    doc.LinkEndChild(new TiXmlDeclaration("1.0", "", "no"));
+    doc.LinkEndChild(new TiXmlComment(" Index of a parameter sweep of the DCT growth modeling"));
+
+    TiXmlElement* pIndex = new TiXmlElement("SweepIndex");
+    pIndex->SetAttribute("base", baseFileName);
+    pIndex->SetAttribute("sweep", m_fileName);
+    pIndex->SetAttribute("runs", m_cRuns);
+    pIndex->SetAttribute("failed", getFailed());
+    doc.LinkEndChild(pIndex);
+
+    for (int a = 0; a < static_cast<int>(m_rgAxis.size()); a++)
+    {
+        TiXmlElement* pAxis = new TiXmlElement("Axis");
+        pAxis->SetAttribute("element", m_rgAxis[a].element);
+        pAxis->SetAttribute("attribute", m_rgAxis[a].attribute);
+        pIndex->LinkEndChild(pAxis);
+    }
+    for (int run = 0; run < m_cRuns; run++)
+    {
+        stringstream seconds;
+        seconds << m_rgSeconds[run];
+
+        TiXmlElement* pRun = new TiXmlElement("Run");
+        pRun->SetAttribute("index", run);
+        pRun->SetAttribute("status", m_rgStatus[run]);
+        pRun->SetAttribute("seconds", seconds.str());
+        for (size_t i = 0; i < rgOutput.size(); i++)
+        {
+            pRun->SetAttribute(rgOutput[i].first, runFileName(rgOutput[i].second, run));
+        }
+        for (int a = 0; a < static_cast<int>(m_rgAxis.size()); a++)
+        {
+            TiXmlElement* pValue = new TiXmlElement("Value");
+            pValue->SetAttribute("element", m_rgAxis[a].element);
+            pValue->SetAttribute("attribute", m_rgAxis[a].attribute);
+            pValue->SetAttribute("value", value(run, a));
+            pRun->LinkEndChild(pValue);
+        }
+        pIndex->LinkEndChild(pRun);
+    }
+
+    // the attribute values are escaped by TinyXML (file names may contain quotes or ampersands)
+    TiXmlPrinter printer;
+    printer.SetIndent("   ");
+    doc.Accept(&printer);
+    os << printer.Str();
+}
+
+/**
+ * The name of an output file of a run: the name of the file of a simulation that is not part
+ * of a sweep, with .s and the run before its extension (out.xml becomes out.s3.xml).
+ * @param[in] fileName	The name of the file.
+ * @param[in] run	The run.
+ * @return the name of the file of the run.
+ */
+string Sweep::runFileName(const string& fileName, int run)
+{
+    stringstream ss;
+    ss << ".s" << run;
+    return ChildProcesses::tagFileName(fileName, ss.str());
+}
+
+/**
+ * The name of the index file of a sweep (out.xml becomes out.sweep.xml).
+ * @param[in] fileName	The name of the state output file of a simulation that is not part of a sweep.
+ * @return the name of the index file.
+ */
+string Sweep::indexFileName(const string& fileName)
+{
+    return ChildProcesses::tagFileName(fileName, ".sweep");
+}
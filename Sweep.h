@@ -0,0 +1,121 @@
+/**
+ *	@file Sweep.h
+ *
+ *	@brief Header file for Sweep.
+ */
+//! Runs a parameter sweep of a base configuration as child processes.
+
+/**
+ ** \class Sweep Sweep.h "Sweep.h"
+ **
+ ** \latexonly	\subsubsection*{Implementation} \endlatexonly
+ ** \htmlonly	<h3>Implementation</h3> \endhtmlonly
+ **
+ ** A sweep runs a base configuration (a SimParams file) with some of its parameters changed.
+ ** The sweep specification lists the parameters that are swept, each as an axis with the
+ ** element and the attribute it sets in the SimParams and the values it takes:
+ **
+ **     <Sweep>
+ **         <Axis element="GrowthParams" attribute="epsilon" values="0.55 0.6 0.65"/>
+ **         <Axis element="Inoise" attribute="max" values="1.5e-10 2e-10"/>
+ **     </Sweep>
+ **
+ ** and the sweep runs every combination of the values of the axes; the values of the last
+ ** axis change fastest from one run to the next.  apply() sets the parameters of a run in a
+ ** copy of the base SimParams.
+ **
+ ** The driver reads the base configuration and the specification once, checks the parameters
+ ** of every run, and computes what the runs share, such as the distances between the neurons
+ ** of each size of network, before forkRuns() starts a child process for each run.  A child
+ ** starts with a copy-on-write image of its parent, so it neither reads the files again nor
+ ** recomputes what was shared.  forkRuns() keeps as many runs going as it is given jobs (see
+ ** ChildProcesses), and starts the runs that are estimated to take longest first, so that the
+ ** short runs fill the cores at the end of the sweep.  Each run writes its output to files named by runFileName(),
+ ** and writeIndex() writes the parameters, the output files, the outcome and the time of every
+ ** run to an index file.
+ **
+ ** Sweeps need fork(), so they are not available on Windows.
+ **
+ ** \latexonly	\subsubsection*{Credits} \endlatexonly
+ ** \htmlonly	<h3>Credits</h3> \endhtmlonly
+ **
+ ** This simulator is a rewrite of CSIM (2006) and other work (Stiber and Kawasaki (2007?))
+ **/
+
+#pragma once
+
+#ifndef _SWEEP_H_
+#define _SWEEP_H_
+
+#include "global.h"
+#include "tinyxml/tinyxml.h"
+#include "Matrix/KIIexceptions.h"
+#include "ChildProcesses.h"
+
+class Sweep : private IJobListener
+{
+public:
+    //! The constructor for Sweep.
+    Sweep();
+
+    //! Read a sweep specification.
+    void load(const string& fileName);
+
+    //! Number of runs of the sweep.
+    int getRuns() const { return m_cRuns; }
+
+    //! Number of runs that did not finish successfully.
+    int getFailed() const;
+
+    //! Set the parameters of a run in a copy of the base SimParams.
+    void apply(int run, TiXmlElement* pParams) const;
+
+    //! Run each run in a child process; returns the run in a child, -1 in the parent once all are done.
+    int forkRuns(const vector<double>& rgCost, int cJobs);
+
+    //! Write the index of the runs and their output files.
+    void writeIndex(ostream& os, const string& baseFileName, const vector<pair<string, string> >& rgOutput) const;
+
+    //! The name of an output file of a run.
+    static string runFileName(const string& fileName, int run);
+
+    //! The name of the index file of a sweep.
+    static string indexFileName(const string& fileName);
+
+private:
+    //! A swept parameter.
+    struct Axis
+    {
+        //! The element of the SimParams that holds the parameter.
+        string element;
+
+        //! The attribute of the element that is the parameter.
+        string attribute;
+
+        //! The values of the parameter.
+        vector<string> values;
+    };
+
+    //! The value of an axis in a run.
+    const string& value(int run, int axis) const;
+
+    //! Keep the outcome and the time of a run as its child process exits.
+    virtual void finished(int run, int status, double seconds);
+
+    //! The sweep specification file.
+    string m_fileName;
+
+    //! The swept parameters.
+    vector<Axis> m_rgAxis;
+
+    //! Number of runs.
+    int m_cRuns;
+
+    //! The exit status of each run; -1 if it has not finished.
+    vector<int> m_rgStatus;
+
+    //! The time each run took, in seconds.
+    vector<double> m_rgSeconds;
+};
+
+#endif // _SWEEP_H_
@@ -0,0 +1,269 @@
+/**
+ *	\file BlockCodec.cpp
+ *
+ *	\brief Lightweight compression of blocks of binary output.
+ */
+#include "BlockCodec.h"
+#include <algorithm>
+#include <cstring>
+
+//! Number of bits of the hash of the LZ77 match finder.
+#define BLOCK_HASH_BITS 14
+
+//! Largest distance of a match (bytes).
+#define BLOCK_MAX_DISTANCE 65535
+
+/**
+ * Hash of the 4 bytes at a position, for the match finder.
+ * @param[in] p	The bytes.
+ * @return the hash, below 1 << BLOCK_HASH_BITS.
+ */
+static inline uint32_t hashBytes(const unsigned char* p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return (value * 2654435761U) >> (32 - BLOCK_HASH_BITS);
+}
+
+/**
+ * Append a length that did not fit into its 4 bits of the token.
+ * @param[in,out] packed	The buffer.
+ * @param[in] length	The length minus 15.
+ */
+static void putLength(std::vector<char>& packed, size_t length)
+{
+    while (length >= 255)
+    {
+        packed.push_back(static_cast<char>(255));
+        length -= 255;
+    }
+    packed.push_back(static_cast<char>(length));
+}
+
+/**
+ * Append a sequence: literals, followed by a match unless matchLength is 0.
+ * @param[in,out] packed	The buffer.
+ * @param[in] pLiterals	The literals.
+ * @param[in] cLiterals	Number of literals.
+ * @param[in] distance	Distance of the match.
+ * @param[in] matchLength	Length of the match; 0 for the last sequence.
+ */
+static void putSequence(std::vector<char>& packed, const unsigned char* pLiterals, size_t cLiterals,
+        size_t distance, size_t matchLength)
+{
+    size_t matchCode = matchLength == 0 ? 0 : matchLength - BLOCK_MIN_MATCH;
+
+    packed.push_back(static_cast<char>((std::min<size_t>(cLiterals, 15) << 4) | std::min<size_t>(matchCode, 15)));
+    if (cLiterals >= 15)
+    {
+        putLength(packed, cLiterals - 15);
+    }
+    packed.insert(packed.end(), pLiterals, pLiterals + cLiterals);
+
+    if (matchLength != 0)
+    {
+        packed.push_back(static_cast<char>(distance & 0xff));
+        packed.push_back(static_cast<char>(distance >> 8));
+        if (matchCode >= 15)
+        {
+            putLength(packed, matchCode - 15);
+        }
+    }
+}
+
+/**
+ * Read a length that did not fit into its 4 bits of the token.
+ * @param[in,out] p	The packed bytes; advanced past the length.
+ * @param[in] pEnd	End of the packed bytes.
+ * @param[out] length	Receives the length minus 15.
+ * @return false if the packed bytes end within the length.
+ */
+static bool getLength(const unsigned char*& p, const unsigned char* pEnd, size_t& length)
+{
+    length = 0;
+    for (;;)
+    {
+        if (p == pEnd)
+            return false;
+        unsigned char b = *p++;
+        length += b;
+        if (b != 255)
+            return true;
+    }
+}
+
+/**
+ * Compress bytes with LZ77.
+ * @param[in] pData	The bytes.
+ * @param[in] cBytes	Number of bytes.
+ * @param[in,out] packed	Receives the compressed bytes, appended.
+ */
+static void compress(const unsigned char* pData, size_t cBytes, std::vector<char>& packed)
+{
+    // position + 1 of the last occurrence of each hash, 0 if none
+    std::vector<size_t> rgLast(static_cast<size_t>(1) << BLOCK_HASH_BITS, 0);
+    size_t anchor = 0;
+    size_t i = 0;
+
+    while (i + BLOCK_MIN_MATCH <= cBytes)
+    {
+        uint32_t hash = hashBytes(pData + i);
+        size_t candidate = rgLast[hash];
+        rgLast[hash] = i + 1;
+
+        if (candidate != 0 && i - (candidate - 1) <= BLOCK_MAX_DISTANCE
+                && memcmp(pData + candidate - 1, pData + i, BLOCK_MIN_MATCH) == 0)
+        {
+            size_t ref = candidate - 1;
+            size_t length = BLOCK_MIN_MATCH;
+            while (i + length < cBytes && pData[ref + length] == pData[i + length])
+            {
+                length++;
+            }
+
+            putSequence(packed, pData + anchor, i - anchor, i - ref, length);
+            i += length;
+            anchor = i;
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    putSequence(packed, pData + anchor, cBytes - anchor, 0, 0);
+}
+
+/**
+ * Decompress bytes compressed by compress().
+ * @param[in] p	The compressed bytes.
+ * @param[in] pEnd	End of the compressed bytes.
+ * @param[out] pData	Receives the bytes.
+ * @param[in] cBytes	Number of bytes.
+ * @return false if the compressed bytes do not decompress to exactly cBytes bytes.
+ */
+static bool decompress(const unsigned char* p, const unsigned char* pEnd, unsigned char* pData, size_t cBytes)
+{
+    size_t out = 0;
+
+    while (p != pEnd)
+    {
+        unsigned char token = *p++;
+        size_t cLiterals = token >> 4;
+        size_t extra;
+        if (cLiterals == 15)
+        {
+            if (!getLength(p, pEnd, extra))
+                return false;
+            cLiterals += extra;
+        }
+        if (static_cast<size_t>(pEnd - p) < cLiterals || cBytes - out < cLiterals)
+            return false;
+        memcpy(pData + out, p, cLiterals);
+        p += cLiterals;
+        out += cLiterals;
+
+        // the last sequence has no match
+        if (p == pEnd)
+            break;
+
+        if (pEnd - p < 2)
+            return false;
+        size_t distance = p[0] | (static_cast<size_t>(p[1]) << 8);
+        p += 2;
+        size_t length = (token & 0x0f) + BLOCK_MIN_MATCH;
+        if ((token & 0x0f) == 15)
+        {
+            if (!getLength(p, pEnd, extra))
+                return false;
+            length += extra;
+        }
+        if (distance == 0 || distance > out || cBytes - out < length)
+            return false;
+
+        // byte by byte, since a match may overlap the bytes it produces
+        const unsigned char* pRef = pData + out - distance;
+        for (size_t k = 0; k < length; k++)
+        {
+            pData[out + k] = pRef[k];
+        }
+        out += length;
+    }
+
+    return out == cBytes;
+}
+
+/**
+ * Pack a block of values.  The packed block may be larger than the values if they do not
+ * compress; the caller then keeps the values as they are.
+ * @param[in] pData	The values.
+ * @param[in] cBytes	Number of bytes of the values.
+ * @param[in] cValueBytes	Size of a value (bytes); the bytes are shuffled and filtered if it is more than 1.
+ * @param[in,out] packed	Receives the packed block, appended.
+ */
+void packBlock(const void* pData, size_t cBytes, size_t cValueBytes, std::vector<char>& packed)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(pData);
+
+    if (cValueBytes <= 1 || cBytes < cValueBytes)
+    {
+        compress(p, cBytes, packed);
+        return;
+    }
+
+    size_t cValues = cBytes / cValueBytes;
+    std::vector<unsigned char> filtered(cBytes);
+    for (size_t k = 0; k < cValueBytes; k++)
+    {
+        unsigned char* pPlane = &filtered[k * cValues];
+        unsigned char prev = 0;
+        for (size_t i = 0; i < cValues; i++)
+        {
+            unsigned char b = p[i * cValueBytes + k];
+            pPlane[i] = static_cast<unsigned char>(b - prev);
+            prev = b;
+        }
+    }
+    memcpy(&filtered[0] + cValues * cValueBytes, p + cValues * cValueBytes, cBytes - cValues * cValueBytes);
+
+    compress(&filtered[0], cBytes, packed);
+}
+
+/**
+ * Unpack a block of values.
+ * @param[in] pPacked	The packed block.
+ * @param[in] cPackedBytes	Size of the packed block (bytes).
+ * @param[in] cValueBytes	Size of a value (bytes), as passed to packBlock().
+ * @param[out] pData	Receives the values.
+ * @param[in] cBytes	Number of bytes of the values.
+ * @return false if the packed block is corrupt.
+ */
+bool unpackBlock(const void* pPacked, size_t cPackedBytes, size_t cValueBytes, void* pData, size_t cBytes)
+{
+    const unsigned char* pIn = static_cast<const unsigned char*>(pPacked);
+    unsigned char* p = static_cast<unsigned char*>(pData);
+
+    if (cValueBytes <= 1 || cBytes < cValueBytes)
+    {
+        return decompress(pIn, pIn + cPackedBytes, p, cBytes);
+    }
+
+    std::vector<unsigned char> filtered(cBytes);
+    if (!decompress(pIn, pIn + cPackedBytes, &filtered[0], cBytes))
+        return false;
+
+    size_t cValues = cBytes / cValueBytes;
+    for (size_t k = 0; k < cValueBytes; k++)
+    {
+        const unsigned char* pPlane = &filtered[k * cValues];
+        unsigned char prev = 0;
+        for (size_t i = 0; i < cValues; i++)
+        {
+            prev = static_cast<unsigned char>(prev + pPlane[i]);
+            p[i * cValueBytes + k] = prev;
+        }
+    }
+    memcpy(p + cValues * cValueBytes, &filtered[0] + cValues * cValueBytes, cBytes - cValues * cValueBytes);
+
+    return true;
+}
@@ -0,0 +1,52 @@
+/**
+ *	@file BlockCodec.h
+ *
+ *	@brief Header file for packBlock() and unpackBlock().
+ */
+//! Lightweight compression of blocks of binary output.
+
+/**
+ ** A block of values is packed in two stages.  If its values are wider than a byte, the bytes
+ ** are first shuffled into planes (all first bytes of the values, then all second bytes, ...)
+ ** and each byte of a plane is replaced by its difference to the byte before it (modulo 256),
+ ** so values that are constant or vary slowly, such as the parameters of neurons of one type or
+ ** a counter, become runs of equal bytes.  The bytes left over after the last whole value are
+ ** not filtered.  The result is then compressed with LZ77: a sequence of
+ **	- a token: the number of literals in the high 4 bits, the length of the match minus
+ **	  BLOCK_MIN_MATCH in the low 4 bits; 15 means that bytes of 255 follow, and a last byte
+ **	  below 255, which are added to it
+ **	- the literals
+ **	- the distance of the match back from the current position, uint16_t in little-endian
+ **	  byte order, and the bytes of the length of the match
+ **
+ ** ending with a token, the literals and no match.  Packing needs no tables shared between
+ ** blocks, so the blocks of a file can be packed and unpacked in any order, by any thread.
+ **
+ ** \latexonly	\subsubsection*{Credits} \endlatexonly
+ ** \htmlonly	<h3>Credits</h3> \endhtmlonly
+ **
+ ** This simulator is a rewrite of CSIM (2006) and other work (Stiber and Kawasaki (2007?))
+ **/
+
+#pragma once
+
+#ifndef _BLOCKCODEC_H_
+#define _BLOCKCODEC_H_
+
+#include <cstddef>
+#include <vector>
+#ifndef _WIN32
+#include <inttypes.h>
+#endif
+#include "bgtypes.h"
+
+//! Length of the shortest match of the LZ77 stage (bytes).
+#define BLOCK_MIN_MATCH 4
+
+//! Pack a block of values, appending the packed bytes to a buffer.
+void packBlock(const void* pData, size_t cBytes, size_t cValueBytes, std::vector<char>& packed);
+
+//! Unpack a block packed by packBlock(); false if the packed bytes are not a block of that size.
+bool unpackBlock(const void* pPacked, size_t cPackedBytes, size_t cValueBytes, void* pData, size_t cBytes);
+
+#endif // _BLOCKCODEC_H_
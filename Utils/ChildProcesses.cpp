@@ -0,0 +1,113 @@
+/**
+ *	\file ChildProcesses.cpp
+ *
+ *	\brief Runs jobs in child processes started with fork(), a number of them at a time.
+ */
+#include "ChildProcesses.h"
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <map>
+#ifndef _WIN32
+#include <cerrno>
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+
+using namespace std;
+
+/**
+ * Start a child process for each job, in the order of the jobs, keeping cJobs of them going at
+ * a time, and wait for them.  The children return from this function and perform their job;
+ * the parent returns once all of them have exited.  A job whose child could not be started, or
+ * could not be waited for, is reported as not run.
+ * @param[in] rgJob	The jobs, in the order they are started.
+ * @param[in] cJobs	Number of jobs to keep going at a time.
+ * @param[in] listener	Receives the outcome and the time of each job, in the parent.
+ * @return the job to perform, in a child; -1 in the parent.
+ */
+int ChildProcesses::run(const vector<int>& rgJob, int cJobs, IJobListener& listener)
+{
+#ifdef _WIN32
+    for (size_t i = 0; i < rgJob.size(); i++)
+    {
+        listener.finished(rgJob[i], -1, 0);
+    }
+    return -1;
+#else
+    // output still buffered would be written again by each child
+    cout.flush();
+    cerr.flush();
+    fflush(NULL);
+
+    map<pid_t, int> running;
+    map<pid_t, time_t> started;
+    size_t next = 0;
+    while (next < rgJob.size() || !running.empty())
+    {
+        if (next < rgJob.size() && static_cast<int>(running.size()) < cJobs)
+        {
+            int job = rgJob[next++];
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                return job;
+            }
+            if (pid < 0)
+            {
+                listener.finished(job, -1, 0);
+            }
+            else
+            {
+                running[pid] = job;
+                started[pid] = time(NULL);
+            }
+            continue;
+        }
+
+        int status;
+        pid_t pid = wait(&status);
+        if (pid < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            for (map<pid_t, int>::iterator it = running.begin(); it != running.end(); ++it)
+            {
+                listener.finished(it->second, -1, 0);
+            }
+            break;
+        }
+
+        map<pid_t, int>::iterator it = running.find(pid);
+        if (it == running.end())
+        {
+            continue;
+        }
+        listener.finished(it->second, WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status),
+                difftime(time(NULL), started[pid]));
+        running.erase(it);
+        started.erase(pid);
+    }
+    return -1;
+#endif
+}
+
+/**
+ * The name of a file with a tag before its extension (out.xml becomes out.tag.xml); a file
+ * without an extension gets the tag at its end.
+ * @param[in] fileName	The name of the file.
+ * @param[in] tag	The tag, with its leading dot.
+ * @return the name of the file with the tag.
+ */
+string ChildProcesses::tagFileName(const string& fileName, const string& tag)
+{
+    size_t dot = fileName.rfind('.');
+    size_t slash = fileName.find_last_of("/\\");
+    if (dot == string::npos || dot == 0 || (slash != string::npos && dot < slash + 2))
+    {
+        return fileName + tag;
+    }
+    return fileName.substr(0, dot) + tag + fileName.substr(dot);
+}
@@ -0,0 +1,59 @@
+/**
+ *	@file ChildProcesses.h
+ *
+ *	@brief Header file for ChildProcesses.
+ */
+//! Runs jobs in child processes started with fork(), a number of them at a time.
+
+/**
+ ** \class ChildProcesses ChildProcesses.h "ChildProcesses.h"
+ **
+ ** \latexonly	\subsubsection*{Implementation} \endlatexonly
+ ** \htmlonly	<h3>Implementation</h3> \endhtmlonly
+ **
+ ** run() starts a child process for each job, in the order of the jobs, keeps as many of them
+ ** going as it is given, and waits for them.  The children return from run() with their job;
+ ** the parent returns once all of them have exited, and reports the outcome and the time of
+ ** each job to an IJobListener as its child exits.  Output still buffered when run() is
+ ** called is flushed first, so that the children do not write it again.
+ **
+ ** The jobs write their output to files named by tagFileName(), e.g. the replicas of an
+ ** Ensemble and the runs of a Sweep.
+ **
+ ** Child processes need fork(), so they are not available on Windows.
+ **
+ ** \latexonly	\subsubsection*{Credits} \endlatexonly
+ ** \htmlonly	<h3>Credits</h3> \endhtmlonly
+ **
+ ** This simulator is a rewrite of CSIM (2006) and other work (Stiber and Kawasaki (2007?))
+ **/
+
+#pragma once
+
+#ifndef _CHILDPROCESSES_H_
+#define _CHILDPROCESSES_H_
+
+#include <string>
+#include <vector>
+
+//! Interface of the receivers of the outcomes of the jobs of ChildProcesses::run().
+class IJobListener
+{
+public:
+    virtual ~IJobListener() {}
+
+    //! A job has finished: status is its exit status, 128 + the signal that ended it, or -1 if it did not run.
+    virtual void finished(int job, int status, double seconds) = 0;
+};
+
+class ChildProcesses
+{
+public:
+    //! Run each job in a child process; returns the job in a child, -1 in the parent once all are done.
+    static int run(const std::vector<int>& rgJob, int cJobs, IJobListener& listener);
+
+    //! The name of a file with a tag before its extension.
+    static std::string tagFileName(const std::string& fileName, const std::string& tag);
+};
+
+#endif // _CHILDPROCESSES_H_
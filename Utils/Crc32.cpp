@@ -0,0 +1,43 @@
+/**
+ *	\file Crc32.cpp
+ *
+ *	\brief CRC-32 checksums of binary output blocks.
+ */
+#include "Crc32.h"
+
+//! Table of the CRC of each byte value, built before main() runs so that
+//! threads can share it without locking.
+static struct Crc32Table
+{
+    uint32_t rgCrc[256];
+
+    Crc32Table()
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+            {
+                c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+            }
+            rgCrc[i] = c;
+        }
+    }
+} s_table;
+
+/**
+ * @param[in] pData	The data.
+ * @param[in] cBytes	Number of bytes of data.
+ * @param[in] crc	The checksum of the preceding data, or 0.
+ * @return the checksum of the preceding data and this block.
+ */
+uint32_t crc32(const void* pData, size_t cBytes, uint32_t crc)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(pData);
+    crc = ~crc;
+    for (size_t i = 0; i < cBytes; i++)
+    {
+        crc = s_table.rgCrc[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
@@ -0,0 +1,33 @@
+/**
+ *	@file Crc32.h
+ *
+ *	@brief Header file for crc32().
+ */
+//! CRC-32 checksums of binary output blocks.
+
+/**
+ ** The CRC-32 of IEEE 802.3 (as used by zlib and PNG): polynomial 0x04C11DB7, reflected, with
+ ** the initial value and the result inverted.  A checksum can be computed over several pieces
+ ** of data by passing the checksum of the previous pieces as the initial value.
+ **
+ ** \latexonly	\subsubsection*{Credits} \endlatexonly
+ ** \htmlonly	<h3>Credits</h3> \endhtmlonly
+ **
+ ** This simulator is a rewrite of CSIM (2006) and other work (Stiber and Kawasaki (2007?))
+ **/
+
+#pragma once
+
+#ifndef _CRC32_H_
+#define _CRC32_H_
+
+#include <cstddef>
+#ifndef _WIN32
+#include <inttypes.h>
+#endif
+#include "bgtypes.h"
+
+//! Compute the CRC-32 of a block of data, continuing the checksum crc.
+uint32_t crc32(const void* pData, size_t cBytes, uint32_t crc = 0);
+
+#endif // _CRC32_H_
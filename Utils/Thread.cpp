@@ -0,0 +1,174 @@
+/**
+ *	\file Thread.cpp
+ *
+ *	\brief Minimal portable threads for work that overlaps the simulation (e.g. output).
+ */
+#include "Thread.h"
+#include <cassert>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+Mutex::Mutex()
+{
+#ifdef _WIN32
+    InitializeCriticalSection(&m_cs);
+#else
+    pthread_mutex_init(&m_mutex, NULL);
+#endif
+}
+
+Mutex::~Mutex()
+{
+#ifdef _WIN32
+    DeleteCriticalSection(&m_cs);
+#else
+    pthread_mutex_destroy(&m_mutex);
+#endif
+}
+
+void Mutex::lock()
+{
+#ifdef _WIN32
+    EnterCriticalSection(&m_cs);
+#else
+    pthread_mutex_lock(&m_mutex);
+#endif
+}
+
+void Mutex::unlock()
+{
+#ifdef _WIN32
+    LeaveCriticalSection(&m_cs);
+#else
+    pthread_mutex_unlock(&m_mutex);
+#endif
+}
+
+Condition::Condition()
+{
+#ifdef _WIN32
+    InitializeConditionVariable(&m_cv);
+#else
+    pthread_cond_init(&m_cond, NULL);
+#endif
+}
+
+Condition::~Condition()
+{
+#ifndef _WIN32
+    pthread_cond_destroy(&m_cond);
+#endif
+}
+
+/**
+ * Wait until the condition is signaled.  Callers must check what they wait for
+ * in a loop, as the wait may also end spuriously.
+ * @param[in] mutex	The mutex that protects what is waited for; locked by the caller.
+ */
+void Condition::wait(Mutex& mutex)
+{
+#ifdef _WIN32
+    SleepConditionVariableCS(&m_cv, &mutex.m_cs, INFINITE);
+#else
+    pthread_cond_wait(&m_cond, &mutex.m_mutex);
+#endif
+}
+
+void Condition::broadcast()
+{
+#ifdef _WIN32
+    WakeAllConditionVariable(&m_cv);
+#else
+    pthread_cond_broadcast(&m_cond);
+#endif
+}
+
+Thread::Thread() :
+    m_pfn(NULL),
+    m_arg(NULL),
+    m_fRunning(false)
+{
+}
+
+/**
+ * A thread must be joined before it is destroyed.
+ */
+Thread::~Thread()
+{
+    assert(!m_fRunning);
+}
+
+/**
+ * Run a function in a new thread.
+ * @param[in] pfn	The function.
+ * @param[in] arg	The argument of the function.
+ * @return true if the thread was created.
+ */
+bool Thread::start(void (*pfn)(void*), void* arg)
+{
+    assert(!m_fRunning);
+
+    m_pfn = pfn;
+    m_arg = arg;
+#ifdef _WIN32
+    m_hThread = CreateThread(NULL, 0, run, this, 0, NULL);
+    m_fRunning = (m_hThread != NULL);
+#else
+    m_fRunning = (pthread_create(&m_thread, NULL, run, this) == 0);
+#endif
+    return m_fRunning;
+}
+
+/**
+ * Wait until the thread has finished.
+ */
+void Thread::join()
+{
+    if (!m_fRunning)
+        return;
+
+#ifdef _WIN32
+    WaitForSingleObject(m_hThread, INFINITE);
+    CloseHandle(m_hThread);
+#else
+    pthread_join(m_thread, NULL);
+#endif
+    m_fRunning = false;
+}
+
+bool Thread::running() const
+{
+    return m_fRunning;
+}
+
+/**
+ * @return the number of online processors, at least 1.
+ */
+int Thread::hardwareConcurrency()
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    int cProcessors = info.dwNumberOfProcessors;
+#else
+    int cProcessors = static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN));
+#endif
+    return cProcessors > 0 ? cProcessors : 1;
+}
+
+#ifdef _WIN32
+DWORD WINAPI Thread::run(LPVOID p)
+{
+    Thread* pThread = static_cast<Thread*>(p);
+    pThread->m_pfn(pThread->m_arg);
+    return 0;
+}
+#else
+void* Thread::run(void* p)
+{
+    Thread* pThread = static_cast<Thread*>(p);
+    pThread->m_pfn(pThread->m_arg);
+    return NULL;
+}
+#endif
@@ -0,0 +1,134 @@
+/**
+ *	@file Thread.h
+ *
+ *	@brief Header file for Thread, Mutex and Condition.
+ */
+//! Minimal portable threads for work that overlaps the simulation (e.g. output).
+
+/**
+ ** \class Thread Thread.h "Thread.h"
+ **
+ ** \latexonly	\subsubsection*{Implementation} \endlatexonly
+ ** \htmlonly	<h3>Implementation</h3> \endhtmlonly
+ **
+ ** Thin wrappers of the Win32 and the POSIX thread APIs.  A Thread runs a function with
+ ** one argument until it returns; join() waits for it.  A Mutex is locked for the lifetime
+ ** of a Mutex::Lock, and a Condition lets a thread wait, with a locked Mutex, until it is
+ ** signaled.
+ **
+ ** \latexonly	\subsubsection*{Credits} \endlatexonly
+ ** \htmlonly	<h3>Credits</h3> \endhtmlonly
+ **
+ ** This simulator is a rewrite of CSIM (2006) and other work (Stiber and Kawasaki (2007?))
+ **/
+
+#pragma once
+
+#ifndef _THREAD_H_
+#define _THREAD_H_
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+class Condition;
+
+class Mutex
+{
+public:
+    Mutex();
+    ~Mutex();
+
+    void lock();
+    void unlock();
+
+    //! Locks a Mutex for the lifetime of the Lock.
+    class Lock
+    {
+    public:
+        Lock(Mutex& mutex) : m_mutex(mutex) { m_mutex.lock(); }
+        ~Lock() { m_mutex.unlock(); }
+
+    private:
+        Mutex& m_mutex;
+
+        Lock(const Lock&);
+        Lock& operator=(const Lock&);
+    };
+
+private:
+    friend class Condition;
+
+#ifdef _WIN32
+    CRITICAL_SECTION m_cs;
+#else
+    pthread_mutex_t m_mutex;
+#endif
+
+    Mutex(const Mutex&);
+    Mutex& operator=(const Mutex&);
+};
+
+class Condition
+{
+public:
+    Condition();
+    ~Condition();
+
+    //! Wait until signaled; the mutex must be locked by the caller.
+    void wait(Mutex& mutex);
+
+    //! Wake up all waiting threads.
+    void broadcast();
+
+private:
+#ifdef _WIN32
+    CONDITION_VARIABLE m_cv;
+#else
+    pthread_cond_t m_cond;
+#endif
+
+    Condition(const Condition&);
+    Condition& operator=(const Condition&);
+};
+
+class Thread
+{
+public:
+    Thread();
+    ~Thread();
+
+    //! Run a function in a new thread.
+    bool start(void (*pfn)(void*), void* arg);
+
+    //! Wait until the thread has finished.
+    void join();
+
+    //! True if the thread has been started and not yet joined.
+    bool running() const;
+
+    //! Number of processors available to run threads.
+    static int hardwareConcurrency();
+
+private:
+#ifdef _WIN32
+    static DWORD WINAPI run(LPVOID p);
+    HANDLE m_hThread;
+#else
+    static void* run(void* p);
+    pthread_t m_thread;
+#endif
+
+    //! The function and the argument of the thread.
+    void (*m_pfn)(void*);
+    void* m_arg;
+
+    bool m_fRunning;
+
+    Thread(const Thread&);
+    Thread& operator=(const Thread&);
+};
+
+#endif // _THREAD_H_
@@ -40,20 +40,6 @@ string neuronTypeToString(neuronType t) {
 	}
 }
 
-#if defined(USE_GPU)
-//! CUDA device ID
-int g_deviceId = 0;
-#endif // USE_GPU
-
-//! A random number generator.
-RNG rng(1);
-
-//! A normalized random number generator.
-vector<Norm *> rgNormrnd;
-
-/*		simulation vars		*/
-uint64_t g_simulationStep = 0;
-
 const FLOAT g_synapseStrengthAdjustmentConstant = 1.0e-8;
 
 /*		Neuron constants	*/
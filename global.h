@@ -55,25 +55,11 @@ using namespace std;
 #   define DEBUG2(x)
 #endif
 
-#if defined(USE_GPU)
-//! CUDA device ID
-extern int g_deviceId;
-#endif // USE_GPU
-
 extern const FLOAT g_synapseStrengthAdjustmentConstant;
 
 //! The constant PI.
 extern const FLOAT pi;
 
-//! A random number generator.
-extern RNG rng;
-
-//! A normalized random number generator.
-extern vector<Norm *> rgNormrnd;
-
-//! The current simulation step.
-extern uint64_t g_simulationStep;
-
 //! Neuron types.
 //!	INH - Inhibitory neuron 
 //!	EXC - Excitory neuron
@@ -88,6 +74,12 @@ const int g_nMaxChunkSize = 100;
 //!	EE - Synapse from excitory neuron to excitory neuron.
 enum synapseType { II = 0, IE = 1, EI = 2, EE = 3, STYPE_UNDEF = -1 };
 
+//! Orders in which neurons, their synapses and summation points are stored.
+//!	ROW_MAJOR - Index x + y * width, the order of all inputs and outputs.
+//!	MORTON - Along a Z-order curve over the grid.
+//!	HILBERT - Along a Hilbert curve over the grid.
+enum neuronOrder { ROW_MAJOR = 0, MORTON = 1, HILBERT = 2 };
+
 //! The default membrane capacitance.
 extern const FLOAT DEFAULT_Cm;
 //! The default membrane resistance.